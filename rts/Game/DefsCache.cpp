@@ -0,0 +1,181 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "DefsCache.h"
+#include "GameSetup.h"
+#include "GameVersion.h"
+#include "Lua/LuaParser.h"
+#include "System/CRC.h"
+#include "System/Config/ConfigHandler.h"
+#include "System/FileSystem/ArchiveScanner.h"
+#include "System/FileSystem/DataDirsAccess.h"
+#include "System/FileSystem/FileQueryFlags.h"
+#include "System/FileSystem/FileSystem.h"
+#include "System/Log/ILog.h"
+#include "System/TimeProfiler.h"
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+CONFIG(bool, UseDefsCache).defaultValue(true);
+
+static const std::string DEFS_CACHE_DIR = "cache/defs/";
+
+// bump whenever the layout written by LuaParser::DumpRoot changes
+static const unsigned int DEFS_CACHE_VERSION = 2;
+static const char DEFS_CACHE_MAGIC[4] = {'S', 'D', 'E', 'F'};
+
+
+static void HashString(CRC& crc, const std::string& str)
+{
+	crc.Update(str.c_str(), str.size() + 1);
+}
+
+static void HashOptions(CRC& crc, const std::map<std::string, std::string>& options)
+{
+	std::map<std::string, std::string>::const_iterator it;
+
+	crc << int(options.size());
+
+	for (it = options.begin(); it != options.end(); ++it) {
+		HashString(crc, it->first);
+		HashString(crc, it->second);
+	}
+}
+
+
+
+CDefsCache::CDefsCache(const CGameSetup* setup): cacheKey(0)
+{
+	if (!configHandler->GetBool("UseDefsCache"))
+		return;
+
+	const std::string& modArchive = archiveScanner->ArchiveFromName(setup->modName);
+	const std::string& mapArchive = archiveScanner->ArchiveFromName(setup->mapName);
+
+	CRC crc;
+	crc << DEFS_CACHE_VERSION;
+	HashString(crc, SpringVersion::GetFull());
+	crc << archiveScanner->GetArchiveCompleteChecksum(modArchive);
+	crc << archiveScanner->GetArchiveCompleteChecksum(mapArchive);
+	HashOptions(crc, setup->modOptions);
+	HashOptions(crc, setup->mapOptions);
+
+	char keyString[16] = {0};
+	sprintf(keyString, "%08x", crc.GetDigest());
+
+	cacheKey = crc.GetDigest();
+	cacheFileName = DEFS_CACHE_DIR + "defs." + keyString + ".bin";
+}
+
+
+bool CDefsCache::Exists() const
+{
+	if (cacheFileName.empty())
+		return false;
+
+	return FileSystem::FileExists(dataDirsAccess.LocateFile(cacheFileName));
+}
+
+
+bool CDefsCache::Load(LuaParser* parser) const
+{
+	if (cacheFileName.empty())
+		return false;
+
+	ScopedOnceTimer timer("DefsCache::Load");
+
+	const std::string path = dataDirsAccess.LocateFile(cacheFileName);
+
+	if (!FileSystem::FileExists(path))
+		return false;
+
+	FILE* file = fopen(path.c_str(), "rb");
+
+	if (file == NULL)
+		return false;
+
+	char magic[sizeof(DEFS_CACHE_MAGIC)];
+	unsigned int key = 0;
+	unsigned int size = 0;
+
+	bool ret = true;
+	ret = ret && (fread(magic, sizeof(magic), 1, file) == 1);
+	ret = ret && (fread(&key, sizeof(key), 1, file) == 1);
+	ret = ret && (fread(&size, sizeof(size), 1, file) == 1);
+	ret = ret && (memcmp(magic, DEFS_CACHE_MAGIC, sizeof(magic)) == 0);
+	ret = ret && (key == cacheKey);
+
+	std::string blob;
+
+	if (ret) {
+		blob.resize(size);
+		ret = (size > 0) && (fread(&blob[0], size, 1, file) == 1);
+	}
+
+	fclose(file);
+
+	if (!ret) {
+		LOG_L(L_WARNING, "[DefsCache::%s] ignoring invalid cache-file %s", __FUNCTION__, path.c_str());
+		return false;
+	}
+
+	if (!parser->ExecuteBlob(blob)) {
+		LOG_L(L_WARNING, "[DefsCache::%s] failed to restore definitions from %s", __FUNCTION__, path.c_str());
+		return false;
+	}
+
+	LOG("[DefsCache::%s] loaded definitions from %s (%u bytes)", __FUNCTION__, cacheFileName.c_str(), size);
+	return true;
+}
+
+
+void CDefsCache::Save(const LuaParser* parser) const
+{
+	if (cacheFileName.empty())
+		return;
+
+	ScopedOnceTimer timer("DefsCache::Save");
+
+	std::string blob;
+
+	if (!parser->DumpRoot(blob)) {
+		// e.g. defs.lua returned functions, nothing we can store
+		LOG_L(L_WARNING, "[DefsCache::%s] definitions can not be cached", __FUNCTION__);
+		return;
+	}
+
+	// We need this directory to exist
+	if (!FileSystem::CreateDirectory(DEFS_CACHE_DIR))
+		return;
+
+	const std::string path = dataDirsAccess.LocateFile(cacheFileName, FileQueryFlags::WRITE);
+	const std::string tmpPath = path + ".tmp";
+
+	FILE* file = fopen(tmpPath.c_str(), "wb");
+
+	if (file == NULL)
+		return;
+
+	const unsigned int size = blob.size();
+
+	bool ret = true;
+	ret = ret && (fwrite(DEFS_CACHE_MAGIC, sizeof(DEFS_CACHE_MAGIC), 1, file) == 1);
+	ret = ret && (fwrite(&cacheKey, sizeof(cacheKey), 1, file) == 1);
+	ret = ret && (fwrite(&size, sizeof(size), 1, file) == 1);
+	ret = ret && (fwrite(blob.data(), size, 1, file) == 1);
+	ret = (fclose(file) == 0) && ret;
+
+	// write to a temporary first so concurrent instances never see a partial file
+	// (rename does not replace existing files on every platform, remove it first)
+	if (ret) {
+		remove(path.c_str());
+		ret = (rename(tmpPath.c_str(), path.c_str()) == 0);
+	}
+	if (!ret) {
+		remove(tmpPath.c_str());
+		return;
+	}
+
+	LOG("[DefsCache::%s] stored definitions in %s (%u bytes)", __FUNCTION__, cacheFileName.c_str(), size);
+}
@@ -0,0 +1,38 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef DEFS_CACHE_H
+#define DEFS_CACHE_H
+
+#include <string>
+
+class CGameSetup;
+class LuaParser;
+
+/**
+ * On-disk cache of the table returned by gamedata/defs.lua.
+ *
+ * Entries are keyed on the engine version, the complete checksums of the
+ * mod and map archives and the mod- and map-options, so a hit restores
+ * exactly the tables a full parse would have produced.
+ */
+class CDefsCache
+{
+public:
+	CDefsCache(const CGameSetup* setup);
+
+	/// @return true if there is a cache-file for these defs (Load can still reject it)
+	bool Exists() const;
+	/**
+	 * Fills the parser's root table from the cache.
+	 * @return false on a miss, in which case the parser must Execute()
+	 */
+	bool Load(LuaParser* parser) const;
+	/// Stores the root table of an executed parser
+	void Save(const LuaParser* parser) const;
+
+private:
+	std::string cacheFileName;
+	unsigned int cacheKey;
+};
+
+#endif // DEFS_CACHE_H
@@ -23,6 +23,7 @@
 #include "ClientSetup.h"
 #include "CommandMessage.h"
 #include "ConsoleHistory.h"
+#include "DefsCache.h"
 #include "GameHelper.h"
 #include "GameServer.h"
 #include "GameVersion.h"
@@ -86,10 +87,12 @@
 #include "Lua/LuaUnsyncedCtrl.h"
 #include "Map/BaseGroundDrawer.h"
 #include "Map/MapDamage.h"
+#include "Map/MapDataCache.h"
 #include "Map/MapInfo.h"
 #include "Map/ReadMap.h"
 #include "Sim/Misc/CategoryHandler.h"
 #include "Sim/Misc/DamageArrayHandler.h"
+#include "Sim/Features/FeatureDef.h"
 #include "Sim/Features/FeatureHandler.h"
 #include "Sim/Misc/GeometricObjects.h"
 #include "Sim/Misc/GroundBlockingObjectMap.h"
@@ -99,6 +102,7 @@
 #include "Sim/Misc/RadarHandler.h"
 #include "Sim/Misc/SideParser.h"
 #include "Sim/Misc/SmoothHeightMesh.h"
+#include "Sim/Misc/SyncStateHasher.h"
 #include "Sim/Misc/TeamHandler.h"
 #include "Sim/Misc/Wind.h"
 #include "Sim/Misc/ResourceHandler.h"
@@ -106,11 +110,14 @@
 #include "Sim/MoveTypes/GroundMoveType.h"
 #include "Sim/Path/IPathManager.h"
 #include "Sim/Projectiles/ExplosionGenerator.h"
+#include "Sim/Projectiles/ParticlePool.h"
 #include "Sim/Projectiles/Projectile.h"
 #include "Sim/Projectiles/ProjectileHandler.h"
+#include "Sim/Units/CommandAI/BuilderCAI.h"
 #include "Sim/Units/CommandAI/CommandAI.h"
 #include "Sim/Units/Scripts/CobEngine.h"
 #include "Sim/Units/Scripts/UnitScriptEngine.h"
+#include "Sim/Units/UnitDef.h"
 #include "Sim/Units/UnitDefHandler.h"
 #include "Sim/Units/Groups/GroupHandler.h"
 #include "Sim/Units/UnitLoader.h"
@@ -179,6 +186,12 @@ CONFIG(int, ShowPlayerInfo).defaultValue(1);
 CONFIG(float, GuiOpacity).defaultValue(0.8f);
 CONFIG(std::string, InputTextGeo).defaultValue("");
 CONFIG(bool, LuaModUICtrl).defaultValue(true);
+CONFIG(bool, ArchivePrefetch)
+	.defaultValue(true)
+	.description("Decompress game content on all cores at the start of loading, instead of file by file on first use. Skipped for content the defs and model caches already hold.");
+CONFIG(bool, SyncStateHashes)
+	.defaultValue(true)
+	.description("Send hashes of the synced state (units, features, projectiles, ...) to the server every 10 seconds, so it can tell which part of the simulation desynced.");
 
 
 CGame* game = NULL;
@@ -387,11 +400,13 @@ CGame::~CGame()
 	SafeDelete(cam2);
 	SafeDelete(icon::iconHandler);
 	SafeDelete(geometricObjects);
+	SafeDelete(syncStateHasher);
 	SafeDelete(texturehandler3DO);
 	SafeDelete(texturehandlerS3O);
 
 	SafeDelete(featureHandler); // depends on unitHandler (via ~CFeature)
 	SafeDelete(uh); // CUnitHandler*, depends on modelParser (via ~CUnit)
+	CBuilderCAI::ClearTargetReservations(); // keyed by the ids of the deleted units
 	SafeDelete(ph); // CProjectileHandler*
 
 	SafeDelete(cubeMapHandler);
@@ -460,6 +475,20 @@ void CGame::LoadGame(const std::string& mapName)
 
 void CGame::LoadDefs()
 {
+	const CDefsCache defsCache(gameSetup);
+
+	// with cached defs these are only read piecemeal later, if at all
+	if (configHandler->GetBool("ArchivePrefetch") && !defsCache.Exists()) {
+		ScopedOnceTimer timer("Game::LoadDefs (Prefetch)");
+		loadscreen->SetLoadMessage("Prefetching Game Content");
+
+		// everything the defs parser and the unit scripts are going to read
+		const char* prefetchDirs[] = {"gamedata/", "units/", "weapons/", "features/", "scripts/"};
+		const std::vector<std::string> dirs(prefetchDirs, prefetchDirs + (sizeof(prefetchDirs) / sizeof(prefetchDirs[0])));
+
+		vfsHandler->PrefetchDirs(dirs);
+	}
+
 	{
 		loadscreen->SetLoadMessage("Loading Radar Icons");
 		icon::iconHandler = new icon::CIconHandler();
@@ -470,15 +499,26 @@ void CGame::LoadDefs()
 		loadscreen->SetLoadMessage("Loading GameData Definitions");
 
 		defsParser = new LuaParser("gamedata/defs.lua", SPRING_VFS_MOD_BASE, SPRING_VFS_ZIP);
-		// customize the defs environment
-		defsParser->GetTable("Spring");
-		defsParser->AddFunc("GetModOptions", LuaSyncedRead::GetModOptions);
-		defsParser->AddFunc("GetMapOptions", LuaSyncedRead::GetMapOptions);
-		defsParser->EndTable();
 
-		// run the parser
-		if (!defsParser->Execute()) {
-			throw content_error("Defs-Parser: " + defsParser->GetErrorLog());
+		if (!defsCache.Load(defsParser)) {
+			if (!defsParser->IsValid()) {
+				// a corrupt cache-file leaves the parser unusable
+				delete defsParser;
+				defsParser = new LuaParser("gamedata/defs.lua", SPRING_VFS_MOD_BASE, SPRING_VFS_ZIP);
+			}
+
+			// customize the defs environment
+			defsParser->GetTable("Spring");
+			defsParser->AddFunc("GetModOptions", LuaSyncedRead::GetModOptions);
+			defsParser->AddFunc("GetMapOptions", LuaSyncedRead::GetMapOptions);
+			defsParser->EndTable();
+
+			// run the parser
+			if (!defsParser->Execute()) {
+				throw content_error("Defs-Parser: " + defsParser->GetErrorLog());
+			}
+
+			defsCache.Save(defsParser);
 		}
 		const LuaTable root = defsParser->GetRoot();
 		if (!root.IsValid()) {
@@ -531,6 +571,8 @@ void CGame::LoadSimulation(const std::string& mapName)
 
 	loadscreen->SetLoadMessage("Creating Smooth Height Mesh");
 	smoothGround = new SmoothHeightMesh(ground, float3::maxxpos, float3::maxzpos, SQUARE_SIZE * 2, SQUARE_SIZE * 40);
+	// write what the map and the mesh did not find in the cache
+	readmap->GetMapDataCache()->Save();
 
 	loadscreen->SetLoadMessage("Creating QuadField & CEGs");
 	moveinfo = new CMoveInfo();
@@ -564,6 +606,35 @@ void CGame::LoadSimulation(const std::string& mapName)
 
 	loadscreen->SetLoadMessage("Loading Feature Definitions");
 	featureHandler = new CFeatureHandler();
+
+	{
+		loadscreen->SetLoadMessage("Preloading Models");
+
+		// parse all models the defs refer to up-front on every core;
+		// the defs still load them on demand, but find them ready
+		std::vector<std::string> modelNames;
+
+		for (size_t n = 1; n < unitDefHandler->unitDefs.size(); n++) {
+			modelNames.push_back(unitDefHandler->unitDefs[n]->modelDef.modelPath);
+		}
+
+		const std::map<std::string, const FeatureDef*>& featureDefs = featureHandler->GetFeatureDefs();
+		std::map<std::string, const FeatureDef*>::const_iterator fdi;
+
+		for (fdi = featureDefs.begin(); fdi != featureDefs.end(); ++fdi) {
+			if (fdi->second->drawType == DRAWTYPE_MODEL && !fdi->second->modelname.empty()) {
+				modelNames.push_back(fdi->second->modelname);
+			}
+		}
+
+		if (configHandler->GetBool("ArchivePrefetch") && !modelParser->AllCached(modelNames)) {
+			ScopedOnceTimer timer("Game::LoadSimulation (Prefetch)");
+			vfsHandler->PrefetchDirs(std::vector<std::string>(1, "objects3d/"));
+		}
+
+		modelParser->PreloadModels(modelNames);
+	}
+
 	loadscreen->SetLoadMessage("Initializing Map Features");
 	featureHandler->LoadFeaturesFromMap(saveFile != NULL);
 
@@ -580,6 +651,9 @@ void CGame::LoadSimulation(const std::string& mapName)
 
 	geometricObjects = new CGeometricObjects();
 
+	if (configHandler->GetBool("SyncStateHashes"))
+		syncStateHasher = new CSyncStateHasher();
+
 	inMapDrawerModel = new CInMapDrawModel();
 	inMapDrawer = new CInMapDraw();
 
@@ -1149,7 +1223,7 @@ bool CGame::Draw() {
 		//print some infos (fps,gameframe,particles)
 		glColor4f(1,1,0.5f,0.8f);
 		font->glFormat(0.03f, 0.02f, 1.0f, FONT_SCALE | FONT_NORM, "FPS: %d Frame: %d Particles: %d (%d)",
-		    fps, gs->frameNum, ph->syncedProjectiles.size() + ph->unsyncedProjectiles.size(), ph->currentParticles);
+		    fps, gs->frameNum, ph->syncedProjectiles.size() + ph->unsyncedProjectiles.size() + CParticlePools::GetInstance().GetNumParticles(), ph->currentParticles);
 
 		if (playing) {
 			font->glFormat(0.03f, 0.07f, 0.7f, FONT_SCALE | FONT_NORM, "xpos: %5.0f ypos: %5.0f zpos: %5.0f speed %2.2f",
@@ -1443,6 +1517,9 @@ void CGame::SimFrame() {
 	teamHandler->GameFrame(gs->frameNum);
 	playerHandler->GameFrame(gs->frameNum);
 
+	if (syncStateHasher != NULL && syncStateHasher->Update(gs->frameNum))
+		net->Send(CBaseNetProtocol::Get().SendSyncState(gu->myPlayerNum, syncStateHasher->GetRoundFrame(), syncStateHasher->GetHashes()));
+
 	lastUpdate = SDL_GetTicks();
 
 	DumpState(-1, -1, 1);
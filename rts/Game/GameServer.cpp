@@ -471,6 +471,7 @@ bool CGameServer::SendDemoData(int targetFrameNum)
 			}
 
 			case NETMSG_AICOMMAND:
+			case NETMSG_AICOMMANDS_BATCH:
 			case NETMSG_AISHARE:
 			case NETMSG_COMMAND:
 			case NETMSG_LUAMSG:
@@ -712,6 +713,49 @@ float CGameServer::GetDemoTime() const {
 	return (startTime + serverFrameNum / float(GAME_SPEED));
 }
 
+void CGameServer::CheckSyncState()
+{
+	std::map<int, std::map<int, CSyncStateHashes::Hashes> >::iterator f = syncStateHashes.begin();
+
+	while (f != syncStateHashes.end()) {
+		// wait until every connected player sent its hashes for this round,
+		// or for players which don't send any (SyncStateHashes disabled) until the timeout
+		const int roundEndFrame = f->first + CSyncStateHashes::NUM_FRAMES;
+		bool bComplete = true;
+
+		for (size_t a = 0; a < players.size(); ++a) {
+			if (players[a].link && f->second.find(a) == f->second.end())
+				bComplete = false;
+		}
+		if (!bComplete && serverFrameNum < roundEndFrame + static_cast<int>(SYNCCHECK_TIMEOUT)) {
+			++f;
+			continue;
+		}
+
+		const int refPlayer = (hasLocalClient)? static_cast<int>(localClientNumber): -1;
+		const std::vector< std::vector<int> > desyncs = CSyncStateHashes::FindDesyncs(f->second, refPlayer);
+
+		for (int s = 0; s < CSyncStateHashes::NUM_SUBSYSTEMS; ++s) {
+			std::vector<int> desyncPlayers;
+
+			for (size_t i = 0; i < desyncs[s].size(); ++i) {
+				const int a = desyncs[s][i];
+
+				if (demoReader || !players[a].spectator) {
+					desyncPlayers.push_back(a);
+				} else {
+					PrivateMessage(a, str(format(SyncStateError) %players[a].name %CSyncStateHashes::GetSubsystemName(s) %f->first));
+				}
+			}
+			if (!desyncPlayers.empty())
+				Message(str(format(SyncStateError) %GetPlayerNames(desyncPlayers) %CSyncStateHashes::GetSubsystemName(s) %f->first));
+		}
+
+		syncStateHashes.erase(f++);
+	}
+}
+
+
 void CGameServer::Update()
 {
 	const float tdif = float(spring_tomsecs(spring_gettime() - lastUpdate)) * 0.001f;
@@ -804,6 +848,11 @@ void CGameServer::Update()
 	else if (serverFrameNum > 0 || demoReader)
 		CreateNewFrame(true, false);
 
+	// rounds that are still missing hashes (e.g. from a player who timed out
+	// or has SyncStateHashes disabled) have to be reported without new packets
+	if (gameHasStarted)
+		CheckSyncState();
+
 	if (hostif) {
 		std::string msg = hostif->GetChatMessage();
 
@@ -1130,6 +1179,24 @@ void CGameServer::ProcessPacket(const unsigned playerNum, boost::shared_ptr<cons
 			}
 		} break;
 
+		case NETMSG_AICOMMANDS_BATCH: {
+			try {
+				netcode::UnpackPacket pckt(packet, 3);
+				unsigned char playerNum;
+				pckt >> playerNum;
+				if (playerNum != a) {
+					Message(str(format(WrongPlayer) %msgCode  %a  %(unsigned) playerNum));
+					break;
+				}
+				if (noHelperAIs)
+					Message(str(format(NoHelperAI) %players[a].name %a));
+				else if (!demoReader)
+					Broadcast(packet); //forward data
+			} catch (const netcode::UnpackPacketException& ex) {
+				Message(str(format("Player %s sent invalid AICommands batch: %s") %players[a].name %ex.what()));
+			}
+		} break;
+
 		case NETMSG_AISHARE: {
 			try {
 				netcode::UnpackPacket pckt(packet, 3);
@@ -1179,6 +1246,32 @@ void CGameServer::ProcessPacket(const unsigned playerNum, boost::shared_ptr<cons
 		}
 			break;
 
+		case NETMSG_SYNCSTATE:
+			try {
+				netcode::UnpackPacket pckt(packet, 2);
+				unsigned char playerNum;
+				int frameNum;
+				pckt >> playerNum;
+				if (playerNum != a) {
+					Message(str(format(WrongPlayer) %msgCode %a %(unsigned)playerNum));
+					break;
+				}
+				pckt >> frameNum;
+
+				CSyncStateHashes::Hashes hashes(CSyncStateHashes::NUM_SUBSYSTEMS);
+				if (packet->length != (7 + hashes.size() * sizeof(boost::uint32_t)))
+					throw netcode::UnpackPacketException("Wrong number of hashes");
+				pckt >> hashes;
+
+				if (frameNum >= 0 && frameNum <= serverFrameNum) {
+					syncStateHashes[frameNum][a] = hashes;
+					CheckSyncState();
+				}
+			} catch (const netcode::UnpackPacketException& ex) {
+				Message(str(format("Player %s sent invalid SyncState: %s") %players[a].name %ex.what()));
+			}
+			break;
+
 		case NETMSG_SHARE:
 			if (inbuf[1] != a) {
 				Message(str(format(WrongPlayer) %msgCode %a %(unsigned)inbuf[1]));
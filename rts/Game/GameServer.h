@@ -18,6 +18,7 @@
 #include "System/float3.h"
 #include "System/myTime.h"
 #include "System/Platform/Synchro.h"
+#include "System/Sync/SyncStateHashes.h"
 
 
 namespace netcode
@@ -115,6 +116,7 @@ private:
 	void Update();
 	void ProcessPacket(const unsigned playerNum, boost::shared_ptr<const netcode::RawPacket> packet);
 	void CheckSync();
+	void CheckSyncState();
 	void ServerReadNet();
 	void CheckForGameEnd();
 
@@ -215,6 +217,8 @@ private:
 #endif
 	int syncErrorFrame;
 	int syncWarningFrame;
+	/// NETMSG_SYNCSTATE hashes by first frame of the round and player
+	std::map<int, std::map<int, CSyncStateHashes::Hashes> > syncStateHashes;
 
 	///////////////// internal stuff //////////////////
 	void InternalSpeedChange(float newSpeed);
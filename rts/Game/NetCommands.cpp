@@ -25,6 +25,7 @@
 #include "UI/MouseHandler.h"
 #include "Sim/Misc/TeamHandler.h"
 #include "Sim/Path/IPathManager.h"
+#include "System/AICommandBatch.h"
 #include "System/EventHandler.h"
 #include "System/Log/ILog.h"
 #include "System/myMath.h"
@@ -533,6 +534,39 @@ void CGame::ClientReadNet()
 				break;
 			}
 
+			case NETMSG_AICOMMANDS_BATCH: {
+				try {
+					CAICommandBatch batch;
+					batch.Unpack(packet);
+
+					const unsigned char player = batch.GetPlayerNum();
+					if (!playerHandler->IsValidPlayer(player))
+						throw netcode::UnpackPacketException("Invalid player number");
+
+					for (size_t u = 0; u < batch.GetNumUnits(); u++) {
+						const short int unitID = batch.GetUnitID(u);
+						if (unitID < 0 || static_cast<size_t>(unitID) >= uh->MaxUnits())
+							throw netcode::UnpackPacketException("Invalid unit ID");
+					}
+
+					// decode and apply the orders in the order they were given
+					float params[CAICommandBatch::MAX_PARAMS];
+
+					for (size_t u = 0; u < batch.GetNumUnits(); u++) {
+						batch.GetUnitParams(u, params);
+
+						Command c(batch.GetCommandID(), batch.GetOptions());
+						c.params.assign(params, params + batch.GetNumParams());
+
+						selectedUnits.AiOrder(batch.GetUnitID(u), c, player);
+					}
+					AddTraffic(player, packetCode, dataLength);
+				} catch (const netcode::UnpackPacketException& ex) {
+					LOG_L(L_ERROR, "Got invalid AICommands batch: %s", ex.what());
+				}
+				break;
+			}
+
 			case NETMSG_AISHARE: {
 				try {
 					netcode::UnpackPacket pckt(packet, 1);
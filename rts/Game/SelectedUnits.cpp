@@ -808,7 +808,7 @@ void CSelectedUnits::SendCommand(const Command& c)
 		selectionChanged = false;
 	}
 
-	net->Send(CBaseNetProtocol::Get().SendCommand(gu->myPlayerNum, c.GetID(), c.options, c.params));
+	net->Send(CBaseNetProtocol::Get().SendCommand(gu->myPlayerNum, c.GetID(), c.options, c.params.begin(), c.params.size()));
 }
 
 
@@ -860,7 +860,10 @@ void CSelectedUnits::SendCommandsToUnits(const std::vector<int>& unitIDs, const
 		const Command& cmd = commands[i];
 		*packet << static_cast<unsigned int>(cmd.GetID())
 		        << cmd.options
-		        << static_cast<unsigned short>(cmd.params.size()) << cmd.params;
+		        << static_cast<unsigned short>(cmd.params.size());
+		for (unsigned p = 0; p < cmd.params.size(); ++p) {
+			*packet << cmd.params[p];
+		}
 	}
 
 	net->Send(boost::shared_ptr<netcode::RawPacket>(packet));
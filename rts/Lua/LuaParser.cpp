@@ -5,6 +5,8 @@
 
 #include <algorithm>
 #include <limits.h>
+#include <cstring>
+#include <boost/cstdint.hpp>
 #include <boost/regex.hpp>
 
 #include "System/mmgr.h"
@@ -219,6 +221,212 @@ bool LuaParser::Execute()
 }
 
 
+/******************************************************************************/
+//
+//  Root table (de)serialization
+//
+
+static const int MAX_BLOB_TABLE_DEPTH = 64;
+
+enum BlobValueType {
+	BLOB_NUMBER    = 'n',
+	BLOB_STRING    = 's',
+	BLOB_BOOLEAN   = 'b',
+	BLOB_TABLE     = 't',
+	BLOB_TABLE_REF = 'r', // a table that was already written, by its id
+};
+
+
+bool LuaParser::DumpValue(lua_State* L, int index, string& blob, int depth, map<const void*, boost::uint32_t>& tableIds)
+{
+	switch (lua_type(L, index)) {
+		case LUA_TNUMBER: {
+			const lua_Number value = lua_tonumber(L, index);
+			blob += char(BLOB_NUMBER);
+			blob.append(reinterpret_cast<const char*>(&value), sizeof(value));
+		} break;
+		case LUA_TSTRING: {
+			size_t len = 0;
+			const char* str = lua_tolstring(L, index, &len);
+			const boost::uint32_t len32 = len;
+			blob += char(BLOB_STRING);
+			blob.append(reinterpret_cast<const char*>(&len32), sizeof(len32));
+			blob.append(str, len);
+		} break;
+		case LUA_TBOOLEAN: {
+			blob += char(BLOB_BOOLEAN);
+			blob += char(lua_toboolean(L, index));
+		} break;
+		case LUA_TTABLE: {
+			// tables referenced more than once (including cycles) are
+			// written once and referred to by id, so they stay shared
+			const map<const void*, boost::uint32_t>::const_iterator it = tableIds.find(lua_topointer(L, index));
+
+			if (it != tableIds.end()) {
+				blob += char(BLOB_TABLE_REF);
+				blob.append(reinterpret_cast<const char*>(&it->second), sizeof(it->second));
+				break;
+			}
+
+			if (depth >= MAX_BLOB_TABLE_DEPTH || !lua_checkstack(L, 3))
+				return false;
+
+			const int table = (index > 0)? index: (lua_gettop(L) + index + 1);
+			const boost::uint32_t tableId = tableIds.size();
+			tableIds[lua_topointer(L, table)] = tableId;
+
+			boost::uint32_t numPairs = 0;
+			for (lua_pushnil(L); lua_next(L, table) != 0; lua_pop(L, 1)) {
+				numPairs++;
+			}
+
+			blob += char(BLOB_TABLE);
+			blob.append(reinterpret_cast<const char*>(&numPairs), sizeof(numPairs));
+
+			for (lua_pushnil(L); lua_next(L, table) != 0; lua_pop(L, 1)) {
+				if (!DumpValue(L, -2, blob, depth + 1, tableIds) || !DumpValue(L, -1, blob, depth + 1, tableIds)) {
+					lua_pop(L, 2);
+					return false;
+				}
+			}
+		} break;
+		default: {
+			// functions, userdata, threads
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+bool LuaParser::LoadValue(lua_State* L, const char*& pos, const char* end, int depth, int tables, boost::uint32_t& numTables)
+{
+	if (pos >= end)
+		return false;
+
+	switch (*pos++) {
+		case BLOB_NUMBER: {
+			lua_Number value;
+			if ((end - pos) < int(sizeof(value)))
+				return false;
+			memcpy(&value, pos, sizeof(value));
+			pos += sizeof(value);
+			lua_pushnumber(L, value);
+		} break;
+		case BLOB_STRING: {
+			boost::uint32_t len;
+			if ((end - pos) < int(sizeof(len)))
+				return false;
+			memcpy(&len, pos, sizeof(len));
+			pos += sizeof(len);
+			if (boost::uint32_t(end - pos) < len)
+				return false;
+			lua_pushlstring(L, pos, len);
+			pos += len;
+		} break;
+		case BLOB_BOOLEAN: {
+			if (pos >= end)
+				return false;
+			lua_pushboolean(L, *pos++);
+		} break;
+		case BLOB_TABLE: {
+			boost::uint32_t numPairs;
+			if (depth >= MAX_BLOB_TABLE_DEPTH || (end - pos) < int(sizeof(numPairs)))
+				return false;
+			memcpy(&numPairs, pos, sizeof(numPairs));
+			pos += sizeof(numPairs);
+
+			if (!lua_checkstack(L, 3))
+				return false;
+
+			// registered before its contents, which may refer back to it
+			lua_newtable(L);
+			lua_pushvalue(L, -1);
+			lua_rawseti(L, tables, ++numTables);
+
+			for (boost::uint32_t n = 0; n < numPairs; n++) {
+				if (!LoadValue(L, pos, end, depth + 1, tables, numTables))
+					return false;
+				if (!LoadValue(L, pos, end, depth + 1, tables, numTables))
+					return false;
+				lua_rawset(L, -3);
+			}
+		} break;
+		case BLOB_TABLE_REF: {
+			boost::uint32_t tableId;
+			if ((end - pos) < int(sizeof(tableId)))
+				return false;
+			memcpy(&tableId, pos, sizeof(tableId));
+			pos += sizeof(tableId);
+			if (tableId >= numTables || !lua_checkstack(L, 1))
+				return false;
+			lua_rawgeti(L, tables, tableId + 1);
+		} break;
+		default: {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+bool LuaParser::DumpRoot(string& blob) const
+{
+	if (!valid)
+		return false;
+
+	lua_rawgeti(L, LUA_REGISTRYINDEX, rootRef);
+
+	const int top = lua_gettop(L);
+	map<const void*, boost::uint32_t> tableIds;
+	const bool ret = DumpValue(L, top, blob, 0, tableIds);
+
+	lua_settop(L, top - 1);
+	return ret;
+}
+
+
+bool LuaParser::ExecuteBlob(const string& blob)
+{
+	if (!IsValid()) {
+		errorLog = "could not initialize LUA library";
+		return false;
+	}
+
+	rootRef = LUA_NOREF;
+
+	assert(initDepth == 0);
+	initDepth = -1;
+
+	const char* pos = blob.data();
+	const char* end = blob.data() + blob.size();
+
+	// every table loaded so far, by id + 1
+	lua_newtable(L);
+	const int tables = lua_gettop(L);
+	boost::uint32_t numTables = 0;
+
+	if (!LoadValue(L, pos, end, 0, tables, numTables) || (pos != end) || !lua_istable(L, -1)) {
+		errorLog = "invalid or truncated table blob";
+		LOG_L(L_ERROR, "%s", errorLog.c_str());
+		LUA_CLOSE(L);
+		L = NULL;
+		return false;
+	}
+
+	// the blob was made from an already lower-cased table
+	rootRef = luaL_ref(L, LUA_REGISTRYINDEX);
+
+	lua_settop(L, 0);
+
+	valid = true;
+
+	return true;
+}
+
+
 void LuaParser::AddTable(LuaTable* tbl)
 {
 	tables.insert(tbl);
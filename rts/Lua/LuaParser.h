@@ -7,6 +7,7 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <boost/cstdint.hpp>
 using std::string;
 using std::vector;
 using std::map;
@@ -114,6 +115,19 @@ class LuaParser {
 
 		bool Execute();
 
+		/**
+		 * Serializes the root table into blob, for ExecuteBlob().
+		 * Only numbers, strings, booleans and tables can be stored;
+		 * returns false if anything else is encountered. Shared and
+		 * cyclic tables are kept shared.
+		 */
+		bool DumpRoot(string& blob) const;
+		/**
+		 * Alternative to Execute(), which restores the root table
+		 * from the output of DumpRoot() instead of running code.
+		 */
+		bool ExecuteBlob(const string& blob);
+
 		bool IsValid() const { return (L != NULL); }
 
 		LuaTable GetRoot();
@@ -158,6 +172,9 @@ class LuaParser {
 		void AddTable(LuaTable* tbl);
 		void RemoveTable(LuaTable* tbl);
 
+		static bool DumpValue(lua_State* L, int index, string& blob, int depth, map<const void*, boost::uint32_t>& tableIds);
+		static bool LoadValue(lua_State* L, const char*& pos, const char* end, int depth, int tables, boost::uint32_t& numTables);
+
 	private:
 		bool valid;
 		int initDepth;
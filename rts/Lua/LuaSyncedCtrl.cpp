@@ -39,6 +39,7 @@
 #include "Sim/Misc/TeamHandler.h"
 #include "Sim/Misc/QuadField.h"
 #include "Sim/MoveTypes/AAirMoveType.h"
+#include "Sim/MoveTypes/MoveInfo.h"
 #include "Sim/Path/IPathManager.h"
 #include "Sim/Projectiles/ExplosionGenerator.h"
 #include "Sim/Projectiles/Projectile.h"
@@ -3190,6 +3191,7 @@ int LuaSyncedCtrl::SetMapSquareTerrainType(lua_State* L)
 	const int ntt = luaL_checkint(L, 3);
 
 	readmap->GetTypeMapSynced()[tz * gs->hmapx + tx] = std::max(0, std::min(ntt, (CMapInfo::NUM_TERRAIN_TYPES - 1)));
+	moveinfo->TerrainChange(hx, hz,  hx + 1, hz + 1);
 	pathManager->TerrainChange(hx, hz,  hx + 1, hz + 1);
 
 	lua_pushnumber(L, ott);
@@ -3226,6 +3228,9 @@ int LuaSyncedCtrl::SetTerrainTypeData(lua_State* L)
 
 	const unsigned char* typeMap = readmap->GetTypeMapSynced();
 
+	// the speed-mod grids in one go, the squares might cover the whole map
+	moveinfo->TerrainChange(0, 0, gs->mapxm1, gs->mapym1);
+
 	// update all map-squares set to this terrain-type (slow)
 	for (int tx = 0; tx < gs->hmapx; tx++) {
 		for (int tz = 0; tz < gs->hmapy; tz++) {
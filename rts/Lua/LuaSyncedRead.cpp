@@ -518,14 +518,12 @@ static inline CUnit* ParseTypedUnit(lua_State* L, const char* caller, int index)
 static CProjectile* ParseProjectile(lua_State* L, const char* caller, int index)
 {
 	const int proID = luaL_checkint(L, index);
-	ProjectileMap::iterator it = ph->syncedProjectileIDs.find(proID);
-
-	if (it == ph->syncedProjectileIDs.end()) {
+	if (!ph->syncedProjectileIDs.IsUsed(proID)) {
 		// not an assigned synced projectile ID
 		return NULL;
 	}
 
-	const ProjectileMapPair& pp = it->second;
+	const ProjectileMapPair& pp = ph->syncedProjectileIDs[proID];
 	return IsProjectileVisible(pp)? pp.first: NULL;
 }
 
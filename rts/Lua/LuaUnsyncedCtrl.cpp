@@ -278,13 +278,11 @@ static inline CProjectile* ParseRawProjectile(lua_State* L, const char* caller,
 		ph->syncedProjectileIDs:
 		ph->unsyncedProjectileIDs;
 
-	ProjectileMap::const_iterator it = projectiles.find(projID);
-
-	if (it == projectiles.end()) {
+	if (!projectiles.IsUsed(projID)) {
 		return NULL;
 	}
 
-	return ((it->second).first);
+	return (projectiles[projID].first);
 }
 
 static inline CUnit* ParseRawUnit(lua_State* L, const char* caller, int index)
@@ -2396,7 +2394,7 @@ int LuaUnsyncedCtrl::GiveOrderToUnit(lua_State* L)
 
 	Command cmd = LuaUtils::ParseCommand(L, __FUNCTION__, 2);
 
-	net->Send(CBaseNetProtocol::Get().SendAICommand(gu->myPlayerNum, unit->id, cmd.GetID(), cmd.aiCommandId, cmd.options, cmd.params));
+	net->SendAICommand(gu->myPlayerNum, unit->id, cmd.GetID(), cmd.aiCommandId, cmd.options, cmd.params.begin(), cmd.params.size());
 
 	lua_pushboolean(L, true);
 	return 1;
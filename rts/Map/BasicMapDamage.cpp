@@ -12,6 +12,7 @@
 #include "Sim/Misc/GroundBlockingObjectMap.h"
 #include "Sim/Misc/LosHandler.h"
 #include "Sim/Misc/QuadField.h"
+#include "Sim/MoveTypes/MoveInfo.h"
 #include "Sim/Units/Unit.h"
 #include "Sim/Units/UnitHandler.h"
 #include "Sim/Path/IPathManager.h"
@@ -19,6 +20,7 @@
 #include "Sim/Units/UnitTypes/Building.h"
 #include "Sim/Units/UnitDef.h"
 #include "System/TimeProfiler.h"
+#include "System/Log/ILog.h"
 
 
 CBasicMapDamage::CBasicMapDamage()
@@ -31,6 +33,11 @@ CBasicMapDamage::CBasicMapDamage()
 	relosSize = 0;
 	neededLosUpdate = 0;
 
+	numRawUpdates = 0;
+	numMergedUpdates = 0;
+	rawUpdateArea = 0;
+	mergedUpdateArea = 0;
+
 	for (int a = 0; a <= CRATER_TABLE_SIZE; ++a) {
 		const float r = a / float(CRATER_TABLE_SIZE);
 		const float d = cos((r - 0.1f) * (PI + 0.3f)) * (1 - r) * (0.5f + 0.5f * cos(std::max(0.0f, r * 3 - 2) * PI));
@@ -48,6 +55,9 @@ CBasicMapDamage::CBasicMapDamage()
 
 CBasicMapDamage::~CBasicMapDamage()
 {
+	LOG("[%s] %u terrain updates merged into %u (%.0f squares merged into %.0f)",
+		__FUNCTION__, numRawUpdates, numMergedUpdates, double(rawUpdateArea), double(mergedUpdateArea));
+
 	while (!explosions.empty()) {
 		delete explosions.front();
 		explosions.pop_front();
@@ -175,34 +185,84 @@ void CBasicMapDamage::Explosion(const float3& pos, float strength, float radius)
 
 void CBasicMapDamage::RecalcArea(int x1, int x2, int y1, int y2)
 {
-	const int decy = std::max(                     0, (y1 * SQUARE_SIZE - CQuadField::QUAD_SIZE / 2) / CQuadField::QUAD_SIZE);
-	const int incy = std::min(qf->GetNumQuadsZ() - 1, (y2 * SQUARE_SIZE + CQuadField::QUAD_SIZE / 2) / CQuadField::QUAD_SIZE);
-	const int decx = std::max(                     0, (x1 * SQUARE_SIZE - CQuadField::QUAD_SIZE / 2) / CQuadField::QUAD_SIZE);
-	const int incx = std::min(qf->GetNumQuadsX() - 1, (x2 * SQUARE_SIZE + CQuadField::QUAD_SIZE / 2) / CQuadField::QUAD_SIZE);
+	// terraforming, Lua and repairs expect the derived data to be
+	// up-to-date as soon as this returns, so these are not deferred
+	AddDirtyArea(x1, x2, y1, y2);
+	RecalcDirtyAreas();
+}
 
-	const int numQuadsX = qf->GetNumQuadsX();
-	const int frameNum  = gs->frameNum;
+void CBasicMapDamage::AddDirtyArea(int x1, int x2, int y1, int y2)
+{
+	const SRectangle rect(x1, y1, x2 + 1, y2 + 1);
 
-	for (int y = decy; y <= incy; y++) {
-		for (int x = decx; x <= incx; x++) {
-			if (inRelosQue[y * numQuadsX + x]) {
-				continue;
-			}
+	numRawUpdates++;
+	rawUpdateArea += std::max(0, rect.GetWidth()) * std::max(0, rect.GetHeight());
+
+	dirtyAreas.push_back(rect);
+}
+
+
+void CBasicMapDamage::RecalcDirtyAreas()
+{
+	if (dirtyAreas.empty()) {
+		return;
+	}
+
+	// remove the overlap between the craters of a barrage
+	dirtyAreas.Optimize();
+
+	CRectangleOptimizer::iterator ri;
 
-			RelosSquare rs;
-			rs.x = x;
-			rs.y = y;
-			rs.neededUpdate = frameNum;
-			rs.numUnits = qf->GetQuadAt(x, y).units.size();
-			relosSize += rs.numUnits;
-			inRelosQue[y * numQuadsX + x] = true;
-			relosQue.push_back(rs);
+	for (ri = dirtyAreas.begin(); ri != dirtyAreas.end(); ++ri) {
+		numMergedUpdates++;
+		mergedUpdateArea += ri->GetWidth() * ri->GetHeight();
+	}
+
+	// hand the whole set to one consumer after the other
+	{
+		const int numQuadsX = qf->GetNumQuadsX();
+		const int frameNum  = gs->frameNum;
+
+		for (ri = dirtyAreas.begin(); ri != dirtyAreas.end(); ++ri) {
+			const int decy = std::max(                     0, ( ri->z1      * SQUARE_SIZE - CQuadField::QUAD_SIZE / 2) / CQuadField::QUAD_SIZE);
+			const int incy = std::min(qf->GetNumQuadsZ() - 1, ((ri->z2 - 1) * SQUARE_SIZE + CQuadField::QUAD_SIZE / 2) / CQuadField::QUAD_SIZE);
+			const int decx = std::max(                     0, ( ri->x1      * SQUARE_SIZE - CQuadField::QUAD_SIZE / 2) / CQuadField::QUAD_SIZE);
+			const int incx = std::min(qf->GetNumQuadsX() - 1, ((ri->x2 - 1) * SQUARE_SIZE + CQuadField::QUAD_SIZE / 2) / CQuadField::QUAD_SIZE);
+
+			for (int y = decy; y <= incy; y++) {
+				for (int x = decx; x <= incx; x++) {
+					if (inRelosQue[y * numQuadsX + x]) {
+						continue;
+					}
+
+					RelosSquare rs;
+					rs.x = x;
+					rs.y = y;
+					rs.neededUpdate = frameNum;
+					rs.numUnits = qf->GetQuadAt(x, y).units.size();
+					relosSize += rs.numUnits;
+					inRelosQue[y * numQuadsX + x] = true;
+					relosQue.push_back(rs);
+				}
+			}
 		}
 	}
 
-	readmap->UpdateHeightMapSynced(x1, y1, x2, y2);
-	pathManager->TerrainChange(x1, y1, x2, y2);
-	featureHandler->TerrainChanged(x1, y1, x2, y2);
+	for (ri = dirtyAreas.begin(); ri != dirtyAreas.end(); ++ri) {
+		// skips areas with x1 == x2, so give it the exclusive bounds
+		readmap->UpdateHeightMapSynced(ri->x1, ri->z1, ri->x2, ri->z2);
+	}
+	for (ri = dirtyAreas.begin(); ri != dirtyAreas.end(); ++ri) {
+		moveinfo->TerrainChange(ri->x1, ri->z1, ri->x2 - 1, ri->z2 - 1);
+	}
+	for (ri = dirtyAreas.begin(); ri != dirtyAreas.end(); ++ri) {
+		pathManager->TerrainChange(ri->x1, ri->z1, ri->x2 - 1, ri->z2 - 1);
+	}
+	for (ri = dirtyAreas.begin(); ri != dirtyAreas.end(); ++ri) {
+		featureHandler->TerrainChanged(ri->x1, ri->z1, ri->x2 - 1, ri->z2 - 1);
+	}
+
+	dirtyAreas.clear();
 }
 
 
@@ -252,7 +312,7 @@ void CBasicMapDamage::Update()
 			}
 		}
 		if (e->ttl == 0) {
-			RecalcArea(x1 - 2, x2 + 2, y1 - 2, y2 + 2);
+			AddDirtyArea(x1 - 2, x2 + 2, y1 - 2, y2 + 2);
 		}
 	}
 
@@ -261,6 +321,8 @@ void CBasicMapDamage::Update()
 		explosions.pop_front();
 	}
 
+	// the craters that finished this frame, merged
+	RecalcDirtyAreas();
 	UpdateLos();
 }
 
@@ -4,9 +4,11 @@
 #define _BASIC_MAP_DAMAGE_H
 
 #include "MapDamage.h"
+#include "System/Misc/RectangleOptimizer.h"
 
 #include <deque>
 #include <vector>
+#include <boost/cstdint.hpp>
 
 class CUnit;
 
@@ -21,6 +23,12 @@ public:
 	void Update();
 
 private:
+	/**
+	 * Queues a terrain change; the craters finishing in one Update()
+	 * are merged and passed on together at its end.
+	 */
+	void AddDirtyArea(int x1, int x2, int y1, int y2);
+	void RecalcDirtyAreas();
 	void UpdateLos();
 
 	struct ExploBuilding {
@@ -46,6 +54,15 @@ private:
 
 	std::deque<Explo*> explosions;
 
+	/// finished craters of this Update, in squares, [x1, x2) x [z1, z2)
+	CRectangleOptimizer dirtyAreas;
+
+	/// RecalcArea calls versus the merged areas actually recalculated
+	unsigned int numRawUpdates;
+	unsigned int numMergedUpdates;
+	boost::uint64_t rawUpdateArea;
+	boost::uint64_t mergedUpdateArea;
+
 	struct RelosSquare {
 		int x;
 		int y;
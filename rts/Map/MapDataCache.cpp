@@ -0,0 +1,241 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "MapDataCache.h"
+
+#include <cstdio>
+#include "Game/GameVersion.h"
+#include "System/CRC.h"
+#include "System/Log/ILog.h"
+#include "System/TimeProfiler.h"
+#include "System/FileSystem/DataDirsAccess.h"
+#include "System/FileSystem/FileQueryFlags.h"
+#include "System/FileSystem/FileSystem.h"
+
+static const std::string MAP_DATA_CACHE_DIR = "cache/mapdata/";
+static const char MAP_DATA_CACHE_MAGIC[16] = "spring mapdata";
+/// increment whenever the layout or the content of a section changes
+static const boost::uint32_t MAP_DATA_CACHE_VERSION = 1;
+
+
+static size_t AlignSection(size_t offset)
+{
+	const size_t a = CMapDataCache::SECTION_ALIGNMENT;
+	return (((offset + a - 1) / a) * a);
+}
+
+
+CMapDataCache::CMapDataCache(
+	unsigned int mapArchiveChecksum,
+	unsigned int heightMapChecksum,
+	int mapx,
+	int mapy,
+	bool enabled
+)
+	: heightMapChecksum(heightMapChecksum)
+	, mapx(mapx)
+	, mapy(mapy)
+	, enabled(enabled && (mapArchiveChecksum != 0))
+	, dirty(false)
+{
+	if (!this->enabled)
+		return;
+
+	const std::string& version = SpringVersion::GetFull();
+
+	CRC crc;
+	crc << mapArchiveChecksum;
+	crc << mapx << mapy;
+	crc << MAP_DATA_CACHE_VERSION;
+	crc.Update(version.c_str(), version.size());
+
+	char keyString[16] = {0};
+	sprintf(keyString, "%08x", crc.GetDigest());
+
+	fileName = MAP_DATA_CACHE_DIR + keyString + ".bin";
+
+	Load();
+}
+
+CMapDataCache::~CMapDataCache()
+{
+	Save();
+}
+
+
+const boost::uint8_t* CMapDataCache::GetSection(const std::string& name, size_t* size) const
+{
+	const std::map<std::string, Section>::const_iterator it = sections.find(name);
+
+	if (it == sections.end())
+		return NULL;
+
+	*size = it->second.size;
+	return it->second.data;
+}
+
+void CMapDataCache::AddSection(const std::string& name, const void* data, size_t size)
+{
+	if (!enabled)
+		return;
+
+	if (name.size() >= sizeof(SectionHeader().name)) {
+		LOG_L(L_WARNING, "[MapDataCache] section name \"%s\" is too long", name.c_str());
+		return;
+	}
+
+	const boost::uint8_t* bytes = reinterpret_cast<const boost::uint8_t*>(data);
+
+	Section& section = sections[name];
+	section.buffer.assign(bytes, bytes + size);
+	section.data = &section.buffer[0];
+	section.size = size;
+
+	dirty = true;
+}
+
+
+void CMapDataCache::Load()
+{
+	const std::string filePath = dataDirsAccess.LocateFile(fileName);
+
+	if (!FileSystem::FileExists(filePath))
+		return;
+
+	CFileView fileView;
+
+	if (!fileView.MapFile(filePath, 0, FileSystem::GetFileSize(filePath)))
+		return;
+
+	const boost::uint8_t* data = fileView.GetData();
+	const size_t fileSize = fileView.GetSize();
+
+	if (fileSize < sizeof(FileHeader))
+		return;
+
+	FileHeader header;
+	memcpy(&header, data, sizeof(FileHeader));
+
+	if (memcmp(header.magic, MAP_DATA_CACHE_MAGIC, sizeof(header.magic)) != 0 || header.version != MAP_DATA_CACHE_VERSION)
+		return;
+
+	if (header.mapx != mapx || header.mapy != mapy)
+		return;
+
+	if (header.heightMapChecksum != heightMapChecksum) {
+		// same archive, but not the same heightmap (should not happen)
+		LOG_L(L_WARNING, "[MapDataCache] heightmap checksum mismatch in %s, ignoring it", fileName.c_str());
+		return;
+	}
+
+	if (fileSize < (sizeof(FileHeader) + header.numSections * sizeof(SectionHeader)))
+		return;
+
+	std::map<std::string, Section> fileSections;
+
+	for (unsigned int n = 0; n < header.numSections; n++) {
+		SectionHeader sh;
+		memcpy(&sh, data + sizeof(FileHeader) + n * sizeof(SectionHeader), sizeof(SectionHeader));
+
+		if (sh.offset > fileSize || sh.size > (fileSize - sh.offset))
+			return;
+
+		sh.name[sizeof(sh.name) - 1] = 0;
+
+		Section& section = fileSections[sh.name];
+		section.data = data + sh.offset;
+		section.size = sh.size;
+	}
+
+	view = fileView;
+	sections.swap(fileSections);
+}
+
+
+bool CMapDataCache::Write(const std::string& filePath) const
+{
+	FILE* file = fopen(filePath.c_str(), "wb");
+
+	if (file == NULL)
+		return false;
+
+	FileHeader header;
+	memset(&header, 0, sizeof(FileHeader));
+	memcpy(header.magic, MAP_DATA_CACHE_MAGIC, sizeof(header.magic));
+	header.version = MAP_DATA_CACHE_VERSION;
+	header.heightMapChecksum = heightMapChecksum;
+	header.mapx = mapx;
+	header.mapy = mapy;
+	header.numSections = sections.size();
+
+	std::vector<SectionHeader> sectionHeaders(sections.size());
+	size_t offset = AlignSection(sizeof(FileHeader) + sections.size() * sizeof(SectionHeader));
+
+	std::map<std::string, Section>::const_iterator it;
+	size_t n = 0;
+
+	for (it = sections.begin(); it != sections.end(); ++it, ++n) {
+		memset(&sectionHeaders[n], 0, sizeof(SectionHeader));
+		strncpy(sectionHeaders[n].name, it->first.c_str(), sizeof(sectionHeaders[n].name) - 1);
+		sectionHeaders[n].offset = offset;
+		sectionHeaders[n].size = it->second.size;
+
+		offset = AlignSection(offset + it->second.size);
+	}
+
+	bool ret = (fwrite(&header, sizeof(FileHeader), 1, file) == 1);
+
+	if (ret && !sectionHeaders.empty()) {
+		ret = (fwrite(&sectionHeaders[0], sizeof(SectionHeader), sectionHeaders.size(), file) == sectionHeaders.size());
+	}
+
+	for (it = sections.begin(), n = 0; ret && it != sections.end(); ++it, ++n) {
+		ret = (fseek(file, sectionHeaders[n].offset, SEEK_SET) == 0);
+
+		if (ret && it->second.size > 0) {
+			ret = (fwrite(it->second.data, it->second.size, 1, file) == 1);
+		}
+	}
+
+	ret = (fclose(file) == 0) && ret;
+	return ret;
+}
+
+void CMapDataCache::Save()
+{
+	if (!enabled || !dirty)
+		return;
+
+	dirty = false;
+
+	if (!FileSystem::CreateDirectory(MAP_DATA_CACHE_DIR))
+		return;
+
+	ScopedOnceTimer timer("MapDataCache::Save");
+
+	const std::string writePath = dataDirsAccess.LocateFile(fileName, FileQueryFlags::WRITE);
+	const std::string tmpPath = writePath + ".tmp";
+
+	if (!Write(tmpPath)) {
+		LOG_L(L_WARNING, "[MapDataCache] failed to write %s", tmpPath.c_str());
+		remove(tmpPath.c_str());
+		return;
+	}
+
+	// the sections loaded from the old file point into its mapping, which
+	// has to be gone before the file can be replaced (on some platforms);
+	// callers only read sections while loading, so just continue with the
+	// new file
+	sections.clear();
+	view.Clear();
+
+	// never expose a partially written file
+	remove(writePath.c_str());
+
+	if (rename(tmpPath.c_str(), writePath.c_str()) != 0) {
+		LOG_L(L_WARNING, "[MapDataCache] failed to replace %s", writePath.c_str());
+		remove(tmpPath.c_str());
+		return;
+	}
+
+	Load();
+}
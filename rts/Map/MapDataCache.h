@@ -0,0 +1,128 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _MAP_DATA_CACHE_H_
+#define _MAP_DATA_CACHE_H_
+
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+#include "System/FileSystem/FileView.h"
+
+/**
+ * Data derived from the initial state of a map (heightmap mip levels,
+ * normals, slope map, smoothed height mesh, resource spots, ...), stored in
+ * one file per map under cache/mapdata/, so loading the same map again does
+ * not need to recompute it.
+ *
+ * The file name is derived from the map archive checksum, the map size and
+ * the engine version; the header additionally holds the heightmap checksum
+ * (CReadMap::mapChecksum), a file with a different one is ignored.
+ *
+ * Layout: FileHeader, FileHeader::numSections times SectionHeader, then the
+ * data of the sections, each at a multiple of SECTION_ALIGNMENT, so the file
+ * can be mapped and its sections read in place.
+ */
+class CMapDataCache
+{
+public:
+	/**
+	 * Maps the cache file of the map if there is one.
+	 * @param enabled false ignores (and never writes) the cache file
+	 */
+	CMapDataCache(
+		unsigned int mapArchiveChecksum,
+		unsigned int heightMapChecksum,
+		int mapx,
+		int mapy,
+		bool enabled = true
+	);
+	/// writes the sections that were added since the last Save
+	~CMapDataCache();
+
+	/**
+	 * @return the data of the section or NULL if there is no such section;
+	 *   stays valid until the next Save
+	 */
+	const boost::uint8_t* GetSection(const std::string& name, size_t* size) const;
+	/**
+	 * Copies a section of exactly v.size() elements into v.
+	 * @return false if there is no such section or its size differs
+	 */
+	template<typename T> bool ReadSection(const std::string& name, std::vector<T>& v) const {
+		size_t size = 0;
+		const boost::uint8_t* data = GetSection(name, &size);
+
+		if (data == NULL || v.empty() || size != (v.size() * sizeof(T)))
+			return false;
+
+		memcpy(&v[0], data, size);
+		return true;
+	}
+
+	/// Adds (or replaces) a section, the data is copied
+	void AddSection(const std::string& name, const void* data, size_t size);
+	template<typename T> void AddSection(const std::string& name, const std::vector<T>& v) {
+		if (!v.empty()) {
+			AddSection(name, &v[0], v.size() * sizeof(T));
+		}
+	}
+
+	/**
+	 * Writes the cache file if sections were added since the last call,
+	 * invalidates the data returned by GetSection
+	 */
+	void Save();
+
+	bool IsEnabled() const { return enabled; }
+	bool IsLoaded() const { return !view.Empty(); }
+
+public:
+	static const int SECTION_ALIGNMENT = 16;
+
+	struct FileHeader {
+		char magic[16];
+		boost::uint32_t version;
+		boost::uint32_t heightMapChecksum;
+		boost::int32_t mapx;
+		boost::int32_t mapy;
+		boost::uint32_t numSections;
+		boost::uint32_t reserved[3];
+	};
+
+	struct SectionHeader {
+		char name[48];
+		boost::uint64_t offset;
+		boost::uint64_t size;
+	};
+
+private:
+	struct Section {
+		Section(): data(NULL), size(0) {}
+
+		/// points into view or buffer
+		const boost::uint8_t* data;
+		size_t size;
+		std::vector<boost::uint8_t> buffer;
+	};
+
+	void Load();
+	bool Write(const std::string& filePath) const;
+
+private:
+	const unsigned int heightMapChecksum;
+	const int mapx;
+	const int mapy;
+	const bool enabled;
+
+	std::string fileName;
+
+	CFileView view;
+	std::map<std::string, Section> sections;
+
+	bool dirty;
+};
+
+#endif // _MAP_DATA_CACHE_H_
@@ -6,28 +6,36 @@
 
 #include "ReadMap.h"
 #include "MapDamage.h"
+#include "MapDataCache.h"
 #include "MapInfo.h"
 #include "MetalMap.h"
-#include "SM3/SM3Map.h"
-#include "SMF/SMFReadMap.h"
 #include "lib/gml/gmlmut.h"
+#include "Game/GameSetup.h"
 #include "Game/LoadScreen.h"
 #include "System/bitops.h"
 #include "System/EventHandler.h"
 #include "System/Exceptions.h"
 #include "System/myMath.h"
+#include "System/ThreadPool.h"
 #include "System/TimeProfiler.h"
+#include "System/Util.h"
+#include "System/Config/ConfigHandler.h"
 #include "System/FileSystem/ArchiveScanner.h"
 #include "System/FileSystem/FileHandler.h"
-#include "System/FileSystem/FileSystem.h"
 #include "System/LoadSave/LoadSaveInterface.h"
 #include "System/Misc/RectangleOptimizer.h"
 
+#include <boost/bind.hpp>
+
 #ifdef USE_UNSYNCED_HEIGHTMAP
 #include "Game/GlobalUnsynced.h"
 #include "Sim/Misc/LosHandler.h"
 #endif
 
+CONFIG(bool, MapDataCache)
+	.defaultValue(true)
+	.description("Store data derived from the heightmap in the cache directory, so it does not need to be recomputed when the same map is loaded again.");
+
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
 //////////////////////////////////////////////////////////////////////
@@ -41,57 +49,6 @@ CR_REG_METADATA(CReadMap, (
 ));
 
 
-CReadMap* CReadMap::LoadMap(const std::string& mapname)
-{
-	if (mapname.length() < 3)
-		throw content_error("CReadMap::LoadMap(): mapname '" + mapname + "' too short");
-
-	const std::string extension = FileSystem::GetExtension(mapname);
-
-	CReadMap* rm = NULL;
-
-	if (extension == "sm3") {
-		rm = new CSM3ReadMap(mapname);
-	} else {
-		rm = new CSMFReadMap(mapname);
-	}
-
-	if (!rm) {
-		return NULL;
-	}
-
-	/* Read metal map */
-	MapBitmapInfo mbi;
-	unsigned char* metalmapPtr = rm->GetInfoMap("metal", &mbi);
-
-	assert(mbi.width == (rm->width >> 1));
-	assert(mbi.height == (rm->height >> 1));
-
-	rm->metalMap = new CMetalMap(metalmapPtr, mbi.width, mbi.height, mapInfo->map.maxMetal);
-
-	if (metalmapPtr != NULL) {
-		rm->FreeInfoMap("metal", metalmapPtr);
-	}
-
-
-	/* Read type map */
-	MapBitmapInfo tbi;
-	unsigned char* typemapPtr = rm->GetInfoMap("type", &tbi);
-
-	if (typemapPtr && tbi.width == (rm->width >> 1) && tbi.height == (rm->height >> 1)) {
-		assert(gs->hmapx == tbi.width && gs->hmapy == tbi.height);
-		rm->typeMap.resize(tbi.width * tbi.height);
-		memcpy(&rm->typeMap[0], typemapPtr, tbi.width * tbi.height);
-	} else
-		throw content_error("Bad/no terrain type map.");
-
-	if (typemapPtr)
-		rm->FreeInfoMap("type", typemapPtr);
-
-	return rm;
-}
-
-
 void CReadMap::Serialize(creg::ISerializer& s)
 {
 	// remove the const
@@ -113,13 +70,15 @@ CReadMap::CReadMap():
 	initMaxHeight(0.0f),
 	currMinHeight(0.0f),
 	currMaxHeight(0.0f),
-	mapChecksum(0)
+	mapChecksum(0),
+	mapDataCache(NULL)
 {
 }
 
 
 CReadMap::~CReadMap()
 {
+	delete mapDataCache;
 	delete metalMap;
 }
 
@@ -186,7 +145,58 @@ void CReadMap::Initialize()
 	visVertexNormals.resize(gs->mapxp1 * gs->mapyp1);
 
 	CalcHeightmapChecksum();
-	UpdateHeightMapSynced(0, 0, gs->mapx, gs->mapy);
+
+	mapDataCache = new CMapDataCache(
+		archiveScanner->GetSingleArchiveChecksum(gameSetup->mapName),
+		mapChecksum,
+		gs->mapx,
+		gs->mapy,
+		configHandler->GetBool("MapDataCache")
+	);
+
+	if (LoadCachedHeightMapData()) {
+		// same bounds as the update of the whole map would push
+		PushVisibleHeightMapUpdate(0, 0,  gs->mapxm1, gs->mapym1,  false);
+	} else {
+		UpdateHeightMapSynced(0, 0, gs->mapx, gs->mapy);
+		SaveCachedHeightMapData();
+	}
+}
+
+
+bool CReadMap::LoadCachedHeightMapData()
+{
+	if (!mapDataCache->IsLoaded())
+		return false;
+
+	ScopedOnceTimer timer("CReadMap::LoadCachedHeightMapData");
+
+	bool ret = true;
+
+	ret = ret && mapDataCache->ReadSection("centerHeightMap", centerHeightMap);
+
+	for (int i = 1; ret && i < numHeightMipMaps; i++) {
+		ret = mapDataCache->ReadSection("mipHeightMap" + IntToString(i), mipCenterHeightMaps[i - 1]);
+	}
+
+	ret = ret && mapDataCache->ReadSection("faceNormals", faceNormalsSynced);
+	ret = ret && mapDataCache->ReadSection("centerNormals", centerNormalsSynced);
+	ret = ret && mapDataCache->ReadSection("slopeMap", slopeMap);
+
+	return ret;
+}
+
+void CReadMap::SaveCachedHeightMapData()
+{
+	mapDataCache->AddSection("centerHeightMap", centerHeightMap);
+
+	for (int i = 1; i < numHeightMipMaps; i++) {
+		mapDataCache->AddSection("mipHeightMap" + IntToString(i), mipCenterHeightMaps[i - 1]);
+	}
+
+	mapDataCache->AddSection("faceNormals", faceNormalsSynced);
+	mapDataCache->AddSection("centerNormals", centerNormalsSynced);
+	mapDataCache->AddSection("slopeMap", slopeMap);
 }
 
 
@@ -242,6 +252,27 @@ void CReadMap::UpdateDraw() {
 
 
 
+/**
+ * Calls rowFunc(y) for all rows in [y1, y2], spread over all cores if the
+ * rows hold enough cells to be worth the thread start-up.
+ * Every cell of a pass only depends on data written by previous passes,
+ * so the results do not depend on the number of threads.
+ */
+static void ForEachRow(int y1, int y2, int rowLength, const boost::function<void(int)>& rowFunc)
+{
+	static const int MIN_PARALLEL_CELLS = 256 * 256;
+
+	if ((y2 - y1 + 1) * rowLength >= MIN_PARALLEL_CELLS) {
+		ThreadPool::for_mt(y1, y2 + 1, rowFunc);
+		return;
+	}
+
+	for (int y = y1; y <= y2; y++) {
+		rowFunc(y);
+	}
+}
+
+
 void CReadMap::UpdateHeightMapSynced(int x1, int z1, int x2, int z2)
 {
 	if ((x1 >= x2) || (z1 >= z2)) {
@@ -249,42 +280,25 @@ void CReadMap::UpdateHeightMapSynced(int x1, int z1, int x2, int z2)
 		return;
 	}
 
-	const float* heightmapSynced = GetCornerHeightMapSynced();
+	SCOPED_TIMER("ReadMap::UpdateHeightMapSynced");
 
 	x1 = std::max(           0, x1 - 1);
 	z1 = std::max(           0, z1 - 1);
 	x2 = std::min(gs->mapxm1, x2 + 1);
 	z2 = std::min(gs->mapym1, z2 + 1);
 
-	for (int y = z1; y <= z2; y++) {
-		for (int x = x1; x <= x2; x++) {
-			const int idxTL = (y    ) * gs->mapxp1 + x;
-			const int idxTR = (y    ) * gs->mapxp1 + x + 1;
-			const int idxBL = (y + 1) * gs->mapxp1 + x;
-			const int idxBR = (y + 1) * gs->mapxp1 + x + 1;
-
-			const float height =
-				heightmapSynced[idxTL] +
-				heightmapSynced[idxTR] +
-				heightmapSynced[idxBL] +
-				heightmapSynced[idxBR];
-			centerHeightMap[y * gs->mapx + x] = height * 0.25f;
-		}
-	}
+	ForEachRow(z1, z2, x2 - x1 + 1, boost::bind(&CReadMap::UpdateCenterHeightMapRow, this, _1, x1, x2));
 
+	// every mip level is built from the previous one
 	for (int i = 0; i < numHeightMipMaps - 1; i++) {
-		const int hmapx = gs->mapx >> i;
-
-		for (int y = ((z1 >> i) & (~1)); y < (z2 >> i); y += 2) {
-			for (int x = ((x1 >> i) & (~1)); x < (x2 >> i); x += 2) {
-				const float height =
-					mipPointerHeightMaps[i][(x    ) + (y    ) * hmapx] +
-					mipPointerHeightMaps[i][(x    ) + (y + 1) * hmapx] +
-					mipPointerHeightMaps[i][(x + 1) + (y    ) * hmapx] +
-					mipPointerHeightMaps[i][(x + 1) + (y + 1) * hmapx];
-				mipPointerHeightMaps[i + 1][(x / 2) + (y / 2) * hmapx / 2] = height * 0.25f;
-			}
-		}
+		const int mx1 = ((x1 >> i) & (~1)), mx2 = (x2 >> i) - 1;
+		const int my1 = ((z1 >> i) & (~1)), my2 = (z2 >> i) - 1;
+
+		if (mx1 > mx2 || my1 > my2)
+			continue;
+
+		// one row of the next level per two rows of this level
+		ForEachRow(my1 >> 1, my2 >> 1, (mx2 - mx1 + 2) >> 1, boost::bind(&CReadMap::UpdateMipHeightMapRow, this, i, _1, mx1, mx2));
 	}
 
 	const int decy = std::max(           0, z1 - 1);
@@ -292,80 +306,122 @@ void CReadMap::UpdateHeightMapSynced(int x1, int z1, int x2, int z2)
 	const int decx = std::max(           0, x1 - 1);
 	const int incx = std::min(gs->mapxm1, x2 + 1);
 
-	//! create the surface normals
-	for (int y = decy; y <= incy; y++) {
-		for (int x = decx; x <= incx; x++) {
-			const int idxTL = (y    ) * gs->mapxp1 + x; // TL
-			const int idxBL = (y + 1) * gs->mapxp1 + x; // BL
-
-			//!  *---> e1
-			//!  |
-			//!  |
-			//!  v
-			//!  e2
-			float3 e1( SQUARE_SIZE, heightmapSynced[idxTL + 1] - heightmapSynced[idxTL],            0);
-			float3 e2(           0, heightmapSynced[idxBL    ] - heightmapSynced[idxTL],  SQUARE_SIZE);
-
-			//! normal of top-left triangle (face) in square
-			const float3 fnTL = (e2.cross(e1)).Normalize();
-
-			//!         e1
-			//!         ^
-			//!         |
-			//!         |
-			//!  e2 <---*
-			e1 = float3(-SQUARE_SIZE, heightmapSynced[idxBL    ] - heightmapSynced[idxBL + 1],            0);
-			e2 = float3(           0, heightmapSynced[idxTL + 1] - heightmapSynced[idxBL + 1], -SQUARE_SIZE);
-
-			//! normal of bottom-right triangle (face) in square
-			const float3 fnBR = (e2.cross(e1)).Normalize();
-
-			faceNormalsSynced[(y * gs->mapx + x) * 2] = fnTL;
-			faceNormalsSynced[(y * gs->mapx + x) * 2 + 1] = fnBR;
-
-			//! square-normal
-			centerNormalsSynced[y * gs->mapx + x] = (fnTL + fnBR).Normalize();
-		}
-	}
+	ForEachRow(decy, incy, incx - decx + 1, boost::bind(&CReadMap::UpdateFaceNormalsRow, this, _1, decx, incx));
 
-	for (int y = std::max(0, (z1 / 2) - 1); y <= std::min(gs->hmapy - 1, (z2 / 2) + 1); y++) {
-		for (int x = std::max(0, (x1 / 2) - 1); x <= std::min(gs->hmapx - 1, (x2 / 2) + 1); x++) {
-			const int idx0 = (y*2    ) * (gs->mapx) + x*2;
-			const int idx1 = (y*2 + 1) * (gs->mapx) + x*2;
-
-			float avgslope = 0.0f;
-			avgslope += faceNormalsSynced[(idx0    ) * 2    ].y;
-			avgslope += faceNormalsSynced[(idx0    ) * 2 + 1].y;
-			avgslope += faceNormalsSynced[(idx0 + 1) * 2    ].y;
-			avgslope += faceNormalsSynced[(idx0 + 1) * 2 + 1].y;
-			avgslope += faceNormalsSynced[(idx1    ) * 2    ].y;
-			avgslope += faceNormalsSynced[(idx1    ) * 2 + 1].y;
-			avgslope += faceNormalsSynced[(idx1 + 1) * 2    ].y;
-			avgslope += faceNormalsSynced[(idx1 + 1) * 2 + 1].y;
-			avgslope /= 8.0f;
-
-			float maxslope =              faceNormalsSynced[(idx0    ) * 2    ].y;
-			maxslope = std::min(maxslope, faceNormalsSynced[(idx0    ) * 2 + 1].y);
-			maxslope = std::min(maxslope, faceNormalsSynced[(idx0 + 1) * 2    ].y);
-			maxslope = std::min(maxslope, faceNormalsSynced[(idx0 + 1) * 2 + 1].y);
-			maxslope = std::min(maxslope, faceNormalsSynced[(idx1    ) * 2    ].y);
-			maxslope = std::min(maxslope, faceNormalsSynced[(idx1    ) * 2 + 1].y);
-			maxslope = std::min(maxslope, faceNormalsSynced[(idx1 + 1) * 2    ].y);
-			maxslope = std::min(maxslope, faceNormalsSynced[(idx1 + 1) * 2 + 1].y);
-
-			//! smooth it a bit, so small holes don't block huge tanks
-			const float lerp = maxslope / avgslope;
-			const float slope = maxslope * (1.0f - lerp) + avgslope * lerp;
-
-			slopeMap[y * gs->hmapx + x] = 1.0f - slope;
-		}
-	}
+	const int sy1 = std::max(0, (z1 / 2) - 1), sy2 = std::min(gs->hmapy - 1, (z2 / 2) + 1);
+	const int sx1 = std::max(0, (x1 / 2) - 1), sx2 = std::min(gs->hmapx - 1, (x2 / 2) + 1);
+
+	ForEachRow(sy1, sy2, sx2 - sx1 + 1, boost::bind(&CReadMap::UpdateSlopeMapRow, this, _1, sx1, sx2));
 
 	//! push the unsynced update
 	PushVisibleHeightMapUpdate(x1, z1,  x2, z2,  false);
 }
 
 
+void CReadMap::UpdateCenterHeightMapRow(int y, int x1, int x2)
+{
+	// plain contiguous loop (and the same order of additions as
+	// everywhere else), so the compiler is free to vectorize it
+	const float* hmTop = GetCornerHeightMapSynced() + y * gs->mapxp1;
+	const float* hmBot = hmTop + gs->mapxp1;
+	float* center = &centerHeightMap[y * gs->mapx];
+
+	for (int x = x1; x <= x2; x++) {
+		center[x] = (hmTop[x] + hmTop[x + 1] + hmBot[x] + hmBot[x + 1]) * 0.25f;
+	}
+}
+
+
+void CReadMap::UpdateMipHeightMapRow(int mip, int y, int x1, int x2)
+{
+	// y is a row of mip level <mip + 1>, x1 and x2 are in level <mip>
+	const int hmapx = gs->mapx >> mip;
+
+	const float* srcTop = mipPointerHeightMaps[mip] + (y * 2    ) * hmapx;
+	const float* srcBot = mipPointerHeightMaps[mip] + (y * 2 + 1) * hmapx;
+	float* dst = mipPointerHeightMaps[mip + 1] + y * (hmapx / 2);
+
+	for (int x = x1; x <= x2; x += 2) {
+		dst[x / 2] = (srcTop[x] + srcBot[x] + srcTop[x + 1] + srcBot[x + 1]) * 0.25f;
+	}
+}
+
+
+void CReadMap::UpdateFaceNormalsRow(int y, int x1, int x2)
+{
+	const float* heightmapSynced = GetCornerHeightMapSynced();
+
+	//! create the surface normals
+	for (int x = x1; x <= x2; x++) {
+		const int idxTL = (y    ) * gs->mapxp1 + x; // TL
+		const int idxBL = (y + 1) * gs->mapxp1 + x; // BL
+
+		//!  *---> e1
+		//!  |
+		//!  |
+		//!  v
+		//!  e2
+		float3 e1( SQUARE_SIZE, heightmapSynced[idxTL + 1] - heightmapSynced[idxTL],            0);
+		float3 e2(           0, heightmapSynced[idxBL    ] - heightmapSynced[idxTL],  SQUARE_SIZE);
+
+		//! normal of top-left triangle (face) in square
+		const float3 fnTL = (e2.cross(e1)).Normalize();
+
+		//!         e1
+		//!         ^
+		//!         |
+		//!         |
+		//!  e2 <---*
+		e1 = float3(-SQUARE_SIZE, heightmapSynced[idxBL    ] - heightmapSynced[idxBL + 1],            0);
+		e2 = float3(           0, heightmapSynced[idxTL + 1] - heightmapSynced[idxBL + 1], -SQUARE_SIZE);
+
+		//! normal of bottom-right triangle (face) in square
+		const float3 fnBR = (e2.cross(e1)).Normalize();
+
+		faceNormalsSynced[(y * gs->mapx + x) * 2] = fnTL;
+		faceNormalsSynced[(y * gs->mapx + x) * 2 + 1] = fnBR;
+
+		//! square-normal
+		centerNormalsSynced[y * gs->mapx + x] = (fnTL + fnBR).Normalize();
+	}
+}
+
+
+void CReadMap::UpdateSlopeMapRow(int y, int x1, int x2)
+{
+	for (int x = x1; x <= x2; x++) {
+		const int idx0 = (y*2    ) * (gs->mapx) + x*2;
+		const int idx1 = (y*2 + 1) * (gs->mapx) + x*2;
+
+		float avgslope = 0.0f;
+		avgslope += faceNormalsSynced[(idx0    ) * 2    ].y;
+		avgslope += faceNormalsSynced[(idx0    ) * 2 + 1].y;
+		avgslope += faceNormalsSynced[(idx0 + 1) * 2    ].y;
+		avgslope += faceNormalsSynced[(idx0 + 1) * 2 + 1].y;
+		avgslope += faceNormalsSynced[(idx1    ) * 2    ].y;
+		avgslope += faceNormalsSynced[(idx1    ) * 2 + 1].y;
+		avgslope += faceNormalsSynced[(idx1 + 1) * 2    ].y;
+		avgslope += faceNormalsSynced[(idx1 + 1) * 2 + 1].y;
+		avgslope /= 8.0f;
+
+		float maxslope =              faceNormalsSynced[(idx0    ) * 2    ].y;
+		maxslope = std::min(maxslope, faceNormalsSynced[(idx0    ) * 2 + 1].y);
+		maxslope = std::min(maxslope, faceNormalsSynced[(idx0 + 1) * 2    ].y);
+		maxslope = std::min(maxslope, faceNormalsSynced[(idx0 + 1) * 2 + 1].y);
+		maxslope = std::min(maxslope, faceNormalsSynced[(idx1    ) * 2    ].y);
+		maxslope = std::min(maxslope, faceNormalsSynced[(idx1    ) * 2 + 1].y);
+		maxslope = std::min(maxslope, faceNormalsSynced[(idx1 + 1) * 2    ].y);
+		maxslope = std::min(maxslope, faceNormalsSynced[(idx1 + 1) * 2 + 1].y);
+
+		//! smooth it a bit, so small holes don't block huge tanks
+		const float lerp = maxslope / avgslope;
+		const float slope = maxslope * (1.0f - lerp) + avgslope * lerp;
+
+		slopeMap[y * gs->hmapx + x] = 1.0f - slope;
+	}
+}
+
+
 void CReadMap::PushVisibleHeightMapUpdate(int x1, int z1,  int x2, int z2,  bool losMapCall)
 {
 	GML_STDMUTEX_LOCK(map); // PushVisibleHeightMapUpdate
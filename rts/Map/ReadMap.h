@@ -20,6 +20,7 @@ class CSolidObject;
 class CFileHandler;
 class CLoadSaveInterface;
 class CBaseGroundDrawer;
+class CMapDataCache;
 
 
 struct MapFeatureInfo
@@ -76,6 +77,7 @@ public:
 	/**
 	 * calculates derived heightmap information
 	 * such as normals, centerheightmap and slopemap
+	 * (large areas are processed on all cores)
 	 */
 	void UpdateHeightMapSynced(int x1, int z1, int x2, int z2);
 	void PushVisibleHeightMapUpdate(int x1, int z1, int x2, int z2, bool);
@@ -140,6 +142,9 @@ public:
 	const unsigned char* GetTypeMapSynced() const { return &typeMap[0]; }
 	      unsigned char* GetTypeMapSynced()       { return &typeMap[0]; }
 
+	/// data derived from the initial map, shared by all map-related loaders
+	CMapDataCache* GetMapDataCache() const { return mapDataCache; }
+
 	/// unsynced
 	const float3* GetRawVertexNormalsUnsynced() const { return &rawVertexNormals[0]; }
 	const float3* GetVisVertexNormalsUnsynced() const { return &visVertexNormals[0]; }
@@ -212,6 +217,20 @@ protected:
 
 	std::list<HeightMapUpdate> unsyncedHeightMapUpdates;
 
+	CMapDataCache* mapDataCache;
+
+private:
+	/// @return false if the synced derived heightmap data is not in mapDataCache
+	bool LoadCachedHeightMapData();
+	void SaveCachedHeightMapData();
+
+	/// row kernels of UpdateHeightMapSynced, [x1, x2] is inclusive
+	void UpdateCenterHeightMapRow(int y, int x1, int x2);
+	void UpdateMipHeightMapRow(int mip, int y, int x1, int x2);
+	void UpdateFaceNormalsRow(int y, int x1, int x2);
+	void UpdateSlopeMapRow(int y, int x1, int x2);
+
+protected:
 #ifdef USE_UNSYNCED_HEIGHTMAP
 	struct HeightMapUpdateFilter {
 		HeightMapUpdateFilter(bool upd = false) : minx(0), maxx(0), miny(0), maxy(0), update(upd) {}
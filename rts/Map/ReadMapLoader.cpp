@@ -0,0 +1,67 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+// kept apart from ReadMap.cpp, so the map-format independent parts of
+// CReadMap can be used without the SMF and SM3 implementations
+
+#include "System/mmgr.h"
+
+#include "ReadMap.h"
+#include "MapInfo.h"
+#include "MetalMap.h"
+#include "SM3/SM3Map.h"
+#include "SMF/SMFReadMap.h"
+#include "System/Exceptions.h"
+#include "System/FileSystem/FileSystem.h"
+
+#include <cstring>
+
+
+CReadMap* CReadMap::LoadMap(const std::string& mapname)
+{
+	if (mapname.length() < 3)
+		throw content_error("CReadMap::LoadMap(): mapname '" + mapname + "' too short");
+
+	const std::string extension = FileSystem::GetExtension(mapname);
+
+	CReadMap* rm = NULL;
+
+	if (extension == "sm3") {
+		rm = new CSM3ReadMap(mapname);
+	} else {
+		rm = new CSMFReadMap(mapname);
+	}
+
+	if (!rm) {
+		return NULL;
+	}
+
+	/* Read metal map */
+	MapBitmapInfo mbi;
+	unsigned char* metalmapPtr = rm->GetInfoMap("metal", &mbi);
+
+	assert(mbi.width == (rm->width >> 1));
+	assert(mbi.height == (rm->height >> 1));
+
+	rm->metalMap = new CMetalMap(metalmapPtr, mbi.width, mbi.height, mapInfo->map.maxMetal);
+
+	if (metalmapPtr != NULL) {
+		rm->FreeInfoMap("metal", metalmapPtr);
+	}
+
+
+	/* Read type map */
+	MapBitmapInfo tbi;
+	unsigned char* typemapPtr = rm->GetInfoMap("type", &tbi);
+
+	if (typemapPtr && tbi.width == (rm->width >> 1) && tbi.height == (rm->height >> 1)) {
+		assert(gs->hmapx == tbi.width && gs->hmapy == tbi.height);
+		rm->typeMap.resize(tbi.width * tbi.height);
+		memcpy(&rm->typeMap[0], typemapPtr, tbi.width * tbi.height);
+	} else
+		throw content_error("Bad/no terrain type map.");
+
+	if (typemapPtr)
+		rm->FreeInfoMap("type", typemapPtr);
+
+	return rm;
+}
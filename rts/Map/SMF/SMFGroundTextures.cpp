@@ -20,8 +20,15 @@
 #include "System/Log/ILog.h"
 #include "System/mmgr.h"
 #include "System/TimeProfiler.h"
+#include "System/Util.h"
+#include "System/CRC.h"
+#include "System/Config/ConfigHandler.h"
+#include "System/FileSystem/ArchiveScanner.h"
+#include "System/FileSystem/DataDirsAccess.h"
 #include "System/FileSystem/FileHandler.h"
+#include "System/FileSystem/FileQueryFlags.h"
 #include "System/FileSystem/FileSystem.h"
+#include "System/FileSystem/VFSHandler.h"
 
 using std::sprintf;
 
@@ -34,6 +41,13 @@ LOG_REGISTER_SECTION_GLOBAL(LOG_SECTION_SMF_GROUND_TEXTURES)
 #endif
 #define LOG_SECTION_CURRENT LOG_SECTION_SMF_GROUND_TEXTURES
 
+CONFIG(int, SMFTileCacheSize)
+	.defaultValue(128)
+	.minimumValue(16)
+	.description("Memory (in MB) for the ground texture tiles of SMF maps near the camera; the rest is loaded on demand.");
+
+static const std::string TILE_CACHE_DIR = "cache/maptiles/";
+
 
 CSMFGroundTextures::CSMFGroundTextures(CSMFReadMap* rm): smfMap(rm)
 {
@@ -52,12 +66,10 @@ CSMFGroundTextures::CSMFGroundTextures(CSMFReadMap* rm): smfMap(rm)
 	MapTileHeader tileHeader;
 	READPTR_MAPTILEHEADER(tileHeader, ifs);
 
-	tileMap.resize(smfMap->tileCount);
-	tiles.resize(tileHeader.numTiles * SMALL_TILE_SIZE);
+	std::vector<int> tileMap(smfMap->tileCount);
 	squares.resize(smfMap->numBigTexX * smfMap->numBigTexY);
 
 	bool smtHeaderOverride = false;
-	int curTile = 0;
 
 	if (!smf.smtFileNames.empty()) {
 		if (smf.smtFileNames.size() != tileHeader.numTileFiles) {
@@ -117,8 +129,7 @@ CSMFGroundTextures::CSMFGroundTextures(CSMFReadMap* rm): smfMap(rm)
 					"could not find .smt tile-file "
 					"\"%s\" (all %d missing tiles will be colored red)",
 					smtFilePath.c_str(), numSmallTiles);
-			memset(&tiles[curTile * SMALL_TILE_SIZE], 0xaa, numSmallTiles * SMALL_TILE_SIZE);
-			curTile += numSmallTiles;
+			tileFiles.AddMissing(numSmallTiles);
 			continue;
 		}
 
@@ -131,24 +142,28 @@ CSMFGroundTextures::CSMFGroundTextures(CSMFReadMap* rm): smfMap(rm)
 			throw content_error(t);
 		}
 
-		for (int b = 0; b < numSmallTiles; ++b) {
-			tileFile.Read(&tiles[curTile * SMALL_TILE_SIZE], SMALL_TILE_SIZE);
-			curTile++;
+		if (!tileFiles.AddFile(smtFilePath, tileFile.GetPos(), numSmallTiles)) {
+			LOG_L(L_WARNING,
+					".smt tile-file \"%s\" is truncated"
+					" (all %d tiles will be colored red)",
+					smtFilePath.c_str(), numSmallTiles);
 		}
 	}
 
 	loadscreen->SetLoadMessage("Reading Tile Map");
 
-	{
-		ifs->Read(&tileMap[0], smfMap->tileCount * sizeof(int));
-
-		for (int i = 0; i < smfMap->tileCount; i++) {
-			swabDWordInPlace(tileMap[i]);
-		}
-	}
+	file.ReadTileMap(&tileMap[0], ifs->GetPos(), smfMap->tileCount);
 
 	loadscreen->SetLoadMessage("Loading Square Textures");
 
+	tileCache = new CSMFTileCache(
+		&tileFiles,
+		tileMap,
+		smfMap->numBigTexX,
+		smfMap->numBigTexY,
+		size_t(configHandler->GetInt("SMFTileCacheSize")) * 1024 * 1024
+	);
+
 	for (int y = 0; y < smfMap->numBigTexY; ++y) {
 		for (int x = 0; x < smfMap->numBigTexX; ++x) {
 			GroundSquare* square = &squares[y * smfMap->numBigTexX + x];
@@ -229,6 +244,132 @@ CSMFGroundTextures::~CSMFGroundTextures(void)
 			glDeleteTextures(1, &squares[i].textureID);
 		}
 	}
+
+	const CSMFTileCache::Stats& stats = tileCache->GetStats();
+
+	LOG("[%s] tile cache: %u loads, %u evictions, %u KB resident (max. %u KB), miss latency avg. %u ms, max. %u ms",
+		__FUNCTION__, stats.numLoads, stats.numEvictions,
+		unsigned(stats.residentBytes / 1024), unsigned(stats.maxResidentBytes / 1024),
+		stats.totalMissLatency / std::max(1u, stats.numLoads), stats.maxMissLatency);
+
+	delete tileCache;
+}
+
+
+CSMFGroundTextures::TileFiles::TileFiles(): missingTile(SMALL_TILE_SIZE, char(0xaa)), numTiles(0)
+{
+}
+
+bool CSMFGroundTextures::TileFiles::AddFile(const std::string& filePath, int tileDataOffset, int numFileTiles)
+{
+	const size_t dataSize = size_t(numFileTiles) * SMALL_TILE_SIZE;
+
+	TileFile tf;
+	tf.offset = tileDataOffset;
+	tf.firstTile = numTiles;
+	tf.numTiles = numFileTiles;
+
+	bool haveView = false;
+
+	if (CFileHandler::FileExists(filePath, SPRING_VFS_RAW)) {
+		const std::string rawPath = dataDirsAccess.LocateFile(filePath);
+		haveView = tf.view.MapFile(rawPath, 0, FileSystem::GetFileSize(rawPath));
+	} else {
+		// files that are compressed in the map archive get an uncompressed
+		// copy in the cache-dir, which can be mapped instead of being held
+		// in memory as a whole
+		std::string cacheFileName;
+
+		const std::string archiveName = vfsHandler->GetFileArchiveName(filePath);
+		const unsigned int archiveChecksum = archiveName.empty()? 0: archiveScanner->GetSingleArchiveChecksum(archiveName);
+
+		if (archiveChecksum != 0 && FileSystem::CreateDirectory(TILE_CACHE_DIR)) {
+			const std::string lcName = StringToLower(filePath);
+
+			CRC crc;
+			crc << archiveChecksum;
+			crc.Update(lcName.c_str(), lcName.size() + 1);
+
+			char keyString[16] = {0};
+			sprintf(keyString, "%08x", crc.GetDigest());
+
+			cacheFileName = TILE_CACHE_DIR + keyString + ".smt";
+		}
+
+		const std::string cachePath = cacheFileName.empty()? "": dataDirsAccess.LocateFile(cacheFileName);
+
+		if (!cachePath.empty() && FileSystem::FileExists(cachePath) && FileSystem::GetFileSize(cachePath) == dataSize) {
+			haveView = tf.view.MapFile(cachePath, 0, dataSize);
+			tf.offset = 0;
+		}
+
+		if (!haveView) {
+			haveView = vfsHandler->LoadFileView(filePath, tf.view);
+
+			if (haveView && !tf.view.IsMapped() && !cacheFileName.empty() && tf.view.GetSize() >= (tf.offset + dataSize)) {
+				const std::string writePath = dataDirsAccess.LocateFile(cacheFileName, FileQueryFlags::WRITE);
+				const std::string tmpPath = writePath + ".tmp";
+
+				FILE* file = fopen(tmpPath.c_str(), "wb");
+				bool ret = (file != NULL);
+
+				if (ret) {
+					ret = (fwrite(tf.view.GetData() + tf.offset, dataSize, 1, file) == 1);
+					ret = (fclose(file) == 0) && ret;
+				}
+				// never expose a partially written file
+				if (ret) {
+					remove(writePath.c_str());
+					ret = (rename(tmpPath.c_str(), writePath.c_str()) == 0);
+				}
+
+				CFileView cacheView;
+
+				if (ret && cacheView.MapFile(writePath, 0, dataSize)) {
+					tf.view = cacheView;
+					tf.offset = 0;
+				} else {
+					// keep the decompressed copy
+					remove(tmpPath.c_str());
+				}
+			}
+		}
+	}
+
+	if (!haveView || tf.view.GetSize() < (tf.offset + dataSize)) {
+		AddMissing(numFileTiles);
+		return false;
+	}
+
+	files.push_back(tf);
+	numTiles += numFileTiles;
+	return true;
+}
+
+void CSMFGroundTextures::TileFiles::AddMissing(int numFileTiles)
+{
+	TileFile tf;
+	tf.offset = 0;
+	tf.firstTile = numTiles;
+	tf.numTiles = numFileTiles;
+
+	files.push_back(tf);
+	numTiles += numFileTiles;
+}
+
+const char* CSMFGroundTextures::TileFiles::GetTile(int tileIdx)
+{
+	for (std::vector<TileFile>::const_iterator it = files.begin(); it != files.end(); ++it) {
+		if (tileIdx < it->firstTile || tileIdx >= (it->firstTile + it->numTiles))
+			continue;
+
+		if (it->view.Empty())
+			break;
+
+		return (reinterpret_cast<const char*>(it->view.GetData()) + it->offset + size_t(tileIdx - it->firstTile) * SMALL_TILE_SIZE);
+	}
+
+	return &missingTile[0];
 }
 
 
@@ -256,6 +397,8 @@ void CSMFGroundTextures::DrawUpdate(void)
 	const float vsySq = globalRendering->viewSizeY * globalRendering->viewSizeY;
 	const float vdiag = fastmath::apxsqrt(vsxSq + vsySq);
 
+	tileCache->Update();
+
 	for (int y = 0; y < smfMap->numBigTexY; ++y) {
 		float dz = cam2->pos.z - (y * smfMap->bigSquareSize * SQUARE_SIZE);
 		dz -= (SQUARE_SIZE << 6);
@@ -329,6 +472,11 @@ void CSMFGroundTextures::DrawUpdate(void)
 			if (stretchFactors[y * smfMap->numBigTexX + x] > 16000 && wantedLevel > 0)
 				wantedLevel--;
 
+			// keep the current texture until the tiles are
+			// resident, the low-res level is always available
+			if (wantedLevel < CSMFTileCache::LOW_RES_LEVEL && !tileCache->Request(x, y))
+				continue;
+
 			if (square->texLevel != wantedLevel) {
 				glDeleteTextures(1, &square->textureID);
 				LoadSquareTexture(x, y, wantedLevel);
@@ -380,9 +528,11 @@ bool CSMFGroundTextures::GetSquareLuaTexture(int texSquareX, int texSquareY, int
 	const int mipSqSize = smfMap->bigTexSize >> texMipLevel;
 	const int numSqBytes = (mipSqSize * mipSqSize) / 2;
 
+	tileCache->RequestNow(texSquareX, texSquareY);
+
 	pbo.Bind();
 	pbo.Resize(numSqBytes);
-	ExtractSquareTiles(texSquareX, texSquareY, texMipLevel, (GLint*) pbo.MapBuffer());
+	tileCache->ExtractSquare(texSquareX, texSquareY, texMipLevel, (char*) pbo.MapBuffer());
 	pbo.UnmapBuffer();
 
 	glBindTexture(ttarget, texID);
@@ -395,48 +545,16 @@ bool CSMFGroundTextures::GetSquareLuaTexture(int texSquareX, int texSquareY, int
 
 
 
-void CSMFGroundTextures::ExtractSquareTiles(
-	const int texSquareX,
-	const int texSquareY,
-	const int mipLevel,
-	GLint* tileBuf
-) const {
-	static const int TILE_MIP_OFFSET[] = {0, 512, 640, 672};
-	static const int BLOCK_SIZE = 32;
-
-	const int mipOffset = TILE_MIP_OFFSET[mipLevel];
-	const int numBlocks = SQUARE_SIZE >> mipLevel;
-	const int tileOffsetX = texSquareX * BLOCK_SIZE;
-	const int tileOffsetY = texSquareY * BLOCK_SIZE;
-
-	// extract all 32x32 sub-blocks (tiles) in the 128x128 square
-	// (each 32x32 tile covers a (bigSquareSize = 32 * tileScale) x
-	// (bigSquareSize = 32 * tileScale) heightmap chunk)
-	for (int y1 = 0; y1 < BLOCK_SIZE; y1++) {
-		for (int x1 = 0; x1 < BLOCK_SIZE; x1++) {
-			const int tileX = tileOffsetX + x1;
-			const int tileY = tileOffsetY + y1;
-			const int tileIdx = tileMap[tileY * smfMap->tileMapSizeX + tileX];
-			const GLint* tile = (GLint*) &tiles[tileIdx * SMALL_TILE_SIZE + mipOffset];
-
-			const int doff = (x1 * numBlocks) + (y1 * numBlocks * numBlocks) * BLOCK_SIZE;
-
-			for (int b = 0; b < numBlocks; b++) {
-				const GLint* sbuf = &tile[b * numBlocks * 2];
-				      GLint* dbuf = &tileBuf[(doff + b * numBlocks * BLOCK_SIZE) * 2];
-
-				// at MIP level n: ((8 >> n) * 2 * 4) = (64 >> n) bytes for each <b>
-				memcpy(dbuf, sbuf, numBlocks * 2 * sizeof(GLint));
-			}
-		}
-	}
-}
-
 void CSMFGroundTextures::LoadSquareTexture(int x, int y, int level)
 {
 	static const GLenum ttarget = GL_TEXTURE_2D;
 	static const GLenum tformat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
 
+	// the tiles can have been evicted since DrawUpdate asked for them
+	if (level < CSMFTileCache::LOW_RES_LEVEL && !tileCache->Request(x, y)) {
+		level = CSMFTileCache::LOW_RES_LEVEL;
+	}
+
 	const int mipSqSize = smfMap->bigTexSize >> level;
 	const int numSqBytes = (mipSqSize * mipSqSize) / 2;
 
@@ -445,7 +563,7 @@ void CSMFGroundTextures::LoadSquareTexture(int x, int y, int level)
 
 	pbo.Bind();
 	pbo.Resize(numSqBytes);
-	ExtractSquareTiles(x, y, level, (GLint*) pbo.MapBuffer());
+	tileCache->ExtractSquare(x, y, level, (char*) pbo.MapBuffer());
 	pbo.UnmapBuffer();
 
 	glGenTextures(1, &square->textureID);
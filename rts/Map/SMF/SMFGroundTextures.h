@@ -3,8 +3,10 @@
 #ifndef _SMF_GROUND_TEXTURES_H_
 #define _SMF_GROUND_TEXTURES_H_
 
+#include "SMFTileCache.h"
 #include "Map/BaseGroundTextures.h"
 #include "Rendering/GL/PBO.h"
+#include "System/FileSystem/FileView.h"
 
 class CFileHandler;
 class CSMFReadMap;
@@ -21,9 +23,37 @@ public:
 	void BindSquareTexture(int texSquareX, int texSquareY);
 
 protected:
-	void ExtractSquareTiles(const int texSquareX, const int texSquareY, const int mipLevel, GLint* tileBuf) const;
 	void LoadSquareTexture(int x, int y, int level);
 
+	/// the .smt files of the map, memory-mapped where possible
+	class TileFiles: public CSMFTileCache::ITileSource {
+	public:
+		TileFiles();
+
+		/**
+		 * @param tileDataOffset position of the first tile in the file
+		 * @return false if the tiles could not be read, they are
+		 *   added as missing then
+		 */
+		bool AddFile(const std::string& filePath, int tileDataOffset, int numFileTiles);
+		/// tiles of files that could not be found, drawn red
+		void AddMissing(int numFileTiles);
+
+		const char* GetTile(int tileIdx);
+
+	private:
+		struct TileFile {
+			CFileView view;
+			size_t offset;
+			int firstTile;
+			int numTiles;
+		};
+
+		std::vector<TileFile> files;
+		std::vector<char> missingTile;
+		int numTiles;
+	};
+
 	CSMFReadMap* smfMap;
 
 	struct GroundSquare {
@@ -35,8 +65,8 @@ protected:
 
 	std::vector<GroundSquare> squares;
 
-	std::vector<int> tileMap;
-	std::vector<char> tiles;
+	TileFiles tileFiles;
+	CSMFTileCache* tileCache;
 
 	//! FIXME? these are not updated at runtime
 	std::vector<float> heightMaxima;
@@ -36,6 +36,11 @@ void CSMFMapFile::ReadMinimap(void* data)
 	ifs.Read(data, MINIMAP_SIZE);
 }
 
+const boost::uint8_t* CSMFMapFile::GetMinimapData(std::vector<boost::uint8_t>& buffer)
+{
+	return GetFileData(header.minimapPtr, MINIMAP_SIZE, buffer);
+}
+
 int CSMFMapFile::ReadMinimap(std::vector<boost::uint8_t>& data, unsigned miplevel)
 {
 	int offset=0;
@@ -73,16 +78,45 @@ void CSMFMapFile::ReadHeightmap(float* heightmap, float base, float mod)
 {
 	const int hmx = header.mapx + 1;
 	const int hmy = header.mapy + 1;
-	unsigned short* temphm = new unsigned short[hmx * hmy];
 
-	ifs.Seek(header.heightmapPtr);
-	ifs.Read(temphm, hmx * hmy * 2);
+	std::vector<boost::uint8_t> buffer;
+	const boost::uint8_t* data = GetFileData(header.heightmapPtr, hmx * hmy * sizeof(short), buffer);
 
 	for (int y = 0; y < hmx * hmy; ++y) {
-		heightmap[y] = base + swabWord(temphm[y]) * mod;
+		// the map file gives no alignment guarantees
+		unsigned short h;
+		memcpy(&h, data + y * sizeof(short), sizeof(short));
+		heightmap[y] = base + swabWord(h) * mod;
 	}
+}
+
+
+void CSMFMapFile::ReadTileMap(int* tileMap, int pos, int numTiles)
+{
+	std::vector<boost::uint8_t> buffer;
+	const boost::uint8_t* data = GetFileData(pos, numTiles * sizeof(int), buffer);
+
+	for (int i = 0; i < numTiles; ++i) {
+		// the map file gives no alignment guarantees
+		int tile;
+		memcpy(&tile, data + i * sizeof(int), sizeof(int));
+		tileMap[i] = swabDWord(tile);
+	}
+}
+
+
+const boost::uint8_t* CSMFMapFile::GetFileData(int pos, int size, std::vector<boost::uint8_t>& buffer)
+{
+	const boost::uint8_t* data = ifs.GetData(pos, size);
+
+	if (data != NULL)
+		return data;
+
+	buffer.resize(size, 0);
 
-	delete[] temphm;
+	ifs.Seek(pos);
+	ifs.Read(&buffer[0], size);
+	return &buffer[0];
 }
 
 
@@ -19,10 +19,18 @@ public:
 	CSMFMapFile(const std::string& mapFileName);
 
 	void ReadMinimap(void* data);
+	/**
+	 * @return pointer to the minimap (all mip levels, MINIMAP_SIZE bytes);
+	 *   points into the map file if it is held in memory, otherwise the
+	 *   minimap is read into buffer
+	 */
+	const boost::uint8_t* GetMinimapData(std::vector<boost::uint8_t>& buffer);
 	/// @return mip size
 	int ReadMinimap(std::vector<boost::uint8_t>& data, unsigned miplevel);
 	void ReadHeightmap(unsigned short* heightmap);
 	void ReadHeightmap(float* heightmap, float base, float mod);
+	/// reads numTiles tile indices starting at pos (the tile map follows the tile-file names)
+	void ReadTileMap(int* tileMap, int pos, int numTiles);
 	void ReadFeatureInfo();
 	void ReadFeatureInfo(MapFeatureInfo* f);
 	void GetInfoMapSize(const std::string& name, MapBitmapInfo*) const;
@@ -43,6 +51,8 @@ public:
 
 private:
 	void ReadGrassMap(void* data);
+	/// like GetMinimapData, for size bytes starting at pos
+	const boost::uint8_t* GetFileData(int pos, int size, std::vector<boost::uint8_t>& buffer);
 
 	SMFHeader header;
 	CFileHandler ifs;
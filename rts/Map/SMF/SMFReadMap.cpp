@@ -186,8 +186,8 @@ CSMFReadMap::CSMFReadMap(std::string mapname): file(mapname)
 
 	{
 		// the minimap is a static texture
-		std::vector<unsigned char> minimapTexBuf(MINIMAP_SIZE, 0);
-		file.ReadMinimap(&minimapTexBuf[0]);
+		std::vector<boost::uint8_t> minimapTexBuf;
+		const boost::uint8_t* minimapTexData = file.GetMinimapData(minimapTexBuf);
 
 		glGenTextures(1, &minimapTex);
 		glBindTexture(GL_TEXTURE_2D, minimapTex);
@@ -198,7 +198,7 @@ CSMFReadMap::CSMFReadMap(std::string mapname): file(mapname)
 		for (unsigned int i = 0; i < MINIMAP_NUM_MIPMAP; i++) {
 			const int mipsize = 1024 >> i;
 			const int size = ((mipsize + 3) / 4) * ((mipsize + 3) / 4) * 8;
-			glCompressedTexImage2DARB(GL_TEXTURE_2D, i, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, mipsize, mipsize, 0, size, &minimapTexBuf[0] + offset);
+			glCompressedTexImage2DARB(GL_TEXTURE_2D, i, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, mipsize, mipsize, 0, size, minimapTexData + offset);
 			offset += size;
 		}
 	}
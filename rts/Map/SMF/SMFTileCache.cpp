@@ -0,0 +1,283 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "SMFTileCache.h"
+#include "SMFFormat.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+const int CSMFTileCache::SQUARE_BYTES = SQUARE_TILES * SQUARE_TILES * SMALL_TILE_SIZE;
+
+// byte offsets of the mip levels inside a tile
+static const int TILE_MIP_OFFSET[] = {0, 512, 640, 672};
+// DXT1 blocks (4x4 pixels, 8 bytes) per side of a tile at mip level 0
+static const int TILE_BLOCKS = 8;
+static const int DXT1_BLOCK_BYTES = 8;
+
+static const int LOW_RES_SQUARE_BYTES =
+	CSMFTileCache::SQUARE_TILES * CSMFTileCache::SQUARE_TILES *
+	(TILE_BLOCKS >> CSMFTileCache::LOW_RES_LEVEL) * (TILE_BLOCKS >> CSMFTileCache::LOW_RES_LEVEL) * DXT1_BLOCK_BYTES;
+
+
+CSMFTileCache::CSMFTileCache(
+	ITileSource* source,
+	const std::vector<int>& tileMap,
+	int numSquaresX,
+	int numSquaresY,
+	size_t maxBytes,
+	bool async
+)
+	: source(source)
+	, tileMap(tileMap)
+	, numSquaresX(numSquaresX)
+	, numSquaresY(numSquaresY)
+	, stopLoader(false)
+	, loader(NULL)
+{
+	assert(tileMap.size() == size_t(numSquaresX * numSquaresY * SQUARE_TILES * SQUARE_TILES));
+
+	stats.maxResidentBytes = maxBytes;
+
+	// this reads every tile once, the operating system
+	// may drop them from memory again right afterwards
+	lowResSquares.resize(numSquaresX * numSquaresY * LOW_RES_SQUARE_BYTES);
+
+	for (int y = 0; y < numSquaresY; ++y) {
+		for (int x = 0; x < numSquaresX; ++x) {
+			ExtractTiles(NULL, x, y, LOW_RES_LEVEL, &lowResSquares[(y * numSquaresX + x) * LOW_RES_SQUARE_BYTES]);
+		}
+	}
+
+	if (async) {
+		loader = new boost::thread(boost::bind(&CSMFTileCache::LoaderThread, this));
+	}
+}
+
+CSMFTileCache::~CSMFTileCache()
+{
+	if (loader != NULL) {
+		{
+			boost::mutex::scoped_lock lock(loaderMutex);
+			stopLoader = true;
+		}
+		loaderCond.notify_all();
+
+		loader->join();
+		delete loader;
+	}
+}
+
+
+void CSMFTileCache::Update()
+{
+	std::deque<LoadedSquare> loaded;
+
+	{
+		boost::mutex::scoped_lock lock(loaderMutex);
+		loaded.swap(loadedSquares);
+	}
+
+	for (std::deque<LoadedSquare>::iterator it = loaded.begin(); it != loaded.end(); ++it) {
+		if (residentSquares.find(it->idx) != residentSquares.end())
+			continue;
+
+		AddResident(it->idx, it->data);
+	}
+
+	while (stats.residentBytes > stats.maxResidentBytes && !lruSquares.empty()) {
+		const int idx = lruSquares.back();
+
+		lruSquares.pop_back();
+		residentSquares.erase(idx);
+
+		stats.numResident -= 1;
+		stats.residentBytes -= SQUARE_BYTES;
+		stats.numEvictions += 1;
+	}
+}
+
+
+bool CSMFTileCache::Request(int sqx, int sqy)
+{
+	const int idx = sqy * numSquaresX + sqx;
+	const std::map<int, ResidentSquare>::iterator it = residentSquares.find(idx);
+
+	if (it != residentSquares.end()) {
+		lruSquares.splice(lruSquares.begin(), lruSquares, it->second.lruPos);
+		stats.numHits += 1;
+		return true;
+	}
+
+	if (pendingSquares.find(idx) != pendingSquares.end())
+		return false;
+
+	pendingSquares[idx] = boost::posix_time::microsec_clock::universal_time();
+	stats.numMisses += 1;
+
+	if (loader == NULL) {
+		std::vector<char> block;
+		LoadSquare(idx, block);
+		AddResident(idx, block);
+		return true;
+	}
+
+	{
+		boost::mutex::scoped_lock lock(loaderMutex);
+		loaderQueue.push_back(idx);
+	}
+	loaderCond.notify_one();
+	return false;
+}
+
+void CSMFTileCache::RequestNow(int sqx, int sqy)
+{
+	const int idx = sqy * numSquaresX + sqx;
+
+	if (residentSquares.find(idx) != residentSquares.end())
+		return;
+
+	if (pendingSquares.find(idx) == pendingSquares.end()) {
+		pendingSquares[idx] = boost::posix_time::microsec_clock::universal_time();
+		stats.numMisses += 1;
+	}
+
+	// if it is queued too, the loaded copy gets dropped in Update
+	std::vector<char> block;
+	LoadSquare(idx, block);
+	AddResident(idx, block);
+}
+
+
+bool CSMFTileCache::ExtractSquare(int sqx, int sqy, int mipLevel, char* dst)
+{
+	assert(mipLevel >= 0 && mipLevel <= LOW_RES_LEVEL);
+
+	const int idx = sqy * numSquaresX + sqx;
+
+	if (mipLevel == LOW_RES_LEVEL) {
+		memcpy(dst, &lowResSquares[idx * LOW_RES_SQUARE_BYTES], LOW_RES_SQUARE_BYTES);
+		return true;
+	}
+
+	const std::map<int, ResidentSquare>::iterator it = residentSquares.find(idx);
+
+	if (it == residentSquares.end())
+		return false;
+
+	lruSquares.splice(lruSquares.begin(), lruSquares, it->second.lruPos);
+	ExtractTiles(&it->second.data[0], sqx, sqy, mipLevel, dst);
+	return true;
+}
+
+
+void CSMFTileCache::LoaderThread()
+{
+	while (true) {
+		int idx = 0;
+
+		{
+			boost::mutex::scoped_lock lock(loaderMutex);
+
+			while (loaderQueue.empty() && !stopLoader) {
+				loaderCond.wait(lock);
+			}
+
+			if (stopLoader)
+				return;
+
+			idx = loaderQueue.front();
+			loaderQueue.pop_front();
+		}
+
+		std::vector<char> block;
+		LoadSquare(idx, block);
+
+		{
+			boost::mutex::scoped_lock lock(loaderMutex);
+
+			loadedSquares.push_back(LoadedSquare());
+			loadedSquares.back().idx = idx;
+			loadedSquares.back().data.swap(block);
+		}
+	}
+}
+
+void CSMFTileCache::LoadSquare(int idx, std::vector<char>& block)
+{
+	const int sqx = idx % numSquaresX;
+	const int sqy = idx / numSquaresX;
+
+	block.resize(SQUARE_BYTES);
+
+	for (int ty = 0; ty < SQUARE_TILES; ++ty) {
+		for (int tx = 0; tx < SQUARE_TILES; ++tx) {
+			memcpy(&block[(ty * SQUARE_TILES + tx) * SMALL_TILE_SIZE], GetTile(NULL, sqx, sqy, tx, ty), SMALL_TILE_SIZE);
+		}
+	}
+}
+
+void CSMFTileCache::AddResident(int idx, std::vector<char>& block)
+{
+	const std::map<int, boost::posix_time::ptime>::iterator pit = pendingSquares.find(idx);
+
+	if (pit != pendingSquares.end()) {
+		const unsigned int latency = (boost::posix_time::microsec_clock::universal_time() - pit->second).total_milliseconds();
+
+		stats.totalMissLatency += latency;
+		stats.maxMissLatency = std::max(stats.maxMissLatency, latency);
+		pendingSquares.erase(pit);
+	}
+
+	lruSquares.push_front(idx);
+
+	ResidentSquare& square = residentSquares[idx];
+	square.data.swap(block);
+	square.lruPos = lruSquares.begin();
+
+	stats.numResident += 1;
+	stats.residentBytes += SQUARE_BYTES;
+	stats.numLoads += 1;
+}
+
+
+const char* CSMFTileCache::GetTile(const char* block, int sqx, int sqy, int tx, int ty) const
+{
+	if (block != NULL)
+		return (block + (ty * SQUARE_TILES + tx) * SMALL_TILE_SIZE);
+
+	const int tileMapSizeX = numSquaresX * SQUARE_TILES;
+	const int tileX = sqx * SQUARE_TILES + tx;
+	const int tileY = sqy * SQUARE_TILES + ty;
+
+	return (source->GetTile(tileMap[tileY * tileMapSizeX + tileX]));
+}
+
+void CSMFTileCache::ExtractTiles(const char* block, int sqx, int sqy, int mipLevel, char* dst) const
+{
+	const int mipOffset = TILE_MIP_OFFSET[mipLevel];
+	const int numBlocks = TILE_BLOCKS >> mipLevel;
+
+	// extract all 32x32 sub-blocks (tiles) in the square
+	// (each 32x32 tile covers a (bigSquareSize = 32 * tileScale) x
+	// (bigSquareSize = 32 * tileScale) heightmap chunk)
+	for (int ty = 0; ty < SQUARE_TILES; ty++) {
+		for (int tx = 0; tx < SQUARE_TILES; tx++) {
+			const char* tile = GetTile(block, sqx, sqy, tx, ty) + mipOffset;
+
+			// offset of the tile in the square, in DXT1 blocks
+			const int doff = (tx * numBlocks) + (ty * numBlocks * numBlocks) * SQUARE_TILES;
+
+			for (int b = 0; b < numBlocks; b++) {
+				const char* sbuf = &tile[b * numBlocks * DXT1_BLOCK_BYTES];
+				      char* dbuf = &dst[(doff + b * numBlocks * SQUARE_TILES) * DXT1_BLOCK_BYTES];
+
+				// at MIP level n: ((8 >> n) * 8) = (64 >> n) bytes for each <b>
+				memcpy(dbuf, sbuf, numBlocks * DXT1_BLOCK_BYTES);
+			}
+		}
+	}
+}
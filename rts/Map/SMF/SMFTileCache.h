@@ -0,0 +1,158 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _SMF_TILE_CACHE_H_
+#define _SMF_TILE_CACHE_H_
+
+#include <deque>
+#include <list>
+#include <map>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace boost {
+	class thread;
+}
+
+/**
+ * CPU-side residency of the compressed (DXT1) ground texture tiles of a SMF
+ * map.
+ * Only the tiles of the big squares that were recently needed at a high
+ * resolution are kept in memory, as one block per square; missing blocks
+ * are loaded by a background thread. The lowest mip level of every square
+ * is always resident, so there is always something to draw.
+ * Does not use OpenGL, so it works (and can be tested) without a GPU.
+ */
+class CSMFTileCache
+{
+public:
+	/// Provides the tile data, called from the loader thread
+	class ITileSource {
+	public:
+		virtual ~ITileSource() {}
+		/// @return SMALL_TILE_SIZE bytes (all mip levels) of tile tileIdx
+		virtual const char* GetTile(int tileIdx) = 0;
+	};
+
+	struct Stats {
+		Stats()
+			: numResident(0)
+			, residentBytes(0)
+			, maxResidentBytes(0)
+			, numHits(0)
+			, numMisses(0)
+			, numLoads(0)
+			, numEvictions(0)
+			, totalMissLatency(0)
+			, maxMissLatency(0)
+		{}
+
+		unsigned int numResident;
+		size_t residentBytes;
+		size_t maxResidentBytes;
+
+		unsigned int numHits;
+		unsigned int numMisses;
+		unsigned int numLoads;
+		unsigned int numEvictions;
+		/// time in ms from the first request of a square until it got resident
+		unsigned int totalMissLatency;
+		unsigned int maxMissLatency;
+	};
+
+	/// tiles per big square side
+	static const int SQUARE_TILES = 32;
+	/// bytes of a resident square block
+	static const int SQUARE_BYTES;
+	/// the mip level that is always available
+	static const int LOW_RES_LEVEL = 3;
+
+	/**
+	 * @param tileMap tile index of every tile position, row-major
+	 * @param maxBytes budget for the resident square blocks
+	 * @param async false loads missing blocks right away in Request, for tests
+	 */
+	CSMFTileCache(
+		ITileSource* source,
+		const std::vector<int>& tileMap,
+		int numSquaresX,
+		int numSquaresY,
+		size_t maxBytes,
+		bool async = true
+	);
+	~CSMFTileCache();
+
+	/**
+	 * Takes over the squares that finished loading and evicts the least
+	 * recently used ones beyond the budget; call once per draw frame.
+	 */
+	void Update();
+
+	/**
+	 * @return true if the square can be extracted at any mip level;
+	 *   otherwise it gets queued for loading
+	 */
+	bool Request(int sqx, int sqy);
+	/// Loads the square on the calling thread if it is not resident
+	void RequestNow(int sqx, int sqy);
+
+	/**
+	 * Writes the DXT1 data of a square at a mip level to dst
+	 * (((SQUARE_TILES * 32) >> mipLevel)^2 / 2 bytes).
+	 * @return false if mipLevel < LOW_RES_LEVEL and the square
+	 *   is not resident
+	 */
+	bool ExtractSquare(int sqx, int sqy, int mipLevel, char* dst);
+
+	const Stats& GetStats() const { return stats; }
+
+private:
+	struct LoadedSquare {
+		int idx;
+		std::vector<char> data;
+	};
+
+	struct ResidentSquare {
+		std::vector<char> data;
+		std::list<int>::iterator lruPos;
+	};
+
+	void LoaderThread();
+	void LoadSquare(int idx, std::vector<char>& block);
+	void AddResident(int idx, std::vector<char>& block);
+
+	const char* GetTile(const char* block, int sqx, int sqy, int tx, int ty) const;
+	void ExtractTiles(const char* block, int sqx, int sqy, int mipLevel, char* dst) const;
+
+private:
+	ITileSource* source;
+	const std::vector<int> tileMap;
+
+	const int numSquaresX;
+	const int numSquaresY;
+
+	/// LOW_RES_LEVEL data of all squares
+	std::vector<char> lowResSquares;
+
+	std::map<int, ResidentSquare> residentSquares;
+	/// most recently used first
+	std::list<int> lruSquares;
+
+	/// requested squares that are not resident yet, with the time of the first request
+	std::map<int, boost::posix_time::ptime> pendingSquares;
+
+	// shared with the loader thread
+	boost::mutex loaderMutex;
+	boost::condition_variable loaderCond;
+	std::deque<int> loaderQueue;
+	std::deque<LoadedSquare> loadedSquares;
+	bool stopLoader;
+
+	boost::thread* loader;
+
+	Stats stats;
+};
+
+#endif // _SMF_TILE_CACHE_H_
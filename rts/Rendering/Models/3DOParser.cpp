@@ -172,6 +172,15 @@ S3DModel* C3DOParser::Load(const std::string& name)
 }
 
 
+S3DModel* C3DOParser::Parse(const std::string& name)
+{
+	// Load keeps its read-state in members, so let every caller work on
+	// its own copy; texture lookups only read the already built 3DO atlas
+	C3DOParser parser(*this);
+	return parser.Load(name);
+}
+
+
 void C3DOParser::GetVertexes(_3DObject* o, S3DOPiece* object)
 {
 	curOffset = o->OffsetToVertexArray;
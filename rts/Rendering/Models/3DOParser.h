@@ -98,6 +98,7 @@ public:
 	C3DOParser();
 
 	S3DModel* Load(const std::string& name);
+	S3DModel* Parse(const std::string& name);
 
 private:
 	void CalcNormals(S3DOPiece* o) const;
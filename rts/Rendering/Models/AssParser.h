@@ -63,6 +63,13 @@ public:
 };
 
 
+/**
+ * Unlike CS3OParser, this does not cache its models on disk: the pieces
+ * depend on more than the model file, namely on the Lua meta-file (which
+ * can read anything else in the VFS) and, through the mesh splitting, on
+ * the GL limits of the machine. A cache key covering all of that would
+ * have to run the meta-file anyway.
+ */
 class CAssParser: public IModelParser
 {
 public:
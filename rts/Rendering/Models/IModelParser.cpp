@@ -19,6 +19,10 @@
 #include "System/Util.h"
 #include "System/Log/ILog.h"
 #include "System/Exceptions.h"
+#include "System/ThreadPool.h"
+#include "System/TimeProfiler.h"
+
+#include <boost/bind.hpp>
 
 C3DModelLoader* modelParser = NULL;
 
@@ -104,6 +108,14 @@ C3DModelLoader::~C3DModelLoader()
 	}
 	cache.clear();
 
+	for (ci = preloaded.begin(); ci != preloaded.end(); ++ci) {
+		S3DModel* model = ci->second;
+
+		DeleteChilds(model->GetRootPiece());
+		delete model;
+	}
+	preloaded.clear();
+
 	// get rid of Spring's native parsers
 	delete parsers["3do"]; parsers.erase("3do");
 	delete parsers["s3o"]; parsers.erase("s3o");
@@ -147,19 +159,30 @@ S3DModel* C3DModelLoader::Load3DModel(std::string name, const float3& centerOffs
 		S3DModel* model = NULL;
 		S3DModelPiece* root = NULL;
 
-		try {
-			model = p->Load(name);
+		const ModelMap::iterator pmi = preloaded.find(name);
+
+		if (pmi != preloaded.end()) {
+			//! already parsed, only the main-thread part is left
+			model = pmi->second;
+			preloaded.erase(pmi);
+
+			p->Finalize(model);
 			model->relMidPos += centerOffset;
-		} catch (const content_error& ex) {
-			// crash-dummy
-			model = new S3DModel();
-			model->type = ModelExtToModelType(parsers, StringToLower(fileExt));
-			model->numPieces = 1;
-			model->SetRootPiece(ModelTypeToModelPiece(model->type));
-			model->GetRootPiece()->SetCollisionVolume(new CollisionVolume("box", UpVector * -1.0f, ZeroVector, CollisionVolume::COLVOL_HITTEST_CONT));
-
-			LOG_L(L_WARNING, "could not load model \"%s\" (reason: %s)",
-					name.c_str(), ex.what());
+		} else {
+			try {
+				model = p->Load(name);
+				model->relMidPos += centerOffset;
+			} catch (const content_error& ex) {
+				// crash-dummy
+				model = new S3DModel();
+				model->type = ModelExtToModelType(parsers, StringToLower(fileExt));
+				model->numPieces = 1;
+				model->SetRootPiece(ModelTypeToModelPiece(model->type));
+				model->GetRootPiece()->SetCollisionVolume(new CollisionVolume("box", UpVector * -1.0f, ZeroVector, CollisionVolume::COLVOL_HITTEST_CONT));
+
+				LOG_L(L_WARNING, "could not load model \"%s\" (reason: %s)",
+						name.c_str(), ex.what());
+			}
 		}
 
 		if ((root = model->GetRootPiece()) != NULL) {
@@ -176,6 +199,78 @@ S3DModel* C3DModelLoader::Load3DModel(std::string name, const float3& centerOffs
 	return NULL;
 }
 
+
+void C3DModelLoader::PreloadModels(const std::vector<std::string>& names)
+{
+	ScopedOnceTimer timer("3DModelLoader::PreloadModels");
+
+	std::vector<std::string> modelNames;
+	std::set<std::string> uniqueNames;
+
+	for (std::vector<std::string>::const_iterator it = names.begin(); it != names.end(); ++it) {
+		const std::string name = StringToLower(*it);
+		const ParserMap::const_iterator pi = parsers.find(FileSystem::GetExtension(name));
+
+		if (pi == parsers.end())
+			continue;
+		if (cache.find(name) != cache.end() || preloaded.find(name) != preloaded.end())
+			continue;
+		if (!uniqueNames.insert(name).second)
+			continue;
+
+		modelNames.push_back(name);
+	}
+
+	std::vector<S3DModel*> models(modelNames.size(), NULL);
+
+	ThreadPool::for_mt(0, modelNames.size(), boost::bind(&C3DModelLoader::PreloadModel, this, boost::cref(modelNames), boost::ref(models), _1));
+
+	unsigned int numPreloaded = 0;
+
+	for (size_t n = 0; n < modelNames.size(); n++) {
+		if (models[n] == NULL)
+			continue;
+
+		preloaded[modelNames[n]] = models[n];
+		numPreloaded++;
+	}
+
+	LOG("[%s] preloaded %u of %u models", __FUNCTION__, numPreloaded, (unsigned int) modelNames.size());
+}
+
+
+bool C3DModelLoader::AllCached(const std::vector<std::string>& names) const
+{
+	for (std::vector<std::string>::const_iterator it = names.begin(); it != names.end(); ++it) {
+		const std::string name = StringToLower(*it);
+		const ParserMap::const_iterator pi = parsers.find(FileSystem::GetExtension(name));
+
+		if (pi == parsers.end())
+			continue;
+		if (cache.find(name) != cache.end() || preloaded.find(name) != preloaded.end())
+			continue;
+		if (!pi->second->IsCached(name))
+			return false;
+	}
+
+	return true;
+}
+
+
+void C3DModelLoader::PreloadModel(const std::vector<std::string>& names, std::vector<S3DModel*>& models, int idx)
+{
+	// runs on a worker thread, so only touch parsers (read-only) and models[idx]
+	const std::string& name = names[idx];
+	const ParserMap::const_iterator pi = parsers.find(FileSystem::GetExtension(name));
+
+	try {
+		models[idx] = pi->second->Parse(name);
+	} catch (const std::exception&) {
+		// Load3DModel will try again and report the error
+		models[idx] = NULL;
+	}
+}
+
 void C3DModelLoader::Update() {
 #if defined(USE_GML) && GML_ENABLE_SIM && !GML_SHARE_LISTS
 	GML_RECMUTEX_LOCK(model); // Update
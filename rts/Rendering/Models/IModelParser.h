@@ -16,6 +16,17 @@ class IModelParser
 {
 public:
 	virtual S3DModel* Load(const std::string& name) = 0;
+	/**
+	 * Does the part of Load that needs neither GL nor other shared state
+	 * (reading the file, piece tree, normals, tangents, extents), so it
+	 * can be called from any thread; the model must then be passed to
+	 * Finalize on the main thread before use.
+	 * @return NULL if the format can not be parsed this way
+	 */
+	virtual S3DModel* Parse(const std::string& name) { return NULL; }
+	virtual void Finalize(S3DModel* model) {}
+	/// @return true if Parse can restore the model from a cache instead of reading it
+	virtual bool IsCached(const std::string& name) { return false; }
 };
 
 
@@ -30,6 +41,15 @@ public:
 
 	void Update();
 	S3DModel* Load3DModel(std::string name, const float3& centerOffset = ZeroVector);
+	/**
+	 * Parses the given models on all cores without touching GL and keeps
+	 * them until Load3DModel requests them, which then only has to do the
+	 * texture and display-list work. Models that fail to parse here are
+	 * simply loaded (and reported) the usual way later.
+	 */
+	void PreloadModels(const std::vector<std::string>& names);
+	/// @return true if all the given models can be restored from a cache (see IModelParser::IsCached)
+	bool AllCached(const std::vector<std::string>& names) const;
 
 	void DeleteLocalModel(CUnit* unit);
 	void CreateLocalModel(CUnit* unit);
@@ -41,6 +61,8 @@ private:
 	// FIXME make some static?
 	ModelMap cache;
 	ParserMap parsers;
+	/// parsed by PreloadModels, but not yet requested
+	ModelMap preloaded;
 
 #if defined(USE_GML) && GML_ENABLE_SIM && !GML_SHARE_LISTS
 	std::vector<S3DModelPiece*> createLists;
@@ -54,6 +76,8 @@ private:
 
 	void DeleteChilds(S3DModelPiece* o);
 
+	void PreloadModel(const std::vector<std::string>& names, std::vector<S3DModel*>& models, int idx);
+
 	void SetLocalModelPieceDisplayLists(CUnit* unit);
 	void SetLocalModelPieceDisplayLists(S3DModelPiece* model, LocalModel* lmodel, int* piecenum);
 };
@@ -1,27 +1,234 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
 #include <cctype>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
 #include <stdexcept>
 #include "System/mmgr.h"
 
 #include "S3OParser.h"
 #include "s3o.h"
+#include "3DModelLog.h"
+#include "Game/GameVersion.h"
 #include "Game/GlobalUnsynced.h"
 #include "Rendering/GL/myGL.h"
 #include "Rendering/Textures/S3OTextureHandler.h"
 #include "Sim/Misc/CollisionVolume.h"
 #include "Sim/Projectiles/ProjectileHandler.h"
+#include "System/CRC.h"
 #include "System/Exceptions.h"
 #include "System/Util.h"
 #include "System/Vec2.h"
+#include "System/Config/ConfigHandler.h"
+#include "System/FileSystem/ArchiveScanner.h"
+#include "System/FileSystem/DataDirsAccess.h"
 #include "System/FileSystem/FileHandler.h"
+#include "System/FileSystem/FileQueryFlags.h"
+#include "System/FileSystem/FileSystem.h"
+#include "System/FileSystem/FileView.h"
+#include "System/FileSystem/VFSHandler.h"
+#include "System/Log/ILog.h"
 #include "System/Platform/byteorder.h"
 
+CONFIG(bool, UseModelCache).defaultValue(true);
+
 static const float3 DEF_MIN_SIZE( 10000.0f,  10000.0f,  10000.0f);
 static const float3 DEF_MAX_SIZE(-10000.0f, -10000.0f, -10000.0f);
 
+static const std::string MODEL_CACHE_DIR = "cache/models/";
+
+// bump whenever the layout written by S3OCacheWriter changes
+static const unsigned int MODEL_CACHE_VERSION = 1;
+static const char MODEL_CACHE_MAGIC[4] = {'S', '3', 'O', 'C'};
+static const unsigned int MODEL_CACHE_MAX_DEPTH = 256;
+
+
+
+// cache-files never leave this machine, so everything is stored in native
+// byte order; the key check rejects files written by other engine versions
+struct S3OCacheWriter {
+	template<typename T> void Write(const T& value) {
+		const char* p = reinterpret_cast<const char*>(&value);
+		data.insert(data.end(), p, p + sizeof(T));
+	}
+	template<typename T> void WriteVector(const std::vector<T>& values) {
+		Write(boost::uint32_t(values.size()));
+
+		if (!values.empty()) {
+			const char* p = reinterpret_cast<const char*>(&values[0]);
+			data.insert(data.end(), p, p + values.size() * sizeof(T));
+		}
+	}
+	void WriteString(const std::string& str) {
+		Write(boost::uint32_t(str.size()));
+		data.insert(data.end(), str.begin(), str.end());
+	}
+
+	void WritePiece(const SS3OPiece* piece) {
+		WriteString(piece->name);
+		Write(piece->offset);
+		Write(piece->goffset);
+		Write(piece->mins);
+		Write(piece->maxs);
+		Write(boost::int32_t(piece->primitiveType));
+		WriteVector(piece->vertices);
+		WriteVector(piece->vertexDrawOrder);
+		WriteVector(piece->sTangents);
+		WriteVector(piece->tTangents);
+		Write(boost::uint32_t(piece->childs.size()));
+
+		for (unsigned int n = 0; n < piece->childs.size(); n++) {
+			WritePiece(static_cast<const SS3OPiece*>(piece->childs[n]));
+		}
+	}
+
+	std::vector<char> data;
+};
+
+struct S3OCacheReader {
+	S3OCacheReader(const char* begin, const char* end): pos(begin), end(end) {}
+
+	template<typename T> bool Read(T& value) {
+		if ((end - pos) < ptrdiff_t(sizeof(T)))
+			return false;
+
+		memcpy(&value, pos, sizeof(T));
+		pos += sizeof(T);
+		return true;
+	}
+	template<typename T> bool ReadVector(std::vector<T>& values) {
+		boost::uint32_t size = 0;
+
+		if (!Read(size))
+			return false;
+		if (size_t(end - pos) / sizeof(T) < size)
+			return false;
+
+		values.resize(size);
+
+		if (size > 0) {
+			memcpy(&values[0], pos, size * sizeof(T));
+			pos += (size * sizeof(T));
+		}
+
+		return true;
+	}
+	bool ReadString(std::string& str) {
+		boost::uint32_t size = 0;
+
+		if (!Read(size))
+			return false;
+		if (size_t(end - pos) < size)
+			return false;
+
+		str.assign(pos, size);
+		pos += size;
+		return true;
+	}
+
+	/// mirrors CS3OParser::LoadPiece, but without re-deriving anything
+	SS3OPiece* ReadPiece(S3DModel* model, SS3OPiece* parent, unsigned int depth) {
+		if (depth > MODEL_CACHE_MAX_DEPTH)
+			return NULL;
+
+		model->numPieces++;
+
+		SS3OPiece* piece = new SS3OPiece();
+			piece->type = MODELTYPE_S3O;
+			piece->parent = parent;
+
+		boost::int32_t primitiveType = 0;
+		boost::uint32_t numChilds = 0;
+
+		bool ret = true;
+		ret = ret && ReadString(piece->name);
+		ret = ret && Read(piece->offset);
+		ret = ret && Read(piece->goffset);
+		ret = ret && Read(piece->mins);
+		ret = ret && Read(piece->maxs);
+		ret = ret && Read(primitiveType);
+		ret = ret && ReadVector(piece->vertices);
+		ret = ret && ReadVector(piece->vertexDrawOrder);
+		ret = ret && ReadVector(piece->sTangents);
+		ret = ret && ReadVector(piece->tTangents);
+		ret = ret && Read(numChilds);
+
+		piece->primitiveType = primitiveType;
+		piece->isEmpty = piece->vertexDrawOrder.empty();
+
+		const float3 cvScales = piece->maxs - piece->mins;
+		const float3 cvOffset =
+			(piece->maxs - piece->goffset) +
+			(piece->mins - piece->goffset);
+
+		piece->SetCollisionVolume(new CollisionVolume("box", cvScales, cvOffset * 0.5f, CollisionVolume::COLVOL_HITTEST_CONT));
+
+		for (unsigned int n = 0; ret && n < numChilds; n++) {
+			SS3OPiece* childPiece = ReadPiece(model, piece, depth + 1);
+
+			if (childPiece == NULL) {
+				ret = false;
+				break;
+			}
+
+			piece->childs.push_back(childPiece);
+		}
+
+		if (!ret) {
+			DeletePiece(piece);
+			return NULL;
+		}
+
+		return piece;
+	}
+
+	static void DeletePiece(S3DModelPiece* piece) {
+		for (unsigned int n = 0; n < piece->childs.size(); n++) {
+			DeletePiece(piece->childs[n]);
+		}
+
+		delete piece;
+	}
+
+	const char* pos;
+	const char* end;
+};
+
+
+
+CS3OParser::CS3OParser(): useCache(configHandler->GetBool("UseModelCache"))
+{
+	// created once up front, Parse may run on several threads at a time
+	if (useCache) {
+		useCache = FileSystem::CreateDirectory(MODEL_CACHE_DIR);
+	}
+}
+
 S3DModel* CS3OParser::Load(const std::string& name)
 {
+	S3DModel* model = Parse(name);
+	Finalize(model);
+	return model;
+}
+
+void CS3OParser::Finalize(S3DModel* model)
+{
+	texturehandlerS3O->LoadS3OTexture(model);
+}
+
+S3DModel* CS3OParser::Parse(const std::string& name)
+{
+	unsigned int cacheKey = 0;
+	const std::string cacheFileName = GetCacheFileName(name, cacheKey);
+
+	if (!cacheFileName.empty()) {
+		S3DModel* model = LoadCached(name, cacheFileName, cacheKey);
+
+		if (model != NULL)
+			return model;
+	}
+
 	CFileHandler file(name);
 	if (!file.FileExists()) {
 		throw content_error("[S3OParser] could not find model-file " + name);
@@ -41,7 +248,6 @@ S3DModel* CS3OParser::Load(const std::string& name)
 		model->tex2 = (char*) &fileBuf[header.texture2];
 		model->mins = DEF_MIN_SIZE;
 		model->maxs = DEF_MAX_SIZE;
-	texturehandlerS3O->LoadS3OTexture(model);
 
 	SS3OPiece* rootPiece = LoadPiece(model, NULL, fileBuf, header.rootPiece);
 
@@ -53,9 +259,179 @@ S3DModel* CS3OParser::Load(const std::string& name)
 	model->relMidPos.y = std::max(model->relMidPos.y, 1.0f); // ?
 
 	delete[] fileBuf;
+
+	if (!cacheFileName.empty()) {
+		SaveCached(model, cacheFileName, cacheKey);
+	}
+
+	return model;
+}
+
+
+bool CS3OParser::IsCached(const std::string& name)
+{
+	unsigned int cacheKey = 0;
+	const std::string cacheFileName = GetCacheFileName(name, cacheKey);
+
+	return (!cacheFileName.empty() && FileSystem::FileExists(dataDirsAccess.LocateFile(cacheFileName)));
+}
+
+std::string CS3OParser::GetCacheFileName(const std::string& name, unsigned int& key)
+{
+	if (!useCache)
+		return "";
+	// loose files can change at any time, only archived models have a checksum
+	if (CFileHandler::FileExists(name, SPRING_VFS_RAW))
+		return "";
+
+	const std::string archiveName = vfsHandler->GetFileArchiveName(name);
+
+	if (archiveName.empty())
+		return "";
+
+	unsigned int archiveChecksum = 0;
+
+	{
+		boost::mutex::scoped_lock lock(archiveChecksumsMutex);
+
+		const std::map<std::string, unsigned int>::const_iterator it = archiveChecksums.find(archiveName);
+
+		if (it == archiveChecksums.end()) {
+			archiveChecksum = archiveScanner->GetSingleArchiveChecksum(archiveName);
+			archiveChecksums[archiveName] = archiveChecksum;
+		} else {
+			archiveChecksum = it->second;
+		}
+	}
+
+	if (archiveChecksum == 0)
+		return "";
+
+	const std::string lcName = StringToLower(name);
+	const std::string& version = SpringVersion::GetFull();
+
+	CRC crc;
+	crc << MODEL_CACHE_VERSION;
+	crc << archiveChecksum;
+	crc.Update(version.c_str(), version.size() + 1);
+	crc.Update(lcName.c_str(), lcName.size() + 1);
+
+	char keyString[16] = {0};
+	sprintf(keyString, "%08x", crc.GetDigest());
+
+	key = crc.GetDigest();
+	return (MODEL_CACHE_DIR + "s3o." + keyString + ".bin");
+}
+
+
+S3DModel* CS3OParser::LoadCached(const std::string& name, const std::string& cacheFileName, unsigned int key) const
+{
+	const std::string path = dataDirsAccess.LocateFile(cacheFileName);
+
+	// the pieces are read straight from the mapped file,
+	// without staging its contents in a buffer first
+	CFileView view;
+
+	if (!view.MapFile(path, 0, FileSystem::GetFileSize(path)))
+		return NULL;
+
+	const char* data = reinterpret_cast<const char*>(view.GetData());
+	S3OCacheReader reader(data, data + view.GetSize());
+
+	char magic[sizeof(MODEL_CACHE_MAGIC)];
+	unsigned int fileKey = 0;
+	unsigned int size = 0;
+
+	bool ret = true;
+	ret = ret && reader.Read(magic);
+	ret = ret && reader.Read(fileKey);
+	ret = ret && reader.Read(size);
+	ret = ret && (memcmp(magic, MODEL_CACHE_MAGIC, sizeof(magic)) == 0);
+	ret = ret && (fileKey == key);
+	ret = ret && (size > 0) && (size == size_t(reader.end - reader.pos));
+
+	S3DModel* model = NULL;
+
+	if (ret) {
+		model = new S3DModel;
+			model->name = name;
+			model->type = MODELTYPE_S3O;
+			model->numPieces = 0;
+
+		ret = ret && reader.ReadString(model->tex1);
+		ret = ret && reader.ReadString(model->tex2);
+		ret = ret && reader.Read(model->radius);
+		ret = ret && reader.Read(model->height);
+		ret = ret && reader.Read(model->mins);
+		ret = ret && reader.Read(model->maxs);
+		ret = ret && reader.Read(model->relMidPos);
+
+		SS3OPiece* rootPiece = ret? reader.ReadPiece(model, NULL, 0): NULL;
+
+		if (rootPiece != NULL && reader.pos == reader.end) {
+			model->SetRootPiece(rootPiece);
+		} else {
+			if (rootPiece != NULL) {
+				S3OCacheReader::DeletePiece(rootPiece);
+			}
+
+			delete model;
+			model = NULL;
+		}
+	}
+
+	if (model == NULL) {
+		LOG_SL(LOG_SECTION_MODEL, L_WARNING, "[S3OParser::%s] ignoring invalid cache-file %s", __FUNCTION__, path.c_str());
+		return NULL;
+	}
+
+	LOG_SL(LOG_SECTION_MODEL, L_DEBUG, "[S3OParser::%s] loaded %s from %s", __FUNCTION__, name.c_str(), cacheFileName.c_str());
 	return model;
 }
 
+
+void CS3OParser::SaveCached(const S3DModel* model, const std::string& cacheFileName, unsigned int key) const
+{
+	S3OCacheWriter writer;
+	writer.WriteString(model->tex1);
+	writer.WriteString(model->tex2);
+	writer.Write(model->radius);
+	writer.Write(model->height);
+	writer.Write(model->mins);
+	writer.Write(model->maxs);
+	writer.Write(model->relMidPos);
+	writer.WritePiece(static_cast<const SS3OPiece*>(model->GetRootPiece()));
+
+	const std::string path = dataDirsAccess.LocateFile(cacheFileName, FileQueryFlags::WRITE);
+	const std::string tmpPath = path + ".tmp";
+
+	FILE* file = fopen(tmpPath.c_str(), "wb");
+
+	if (file == NULL)
+		return;
+
+	const unsigned int size = writer.data.size();
+
+	bool ret = true;
+	ret = ret && (fwrite(MODEL_CACHE_MAGIC, sizeof(MODEL_CACHE_MAGIC), 1, file) == 1);
+	ret = ret && (fwrite(&key, sizeof(key), 1, file) == 1);
+	ret = ret && (fwrite(&size, sizeof(size), 1, file) == 1);
+	ret = ret && (fwrite(&writer.data[0], size, 1, file) == 1);
+	ret = (fclose(file) == 0) && ret;
+
+	// same scheme as the defs cache: never expose a partially written file
+	if (ret) {
+		remove(path.c_str());
+		ret = (rename(tmpPath.c_str(), path.c_str()) == 0);
+	}
+	if (!ret) {
+		remove(tmpPath.c_str());
+		return;
+	}
+
+	LOG_SL(LOG_SECTION_MODEL, L_DEBUG, "[S3OParser::%s] stored %s in %s (%u bytes)", __FUNCTION__, model->name.c_str(), cacheFileName.c_str(), size);
+}
+
 SS3OPiece* CS3OParser::LoadPiece(S3DModel* model, SS3OPiece* parent, unsigned char* buf, int offset)
 {
 	model->numPieces++;
@@ -4,6 +4,7 @@
 #define S3O_PARSER_H
 
 #include <map>
+#include <boost/thread/mutex.hpp>
 #include "IModelParser.h"
 
 
@@ -48,10 +49,33 @@ enum {S3O_PRIMTYPE_TRIANGLES = 0, S3O_PRIMTYPE_TRIANGLE_STRIP = 1, S3O_PRIMTYPE_
 class CS3OParser: public IModelParser
 {
 public:
+	CS3OParser();
+
 	S3DModel* Load(const std::string& name);
+	S3DModel* Parse(const std::string& name);
+	void Finalize(S3DModel* model);
+	bool IsCached(const std::string& name);
 
 private:
 	SS3OPiece* LoadPiece(S3DModel*, SS3OPiece*, unsigned char* buf, int offset);
+
+	/**
+	 * Preprocessed models (piece tree, vertices, tangents and extents) are
+	 * stored in cache/models/, keyed on the checksum of the archive that
+	 * contains the model and on its path, so they never go stale.
+	 * @return the cache-file name, or an empty string if the model can not
+	 *   be cached (e.g. when it is read from the raw filesystem)
+	 */
+	std::string GetCacheFileName(const std::string& name, unsigned int& key);
+	/// maps the cache-file and builds the model from it, NULL if it is missing or invalid
+	S3DModel* LoadCached(const std::string& name, const std::string& cacheFileName, unsigned int key) const;
+	void SaveCached(const S3DModel* model, const std::string& cacheFileName, unsigned int key) const;
+
+	bool useCache;
+
+	/// Parse runs on worker threads, archive checksums are looked up once
+	std::map<std::string, unsigned int> archiveChecksums;
+	boost::mutex archiveChecksumsMutex;
 };
 
 #endif /* S3O_PARSER_H */
@@ -29,6 +29,18 @@ CFeatureHandler* featureHandler = NULL;
 
 /******************************************************************************/
 
+typedef CSlotMap<CFeature*> CFeatureIDMap;
+
+CR_BIND_TEMPLATE(CFeatureIDMap, )
+CR_REG_METADATA(CFeatureIDMap, (
+	CR_MEMBER(values),
+	CR_MEMBER(generations),
+	CR_MEMBER(nextFree),
+	CR_MEMBER(numUsed),
+	CR_MEMBER(freeHead),
+	CR_MEMBER(freeTail)
+));
+
 CR_BIND(CFeatureHandler, );
 
 CR_REG_METADATA(CFeatureHandler, (
@@ -36,7 +48,6 @@ CR_REG_METADATA(CFeatureHandler, (
 //	CR_MEMBER(featureDefs),
 //	CR_MEMBER(featureDefsVector),
 
-	CR_MEMBER(freeIDs),
 	CR_MEMBER(toBeFreedIDs),
 	CR_MEMBER(activeFeatures),
 	CR_MEMBER(features),
@@ -82,7 +93,7 @@ CFeatureHandler::~CFeatureHandler()
 	}
 
 	activeFeatures.clear();
-	features.clear();
+	features.Clear();
 	featureDefs.clear();
 }
 
@@ -317,26 +328,22 @@ void CFeatureHandler::LoadFeaturesFromMap(bool onlyCreateDefs)
 
 int CFeatureHandler::AddFeature(CFeature* feature)
 {
-	if (freeIDs.empty()) {
-		// alloc n new ids and randomly insert to freeIDs
+	if (features.GetNumFree() == 0) {
+		// alloc n new ids, handed out in random order
 		static const unsigned n = 100;
 
 		std::vector<int> newIds(n);
 
 		for (unsigned i = 0; i < n; ++i)
-			newIds[i] = i + features.size();
-
-		features.resize(features.size() + n, NULL);
+			newIds[i] = i + features.GetSize();
 
 		SyncedRNG rng;
 		std::random_shuffle(newIds.begin(), newIds.end(), rng); // synced
-		std::copy(newIds.begin(), newIds.end(), std::back_inserter(freeIDs));
+		features.AddSlots(newIds);
 	}
 	
-	feature->id = freeIDs.front();
-	freeIDs.pop_front();
+	feature->id = features.Insert(feature);
 	activeFeatures.insert(feature);
-	features[feature->id] = feature;
 	SetFeatureUpdateable(feature);
 
 	eventHandler.FeatureCreated(feature);
@@ -353,7 +360,7 @@ void CFeatureHandler::DeleteFeature(CFeature* feature)
 
 CFeature* CFeatureHandler::GetFeature(int id)
 {
-	if (id >= 0 && id < features.size())
+	if (id >= 0 && id < features.GetSize())
 		return features[id];
 	else
 		return 0;
@@ -408,8 +415,12 @@ void CFeatureHandler::Update()
 				break;
 			}
 		}
-		if (!dontClear)
-			freeIDs.splice(freeIDs.end(), toBeFreedIDs, toBeFreedIDs.begin(), toBeFreedIDs.end());
+		if (!dontClear) {
+			for (list<int>::iterator it = toBeFreedIDs.begin(); it != toBeFreedIDs.end(); ++it) {
+				features.Erase(*it);
+			}
+			toBeFreedIDs.clear();
+		}
 	}
 
 	{
@@ -7,6 +7,7 @@
 #include <list>
 #include <vector>
 #include <boost/noncopyable.hpp>
+#include "System/SlotMap.h"
 #include "System/creg/creg_cond.h"
 #include "FeatureDef.h"
 #include "FeatureSet.h"
@@ -34,6 +35,8 @@ public:
 	int AddFeature(CFeature* feature);
 	void DeleteFeature(CFeature* feature);
 	CFeature* GetFeature(int id);
+	/// feature ids are below this
+	int MaxFeatures() const { return features.GetSize(); }
 
 	void LoadFeaturesFromMap(bool onlyCreateDefs);
 	const FeatureDef* GetFeatureDef(std::string name, const bool showError = true);
@@ -56,10 +59,11 @@ private:
 	std::map<std::string, const FeatureDef*> featureDefs;
 	std::vector<const FeatureDef*> featureDefsVector;
 
-	std::list<int> freeIDs;
+	/// ids of removed features, released in features once no builder reclaims them anymore
 	std::list<int> toBeFreedIDs;
 	CFeatureSet activeFeatures;
-	std::vector<CFeature*> features;
+	/// features by id, hands out the ids
+	CSlotMap<CFeature*> features;
 
 	std::list<int> toBeRemoved;
 	CFeatureSet updateFeatures;
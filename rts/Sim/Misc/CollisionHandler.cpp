@@ -23,6 +23,24 @@ unsigned int CCollisionHandler::numIntersectionTests = 0;
 
 
 bool CCollisionHandler::DetectHit(const CUnit* u, const float3& p0, const float3& p1, CollisionQuery* q)
+{
+	HitTestCounts counts;
+	const bool r = DetectHit(u, p0, p1, q, &counts);
+
+	AddHitTestCounts(counts);
+	return r;
+}
+
+bool CCollisionHandler::DetectHit(const CFeature* f, const float3& p0, const float3& p1, CollisionQuery* q)
+{
+	HitTestCounts counts;
+	const bool r = DetectHit(f, p0, p1, q, &counts);
+
+	AddHitTestCounts(counts);
+	return r;
+}
+
+bool CCollisionHandler::DetectHit(const CUnit* u, const float3& p0, const float3& p1, CollisionQuery* q, HitTestCounts* counts)
 {
 	bool r = false;
 
@@ -34,31 +52,34 @@ bool CCollisionHandler::DetectHit(const CUnit* u, const float3& p0, const float3
 	if (!u->collisionVolume->IsDisabled()) {
 		switch (u->collisionVolume->GetTestType()) {
 			// Collision(CUnit*) does not need p1 or q
-			case CollisionVolume::COLVOL_HITTEST_DISC: { r = CCollisionHandler::Collision(u, p0       ); numCollisionTests    += 1; } break;
-			case CollisionVolume::COLVOL_HITTEST_CONT: { r = CCollisionHandler::Intersect(u, p0, p1, q); numIntersectionTests += 1; } break;
+			case CollisionVolume::COLVOL_HITTEST_DISC: { r = CCollisionHandler::Collision(u, p0       ); counts->numCollisionTests    += 1; } break;
+			case CollisionVolume::COLVOL_HITTEST_CONT: { r = CCollisionHandler::Intersect(u, p0, p1, q); counts->numIntersectionTests += 1; } break;
 		}
 	}
 
 	return r;
 }
 
-bool CCollisionHandler::DetectHit(const CFeature* f, const float3& p0, const float3& p1, CollisionQuery* q)
+bool CCollisionHandler::DetectHit(const CFeature* f, const float3& p0, const float3& p1, CollisionQuery* q, HitTestCounts* counts)
 {
 	bool r = false;
 
 	if (!f->collisionVolume->IsDisabled()) {
 		switch (f->collisionVolume->GetTestType()) {
 			// Collision(CFeature*) does not need p1 or q
-			case CollisionVolume::COLVOL_HITTEST_DISC: { r = CCollisionHandler::Collision(f, p0       ); numCollisionTests    += 1; } break;
-			case CollisionVolume::COLVOL_HITTEST_CONT: { r = CCollisionHandler::Intersect(f, p0, p1, q); numIntersectionTests += 1; } break;
+			case CollisionVolume::COLVOL_HITTEST_DISC: { r = CCollisionHandler::Collision(f, p0       ); counts->numCollisionTests    += 1; } break;
+			case CollisionVolume::COLVOL_HITTEST_CONT: { r = CCollisionHandler::Intersect(f, p0, p1, q); counts->numIntersectionTests += 1; } break;
 		}
 	}
 
 	return r;
 }
 
-
-
+void CCollisionHandler::AddHitTestCounts(const HitTestCounts& counts)
+{
+	numCollisionTests += counts.numCollisionTests;
+	numIntersectionTests += counts.numIntersectionTests;
+}
 
 
 
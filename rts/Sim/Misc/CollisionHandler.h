@@ -44,8 +44,24 @@ class CCollisionHandler {
 		CCollisionHandler() {}
 		~CCollisionHandler() {}
 
+		/// numbers of hit tests done, by kind
+		struct HitTestCounts {
+			HitTestCounts(): numCollisionTests(0), numIntersectionTests(0) {}
+
+			unsigned int numCollisionTests;
+			unsigned int numIntersectionTests;
+		};
+
 		static bool DetectHit(const CUnit* u, const float3& p0, const float3& p1, CollisionQuery* q = NULL);
 		static bool DetectHit(const CFeature* f, const float3& p0, const float3& p1, CollisionQuery* q = NULL);
+		/**
+		 * Variants of the above for parallel hit tests: count into the
+		 * given (per-thread) counts instead of the global ones, which the
+		 * caller adds up with AddHitTestCounts afterwards.
+		 */
+		static bool DetectHit(const CUnit* u, const float3& p0, const float3& p1, CollisionQuery* q, HitTestCounts* counts);
+		static bool DetectHit(const CFeature* f, const float3& p0, const float3& p1, CollisionQuery* q, HitTestCounts* counts);
+		static void AddHitTestCounts(const HitTestCounts& counts);
 		static bool MouseHit(const CUnit* u, const float3& p0, const float3& p1, const CollisionVolume* v, CollisionQuery* q);
 
 		static bool Intersect(const CUnit* u, const float3& p0, const float3& p1, CollisionQuery* q);
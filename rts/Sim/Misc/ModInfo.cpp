@@ -51,6 +51,7 @@ void CModInfo::Init(const char* modArchive)
 	// determine if bombers are allowed to leave map boundaries
 	const LuaTable movementTbl = root.SubTable("movement");
 	allowAirPlanesToLeaveMap = movementTbl.GetBool("allowAirPlanesToLeaveMap", true);
+	pathFlowFieldMinGroupSize = std::max(0, movementTbl.GetInt("pathFlowFieldMinGroupSize", 32));
 
 	// determine whether the modder allows the user to use team coloured nanospray
 	const LuaTable nanosprayTbl = root.SubTable("nanospray");
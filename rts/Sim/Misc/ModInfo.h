@@ -11,6 +11,7 @@ public:
 	CModInfo()
 		: allowTeamColors(true)
 		, allowAirPlanesToLeaveMap(true)
+		, pathFlowFieldMinGroupSize(32)
 		, constructionDecay(true)
 		, constructionDecayTime(1000)
 		, constructionDecaySpeed(1.0f)
@@ -74,6 +75,8 @@ public:
 
 	// Movement behaviour
 	bool allowAirPlanesToLeaveMap;
+	/// groups of at least this many units ordered to the same area share a flow field for pathing, 0 disables
+	unsigned int pathFlowFieldMinGroupSize;
 
 	// Build behaviour
 	/// Should constructions without builders decay?
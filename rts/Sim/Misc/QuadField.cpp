@@ -2,6 +2,8 @@
 
 #include "System/mmgr.h"
 
+#include <algorithm>
+
 #include "lib/gml/gml.h"
 #include "QuadField.h"
 #include "Sim/Misc/GlobalSynced.h"
@@ -25,7 +27,7 @@ CR_REG_METADATA(CQuadField, (
 ));
 
 
-CQuadField::Quad::Quad() : teamUnits(teamHandler->ActiveAllyTeams())
+CQuadField::Quad::Quad() : teamUnits(teamHandler->ActiveAllyTeams()), lastObjectChange(0), lastLayoutChange(0)
 {
 }
 
@@ -57,7 +59,7 @@ CR_REG_METADATA_SUB(CQuadField, Quad, (
 
 CQuadField* qf;
 
-CQuadField::CQuadField()
+CQuadField::CQuadField(): numObjectChanges(0), numLayoutChanges(0)
 {
 	numQuadsX = gs->mapx * SQUARE_SIZE / QUAD_SIZE;
 	numQuadsZ = gs->mapy * SQUARE_SIZE / QUAD_SIZE;
@@ -158,6 +160,21 @@ std::vector<CUnit*> CQuadField::GetUnits(const float3& pos, float radius)
 	return units;
 }
 
+// true if a unit in the quads [begQuad, curQuad] was already found in one of the earlier ones
+static inline bool InEarlierQuad(const CUnit* unit, const int* begQuad, const int* curQuad)
+{
+	if (unit->quads.size() <= 1)
+		return false;
+
+	for (std::vector<int>::const_iterator qi = unit->quads.begin(); qi != unit->quads.end(); ++qi) {
+		if (std::find(begQuad, curQuad, *qi) != curQuad) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 std::vector<CUnit*> CQuadField::GetUnitsExact(const float3& pos, float radius, bool spherical)
 {
 	GML_RECMUTEX_LOCK(qnum); // GetUnitsExact
@@ -192,6 +209,31 @@ std::vector<CUnit*> CQuadField::GetUnitsExact(const float3& pos, float radius, b
 	return units;
 }
 
+void CQuadField::GetUnitsExact(const float3& pos, float radius, std::vector<int>& quads, std::vector<CUnit*>& units) const
+{
+	quads.resize(numQuadsX * numQuadsZ);
+	units.clear();
+
+	int* begQuad = &quads[0];
+	int* endQuad = begQuad;
+	GetQuads(pos, radius, endQuad);
+
+	std::list<CUnit*>::const_iterator ui;
+
+	for (int* a = begQuad; a != endQuad; ++a) {
+		const Quad& quad = baseQuads[*a];
+
+		for (ui = quad.units.begin(); ui != quad.units.end(); ++ui) {
+			const float totRad = radius + (*ui)->radius;
+
+			if ((pos - (*ui)->midPos).SqLength() >= (totRad * totRad)) { continue; }
+			if (InEarlierQuad(*ui, begQuad, a)) { continue; }
+
+			units.push_back(*ui);
+		}
+	}
+}
+
 std::vector<CUnit*> CQuadField::GetUnitsExact(const float3& mins, const float3& maxs)
 {
 	GML_RECMUTEX_LOCK(qnum); // GetUnitsExact
@@ -375,6 +417,13 @@ void CQuadField::GetQuadsOnRay(float3 start, float3 dir, float length, int*& dst
 
 void CQuadField::MovedUnit(CUnit* unit)
 {
+	numObjectChanges++;
+
+	std::vector<int>::const_iterator qi;
+	for (qi = unit->quads.begin(); qi != unit->quads.end(); ++qi) {
+		baseQuads[*qi].lastObjectChange = numObjectChanges;
+	}
+
 	const std::vector<int>& newQuads = GetQuads(unit->pos,unit->radius);
 
 	//! compare if the quads have changed, if not stop here
@@ -394,8 +443,11 @@ void CQuadField::MovedUnit(CUnit* unit)
 
 	GML_RECMUTEX_LOCK(quad); // MovedUnit - possible performance hog
 
-	std::vector<int>::const_iterator qi;
+	numLayoutChanges++;
+
 	for (qi = unit->quads.begin(); qi != unit->quads.end(); ++qi) {
+		baseQuads[*qi].lastLayoutChange = numLayoutChanges;
+
 		std::list<CUnit*>::iterator ui;
 		for (ui = baseQuads[*qi].units.begin(); ui != baseQuads[*qi].units.end(); ++ui) {
 			if (*ui == unit) {
@@ -413,16 +465,24 @@ void CQuadField::MovedUnit(CUnit* unit)
 	for (qi = newQuads.begin(); qi != newQuads.end(); ++qi) {
 		baseQuads[*qi].units.push_front(unit);
 		baseQuads[*qi].teamUnits[unit->allyteam].push_front(unit);
+		baseQuads[*qi].lastObjectChange = numObjectChanges;
+		baseQuads[*qi].lastLayoutChange = numLayoutChanges;
 	}
 	unit->quads = newQuads;
 }
 
 void CQuadField::RemoveUnit(CUnit* unit)
 {
+	numObjectChanges++;
+	numLayoutChanges++;
+
 	GML_RECMUTEX_LOCK(quad); // RemoveUnit
 
 	std::vector<int>::const_iterator qi;
 	for (qi = unit->quads.begin(); qi != unit->quads.end(); ++qi) {
+		baseQuads[*qi].lastObjectChange = numObjectChanges;
+		baseQuads[*qi].lastLayoutChange = numLayoutChanges;
+
 		std::list<CUnit*>::iterator ui;
 		for (ui = baseQuads[*qi].units.begin(); ui != baseQuads[*qi].units.end(); ++ui) {
 			if (*ui == unit) {
@@ -444,6 +504,9 @@ void CQuadField::RemoveUnit(CUnit* unit)
 
 void CQuadField::AddFeature(CFeature* feature)
 {
+	numObjectChanges++;
+	numLayoutChanges++;
+
 	GML_RECMUTEX_LOCK(quad); // AddFeature
 
 	const std::vector<int>& newQuads = GetQuads(feature->pos, feature->radius);
@@ -451,11 +514,16 @@ void CQuadField::AddFeature(CFeature* feature)
 	std::vector<int>::const_iterator qi;
 	for (qi = newQuads.begin(); qi != newQuads.end(); ++qi) {
 		baseQuads[*qi].features.push_front(feature);
+		baseQuads[*qi].lastObjectChange = numObjectChanges;
+		baseQuads[*qi].lastLayoutChange = numLayoutChanges;
 	}
 }
 
 void CQuadField::RemoveFeature(CFeature* feature)
 {
+	numObjectChanges++;
+	numLayoutChanges++;
+
 	GML_RECMUTEX_LOCK(quad); // RemoveFeature
 
 	const std::vector<int>& quads = GetQuads(feature->pos, feature->radius);
@@ -463,6 +531,59 @@ void CQuadField::RemoveFeature(CFeature* feature)
 	std::vector<int>::const_iterator qi;
 	for (qi = quads.begin(); qi != quads.end(); ++qi) {
 		baseQuads[*qi].features.remove(feature);
+		baseQuads[*qi].lastObjectChange = numObjectChanges;
+		baseQuads[*qi].lastLayoutChange = numLayoutChanges;
+	}
+}
+
+bool CQuadField::ObjectsChangedSince(const float3& pos, float radius, unsigned int numChanges, std::vector<int>& quads) const
+{
+	if (numObjectChanges == numChanges)
+		return false;
+
+	quads.resize(numQuadsX * numQuadsZ);
+
+	int* begQuad = &quads[0];
+	int* endQuad = begQuad;
+	GetQuads(pos, radius, endQuad);
+
+	for (int* a = begQuad; a != endQuad; ++a) {
+		// lastObjectChange in (numChanges, numObjectChanges], modulo 2^32
+		if ((baseQuads[*a].lastObjectChange - numChanges - 1) < (numObjectChanges - numChanges)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool CQuadField::LayoutChangedSince(const float3& pos, float radius, unsigned int numChanges, std::vector<int>& quads) const
+{
+	if (numLayoutChanges == numChanges)
+		return false;
+
+	quads.resize(numQuadsX * numQuadsZ);
+
+	int* begQuad = &quads[0];
+	int* endQuad = begQuad;
+	GetQuads(pos, radius, endQuad);
+
+	for (int* a = begQuad; a != endQuad; ++a) {
+		if ((baseQuads[*a].lastLayoutChange - numChanges - 1) < (numLayoutChanges - numChanges)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void CQuadField::JumpedUnit(const CUnit* unit)
+{
+	numLayoutChanges++;
+
+	std::vector<int>::const_iterator qi;
+	for (qi = unit->quads.begin(); qi != unit->quads.end(); ++qi) {
+		baseQuads[*qi].lastLayoutChange = numLayoutChanges;
 	}
 }
 
@@ -565,6 +686,31 @@ std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& pos, float rad
 	return features;
 }
 
+void CQuadField::GetFeaturesExact(const float3& pos, float radius, std::vector<int>& quads, std::vector<CFeature*>& features) const
+{
+	quads.resize(numQuadsX * numQuadsZ);
+	features.clear();
+
+	int* begQuad = &quads[0];
+	int* endQuad = begQuad;
+	GetQuads(pos, radius, endQuad);
+
+	std::list<CFeature*>::const_iterator fi;
+
+	for (int* a = begQuad; a != endQuad; ++a) {
+		const Quad& quad = baseQuads[*a];
+
+		for (fi = quad.features.begin(); fi != quad.features.end(); ++fi) {
+			const float totRad = radius + (*fi)->radius;
+
+			if ((pos - (*fi)->midPos).SqLength() >= (totRad * totRad)) { continue; }
+			if (std::find(features.begin(), features.end(), *fi) != features.end()) { continue; }
+
+			features.push_back(*fi);
+		}
+	}
+}
+
 std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& pos, float radius, bool spherical)
 {
 	GML_RECMUTEX_LOCK(qnum); // GetFeaturesExact
@@ -783,3 +929,38 @@ void CQuadField::GetUnitsAndFeaturesExact(const float3& pos, float radius, CUnit
 		}
 	}
 }
+
+void CQuadField::GetUnitsAndFeaturesExact(const float3& pos, float radius, std::vector<int>& quads, std::vector<CUnit*>& units, std::vector<CFeature*>& features) const
+{
+	quads.resize(numQuadsX * numQuadsZ);
+	units.clear();
+	features.clear();
+
+	int* begQuad = &quads[0];
+	int* endQuad = begQuad;
+	GetQuads(pos, radius, endQuad);
+
+	std::list<CUnit*>::const_iterator ui;
+	std::list<CFeature*>::const_iterator fi;
+
+	// instead of the tempNum marks, units spanning several quads are skipped
+	// by their quads and features by searching the (short) result list
+	for (int* a = begQuad; a != endQuad; ++a) {
+		const Quad& quad = baseQuads[*a];
+
+		for (ui = quad.units.begin(); ui != quad.units.end(); ++ui) {
+			if (InEarlierQuad(*ui, begQuad, a)) { continue; }
+
+			units.push_back(*ui);
+		}
+
+		for (fi = quad.features.begin(); fi != quad.features.end(); ++fi) {
+			const float totRad = radius + (*fi)->radius;
+
+			if ((pos - (*fi)->midPos).SqLength() >= (totRad * totRad)) { continue; }
+			if (std::find(features.begin(), features.end(), *fi) != features.end()) { continue; }
+
+			features.push_back(*fi);
+		}
+	}
+}
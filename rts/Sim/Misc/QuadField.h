@@ -35,6 +35,12 @@ public:
 	void GetQuads(float3 pos, float radius, int*& dst) const;
 	void GetQuadsOnRay(float3 start, float3 dir, float length, int*& dst);
 	void GetUnitsAndFeaturesExact(const float3& pos, float radius, CUnit**& dstUnit, CFeature**& dstFeature);
+	/**
+	 * Thread-safe variant of the above for parallel queries: does not mark
+	 * the objects with gs->tempNum but works on the given (reused) buffers,
+	 * objects are returned in the same order.
+	 */
+	void GetUnitsAndFeaturesExact(const float3& pos, float radius, std::vector<int>& quads, std::vector<CUnit*>& units, std::vector<CFeature*>& features) const;
 
 	/**
 	 * Returns all units within @c radius of @c pos,
@@ -47,6 +53,12 @@ public:
  	 * and performs the search within a sphere or cylinder depending on @c spherical
 	 */
 	std::vector<CUnit*> GetUnitsExact(const float3& pos, float radius, bool spherical = true);
+	/**
+	 * Thread-safe variant of the above (spherical) for parallel queries (see
+	 * the thread-safe GetUnitsAndFeaturesExact), returns the same units in
+	 * the same order.
+	 */
+	void GetUnitsExact(const float3& pos, float radius, std::vector<int>& quads, std::vector<CUnit*>& units) const;
 	/**
 	 * Returns all units within the rectangle defined by
 	 * mins and maxs, which extends infinitely along the y-axis
@@ -58,6 +70,12 @@ public:
 	 * and takes the 3D model radius of each feature into account
 	 */
 	std::vector<CFeature*> GetFeaturesExact(const float3& pos, float radius);
+	/**
+	 * Thread-safe variant of the above for parallel queries (see the
+	 * thread-safe GetUnitsAndFeaturesExact), returns the same features
+	 * in the same order.
+	 */
+	void GetFeaturesExact(const float3& pos, float radius, std::vector<int>& quads, std::vector<CFeature*>& features) const;
 	/**
 	 * Returns all features within @c radius of @c pos,
 	 * and performs the search within a sphere or cylinder depending on @c spherical
@@ -80,6 +98,34 @@ public:
 	void AddFeature(CFeature* feature);
 	void RemoveFeature(CFeature* feature);
 
+	/**
+	 * Counts the calls of the four functions above, so a caller can tell
+	 * whether units or features were added, removed or moved since it
+	 * queried them (and whether its results are still valid).
+	 */
+	unsigned int GetNumObjectChanges() const { return numObjectChanges; }
+	/**
+	 * @return true if units or features in the quads around @c pos were
+	 *   added, removed or moved since GetNumObjectChanges returned
+	 *   @c numChanges (so queries there would return other results)
+	 * @param quads scratch buffer, as for the thread-safe queries
+	 */
+	bool ObjectsChangedSince(const float3& pos, float radius, unsigned int numChanges, std::vector<int>& quads) const;
+
+	/**
+	 * Counts the changes of which units or features the quads hold (units
+	 * and features added or removed, units put into other quads), and the
+	 * calls of JumpedUnit, but not the regular movement within the quads:
+	 * objects gathered around a position with a margin for that movement
+	 * (CGroundMoveType::PrepareUpdate) are still all the candidates there
+	 * while the quads around it do not change.
+	 */
+	unsigned int GetNumLayoutChanges() const { return numLayoutChanges; }
+	/// as ObjectsChangedSince, for the changes GetNumLayoutChanges counts
+	bool LayoutChangedSince(const float3& pos, float radius, unsigned int numChanges, std::vector<int>& quads) const;
+	/// the unit was teleported, or pushed further than in a regular frame
+	void JumpedUnit(const CUnit* unit);
+
 	void MovedProjectile(CProjectile* projectile);
 	void AddProjectile(CProjectile* projectile);
 	void RemoveProjectile(CProjectile* projectile);
@@ -91,6 +137,10 @@ public:
 		std::vector< std::list<CUnit*> > teamUnits;
 		std::list<CFeature*> features;
 		std::list<CProjectile*> projectiles;
+		/// value of numObjectChanges at the last change of units or features here
+		unsigned int lastObjectChange;
+		/// value of numLayoutChanges at the last change of units or features here
+		unsigned int lastLayoutChange;
 	};
 
 	const Quad& GetQuad(int i) const {
@@ -111,6 +161,9 @@ private:
 	int numQuadsX;
 	int numQuadsZ;
 	int* tempQuads;
+
+	unsigned int numObjectChanges;
+	unsigned int numLayoutChanges;
 };
 
 extern CQuadField* qf;
@@ -1,12 +1,6 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
 #include <string>
-#include <cstdio>
-
-using std::fopen;
-using std::fread;
-using std::fwrite;
-using std::fclose;
 
 #include "ResourceMapAnalyzer.h"
 
@@ -16,16 +10,14 @@ using std::fclose;
 #include "Sim/Units/UnitHandler.h"
 #include "Game/GameHelper.h"
 #include "Game/GameSetup.h"
+#include "Map/MapDataCache.h"
 #include "Map/MapInfo.h"
 #include "Map/MetalMap.h"
-#include "System/FileSystem/DataDirsAccess.h"
-#include "System/FileSystem/FileQueryFlags.h"
+#include "Map/ReadMap.h"
 #include "System/Log/ILog.h"
-
-#include <stdexcept>
+#include "System/Util.h"
 
 static const float3 ERRORVECTOR(-1, 0, 0);
-static std::string CACHE_BASE("");
 
 CResourceMapAnalyzer::CResourceMapAnalyzer(int resourceId)
 	: resourceId(resourceId)
@@ -54,10 +46,6 @@ CResourceMapAnalyzer::CResourceMapAnalyzer(int resourceId)
 	, rexArrayC(NULL)
 	, tempAverage(NULL)
 {
-	if (CACHE_BASE.empty()) {
-		CACHE_BASE = dataDirsAccess.LocateDir("cache/analyzedResourceMaps/", FileQueryFlags::WRITE | FileQueryFlags::CREATE_DIRS);
-	}
-
 	// from 0-255, the minimum percentage of resources a spot needs to have from
 	// the maximum to be saved, prevents crappier spots in between taken spaces
 	// (they are still perfectly valid and will generate resources mind you!)
@@ -544,78 +532,44 @@ void CResourceMapAnalyzer::GetResourcePoints() {
 }
 
 
-template<typename T>
-static inline void writeToFile(const T& value, FILE* file) {
-
-	if (fwrite(&value, sizeof(T), 1, file) != 1) {
-		throw std::runtime_error("failed to write value to file");
-	}
-}
-
 void CResourceMapAnalyzer::SaveResourceMap() {
 
-	const std::string cacheFileName = GetCacheFileName();
-	FILE* saveFile = fopen(cacheFileName.c_str(), "wb");
-
-	try {
-		if (saveFile == NULL) {
-			throw std::runtime_error("failed to open file for writing");
-		}
+	// averageIncome, then the spots
+	std::vector<float> cacheData(1 + numSpotsFound * 3);
+	cacheData[0] = averageIncome;
 
-		writeToFile(numSpotsFound, saveFile);
-		writeToFile(averageIncome, saveFile);
-		for (int i = 0; i < numSpotsFound; i++) {
-			writeToFile(vectoredSpots[i], saveFile);
-		}
-	} catch (const std::runtime_error& err) {
-		LOG_L(L_WARNING,
-				"Failed to save the analyzed resource-map to file %s, reason: %s",
-				cacheFileName.c_str(), err.what());
+	for (int i = 0; i < numSpotsFound; i++) {
+		cacheData[1 + i * 3 + 0] = vectoredSpots[i].x;
+		cacheData[1 + i * 3 + 1] = vectoredSpots[i].y;
+		cacheData[1 + i * 3 + 2] = vectoredSpots[i].z;
 	}
 
-	fclose(saveFile);
-}
-
-static void fileReadChecked(void* buf, size_t size, size_t count, FILE* fstream) {
-
-	if (fread(buf, size, count, fstream) != count) {
-		throw std::runtime_error("Failed to read the required number of items");
-	}
+	readmap->GetMapDataCache()->AddSection(GetCacheSectionName(), cacheData);
 }
 
 bool CResourceMapAnalyzer::LoadResourceMap() {
 
-	bool loaded = false;
+	size_t size = 0;
+	const float* cacheData = reinterpret_cast<const float*>(readmap->GetMapDataCache()->GetSection(GetCacheSectionName(), &size));
 
-	const std::string cacheFileName = GetCacheFileName();
+	if (cacheData == NULL || size < sizeof(float) || ((size / sizeof(float)) - 1) % 3 != 0)
+		return false;
 
-	FILE* cacheFile = fopen(cacheFileName.c_str(), "rb");
+	numSpotsFound = ((size / sizeof(float)) - 1) / 3;
+	averageIncome = cacheData[0];
+	vectoredSpots.resize(numSpotsFound);
 
-	if (cacheFile != NULL) {
-		try {
-			fileReadChecked(&numSpotsFound, sizeof(int), 1, cacheFile);
-			vectoredSpots.resize(numSpotsFound);
-			fileReadChecked(&averageIncome, sizeof(float), 1, cacheFile);
-			for (int i = 0; i < numSpotsFound; i++) {
-				fileReadChecked(&vectoredSpots[i], sizeof(float3), 1, cacheFile);
-			}
-			loaded = true;
-		} catch (const std::runtime_error& err) {
-			LOG_L(L_WARNING,
-					"Failed to load the resource map cache from file %s: %s",
-					cacheFileName.c_str(), err.what());
-		}
-		fclose(cacheFile);
+	for (int i = 0; i < numSpotsFound; i++) {
+		vectoredSpots[i] = float3(cacheData[1 + i * 3 + 0], cacheData[1 + i * 3 + 1], cacheData[1 + i * 3 + 2]);
 	}
 
-	return loaded;
+	return true;
 }
 
 
-std::string CResourceMapAnalyzer::GetCacheFileName() const {
+std::string CResourceMapAnalyzer::GetCacheSectionName() const {
 
+	// the spots depend on the extractor radius, which is set by the game
 	const CResource* resource = resourceHandler->GetResource(resourceId);
-	std::string absFile = CACHE_BASE + gameSetup->mapName + resource->name;
-
-	return absFile;
+	return ("resourceSpots_" + resource->name + "_" + IntToString(int(extractorRadius)));
 }
@@ -32,7 +32,8 @@ class CResourceMapAnalyzer {
 		void SaveResourceMap();
 		bool LoadResourceMap();
 
-		std::string GetCacheFileName() const;
+		/// name of the spots in the map data cache
+		std::string GetCacheSectionName() const;
 
 		int resourceId;
 		float extractorRadius;
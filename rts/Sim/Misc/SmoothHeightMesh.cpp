@@ -7,11 +7,13 @@
 #include "SmoothHeightMesh.h"
 
 #include "Map/Ground.h"
+#include "Map/MapDataCache.h"
 #include "Map/ReadMap.h"
 #include "System/float3.h"
 #include "System/myMath.h"
 #include "System/OpenMP_cond.h"
 #include "System/TimeProfiler.h"
+#include "System/Util.h"
 
 #include "System/mmgr.h"
 
@@ -63,7 +65,22 @@ SmoothHeightMesh::SmoothHeightMesh(const CGround* ground, float mx, float my, fl
 	, resolution(res)
 	, smoothRadius(std::max(1.0f, smoothRad))
 {
+	CMapDataCache* mapDataCache = readmap->GetMapDataCache();
+
+	// the mesh depends on its parameters too
+	const std::string sectionName =
+		"smoothHeightMesh" + IntToString(int(resolution)) + "_" + IntToString(int(smoothRadius));
+
+	mesh.resize((maxx + 1) * (maxy + 1));
+
+	if (mapDataCache->ReadSection(sectionName, mesh)) {
+		origMesh = mesh;
+		return;
+	}
+
+	mesh.clear();
 	MakeSmoothMesh(ground);
+	mapDataCache->AddSection(sectionName, origMesh);
 }
 
 SmoothHeightMesh::~SmoothHeightMesh() {
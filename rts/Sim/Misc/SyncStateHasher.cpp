@@ -0,0 +1,184 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/mmgr.h"
+
+#include "SyncStateHasher.h"
+
+#include <cstring>
+
+#include "Map/ReadMap.h"
+#include "Sim/Features/Feature.h"
+#include "Sim/Features/FeatureHandler.h"
+#include "Sim/Misc/GlobalSynced.h"
+#include "Sim/Misc/Team.h"
+#include "Sim/Misc/TeamHandler.h"
+#include "Sim/Path/IPathManager.h"
+#include "Sim/Projectiles/Projectile.h"
+#include "Sim/Projectiles/ProjectileHandler.h"
+#include "Sim/Units/Unit.h"
+#include "Sim/Units/UnitHandler.h"
+#include "System/Sync/HsiehHash.h"
+#include "System/TimeProfiler.h"
+
+CSyncStateHasher* syncStateHasher = NULL;
+
+static const int NUM_FRAMES = CSyncStateHashes::NUM_FRAMES;
+
+
+namespace {
+	/// collects the values of one object, to hash them at once
+	class HashBuffer {
+	public:
+		HashBuffer(): size(0) {}
+
+		void AddInt(int i) {
+			data[size++] = i;
+		}
+		void AddFloat(float f) {
+			boost::uint32_t i;
+			std::memcpy(&i, &f, sizeof(i));
+			data[size++] = i;
+		}
+		void AddFloat3(const float3& f) {
+			AddFloat(f.x);
+			AddFloat(f.y);
+			AddFloat(f.z);
+		}
+
+		boost::uint32_t Hash(boost::uint32_t hash) const {
+			return HsiehHash((const char*) data, size * sizeof(data[0]), hash);
+		}
+
+	private:
+		boost::uint32_t data[16];
+		int size;
+	};
+}
+
+
+CSyncStateHasher::CSyncStateHasher()
+	: curRoundFrame(-1)
+	, roundFrame(-1)
+{
+}
+
+
+bool CSyncStateHasher::Update(int frameNum)
+{
+	SCOPED_TIMER("SyncStateHasher::Update");
+
+	const int phase = frameNum % NUM_FRAMES;
+
+	if (phase == 0) {
+		curRoundFrame = frameNum;
+		curHashes.assign(CSyncStateHashes::NUM_SUBSYSTEMS, 0);
+	}
+
+	// rounds always start at the same frames, skip the partial first one
+	if (curRoundFrame < 0)
+		return false;
+
+	HashUnits(phase);
+	HashFeatures(phase);
+	HashHeightMap(phase);
+
+	if (phase != (NUM_FRAMES - 1))
+		return false;
+
+	HashProjectiles();
+	HashTeams();
+	curHashes[CSyncStateHashes::SUBSYS_PATHS] = pathManager->GetPathCheckSum();
+
+	roundFrame = curRoundFrame;
+	roundHashes = curHashes;
+	return true;
+}
+
+
+void CSyncStateHasher::HashUnits(int phase)
+{
+	boost::uint32_t& hash = curHashes[CSyncStateHashes::SUBSYS_UNITS];
+
+	for (unsigned int id = phase; id < uh->MaxUnits(); id += NUM_FRAMES) {
+		const CUnit* unit = uh->GetUnitUnsafe(id);
+
+		if (unit == NULL)
+			continue;
+
+		HashBuffer buf;
+		buf.AddInt(unit->id);
+		buf.AddInt(unit->team);
+		buf.AddInt(short(unit->heading));
+		buf.AddFloat3(unit->pos);
+		buf.AddFloat3(unit->speed);
+		buf.AddFloat(unit->health);
+		hash = buf.Hash(hash);
+	}
+}
+
+void CSyncStateHasher::HashFeatures(int phase)
+{
+	boost::uint32_t& hash = curHashes[CSyncStateHashes::SUBSYS_FEATURES];
+
+	for (int id = phase; id < featureHandler->MaxFeatures(); id += NUM_FRAMES) {
+		const CFeature* feature = featureHandler->GetFeature(id);
+
+		if (feature == NULL)
+			continue;
+
+		HashBuffer buf;
+		buf.AddInt(feature->id);
+		buf.AddFloat3(feature->pos);
+		buf.AddFloat(feature->health);
+		buf.AddFloat(feature->reclaimLeft);
+		buf.AddFloat(feature->resurrectProgress);
+		hash = buf.Hash(hash);
+	}
+}
+
+void CSyncStateHasher::HashHeightMap(int phase)
+{
+	boost::uint32_t& hash = curHashes[CSyncStateHashes::SUBSYS_HEIGHTMAP];
+	const float* heightMap = readmap->GetCornerHeightMapSynced();
+
+	for (int z = phase; z <= gs->mapy; z += NUM_FRAMES) {
+		hash = HsiehHash((const char*) &heightMap[z * gs->mapxp1], gs->mapxp1 * sizeof(float), hash);
+	}
+}
+
+void CSyncStateHasher::HashProjectiles()
+{
+	boost::uint32_t& hash = curHashes[CSyncStateHashes::SUBSYS_PROJECTILES];
+
+	const ProjectileMap& projectileIDs = ph->syncedProjectileIDs;
+
+	for (int id = 0; id < projectileIDs.GetSize(); ++id) {
+		if (!projectileIDs.IsUsed(id))
+			continue;
+
+		const CProjectile* p = projectileIDs[id].first;
+
+		HashBuffer buf;
+		buf.AddInt(id);
+		buf.AddFloat3(p->pos);
+		buf.AddFloat3(p->speed);
+		hash = buf.Hash(hash);
+	}
+}
+
+void CSyncStateHasher::HashTeams()
+{
+	boost::uint32_t& hash = curHashes[CSyncStateHashes::SUBSYS_TEAMS];
+
+	for (int t = 0; t < teamHandler->ActiveTeams(); ++t) {
+		const CTeam* team = teamHandler->Team(t);
+
+		HashBuffer buf;
+		buf.AddFloat(team->metal);
+		buf.AddFloat(team->energy);
+		buf.AddFloat(team->metalStorage);
+		buf.AddFloat(team->energyStorage);
+		buf.AddInt(team->units.size());
+		hash = buf.Hash(hash);
+	}
+}
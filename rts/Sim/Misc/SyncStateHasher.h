@@ -0,0 +1,51 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef SYNC_STATE_HASHER_H
+#define SYNC_STATE_HASHER_H
+
+#include "System/Sync/SyncStateHashes.h"
+
+/**
+ * Computes the CSyncStateHashes of the synced state.
+ *
+ * The work of a round is spread over its CSyncStateHashes::NUM_FRAMES
+ * frames: in each frame only the units and features whose id matches the
+ * frame (modulo NUM_FRAMES) and some rows of the heightmap are hashed,
+ * the (short-lived) projectiles and the teams in the last frame.
+ * As the simulation is deterministic, every client hashes the same
+ * objects in the same state, while the cost per frame stays tiny.
+ */
+class CSyncStateHasher
+{
+public:
+	CSyncStateHasher();
+
+	/**
+	 * Call at the end of every SimFrame.
+	 * @return true if the hashes of a round have been completed this frame
+	 */
+	bool Update(int frameNum);
+
+	/// first frame of the last completed round
+	int GetRoundFrame() const { return roundFrame; }
+	const CSyncStateHashes::Hashes& GetHashes() const { return roundHashes; }
+
+private:
+	void HashUnits(int phase);
+	void HashFeatures(int phase);
+	void HashHeightMap(int phase);
+	void HashProjectiles();
+	void HashTeams();
+
+private:
+	/// -1 until the first round started (rounds start at frames divisible by NUM_FRAMES)
+	int curRoundFrame;
+	CSyncStateHashes::Hashes curHashes;
+
+	int roundFrame;
+	CSyncStateHashes::Hashes roundHashes;
+};
+
+extern CSyncStateHasher* syncStateHasher;
+
+#endif // SYNC_STATE_HASHER_H
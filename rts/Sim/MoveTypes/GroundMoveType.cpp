@@ -2,6 +2,8 @@
 
 #include "System/mmgr.h"
 
+#include <algorithm>
+
 #include "GroundMoveType.h"
 #include "ExternalAI/EngineOutHandler.h"
 #include "Game/Camera.h"
@@ -52,6 +54,10 @@ LOG_REGISTER_SECTION_GLOBAL(LOG_SECTION_GMT)
 #define MIN_WAYPOINT_DISTANCE (SQUARE_SIZE << 1)
 #define MAX_IDLING_SLOWUPDATES 16
 #define DEBUG_OUTPUT 0
+
+// allow some degree of inter-penetration (1 - 0.75)
+// between objects to avoid sudden extreme responses
+#define FOOTPRINT_RADIUS(xs, zs) ((math::sqrt((xs * xs + zs * zs)) * 0.5f * SQUARE_SIZE) * 0.75f)
 #define PLAY_SOUNDS 1
 
 
@@ -158,7 +164,10 @@ CGroundMoveType::CGroundMoveType(CUnit* owner):
 	pathRequestDelay(0),
 
 	numIdlingUpdates(0),
-	numIdlingSlowUpdates(0)
+	numIdlingSlowUpdates(0),
+
+	collisionFrame(-1),
+	collisionLayoutChanges(0)
 {
 	assert(owner != NULL);
 
@@ -181,6 +190,104 @@ void CGroundMoveType::PostLoad()
 	}
 }
 
+template<typename T>
+static bool ObjectIdLess(const T* a, const T* b) { return (a->id < b->id); }
+
+// removes the objects not within radius (plus their own) of pos, as GetUnitsExact does
+template<typename T>
+static void FilterCollisionCandidates(std::vector<T*>& objects, const float3& pos, float radius)
+{
+	typename std::vector<T*>::iterator oi = objects.begin();
+
+	for (typename std::vector<T*>::const_iterator it = objects.begin(); it != objects.end(); ++it) {
+		const float totRad = radius + (*it)->radius;
+
+		if ((pos - (*it)->midPos).SqLength() < (totRad * totRad)) {
+			*(oi++) = *it;
+		}
+	}
+
+	objects.erase(oi, objects.end());
+}
+
+// as above, but also removes the units GetUnitsExact would not see: it only
+// looks in the quads around pos, and units are kept in the quads they were
+// put in by their last CQuadField::MovedUnit (not the ones they are in now)
+static void FilterCollisionCandidates(std::vector<CUnit*>& units, const float3& pos, float radius)
+{
+	FilterCollisionCandidates<CUnit>(units, pos, radius);
+
+	const std::vector<int>& quads = qf->GetQuads(pos, radius);
+	std::vector<CUnit*>::iterator ui = units.begin();
+
+	for (std::vector<CUnit*>::const_iterator it = units.begin(); it != units.end(); ++it) {
+		const std::vector<int>& unitQuads = (*it)->quads;
+
+		if (std::find_first_of(unitQuads.begin(), unitQuads.end(), quads.begin(), quads.end()) != unitQuads.end()) {
+			*(ui++) = *it;
+		}
+	}
+
+	units.erase(ui, units.end());
+}
+
+// pushes of one unit in a frame the candidates of PrepareUpdate allow for
+static const float MAX_PREPARED_PUSH = SQUARE_SIZE * 2.0f;
+
+/// tells the quad field if a unit is pushed further than PrepareUpdate allows for
+static void AddCollisionPush(CUnit* unit, const float3& push)
+{
+	AMoveType* moveType = unit->moveType;
+
+	if (moveType->pushFrame != gs->frameNum) {
+		moveType->pushFrame = gs->frameNum;
+		moveType->pushDistance = 0.0f;
+	}
+
+	moveType->pushDistance += push.Length();
+
+	if (moveType->pushDistance > MAX_PREPARED_PUSH) {
+		qf->JumpedUnit(unit);
+	}
+}
+
+void CGroundMoveType::PrepareUpdate(std::vector<int>& tempQuads, float maxUnitSpeed)
+{
+	collisionFrame = -1;
+
+	collisionUnits.clear();
+	collisionFeatures.clear();
+
+	// Update does not get as far as colliding
+	if (owner->transporter != NULL || skidding || owner->falling) {
+		return;
+	}
+	// units standing still rarely collide, Update queries for them itself
+	if (pathId == 0 && owner->speed == ZeroVector) {
+		return;
+	}
+
+	// candidates for HandleObjectCollisions: objects further away than
+	// this at the start of the frame can not get into its query range
+	// before the unit's Update, neither by their own movement nor by
+	// the collider's (each moving at most its speed plus pushes up to
+	// MAX_PREPARED_PUSH; anything else changes the quad field layout)
+	const MoveData* md = owner->mobility;
+	const float colliderRadius = (md != NULL)?
+		FOOTPRINT_RADIUS(md->xsize, md->zsize):
+		FOOTPRINT_RADIUS(owner->unitDef->xsize, owner->unitDef->zsize);
+	const float candidateRadius =
+		(colliderRadius * 2.0f) +
+		((maxSpeed + maxUnitSpeed) * 2.0f) +
+		(MAX_PREPARED_PUSH * 2.0f);
+
+	// all the objects the queries of HandleObjectCollisions can find, and more
+	qf->GetUnitsExact(owner->pos, candidateRadius, tempQuads, collisionUnits);
+	qf->GetFeaturesExact(owner->pos, candidateRadius, tempQuads, collisionFeatures);
+	collisionFrame = gs->frameNum;
+	collisionLayoutChanges = qf->GetNumLayoutChanges();
+}
+
 bool CGroundMoveType::Update()
 {
 	ASSERT_SYNCED(owner->pos);
@@ -910,9 +1017,6 @@ void CGroundMoveType::CalcSkidRot()
  * follow the path even when it's not perfect.
  */
 float3 CGroundMoveType::ObstacleAvoidance(const float3& desiredDir) {
-	// multiplier for how strongly an object should be avoided
-	static const float AVOIDANCE_STRENGTH = 2.0f;
-
 	// NOTE: based on the requirement that all objects have symetrical footprints.
 	// If this is false, then radius has to be calculated in a different way!
 
@@ -952,95 +1056,22 @@ float3 CGroundMoveType::ObstacleAvoidance(const float3& desiredDir) {
 			}
 
 			// now we do the obstacle avoidance proper
-			const float currentDistanceToGoal = owner->pos.distance2D(goalPos);
-			const float currentDistanceToGoalSq = currentDistanceToGoal * currentDistanceToGoal;
-			const float3 rightOfPath = desiredDir.cross(float3(0.0f, 1.0f, 0.0f));
-			const float speedf = owner->speed.Length2D();
-
-			float avoidLeft = 0.0f;
-			float avoidRight = 0.0f;
-			float3 rightOfAvoid = rightOfPath;
-
-
-			MoveData* moveData = owner->mobility;
-			CMoveMath* moveMath = moveData->moveMath;
-			moveData->tempOwner = owner;
-
-			const vector<CSolidObject*> &nearbyObjects = qf->GetSolidsExact(owner->pos, speedf * 35 + 30 + owner->xsize / 2);
 			vector<CSolidObject*> objectsOnPath;
 
-			for (vector<CSolidObject*>::const_iterator oi = nearbyObjects.begin(); oi != nearbyObjects.end(); ++oi) {
-				CSolidObject* o = *oi;
-
-				if (moveMath->IsNonBlocking(*moveData, o)) {
-					// no need to avoid this obstacle
-					continue;
-				}
-
-				// basic blocking-check (test if the obstacle cannot be overrun)
-				if (o != owner && moveMath->CrushResistant(*moveData, o) && desiredDir.dot(o->pos - owner->pos) > 0) {
-					float3 objectToUnit = (owner->pos - o->pos - o->speed * 30);
-					float distanceToObjectSq = objectToUnit.SqLength();
-					float radiusSum = (owner->xsize + o->xsize) * SQUARE_SIZE / 2;
-					float distanceLimit = speedf * 35 + 10 + radiusSum;
-					float distanceLimitSq = distanceLimit * distanceLimit;
-
-					// if object is close enough
-					if (distanceToObjectSq < distanceLimitSq && distanceToObjectSq < currentDistanceToGoalSq
-							&& distanceToObjectSq > 0.0001f) {
-						// Don't divide by zero. (TODO: figure out why this can
-						// actually happen.) Positive value means "to the right".
-						float objectDistToAvoidDirCenter = objectToUnit.dot(rightOfAvoid);
-
-						// If object and unit in relative motion are closing in on one another
-						// (or not yet fully apart), then the object is on the path of the unit
-						// and they are not collided.
-						if (objectToUnit.dot(avoidanceDir) < radiusSum &&
-							math::fabs(objectDistToAvoidDirCenter) < radiusSum &&
-							(o->mobility || Distance2D(owner, o) >= 0)) {
-
-							// Avoid collision by turning the heading to left or right.
-							// Using the object thats needs the most adjustment.
-
-							#if (DEBUG_OUTPUT == 1)
-							GML_RECMUTEX_LOCK(sel); // ObstacleAvoidance
-
-							if (selectedUnits.selectedUnits.find(owner) != selectedUnits.selectedUnits.end())
-								geometricObjects->AddLine(owner->pos + UpVector * 20, o->pos + UpVector * 20, 3, 1, 4);
-							#endif
-
-							if (objectDistToAvoidDirCenter > 0.0f) {
-								avoidRight +=
-									(radiusSum - objectDistToAvoidDirCenter) *
-									AVOIDANCE_STRENGTH * fastmath::isqrt2(distanceToObjectSq);
-								avoidanceDir += (rightOfAvoid * avoidRight);
-								avoidanceDir.SafeNormalize();
-								rightOfAvoid = avoidanceDir.cross(float3(0.0f, 1.0f, 0.0f));
-							} else {
-								avoidLeft +=
-									(radiusSum - math::fabs(objectDistToAvoidDirCenter)) *
-									AVOIDANCE_STRENGTH * fastmath::isqrt2(distanceToObjectSq);
-								avoidanceDir -= (rightOfAvoid * avoidLeft);
-								avoidanceDir.SafeNormalize();
-								rightOfAvoid = avoidanceDir.cross(float3(0.0f, 1.0f, 0.0f));
-							}
-							objectsOnPath.push_back(o);
-						}
-					}
-
-				}
-			}
-
-			moveData->tempOwner = NULL;
-
+			const vector<CSolidObject*>& nearbyObjects = qf->GetSolidsExact(owner->pos, GetAvoidanceRadius());
+			const float avoidanceStrength = GetAvoidanceStrength(desiredDir, nearbyObjects, &objectsOnPath);
 
 			// Sum up avoidance.
-			avoidanceVec = (desiredDir.cross(UpVector) * (avoidRight - avoidLeft));
+			avoidanceVec = (desiredDir.cross(UpVector) * avoidanceStrength);
 
 			#if (DEBUG_OUTPUT == 1)
 			GML_RECMUTEX_LOCK(sel); //ObstacleAvoidance
 
 			if (selectedUnits.selectedUnits.find(owner) != selectedUnits.selectedUnits.end()) {
+				for (vector<CSolidObject*>::const_iterator oi = objectsOnPath.begin(); oi != objectsOnPath.end(); ++oi) {
+					geometricObjects->AddLine(owner->pos + UpVector * 20, (*oi)->pos + UpVector * 20, 3, 1, 4);
+				}
+
 				int a = geometricObjects->AddLine(owner->pos + UpVector * 20, owner->pos + UpVector * 20 + avoidanceVec * 40, 7, 1, 4);
 				geometricObjects->SetColor(a, 1, 0.3f, 0.3f, 0.6f);
 
@@ -1064,6 +1095,93 @@ float3 CGroundMoveType::ObstacleAvoidance(const float3& desiredDir) {
 	}
 }
 
+float CGroundMoveType::GetAvoidanceRadius() const {
+	return (owner->speed.Length2D() * 35 + 30 + owner->xsize / 2);
+}
+
+// How strongly the unit should steer to the right (left if negative) to
+// avoid the given objects; only reads the sim state (see PrepareUpdate).
+float CGroundMoveType::GetAvoidanceStrength(
+	const float3& desiredDir,
+	const std::vector<CSolidObject*>& nearbyObjects,
+	std::vector<CSolidObject*>* objectsOnPath
+) {
+	// multiplier for how strongly an object should be avoided
+	static const float AVOIDANCE_STRENGTH = 2.0f;
+
+	const float currentDistanceToGoal = owner->pos.distance2D(goalPos);
+	const float currentDistanceToGoalSq = currentDistanceToGoal * currentDistanceToGoal;
+	const float3 rightOfPath = desiredDir.cross(float3(0.0f, 1.0f, 0.0f));
+	const float speedf = owner->speed.Length2D();
+
+	float avoidLeft = 0.0f;
+	float avoidRight = 0.0f;
+	float3 avoidanceDir = desiredDir;
+	float3 rightOfAvoid = rightOfPath;
+
+	const MoveData* moveData = owner->mobility;
+	const CMoveMath* moveMath = moveData->moveMath;
+
+	for (vector<CSolidObject*>::const_iterator oi = nearbyObjects.begin(); oi != nearbyObjects.end(); ++oi) {
+		CSolidObject* o = *oi;
+
+		if (moveMath->IsNonBlocking(*moveData, o, owner)) {
+			// no need to avoid this obstacle
+			continue;
+		}
+
+		// basic blocking-check (test if the obstacle cannot be overrun)
+		if (o != owner && moveMath->CrushResistant(*moveData, o) && desiredDir.dot(o->pos - owner->pos) > 0) {
+			float3 objectToUnit = (owner->pos - o->pos - o->speed * 30);
+			float distanceToObjectSq = objectToUnit.SqLength();
+			float radiusSum = (owner->xsize + o->xsize) * SQUARE_SIZE / 2;
+			float distanceLimit = speedf * 35 + 10 + radiusSum;
+			float distanceLimitSq = distanceLimit * distanceLimit;
+
+			// if object is close enough
+			if (distanceToObjectSq < distanceLimitSq && distanceToObjectSq < currentDistanceToGoalSq
+					&& distanceToObjectSq > 0.0001f) {
+				// Don't divide by zero. (TODO: figure out why this can
+				// actually happen.) Positive value means "to the right".
+				float objectDistToAvoidDirCenter = objectToUnit.dot(rightOfAvoid);
+
+				// If object and unit in relative motion are closing in on one another
+				// (or not yet fully apart), then the object is on the path of the unit
+				// and they are not collided.
+				if (objectToUnit.dot(avoidanceDir) < radiusSum &&
+					math::fabs(objectDistToAvoidDirCenter) < radiusSum &&
+					(o->mobility || Distance2D(owner, o) >= 0)) {
+
+					// Avoid collision by turning the heading to left or right.
+					// Using the object thats needs the most adjustment.
+					if (objectDistToAvoidDirCenter > 0.0f) {
+						avoidRight +=
+							(radiusSum - objectDistToAvoidDirCenter) *
+							AVOIDANCE_STRENGTH * fastmath::isqrt2(distanceToObjectSq);
+						avoidanceDir += (rightOfAvoid * avoidRight);
+						avoidanceDir.SafeNormalize();
+						rightOfAvoid = avoidanceDir.cross(float3(0.0f, 1.0f, 0.0f));
+					} else {
+						avoidLeft +=
+							(radiusSum - math::fabs(objectDistToAvoidDirCenter)) *
+							AVOIDANCE_STRENGTH * fastmath::isqrt2(distanceToObjectSq);
+						avoidanceDir -= (rightOfAvoid * avoidLeft);
+						avoidanceDir.SafeNormalize();
+						rightOfAvoid = avoidanceDir.cross(float3(0.0f, 1.0f, 0.0f));
+					}
+
+					if (objectsOnPath != NULL) {
+						objectsOnPath->push_back(o);
+					}
+				}
+			}
+
+		}
+	}
+
+	return (avoidRight - avoidLeft);
+}
+
 
 
 // Calculates an aproximation of the physical 2D-distance between given two objects.
@@ -1301,10 +1419,6 @@ void CGroundMoveType::HandleObjectCollisions()
 	collider->mobility->tempOwner = collider;
 
 	{
-		// allow some degree of inter-penetration (1 - 0.75)
-		// between objects to avoid sudden extreme responses
-		#define FOOTPRINT_RADIUS(xs, zs) ((math::sqrt((xs * xs + zs * zs)) * 0.5f * SQUARE_SIZE) * 0.75f)
-
 		const UnitDef*   colliderUD = collider->unitDef;
 		const MoveData*  colliderMD = collider->mobility;
 		const CMoveMath* colliderMM = colliderMD->moveMath;
@@ -1318,8 +1432,35 @@ void CGroundMoveType::HandleObjectCollisions()
 			FOOTPRINT_RADIUS(colliderMD->xsize, colliderMD->zsize):
 			FOOTPRINT_RADIUS(colliderUD->xsize, colliderUD->zsize);
 
-		const std::vector<CUnit*>& nearUnits = qf->GetUnitsExact(colliderCurPos, colliderRadius * 2.0f);
-		const std::vector<CFeature*>& nearFeatures = qf->GetFeaturesExact(colliderCurPos, colliderRadius * 2.0f);
+		static std::vector<int> tempQuads;
+
+		// not already done by PrepareUpdate, or objects may have come into
+		// range since that it did not allow for (wrecks of crushed features,
+		// teleported units, long pushes of this unit or of others)
+		const bool prepared =
+			(collisionFrame == gs->frameNum) &&
+			(pushFrame != gs->frameNum || pushDistance <= MAX_PREPARED_PUSH) &&
+			!qf->LayoutChangedSince(colliderCurPos, colliderRadius * 2.0f, collisionLayoutChanges, tempQuads);
+
+		if (!prepared) {
+			collisionUnits = qf->GetUnitsExact(colliderCurPos, colliderRadius * 2.0f);
+			collisionFeatures = qf->GetFeaturesExact(colliderCurPos, colliderRadius * 2.0f);
+		} else {
+			// keep the candidates these queries would return now
+			FilterCollisionCandidates(collisionUnits, colliderCurPos, colliderRadius * 2.0f);
+			FilterCollisionCandidates(collisionFeatures, colliderCurPos, colliderRadius * 2.0f);
+		}
+
+		// in the order of their ids instead of the order the quads are
+		// walked in (which differs between the prepared query with its
+		// larger radius and the one above, and with it the pushes)
+		std::sort(collisionUnits.begin(), collisionUnits.end(), ObjectIdLess<CUnit>);
+		std::sort(collisionFeatures.begin(), collisionFeatures.end(), ObjectIdLess<CFeature>);
+
+		collisionFrame = -1;
+
+		const std::vector<CUnit*>& nearUnits = collisionUnits;
+		const std::vector<CFeature*>& nearFeatures = collisionFeatures;
 
 		std::vector<CUnit*>::const_iterator uit;
 		std::vector<CFeature*>::const_iterator fit;
@@ -1396,6 +1537,7 @@ void CGroundMoveType::HandleObjectCollisions()
 					const float3 resVec = float3(std::max(absVec.x, 0.25f) * sgnVec.x, 0.0f, std::max(absVec.y, 0.25f) * sgnVec.y);
 
 					collider->pos = colliderOldPos + resVec;
+					AddCollisionPush(collider, resVec);
 
 					currentSpeed = 0.0f;
 					// <requestedSpeed> is only reset every SlowUpdate, do not touch it
@@ -1418,6 +1560,8 @@ void CGroundMoveType::HandleObjectCollisions()
 
 			if (pushCollider) { collider->pos += (colResponseVec * colliderMassScale); } else if (colliderMobile) { collider->pos = colliderOldPos; }
 			if (pushCollidee) { collidee->pos -= (colResponseVec * collideeMassScale); } else if (collideeMobile) { collidee->pos = collideeOldPos; }
+			if (pushCollider) { AddCollisionPush(collider, colResponseVec * colliderMassScale); }
+			if (pushCollidee) { AddCollisionPush(collidee, colResponseVec * collideeMassScale); }
 
 			collider->UpdateMidPos();
 			collidee->UpdateMidPos();
@@ -1481,6 +1625,7 @@ void CGroundMoveType::HandleObjectCollisions()
 					const float3 resVec = float3(std::max(absVec.x, 0.25f) * sgnVec.x, 0.0f, std::max(absVec.y, 0.25f) * sgnVec.y);
 
 					collider->pos = colliderOldPos + resVec;
+					AddCollisionPush(collider, resVec);
 
 					currentSpeed = 0.0f;
 					// <requestedSpeed> is only reset every SlowUpdate, do not touch it
@@ -1494,15 +1639,18 @@ void CGroundMoveType::HandleObjectCollisions()
 
 			collider->pos += (colResponseVec * colliderMassScale);
 		//	collidee->pos -= (colResponseVec * collideeMassScale);
+			AddCollisionPush(collider, colResponseVec * colliderMassScale);
 
 			collider->UpdateMidPos();
 		}
 
-		#undef FOOTPRINT_RADIUS
 	}
 
 	collider->mobility->tempOwner = NULL;
 	collider->Block();
+
+	collisionUnits.clear();
+	collisionFeatures.clear();
 }
 
 
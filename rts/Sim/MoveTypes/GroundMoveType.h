@@ -7,6 +7,7 @@
 #include "Sim/Objects/SolidObject.h"
 
 struct MoveData;
+class CFeature;
 
 class CGroundMoveType : public AMoveType
 {
@@ -18,6 +19,7 @@ public:
 
 	void PostLoad();
 
+	void PrepareUpdate(std::vector<int>& tempQuads, float maxUnitSpeed);
 	bool Update();
 	void SlowUpdate();
 
@@ -68,6 +70,8 @@ public:
 
 protected:
 	float3 ObstacleAvoidance(const float3& desiredDir);
+	float GetAvoidanceRadius() const;
+	float GetAvoidanceStrength(const float3& desiredDir, const std::vector<CSolidObject*>& nearbyObjects, std::vector<CSolidObject*>* objectsOnPath);
 	float Distance2D(CSolidObject* object1, CSolidObject* object2, float marginal = 0.0f);
 
 	void GetNewPath();
@@ -136,6 +140,13 @@ protected:
 
 	int moveSquareX;
 	int moveSquareY;
+
+	/// collision candidates found by PrepareUpdate, only valid in frame collisionFrame
+	int collisionFrame;
+	std::vector<CUnit*> collisionUnits;
+	std::vector<CFeature*> collisionFeatures;
+	/// CQuadField::GetNumLayoutChanges when PrepareUpdate gathered these
+	unsigned int collisionLayoutChanges;
 };
 
 #endif // GROUNDMOVETYPE_H
@@ -18,6 +18,7 @@
 #include "System/CRC.h"
 #include "System/myMath.h"
 #include "System/Util.h"
+#include "System/TimeProfiler.h"
 
 CR_BIND(MoveData, (0));
 CR_BIND(CMoveInfo, );
@@ -212,6 +213,9 @@ CMoveInfo::CMoveInfo()
 	crc << CHoverMoveMath::noWaterMove;
 
 	moveInfoChecksum = crc.GetDigest();
+
+	speedModGrids.resize(moveData.size(), std::vector<float>(gs->hmapx * gs->hmapy, 0.0f));
+	TerrainChange(0, 0, gs->mapxm1, gs->mapym1);
 }
 
 
@@ -236,3 +240,50 @@ MoveData* CMoveInfo::GetMoveDataFromName(const std::string& name)
 	}
 	return moveData[it->second];
 }
+
+unsigned int CMoveInfo::GetMoveDataChecksum(const MoveData* md) const
+{
+	CRC crc;
+
+	for (int tt = 0; tt < CMapInfo::NUM_TERRAIN_TYPES; ++tt) {
+		const CMapInfo::TerrainType& terrType = mapInfo->terrainTypes[tt];
+
+		crc << terrType.tankSpeed << terrType.kbotSpeed;
+		crc << terrType.hoverSpeed << terrType.shipSpeed;
+	}
+
+	crc << CGroundMoveMath::waterDamageCost;
+	crc << CHoverMoveMath::noWaterMove;
+
+	crc << int(md->moveType) << int(md->moveFamily) << int(md->terrainClass);
+	crc << md->xsize << md->zsize;
+	crc << md->followGround << md->subMarine;
+	crc << md->maxSlope << md->slopeMod;
+	crc << md->depth << md->depthMod;
+	crc << md->crushStrength;
+
+	return crc.GetDigest();
+}
+
+
+void CMoveInfo::TerrainChange(int x1, int z1, int x2, int z2)
+{
+	SCOPED_TIMER("MoveInfo::TerrainChange");
+
+	// the slopes of the neighbouring squares change as well
+	const int hx1 = std::max(            0, (x1 >> 1) - 2);
+	const int hz1 = std::max(            0, (z1 >> 1) - 2);
+	const int hx2 = std::min(gs->hmapx - 1, (x2 >> 1) + 2);
+	const int hz2 = std::min(gs->hmapy - 1, (z2 >> 1) + 2);
+
+	for (size_t n = 0; n < moveData.size(); ++n) {
+		const MoveData* md = moveData[n];
+		float* grid = &speedModGrids[n][0];
+
+		for (int hz = hz1; hz <= hz2; ++hz) {
+			for (int hx = hx1; hx <= hx2; ++hx) {
+				grid[hx + hz * gs->hmapx] = md->moveMath->CalcPosSpeedMod(*md, hx << 1, hz << 1);
+			}
+		}
+	}
+}
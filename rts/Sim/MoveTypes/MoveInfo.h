@@ -113,9 +113,31 @@ public:
 	std::map<std::string, int> name2moveData;
 
 	MoveData* GetMoveDataFromName(const std::string& name);
+	/**
+	 * Checksum of everything the pathing data of one MoveData class depends
+	 * on besides the map itself (its own parameters and the terrain speeds).
+	 */
+	unsigned int GetMoveDataChecksum(const MoveData* md) const;
+
+	/**
+	 * Speed modifiers of the MoveData class with the given pathType, one per
+	 * square of the half-resolution heightmap (as returned by the
+	 * non-directional CMoveMath::GetPosSpeedMod).
+	 */
+	const float* GetSpeedModGrid(unsigned int pathType) const { return &speedModGrids[pathType][0]; }
+	/**
+	 * Recomputes the speed modifiers of all MoveData classes for a changed
+	 * area of the map (in heightmap squares, inclusive); call after the
+	 * readmap updated its derived height data, or after terrain types changed.
+	 */
+	void TerrainChange(int x1, int z1, int x2, int z2);
+
 	unsigned int moveInfoChecksum;
 
 private:
+	/// per MoveData class, not saved (rebuilt from the map)
+	std::vector< std::vector<float> > speedModGrids;
+
 	CMoveMath* groundMoveMath;
 	CMoveMath* hoverMoveMath;
 	CMoveMath* seaMoveMath;
@@ -18,13 +18,23 @@ float CMoveMath::yLevel(const float3& pos) const
 }
 
 
-/* calculate the local speed-modifier for this movedata */
+/* look up the local speed-modifier for this movedata */
 float CMoveMath::GetPosSpeedMod(const MoveData& moveData, int xSquare, int zSquare) const
 {
 	if (xSquare < 0 || zSquare < 0 || xSquare >= gs->mapx || zSquare >= gs->mapy) {
 		return 0.0f;
 	}
 
+	return moveinfo->GetSpeedModGrid(moveData.pathType)[(xSquare >> 1) + ((zSquare >> 1) * gs->hmapx)];
+}
+
+/* calculate the local speed-modifier for this movedata */
+float CMoveMath::CalcPosSpeedMod(const MoveData& moveData, int xSquare, int zSquare) const
+{
+	if (xSquare < 0 || zSquare < 0 || xSquare >= gs->mapx || zSquare >= gs->mapy) {
+		return 0.0f;
+	}
+
 	const int square = (xSquare >> 1) + ((zSquare >> 1) * gs->hmapx);
 	const int squareTerrType = readmap->GetTypeMapSynced()[square];
 
@@ -132,14 +142,12 @@ bool CMoveMath::CrushResistant(const MoveData& moveData, const CSolidObject* obj
  * check if an object is NON-blocking for a given MoveData
  * (ex. a submarine's moveDef vs. a surface ship object)
  */
-bool CMoveMath::IsNonBlocking(const MoveData& moveData, const CSolidObject* obstacle)
+bool CMoveMath::IsNonBlocking(const MoveData& moveData, const CSolidObject* obstacle, const CSolidObject* unit)
 {
 	if (!obstacle->blocking) {
 		return true;
 	}
 
-	const CSolidObject* unit = moveData.tempOwner;
-
 	const int hx = int(obstacle->pos.x / SQUARE_SIZE);
 	const int hz = int(obstacle->pos.z / SQUARE_SIZE);
 	const int hi = (hx >> 1) + (hz >> 1) * gs->hmapx;
@@ -28,6 +28,7 @@ public:
 	const static int BLOCK_IMPASSABLE  = 16 | BLOCK_STRUCTURE;
 
 	// returns a speed-multiplier for given position or data
+	// (the non-directional ones are looked up in CMoveInfo's speed-mod grids)
 	float GetPosSpeedMod(const MoveData& moveData, int xSquare, int zSquare) const;
 	float GetPosSpeedMod(const MoveData& moveData, int xSquare, int zSquare, const float3& moveDir) const;
 	float GetPosSpeedMod(const MoveData& moveData, const float3& pos) const
@@ -39,13 +40,21 @@ public:
 		return GetPosSpeedMod(moveData, pos.x / SQUARE_SIZE, pos.z / SQUARE_SIZE, moveDir);
 	}
 
+	// computes the speed-multiplier the grids hold for a square
+	float CalcPosSpeedMod(const MoveData& moveData, int xSquare, int zSquare) const;
+
 	// tells whether a position is blocked (inaccessable for a given object's movedata)
 	int IsBlocked(const MoveData& moveData, const float3& pos) const;
 	int IsBlocked(const MoveData& moveData, int xSquare, int zSquare) const;
 	
 	// tells whether a given object is blocking the given movedata
 	static bool CrushResistant(const MoveData& moveData, const CSolidObject* object);
-	static bool IsNonBlocking(const MoveData& moveData, const CSolidObject* object);
+	static bool IsNonBlocking(const MoveData& moveData, const CSolidObject* object) {
+		return IsNonBlocking(moveData, object, moveData.tempOwner);
+	}
+	// same for a given owner of the movedata instead of moveData.tempOwner
+	// (which is shared by all units of that movedata, so not thread-safe)
+	static bool IsNonBlocking(const MoveData& moveData, const CSolidObject* object, const CSolidObject* owner);
 
 	// returns the block-status of a single quare
 	static int SquareIsBlocked(const MoveData& moveData, int xSquare, int zSquare);
@@ -9,7 +9,11 @@
 #include "Sim/Misc/RadarHandler.h"
 #include "Sim/Units/Unit.h"
 #include "Sim/Units/UnitDef.h"
+#include "System/ThreadPool.h"
+#include "System/myMath.h"
+#include <algorithm>
 #include <cassert>
+#include <boost/bind.hpp>
 
 CR_BIND_DERIVED_INTERFACE(AMoveType, CObject);
 CR_REG_METADATA(AMoveType, (
@@ -38,11 +42,66 @@ AMoveType::AMoveType(CUnit* owner):
 	padStatus(0),
 	repairBelowHealth(0.3f),
 	useHeading(true),
-	progressState(Done)
+	progressState(Done),
+	pushFrame(-1),
+	pushDistance(0.0f)
 {
 }
 
 
+// fewer units than this are not worth starting threads for
+static const size_t MIN_PARALLEL_UNITS = 256;
+// move types per work item of PrepareUpdates
+static const size_t MOVETYPE_BLOCK_SIZE = 64;
+
+static void PrepareMoveTypeBlock(const std::vector<AMoveType*>* moveTypes, float maxUnitSpeed, int block)
+{
+	const size_t begin = block * MOVETYPE_BLOCK_SIZE;
+	const size_t end = std::min(begin + MOVETYPE_BLOCK_SIZE, moveTypes->size());
+
+	std::vector<int> tempQuads;
+
+	for (size_t i = begin; i < end; ++i) {
+		(*moveTypes)[i]->PrepareUpdate(tempQuads, maxUnitSpeed);
+	}
+}
+
+/**
+ * Lets the move types precompute what they can from the state at the start
+ * of the frame, in parallel: each one only reads the sim state and writes
+ * its own members, so the results do not depend on the number of threads.
+ * With fewer units or a single thread the move types query everything
+ * themselves in Update(), as preparing would only add work: the prepared
+ * queries have to cover more ground than the ones in Update().
+ */
+void AMoveType::PrepareUpdates(const std::list<CUnit*>& units, int numThreads)
+{
+	if (units.size() < MIN_PARALLEL_UNITS)
+		return;
+	if (((numThreads > 0)? numThreads: ThreadPool::GetNumThreads()) < 2)
+		return;
+
+	static std::vector<AMoveType*> moveTypes;
+	moveTypes.clear();
+
+	float maxUnitSpeedSq = 0.0f;
+
+	for (std::list<CUnit*>::const_iterator usi = units.begin(); usi != units.end(); ++usi) {
+		const CUnit* unit = *usi;
+
+		moveTypes.push_back(unit->moveType);
+
+		// units can be faster than their maxSpeed (eg. after impulses)
+		maxUnitSpeedSq = std::max(maxUnitSpeedSq, unit->speed.SqLength());
+		maxUnitSpeedSq = std::max(maxUnitSpeedSq, Square(unit->moveType->maxSpeed));
+	}
+
+	const int numBlocks = (moveTypes.size() + MOVETYPE_BLOCK_SIZE - 1) / MOVETYPE_BLOCK_SIZE;
+
+	ThreadPool::for_mt(0, numBlocks, boost::bind(&PrepareMoveTypeBlock, &moveTypes, math::sqrt(maxUnitSpeedSq), _1), numThreads);
+}
+
+
 void AMoveType::SetMaxSpeed(float speed)
 {
 	assert(speed > 0.0f);
@@ -3,6 +3,9 @@
 #ifndef MOVETYPE_H
 #define MOVETYPE_H
 
+#include <list>
+#include <vector>
+
 #include "System/creg/creg_cond.h"
 #include "Sim/Misc/AirBaseHandler.h"
 #include "System/Object.h"
@@ -31,6 +34,23 @@ public:
 	virtual void SetWantedMaxSpeed(float speed);
 	virtual void LeaveTransport() {}
 
+	/**
+	 * Called for all units before their Update() calls of a frame, from
+	 * several threads at once: may only read the sim state (as it is at
+	 * the start of the frame) and write members of this move type, so it
+	 * can precompute parts of Update() in parallel.
+	 * @param tempQuads scratch buffer of the calling thread for the
+	 *   thread-safe quad field queries
+	 * @param maxUnitSpeed the highest speed or maxSpeed of all units at the
+	 *   start of the frame
+	 */
+	virtual void PrepareUpdate(std::vector<int>& tempQuads, float maxUnitSpeed) {}
+	/**
+	 * Calls PrepareUpdate of the move types of the given units, spread over
+	 * the thread pool (see ThreadPool::for_mt for numThreads); does nothing
+	 * for too few units or threads to be worth it.
+	 */
+	static void PrepareUpdates(const std::list<CUnit*>& units, int numThreads = 0);
 	virtual bool Update() = 0;
 	virtual void SlowUpdate();
 
@@ -66,6 +86,10 @@ public:
 	};
 	ProgressState progressState;
 
+	/// frame of the last collision push of the owner, and the total length of its pushes then
+	int pushFrame;
+	float pushDistance;
+
 protected:
 	void DependentDied(CObject* o);
 };
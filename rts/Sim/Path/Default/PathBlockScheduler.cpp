@@ -0,0 +1,114 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "PathBlockScheduler.h"
+
+#include <cassert>
+
+CPathBlockScheduler::CPathBlockScheduler(int numItems, int numThreads)
+{
+	assert(numThreads > 0);
+
+	ranges.resize(numThreads, NULL);
+
+	for (int i = 0; i < numThreads; i++) {
+		ranges[i] = new Range();
+		ranges[i]->begin = (numItems * (i    )) / numThreads;
+		ranges[i]->end   = (numItems * (i + 1)) / numThreads;
+	}
+}
+
+CPathBlockScheduler::~CPathBlockScheduler()
+{
+	for (size_t i = 0; i < ranges.size(); i++) {
+		delete ranges[i];
+	}
+}
+
+
+bool CPathBlockScheduler::GetNextItem(int thread, int* item)
+{
+	Range& own = *ranges[thread];
+
+	{
+		boost::mutex::scoped_lock lock(own.mutex);
+
+		if (own.begin < own.end) {
+			*item = own.begin++;
+			return true;
+		}
+	}
+
+	return StealItems(thread, item);
+}
+
+bool CPathBlockScheduler::StealItems(int thread, int* item)
+{
+	const int numThreads = ranges.size();
+
+	// items are never added, so once every range was seen
+	// empty there is nothing left for this thread to do
+	while (true) {
+		int victim = -1;
+		int victimSize = 0;
+
+		// pick the largest range; it may shrink before
+		// it gets locked again below, then just retry
+		for (int i = 1; i < numThreads; i++) {
+			const int idx = (thread + i) % numThreads;
+			int size = 0;
+
+			{
+				boost::mutex::scoped_lock lock(ranges[idx]->mutex);
+				size = ranges[idx]->end - ranges[idx]->begin;
+			}
+
+			if (size > victimSize) {
+				victim = idx;
+				victimSize = size;
+			}
+		}
+
+		if (victim == -1)
+			return false;
+
+		int stolenBegin = 0;
+		int stolenEnd = 0;
+
+		{
+			Range& range = *ranges[victim];
+			boost::mutex::scoped_lock lock(range.mutex);
+
+			if (range.begin >= range.end)
+				continue;
+
+			stolenBegin = range.begin + (range.end - range.begin) / 2;
+			stolenEnd = range.end;
+			range.end = stolenBegin;
+		}
+
+		{
+			// nobody else adds to our (empty) range
+			Range& own = *ranges[thread];
+			boost::mutex::scoped_lock lock(own.mutex);
+
+			own.begin = stolenBegin + 1;
+			own.end = stolenEnd;
+		}
+
+		*item = stolenBegin;
+		return true;
+	}
+}
+
+
+int CPathBlockScheduler::GetNumRemaining() const
+{
+	int numRemaining = 0;
+
+	for (size_t i = 0; i < ranges.size(); i++) {
+		boost::mutex::scoped_lock lock(ranges[i]->mutex);
+		numRemaining += (ranges[i]->end - ranges[i]->begin);
+	}
+
+	return numRemaining;
+}
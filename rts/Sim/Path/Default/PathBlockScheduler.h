@@ -0,0 +1,47 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef PATH_BLOCK_SCHEDULER_H
+#define PATH_BLOCK_SCHEDULER_H
+
+#include <vector>
+#include <boost/thread/mutex.hpp>
+
+/**
+ * Hands out the items [0, numItems) to a fixed number of threads.
+ * Every thread starts with its own contiguous range and takes items from
+ * its front; a thread whose range ran dry steals the back half of the
+ * largest remaining range of another thread. Threads only contend when
+ * stealing, and regions of the map that take longer (many obstacles, large
+ * footprints) do not leave the other threads idle at the end.
+ */
+class CPathBlockScheduler
+{
+public:
+	CPathBlockScheduler(int numItems, int numThreads);
+	~CPathBlockScheduler();
+
+	/**
+	 * @param thread in [0, numThreads)
+	 * @return false if all items were handed out
+	 */
+	bool GetNextItem(int thread, int* item);
+
+	/// number of items not handed out yet
+	int GetNumRemaining() const;
+
+private:
+	struct Range {
+		Range(): begin(0), end(0) {}
+
+		mutable boost::mutex mutex;
+		int begin;
+		int end;
+	};
+
+	bool StealItems(int thread, int* item);
+
+	/// one per thread, allocated separately to keep them in different cache lines
+	std::vector<Range*> ranges;
+};
+
+#endif
@@ -6,15 +6,16 @@
 
 #include "PathEstimator.h"
 
+#include <cstdio>
 #include <fstream>
 #include <boost/bind.hpp>
 #include <boost/version.hpp>
-#include <boost/version.hpp>
 
 #include "lib/minizip/zip.h"
 #include "System/mmgr.h"
 
 #include "PathAllocator.h"
+#include "PathBlockScheduler.h"
 #include "PathCache.h"
 #include "PathFinder.h"
 #include "PathFinderDef.h"
@@ -31,6 +32,8 @@
 #include "System/FileSystem/FileSystem.h"
 #include "System/FileSystem/FileQueryFlags.h"
 #include "System/Config/ConfigHandler.h"
+#include "System/CRC.h"
+#include "System/myMath.h"
 #include "System/NetProtocol.h"
 
 CONFIG(int, MaxPathCostsMemoryFootPrint).defaultValue(512 * 1024 * 1024);
@@ -53,8 +56,9 @@ CPathEstimator::CPathEstimator(CPathFinder* pf, unsigned int BSIZE, const std::s
 	blockStates(int2(nbrOfBlocksX, nbrOfBlocksZ), int2(gs->mapx, gs->mapy)),
 	pathFinder(pf),
 	pathChecksum(0),
-	offsetBlockNum(nbrOfBlocksX * nbrOfBlocksZ),
-	costBlockNum(nbrOfBlocksX * nbrOfBlocksZ),
+	pathBarrier(NULL),
+	offsetScheduler(NULL),
+	costScheduler(NULL),
 	nextOffsetMessage(-1),
 	nextCostMessage(-1)
 {
@@ -139,7 +143,21 @@ void CPathEstimator::InitEstimator(const std::string& cacheFileName, const std::
 	InitVertices();
 	InitBlocks();
 
-	if (!ReadFile(cacheFileName, map)) {
+	{
+		char calcMsg[512];
+		sprintf(calcMsg, "Reading Estimate PathCosts [%d]", BLOCK_SIZE);
+		loadscreen->SetLoadMessage(calcMsg);
+	}
+
+	// every MoveData class has its own cache-file, so
+	// a changed class does not invalidate the others
+	for (vector<MoveData*>::iterator mi = moveinfo->moveData.begin(); mi != moveinfo->moveData.end(); ++mi) {
+		if ((*mi)->unitDefRefCount > 0 && !ReadFile(cacheFileName, map, **mi)) {
+			calcMoveData.push_back(*mi);
+		}
+	}
+
+	if (!calcMoveData.empty()) {
 		// start extra threads if applicable, but always keep the total
 		// memory-footprint made by CPathFinder instances within bounds
 		const unsigned int minMemFootPrint = sizeof(CPathFinder) + pathFinder->GetMemFootPrint();
@@ -150,15 +168,17 @@ void CPathEstimator::InitEstimator(const std::string& cacheFileName, const std::
 		{
 			char calcMsg[512];
 			const char* fmtString = (numExtraThreads > 0)?
-				"PathCosts: creating PE%u cache with %u PF threads (%u MB)":
-				"PathCosts: creating PE%u cache with %u PF thread (%u MB)";
+				"PathCosts: creating PE%u cache for %u of %u classes with %u PF threads (%u MB)":
+				"PathCosts: creating PE%u cache for %u of %u classes with %u PF thread (%u MB)";
 
-			sprintf(calcMsg, fmtString, BLOCK_SIZE, numExtraThreads + 1, reqMemFootPrint / (1024 * 1024));
+			sprintf(calcMsg, fmtString, BLOCK_SIZE, unsigned(calcMoveData.size()), unsigned(moveinfo->moveData.size()), numExtraThreads + 1, reqMemFootPrint / (1024 * 1024));
 			loadscreen->SetLoadMessage(calcMsg);
 		}
 
 		// note: only really needed if numExtraThreads > 0
 		pathBarrier = new boost::barrier(numExtraThreads + 1);
+		offsetScheduler = new CPathBlockScheduler(blockStates.GetSize(), numExtraThreads + 1);
+		costScheduler = new CPathBlockScheduler(blockStates.GetSize(), numExtraThreads + 1);
 
 		for (unsigned int i = 1; i <= numExtraThreads; i++) {
 			pathFinders[i] = new CPathFinder();
@@ -174,12 +194,22 @@ void CPathEstimator::InitEstimator(const std::string& cacheFileName, const std::
 			delete pathFinders[i];
 		}
 
+		delete costScheduler;
+		delete offsetScheduler;
 		delete pathBarrier;
 
 		loadscreen->SetLoadMessage("PathCosts: writing", true);
-		WriteFile(cacheFileName, map);
+
+		for (vector<MoveData*>::iterator mi = calcMoveData.begin(); mi != calcMoveData.end(); ++mi) {
+			WriteFile(cacheFileName, map, **mi);
+		}
+
 		loadscreen->SetLoadMessage("PathCosts: written", true);
+
+		calcMoveData.clear();
 	}
+
+	CalcPathChecksum();
 }
 
 
@@ -207,16 +237,15 @@ void CPathEstimator::CalcOffsetsAndPathCosts(int thread) {
 	// A must be completely finished before B_i can be safely called. This means we cannot
 	// let thread i execute (A_i, B_i), but instead have to split the work such that every
 	// thread finishes its part of A before any starts B_i.
-	const int nbr = blockStates.GetSize() - 1;
-	int i;
+	int idx = 0;
 
-	while ((i = --offsetBlockNum) >= 0)
-		CalculateBlockOffsets(nbr - i, thread);
+	while (offsetScheduler->GetNextItem(thread, &idx))
+		CalculateBlockOffsets(idx, thread);
 
 	pathBarrier->wait();
 
-	while ((i = --costBlockNum) >= 0)
-		EstimatePathCosts(nbr - i, thread);
+	while (costScheduler->GetNextItem(thread, &idx))
+		EstimatePathCosts(idx, thread);
 }
 
 
@@ -225,35 +254,39 @@ void CPathEstimator::CalculateBlockOffsets(int idx, int thread)
 	const int x = idx % nbrOfBlocksX;
 	const int z = idx / nbrOfBlocksX;
 
-	if (thread == 0 && idx >= nextOffsetMessage) {
-		nextOffsetMessage = idx + blockStates.GetSize() / 16;
-		net->Send(CBaseNetProtocol::Get().SendCPUUsage(BLOCK_SIZE | (idx << 8)));
-	}
+	if (thread == 0) {
+		const int numDone = blockStates.GetSize() - offsetScheduler->GetNumRemaining();
 
-	for (vector<MoveData*>::iterator mi = moveinfo->moveData.begin(); mi != moveinfo->moveData.end(); ++mi) {
-		if ((*mi)->unitDefRefCount > 0) {
-			FindOffset(**mi, x, z);
+		if (numDone >= nextOffsetMessage) {
+			nextOffsetMessage = numDone + blockStates.GetSize() / 16;
+			net->Send(CBaseNetProtocol::Get().SendCPUUsage(BLOCK_SIZE | (numDone << 8)));
 		}
 	}
+
+	for (vector<MoveData*>::iterator mi = calcMoveData.begin(); mi != calcMoveData.end(); ++mi) {
+		FindOffset(**mi, x, z);
+	}
 }
 
 void CPathEstimator::EstimatePathCosts(int idx, int thread) {
 	const int x = idx % nbrOfBlocksX;
 	const int z = idx / nbrOfBlocksX;
 
-	if (thread == 0 && idx >= nextCostMessage) {
-		nextCostMessage = idx + blockStates.GetSize() / 16;
-		char calcMsg[128];
-		sprintf(calcMsg, "PathCosts: precached %d of %d", idx, blockStates.GetSize());
-		net->Send(CBaseNetProtocol::Get().SendCPUUsage(0x1 | BLOCK_SIZE | (idx<<8)));
-		loadscreen->SetLoadMessage(calcMsg, (idx != 0));
-	}
+	if (thread == 0) {
+		const int numDone = blockStates.GetSize() - costScheduler->GetNumRemaining();
 
-	for (vector<MoveData*>::iterator mi = moveinfo->moveData.begin(); mi != moveinfo->moveData.end(); ++mi) {
-		if ((*mi)->unitDefRefCount > 0) {
-			CalculateVertices(**mi, x, z, thread);
+		if (numDone >= nextCostMessage) {
+			nextCostMessage = numDone + blockStates.GetSize() / 16;
+			char calcMsg[128];
+			sprintf(calcMsg, "PathCosts: precached %d of %d", numDone, blockStates.GetSize());
+			net->Send(CBaseNetProtocol::Get().SendCPUUsage(0x1 | BLOCK_SIZE | (numDone << 8)));
+			loadscreen->SetLoadMessage(calcMsg, (numDone != 0));
 		}
 	}
+
+	for (vector<MoveData*>::iterator mi = calcMoveData.begin(); mi != calcMoveData.end(); ++mi) {
+		CalculateVertices(**mi, x, z, thread);
+	}
 }
 
 
@@ -361,6 +394,57 @@ void CPathEstimator::CalculateVertex(const MoveData& moveData, int parentBlockX,
 }
 
 
+int CPathEstimator::GetBlockIndex(const float3& pos) const {
+	const int blockX = Clamp(int(pos.x / BLOCK_PIXEL_SIZE), 0, nbrOfBlocksX - 1);
+	const int blockZ = Clamp(int(pos.z / BLOCK_PIXEL_SIZE), 0, nbrOfBlocksZ - 1);
+
+	return (blockZ * nbrOfBlocksX + blockX);
+}
+
+float3 CPathEstimator::GetBlockPos(const MoveData& moveData, int blockIdx) const {
+	const int xSquare = blockStates[blockIdx].nodeOffsets[moveData.pathType].x;
+	const int zSquare = blockStates[blockIdx].nodeOffsets[moveData.pathType].y;
+
+	return SquareToFloat3(xSquare, zSquare);
+}
+
+void CPathEstimator::GetEdgeCosts(const MoveData& moveData, std::vector<float>& edgeCosts, bool synced) const {
+	edgeCosts.resize(blockStates.GetSize() * PATH_DIRECTIONS);
+
+	for (int blockIdx = 0; blockIdx < blockStates.GetSize(); blockIdx++) {
+		const int blockX = blockIdx % nbrOfBlocksX;
+		const int blockZ = blockIdx / nbrOfBlocksX;
+
+		for (int dir = 0; dir < PATH_DIRECTIONS; dir++) {
+			float& edgeCost = edgeCosts[blockIdx * PATH_DIRECTIONS + dir];
+
+			// same as in TestBlock
+			const int childBlockX = blockX + directionVector[dir].x;
+			const int childBlockZ = blockZ + directionVector[dir].y;
+			const int vertexIdx =
+				moveData.pathType * blockStates.GetSize() * PATH_DIRECTION_VERTICES +
+				blockIdx * PATH_DIRECTION_VERTICES +
+				directionVertex[dir];
+
+			edgeCost = PATHCOST_INFINITY;
+
+			if (childBlockX < 0 || childBlockX >= nbrOfBlocksX || childBlockZ < 0 || childBlockZ >= nbrOfBlocksZ)
+				continue;
+			if (vertexIdx < 0 || (unsigned int)vertexIdx >= vertices.size())
+				continue;
+			if (vertices[vertexIdx] >= PATHCOST_INFINITY)
+				continue;
+
+			const int childBlockIdx = childBlockZ * nbrOfBlocksX + childBlockX;
+			const int xSquare = blockStates[childBlockIdx].nodeOffsets[moveData.pathType].x;
+			const int zSquare = blockStates[childBlockIdx].nodeOffsets[moveData.pathType].y;
+
+			edgeCost = vertices[vertexIdx] + blockStates.GetNodeExtraCost(xSquare, zSquare, synced);
+		}
+	}
+}
+
+
 /**
  * Mark affected blocks as obsolete
  */
@@ -781,13 +865,11 @@ void CPathEstimator::ResetSearch() {
  * Try to read offset and vertices data from file, return false on failure
  * TODO: Read-error-check.
  */
-bool CPathEstimator::ReadFile(const std::string& cacheFileName, const std::string& map)
+bool CPathEstimator::ReadFile(const std::string& cacheFileName, const std::string& map, const MoveData& moveData)
 {
-	const unsigned int hash = Hash();
-	char hashString[50];
-	sprintf(hashString, "%u", hash);
+	const unsigned int hash = Hash(moveData);
+	const std::string filename = GetCacheFileName(cacheFileName, map, hash);
 
-	std::string filename = std::string(PATH_CACHE_DIR) + map + hashString + "." + cacheFileName + ".zip";
 	if (!FileSystem::FileExists(filename))
 		return false;
 	// open file for reading from a suitable location (where the file exists)
@@ -798,112 +880,144 @@ bool CPathEstimator::ReadFile(const std::string& cacheFileName, const std::strin
 		return false;
 	}
 
-	char calcMsg[512];
-	sprintf(calcMsg, "Reading Estimate PathCosts [%d]", BLOCK_SIZE);
-	loadscreen->SetLoadMessage(calcMsg);
-
 	std::auto_ptr<IArchive> auto_pfile(pfile);
 	IArchive& file(*pfile);
 
 	const unsigned fid = file.FindFile("pathinfo");
 
-	if (fid < file.NumFiles()) {
-		pathChecksum = file.GetCrc32(fid);
-
-		std::vector<boost::uint8_t> buffer;
-		file.GetFile(fid, buffer);
+	if (fid >= file.NumFiles())
+		return false;
 
-		if (buffer.size() < 4)
-			return false;
+	std::vector<boost::uint8_t> buffer;
+	file.GetFile(fid, buffer);
 
-		unsigned filehash = *((unsigned*)&buffer[0]);
-		if (filehash != hash)
-			return false;
+	const unsigned int numBlocks = blockStates.GetSize();
+	const unsigned int numVertices = numBlocks * PATH_DIRECTION_VERTICES;
 
-		unsigned pos = sizeof(unsigned);
+	if (buffer.size() != (sizeof(unsigned) + numBlocks * sizeof(int2) + numVertices * sizeof(float)))
+		return false;
 
-		// Read block-center-offset data.
-		const unsigned blockSize = moveinfo->moveData.size() * sizeof(int2);
-		if (buffer.size() < pos + blockSize * blockStates.GetSize())
-			return false;
+	unsigned filehash = 0;
+	std::memcpy(&filehash, &buffer[0], sizeof(unsigned));
 
-		for (int blocknr = 0; blocknr < blockStates.GetSize(); blocknr++) {
-			std::memcpy(&blockStates[blocknr].nodeOffsets[0], &buffer[pos], blockSize);
-			pos += blockSize;
-		}
+	if (filehash != hash)
+		return false;
 
-		// Read vertices data.
-		if (buffer.size() < pos + vertices.size() * sizeof(float))
-			return false;
-		std::memcpy(&vertices[0], &buffer[pos], vertices.size() * sizeof(float));
+	unsigned pos = sizeof(unsigned);
 
-		// File read successful.
-		return true;
-	} else {
-		return false;
+	// Read block-center-offset data.
+	for (unsigned int blocknr = 0; blocknr < numBlocks; blocknr++) {
+		std::memcpy(&blockStates[blocknr].nodeOffsets[moveData.pathType], &buffer[pos], sizeof(int2));
+		pos += sizeof(int2);
 	}
+
+	// Read vertices data.
+	std::memcpy(&vertices[moveData.pathType * numVertices], &buffer[pos], numVertices * sizeof(float));
+
+	// File read successful.
+	return true;
 }
 
 
 /**
- * Try to write offset and vertex data to file.
+ * Try to write offset and vertex data of one MoveData class to file.
  */
-void CPathEstimator::WriteFile(const std::string& cacheFileName, const std::string& map)
+void CPathEstimator::WriteFile(const std::string& cacheFileName, const std::string& map, const MoveData& moveData)
 {
 	// We need this directory to exist
 	if (!FileSystem::CreateDirectory(PATH_CACHE_DIR))
 		return;
 
-	const unsigned int hash = Hash();
-	char hashString[64] = {0};
-
-	sprintf(hashString, "%u", hash);
-
-	const std::string filename = std::string(PATH_CACHE_DIR) + map + hashString + "." + cacheFileName + ".zip";
-	zipFile file;
+	const unsigned int hash = Hash(moveData);
+	const std::string filename = GetCacheFileName(cacheFileName, map, hash);
+	const std::string filePath = dataDirsAccess.LocateFile(filename, FileQueryFlags::WRITE);
+	const std::string tmpPath = filePath + ".tmp";
 
 	// open file for writing in a suitable location
-	file = zipOpen(dataDirsAccess.LocateFile(filename, FileQueryFlags::WRITE).c_str(), APPEND_STATUS_CREATE);
+	zipFile file = zipOpen(tmpPath.c_str(), APPEND_STATUS_CREATE);
 
-	if (file) {
-		zipOpenNewFileInZip(file, "pathinfo", NULL, NULL, 0, NULL, 0, NULL, Z_DEFLATED, Z_BEST_COMPRESSION);
+	if (!file)
+		return;
 
-		// Write hash.
-		zipWriteInFileInZip(file, (void*) &hash, 4);
+	const unsigned int numBlocks = blockStates.GetSize();
+	const unsigned int numVertices = numBlocks * PATH_DIRECTION_VERTICES;
 
-		// Write block-center-offsets.
-		for (int blocknr = 0; blocknr < blockStates.GetSize(); blocknr++)
-			zipWriteInFileInZip(file, (void*) &blockStates[blocknr].nodeOffsets[0], moveinfo->moveData.size() * sizeof(int2));
+	zipOpenNewFileInZip(file, "pathinfo", NULL, NULL, 0, NULL, 0, NULL, Z_DEFLATED, Z_BEST_COMPRESSION);
 
-		// Write vertices.
-		zipWriteInFileInZip(file, &vertices[0], vertices.size() * sizeof(float));
+	// Write hash.
+	zipWriteInFileInZip(file, (void*) &hash, 4);
 
-		zipCloseFileInZip(file);
-		zipClose(file, NULL);
+	// Write block-center-offsets.
+	for (unsigned int blocknr = 0; blocknr < numBlocks; blocknr++)
+		zipWriteInFileInZip(file, (void*) &blockStates[blocknr].nodeOffsets[moveData.pathType], sizeof(int2));
 
+	// Write vertices.
+	zipWriteInFileInZip(file, &vertices[moveData.pathType * numVertices], numVertices * sizeof(float));
 
-		// get the CRC over the written path data
-		IArchive* pfile = archiveLoader.OpenArchive(dataDirsAccess.LocateFile(filename), "sdz");
+	zipCloseFileInZip(file);
 
-		if (!pfile || !pfile->IsOpen()) {
-			delete pfile;
-			return;
-		}
+	// never leave a partially written file behind
+	if (zipClose(file, NULL) != ZIP_OK) {
+		remove(tmpPath.c_str());
+		return;
+	}
 
-		std::auto_ptr<IArchive> auto_pfile(pfile);
-		IArchive& file(*pfile);
+	remove(filePath.c_str());
 
-		const unsigned fid = file.FindFile("pathinfo");
-		assert(fid < file.NumFiles());
-		pathChecksum = file.GetCrc32(fid);
+	if (rename(tmpPath.c_str(), filePath.c_str()) != 0) {
+		remove(tmpPath.c_str());
 	}
 }
 
 
+std::string CPathEstimator::GetCacheFileName(const std::string& cacheFileName, const std::string& map, unsigned int hash) const
+{
+	char hashString[64] = {0};
+	sprintf(hashString, "%08x", hash);
+
+	return (std::string(PATH_CACHE_DIR) + map + "." + hashString + "." + cacheFileName + ".zip");
+}
+
+
+/**
+ * Returns a hash-code identifying the dataset of one MoveData class
+ */
+unsigned int CPathEstimator::Hash(const MoveData& moveData) const
+{
+	CRC crc;
+	crc << readmap->mapChecksum;
+	crc << moveinfo->GetMoveDataChecksum(&moveData);
+	crc << BLOCK_SIZE;
+	crc << PATHESTIMATOR_VERSION;
+
+	return crc.GetDigest();
+}
+
+
 /**
- * Returns a hash-code identifying the dataset of this estimator.
+ * Checksums the in-memory data of all used MoveData classes, so it does
+ * not matter whether it was read from the cache or calculated
  */
-unsigned int CPathEstimator::Hash() const
+void CPathEstimator::CalcPathChecksum()
 {
-	return (readmap->mapChecksum + moveinfo->moveInfoChecksum + BLOCK_SIZE + PATHESTIMATOR_VERSION);
+	const unsigned int numBlocks = blockStates.GetSize();
+	const unsigned int numVertices = numBlocks * PATH_DIRECTION_VERTICES;
+
+	CRC crc;
+
+	for (vector<MoveData*>::iterator mi = moveinfo->moveData.begin(); mi != moveinfo->moveData.end(); ++mi) {
+		if ((*mi)->unitDefRefCount == 0)
+			continue;
+
+		const unsigned int pathType = (*mi)->pathType;
+
+		for (unsigned int blocknr = 0; blocknr < numBlocks; blocknr++) {
+			crc << blockStates[blocknr].nodeOffsets[pathType].x;
+			crc << blockStates[blocknr].nodeOffsets[pathType].y;
+		}
+
+		crc.Update(&vertices[pathType * numVertices], numVertices * sizeof(float));
+	}
+
+	pathChecksum = crc.GetDigest();
 }
@@ -13,7 +13,6 @@
 #include "System/float3.h"
 
 #include <boost/thread/thread.hpp>
-#include <boost/detail/atomic_count.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/barrier.hpp>
 #include <boost/cstdint.hpp>
@@ -23,6 +22,7 @@ class CPathFinder;
 class CPathEstimatorDef;
 class CPathFinderDef;
 class CPathCache;
+class CPathBlockScheduler;
 
 class CPathEstimator {
 public:
@@ -35,10 +35,10 @@ public:
 	 *   The resolution of the estimator, given in mapsquares.
 	 *
 	 * @param cacheFileName
-	 *   Name of the file on disk where pre-calculated data is stored.
-	 *   The name given are added to the end of the filename, after the
-	 *   name of the corresponding map.
-	 *   Ex. PE-name "pe" + Mapname "Desert" => "Desert.pe"
+	 *   Name of the files on disk where pre-calculated data is stored.
+	 *   The name given are added to the end of the filenames, after the
+	 *   name of the corresponding map and the hash of the MoveData class.
+	 *   Ex. PE-name "pe" + Mapname "Desert" => "Desert.<hash>.pe"
 	 */
 	CPathEstimator(CPathFinder* pathFinder, unsigned int BLOCK_SIZE, const std::string& cacheFileName, const std::string& map);
 	~CPathEstimator();
@@ -112,6 +112,16 @@ public:
 
 	PathNodeStateBuffer& GetNodeStateBuffer() { return blockStates; }
 
+	/// @return the index of the block containing pos
+	int GetBlockIndex(const float3& pos) const;
+	/// @return the position units head for in the block (its offset square)
+	float3 GetBlockPos(const MoveData& moveData, int blockIdx) const;
+	/**
+	 * Gets the costs GetPath uses for moving between neighbouring blocks,
+	 * per block for each of the eight PATHDIR_* directions (for CPathFlowField).
+	 */
+	void GetEdgeCosts(const MoveData& moveData, std::vector<float>& edgeCosts, bool synced) const;
+
 private:
 	void InitEstimator(const std::string& cacheFileName, const std::string& map);
 	void InitVertices();
@@ -142,9 +152,11 @@ private:
 	void FinishSearch(const MoveData& moveData, IPath::Path& path);
 	void ResetSearch();
 
-	bool ReadFile(const std::string& cacheFileName, const std::string& map);
-	void WriteFile(const std::string& cacheFileName, const std::string& map);
-	unsigned int Hash() const;
+	bool ReadFile(const std::string& cacheFileName, const std::string& map, const MoveData& moveData);
+	void WriteFile(const std::string& cacheFileName, const std::string& map, const MoveData& moveData);
+	std::string GetCacheFileName(const std::string& cacheFileName, const std::string& map, unsigned int hash) const;
+	unsigned int Hash(const MoveData& moveData) const;
+	void CalcPathChecksum();
 
 	/// Number of blocks on the X axis of the map.
 	int nbrOfBlocksX;
@@ -180,17 +192,19 @@ private:
 
 	std::vector<CPathFinder*> pathFinders;
 	std::vector<boost::thread*> threads;
+	/// MoveData classes whose data was not in the cache, only during InitEstimator
+	std::vector<MoveData*> calcMoveData;
 
 	CPathFinder* pathFinder;
 	CPathCache* pathCache;
 
-	/// currently crc from the zip
+	/// crc over the offsets and vertices of all used MoveData classes
 	boost::uint32_t pathChecksum;
 
 	boost::mutex loadMsgMutex;
 	boost::barrier* pathBarrier;
-	boost::detail::atomic_count offsetBlockNum;
-	boost::detail::atomic_count costBlockNum;
+	CPathBlockScheduler* offsetScheduler;
+	CPathBlockScheduler* costScheduler;
 
 	int nextOffsetMessage;
 	int nextCostMessage;
@@ -3,6 +3,7 @@
 #include <cstring>
 #include <ostream>
 #include <deque>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 
 #include "System/mmgr.h"
 #include "PathAllocator.h"
@@ -39,6 +40,9 @@ CPathFinder::CPathFinder()
 	, maxSquaresToBeSearched(0)
 	, testedNodes(0)
 	, maxNodeCost(0.0f)
+	, numSearches(0)
+	, numTestedNodes(0)
+	, searchTime(0)
 	, squareStates(int2(gs->mapx, gs->mapy) , int2(gs->mapx, gs->mapy))
 {
 	InitHeatMap();
@@ -92,6 +96,7 @@ IPath::SearchResult CPathFinder::GetPath(
 	int ownerId,
 	bool synced
 ) {
+	const boost::posix_time::ptime searchStart = boost::posix_time::microsec_clock::universal_time();
 
 	// Clear the given path.
 	path.path.clear();
@@ -99,6 +104,7 @@ IPath::SearchResult CPathFinder::GetPath(
 	path.pathCost = PATHCOST_INFINITY;
 
 	// Store som basic data.
+	testedNodes = 0;
 	maxSquaresToBeSearched = std::min(MAX_SEARCHED_NODES_PF - 8U, maxNodes);
 	this->testMobile = testMobile;
 	this->exactPath = exactPath;
@@ -136,6 +142,10 @@ IPath::SearchResult CPathFinder::GetPath(
 			LOG_L(L_DEBUG, "Open squares: %u", openSquareBuffer.GetSize());
 		}
 	}
+
+	numSearches++;
+	numTestedNodes += testedNodes;
+	searchTime += (boost::posix_time::microsec_clock::universal_time() - searchStart).total_microseconds();
 	return result;
 }
 
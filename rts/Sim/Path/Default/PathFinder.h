@@ -6,6 +6,7 @@
 #include <list>
 #include <queue>
 #include <cstdlib>
+#include <boost/cstdint.hpp>
 
 #include "IPath.h"
 #include "PathConstants.h"
@@ -101,6 +102,11 @@ public:
 
 	PathNodeStateBuffer& GetNodeStateBuffer() { return squareStates; }
 
+	/// number of GetPath calls, the squares they tested and the time they took (in microseconds)
+	unsigned int GetNumSearches() const { return numSearches; }
+	boost::uint64_t GetNumTestedNodes() const { return numTestedNodes; }
+	boost::uint64_t GetSearchTime() const { return searchTime; }
+
 private:
 	// Heat mapping
 	int GetHeatMapIndex(int x, int y);
@@ -175,6 +181,10 @@ private:
 	unsigned int testedNodes;
 	float maxNodeCost;
 
+	unsigned int numSearches;
+	boost::uint64_t numTestedNodes;
+	boost::uint64_t searchTime;
+
 	PathNodeBuffer openSquareBuffer;
 	PathNodeStateBuffer squareStates;
 	PathPriorityQueue openSquares;
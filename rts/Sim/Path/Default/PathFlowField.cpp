@@ -0,0 +1,72 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+#include "PathFlowField.h"
+#include "PathConstants.h"
+
+// block offsets of the PATHDIR_* directions
+static const int dirX[8] = {1,  1,  0, -1, -1, -1,  0,  1};
+static const int dirZ[8] = {0,  1,  1,  1,  0, -1, -1, -1};
+
+
+CPathFlowField::CPathFlowField(unsigned int pathType, int goalBlock, int numBlocksX, int numBlocksZ)
+	: pathType(pathType)
+	, goalBlock(goalBlock)
+	, numBlocksX(numBlocksX)
+	, numBlocksZ(numBlocksZ)
+	, costs(numBlocksX * numBlocksZ, PATHCOST_INFINITY)
+	, nextBlocks(numBlocksX * numBlocksZ, -1)
+	, refCount(0)
+	, obsolete(true)
+{
+}
+
+
+void CPathFlowField::Calculate(const std::vector<float>& edgeCosts)
+{
+	// (cost, block); ties are broken by the block index,
+	// so every client ends up with the same field
+	typedef std::pair<float, int> Node;
+	std::priority_queue<Node, std::vector<Node>, std::greater<Node> > openBlocks;
+
+	std::fill(costs.begin(), costs.end(), PATHCOST_INFINITY);
+	std::fill(nextBlocks.begin(), nextBlocks.end(), -1);
+
+	costs[goalBlock] = 0.0f;
+	openBlocks.push(Node(0.0f, goalBlock));
+
+	while (!openBlocks.empty()) {
+		const Node node = openBlocks.top();
+		openBlocks.pop();
+
+		if (node.first > costs[node.second])
+			continue;
+
+		const int bx = node.second % numBlocksX;
+		const int bz = node.second / numBlocksX;
+
+		for (int dir = 0; dir < 8; dir++) {
+			const int nx = bx + dirX[dir];
+			const int nz = bz + dirZ[dir];
+
+			if (nx < 0 || nz < 0 || nx >= numBlocksX || nz >= numBlocksZ)
+				continue;
+
+			// the cost of the way back, from the neighbour into this block
+			const int neighbour = nz * numBlocksX + nx;
+			const float cost = node.first + edgeCosts[neighbour * 8 + ((dir + 4) & 7)];
+
+			if (cost >= costs[neighbour])
+				continue;
+
+			costs[neighbour] = cost;
+			nextBlocks[neighbour] = node.second;
+			openBlocks.push(Node(cost, neighbour));
+		}
+	}
+
+	obsolete = false;
+}
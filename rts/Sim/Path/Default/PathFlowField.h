@@ -0,0 +1,62 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef PATH_FLOW_FIELD_H
+#define PATH_FLOW_FIELD_H
+
+#include <vector>
+
+/**
+ * Cost-to-goal field over the blocks of a path estimator, for one MoveData
+ * class and goal block.
+ *
+ * When a large group is ordered to the same area, the paths of its units
+ * share one of these (see CPathManager::RequestPath): a single search from
+ * the goal block covers every block, and each unit just follows the next
+ * blocks from wherever it is instead of running an estimator search of its
+ * own. Costs are the same as those of CPathEstimator::GetPath.
+ */
+class CPathFlowField
+{
+public:
+	CPathFlowField(unsigned int pathType, int goalBlock, int numBlocksX, int numBlocksZ);
+
+	/**
+	 * (Re)computes the field.
+	 * @param edgeCosts per block the costs of moving to each of its eight
+	 *   neighbours, in PATHDIR_* order (PATHCOST_INFINITY if impassable),
+	 *   as given by CPathEstimator::GetEdgeCosts
+	 */
+	void Calculate(const std::vector<float>& edgeCosts);
+
+	/// @return the neighbour to move to from the block, -1 at the goal block or if the goal is unreachable
+	int GetNextBlock(int block) const { return nextBlocks[block]; }
+	/// @return the cost of moving from the block to the goal, PATHCOST_INFINITY if unreachable
+	float GetCost(int block) const { return costs[block]; }
+
+	unsigned int GetPathType() const { return pathType; }
+	int GetGoalBlock() const { return goalBlock; }
+	int GetNumBlocks() const { return costs.size(); }
+
+	/// number of paths using the field
+	void AddRef() { refCount++; }
+	void Release() { refCount--; }
+	unsigned int GetRefCount() const { return refCount; }
+
+	/// the estimator data changed, Calculate has to be called again
+	void SetObsolete(bool b) { obsolete = b; }
+	bool IsObsolete() const { return obsolete; }
+
+private:
+	unsigned int pathType;
+	int goalBlock;
+	int numBlocksX;
+	int numBlocksZ;
+
+	std::vector<float> costs;
+	std::vector<int> nextBlocks;
+
+	unsigned int refCount;
+	bool obsolete;
+};
+
+#endif // PATH_FLOW_FIELD_H
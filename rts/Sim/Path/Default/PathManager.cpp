@@ -6,8 +6,10 @@
 #include "PathConstants.h"
 #include "PathFinder.h"
 #include "PathEstimator.h"
+#include "PathFlowField.h"
 #include "Map/MapInfo.h"
 #include "Sim/Misc/GlobalSynced.h"
+#include "Sim/Misc/ModInfo.h"
 #include "Sim/MoveTypes/MoveInfo.h"
 #include "Sim/MoveTypes/MoveMath/MoveMath.h"
 #include "System/Log/ILog.h"
@@ -18,9 +20,20 @@
 #define PM_UNCONSTRAINED_MEDRES_FALLBACK_SEARCH 1
 #define PM_UNCONSTRAINED_LOWRES_FALLBACK_SEARCH 1
 
+// requests for the same goal within this many frames count as one group
+static const int FLOW_FIELD_GROUP_FRAMES = GAME_SPEED;
+// how many blocks ahead paths read from their flow field at a time
+static const int FLOW_FIELD_LOOKAHEAD = 12;
+// obsolete flow fields are recalculated at most this often
+static const int FLOW_FIELD_UPDATE_RATE = 16;
 
 
-CPathManager::CPathManager(): nextPathId(0)
+
+CPathManager::CPathManager()
+	: nextPathId(0)
+	, flowFieldMinGroupSize(modInfo.pathFlowFieldMinGroupSize)
+	, numFlowFieldPaths(0)
+	, numFlowFieldCalcs(0)
 {
 	maxResPF = new CPathFinder();
 	medResPE = new CPathEstimator(maxResPF,  8, "pe",  mapInfo->map.name);
@@ -29,17 +42,27 @@ CPathManager::CPathManager(): nextPathId(0)
 	LOG("[CPathManager] pathing data checksum: %08x", GetPathCheckSum());
 
 	#ifdef SYNCDEBUG
-	// clients may have a non-writable cache directory (which causes
-	// the estimator path-file checksum to remain zero), so we can't
-	// update the sync-checker with this in normal builds
-	// NOTE: better to just checksum the in-memory data and broadcast
-	// that instead of relying on the zip-file CRC?
+	// the checksum covers the in-memory estimator data, but that is
+	// only known to be synced if every client ran the same pathing
+	// code, so only update the sync-checker with it in debug builds
 	{ SyncedUint tmp(GetPathCheckSum()); }
 	#endif
 }
 
 CPathManager::~CPathManager()
 {
+	for (std::map<FlowFieldKey, CPathFlowField*>::iterator it = flowFields.begin(); it != flowFields.end(); ++it) {
+		delete it->second;
+	}
+
+	LOG("[%s] %u paths shared %u flow-field calculations", __FUNCTION__, numFlowFieldPaths, numFlowFieldCalcs);
+
+	const boost::uint64_t searchTime = maxResPF->GetSearchTime();
+
+	LOG("[%s] %u max-res searches tested %.0f nodes in %.3fs (%.0f nodes/s)",
+		__FUNCTION__, maxResPF->GetNumSearches(), double(maxResPF->GetNumTestedNodes()),
+		searchTime * 1e-6, (searchTime > 0)? (maxResPF->GetNumTestedNodes() * 1e6 / searchTime): 0.0);
+
 	delete lowResPE;
 	delete medResPE;
 	delete maxResPF;
@@ -120,6 +143,12 @@ unsigned int CPathManager::RequestPath(
 		if (result != IPath::Ok) {
 			result = lowResPE->GetPath(*moveData, startPos, *pfDef, newPath->lowResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
 		}
+	} else if ((newPath->flowField = GetGroupFlowField(*moveData, startPos, goalPos, synced)) != NULL) {
+		// member of a large group, no search of its own
+		newPath->flowField->AddRef();
+		numFlowFieldPaths++;
+
+		result = FlowField2MedRes(*newPath, startPos, synced);
 	} else if (goalDist2D < ESTIMATE_DISTANCE) {
 		result = medResPE->GetPath(*moveData, startPos, *pfDef, newPath->medResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
 
@@ -219,6 +248,47 @@ void CPathManager::MedRes2MaxRes(MultiPath& multiPath, const float3& startPos, i
 	}
 }
 
+// reads the next blocks towards the goal from the shared flow field into the med-res path
+IPath::SearchResult CPathManager::FlowField2MedRes(MultiPath& multiPath, const float3& startPos, bool synced) const
+{
+	IPath::Path& medResPath = multiPath.medResPath;
+	CPathFlowField* flowField = multiPath.flowField;
+
+	const int startBlock = medResPE->GetBlockIndex(startPos);
+
+	if (flowField->GetCost(startBlock) >= PATHCOST_INFINITY) {
+		// pushed off the field, or the terrain changed: back to a search of its own
+		flowField->Release();
+		multiPath.flowField = NULL;
+
+		return medResPE->GetPath(*multiPath.moveData, startPos, *multiPath.peDef, medResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
+	}
+
+	// paths are stored goal-first, the block
+	// of startPos is consumed by MedRes2MaxRes
+	IPath::path_list_type waypoints;
+	int block = startBlock;
+
+	waypoints.push_back(medResPE->GetBlockPos(*multiPath.moveData, block));
+
+	for (int n = 0; n < FLOW_FIELD_LOOKAHEAD && block != flowField->GetGoalBlock(); n++) {
+		block = flowField->GetNextBlock(block);
+		waypoints.push_back(medResPE->GetBlockPos(*multiPath.moveData, block));
+	}
+
+	medResPath.path.assign(waypoints.rbegin(), waypoints.rend());
+	medResPath.pathGoal = medResPath.path.front();
+	medResPath.pathCost = flowField->GetCost(startBlock);
+
+	if (block == flowField->GetGoalBlock()) {
+		// the rest of the way is up to the path's own goal definition
+		flowField->Release();
+		multiPath.flowField = NULL;
+	}
+
+	return IPath::Ok;
+}
+
 // converts part of a low-res path into a med-res path
 void CPathManager::LowRes2MedRes(MultiPath& multiPath, const float3& startPos, int ownerId, bool synced) const
 {
@@ -299,6 +369,12 @@ float3 CPathManager::NextWaypoint(
 			callerPos = multiPath->maxResPath.path.back();
 	}
 
+	// paths sharing a flow field read their next blocks from it
+	// (if a path has to search on its own, the goal may turn out unreachable)
+	if (multiPath->flowField != NULL && multiPath->medResPath.path.size() <= 2) {
+		multiPath->searchResult = FlowField2MedRes(*multiPath, callerPos, synced);
+	}
+
 	// check if detailed path needs bettering
 	if (!multiPath->medResPath.path.empty() &&
 		(multiPath->medResPath.path.back().SqDistance2D(callerPos) < Square(MIN_DETAILED_DISTANCE * SQUARE_SIZE) ||
@@ -361,6 +437,10 @@ void CPathManager::DeletePath(unsigned int pathId) {
 
 	const MultiPath* multiPath = pi->second;
 
+	if (multiPath->flowField != NULL) {
+		multiPath->flowField->Release();
+	}
+
 	pathMap.erase(pathId);
 	delete multiPath;
 }
@@ -371,6 +451,15 @@ void CPathManager::DeletePath(unsigned int pathId) {
 void CPathManager::TerrainChange(unsigned int x1, unsigned int z1, unsigned int x2, unsigned int z2) {
 	medResPE->MapChanged(x1, z1, x2, z2);
 	lowResPE->MapChanged(x1, z1, x2, z2);
+
+	SetFlowFieldsObsolete();
+}
+
+// the flow fields are recalculated on the next update (they cover the whole map)
+void CPathManager::SetFlowFieldsObsolete() {
+	for (std::map<FlowFieldKey, CPathFlowField*>::iterator it = flowFields.begin(); it != flowFields.end(); ++it) {
+		it->second->SetObsolete(true);
+	}
 }
 
 
@@ -381,6 +470,84 @@ void CPathManager::Update()
 	maxResPF->UpdateHeatMap();
 	medResPE->Update();
 	lowResPE->Update();
+
+	UpdateFlowFields();
+}
+
+
+
+CPathFlowField* CPathManager::GetGroupFlowField(const MoveData& moveData, const float3& startPos, const float3& goalPos, bool synced)
+{
+	// unsynced requests must not change what later requests get
+	if (flowFieldMinGroupSize == 0 || !synced)
+		return NULL;
+
+	const FlowFieldKey key(moveData.pathType, medResPE->GetBlockIndex(goalPos));
+	GroupRequests& group = groupRequests[key];
+
+	if (group.numRequests == 0 || (gs->frameNum - group.firstFrame) > FLOW_FIELD_GROUP_FRAMES) {
+		group.firstFrame = gs->frameNum;
+		group.numRequests = 0;
+	}
+
+	group.numRequests++;
+
+	const std::map<FlowFieldKey, CPathFlowField*>::const_iterator it = flowFields.find(key);
+	CPathFlowField* flowField = (it != flowFields.end())? it->second: NULL;
+
+	if (flowField == NULL || flowField->IsObsolete()) {
+		if (group.numRequests < flowFieldMinGroupSize)
+			return NULL;
+
+		if (flowField == NULL) {
+			flowField = new CPathFlowField(key.first, key.second, medResPE->GetNumBlocksX(), medResPE->GetNumBlocksZ());
+			flowFields[key] = flowField;
+		}
+
+		medResPE->GetEdgeCosts(moveData, edgeCosts, true);
+		flowField->Calculate(edgeCosts);
+		numFlowFieldCalcs++;
+	}
+
+	// units that can not reach the goal get a search of their own
+	if (flowField->GetCost(medResPE->GetBlockIndex(startPos)) >= PATHCOST_INFINITY)
+		return NULL;
+
+	return flowField;
+}
+
+void CPathManager::UpdateFlowFields()
+{
+	std::map<FlowFieldKey, GroupRequests>::iterator git = groupRequests.begin();
+
+	while (git != groupRequests.end()) {
+		if ((gs->frameNum - git->second.firstFrame) > FLOW_FIELD_GROUP_FRAMES) {
+			groupRequests.erase(git++);
+		} else {
+			++git;
+		}
+	}
+
+	std::map<FlowFieldKey, CPathFlowField*>::iterator fit = flowFields.begin();
+
+	while (fit != flowFields.end()) {
+		CPathFlowField* flowField = fit->second;
+
+		if (flowField->GetRefCount() == 0 && groupRequests.find(fit->first) == groupRequests.end()) {
+			// no path uses it, and no more group members are expected
+			delete flowField;
+			flowFields.erase(fit++);
+			continue;
+		}
+
+		if (flowField->IsObsolete() && (gs->frameNum % FLOW_FIELD_UPDATE_RATE) == 0) {
+			medResPE->GetEdgeCosts(*moveinfo->moveData[flowField->GetPathType()], edgeCosts, true);
+			flowField->Calculate(edgeCosts);
+			numFlowFieldCalcs++;
+		}
+
+		++fit;
+	}
 }
 
 // used to deposit heat on the heat-map as a unit moves along its path
@@ -517,6 +684,11 @@ bool CPathManager::SetNodeExtraCost(unsigned int x, unsigned int z, float cost,
 	maxResBuf.SetNodeExtraCost(x, z, cost, synced);
 	medResBuf.SetNodeExtraCost(x, z, cost, synced);
 	lowResBuf.SetNodeExtraCost(x, z, cost, synced);
+
+	// flow fields are only made of synced costs
+	if (synced)
+		SetFlowFieldsObsolete();
+
 	return true;
 }
 
@@ -532,6 +704,10 @@ bool CPathManager::SetNodeExtraCosts(const float* costs, unsigned int sizex, uns
 	maxResBuf.SetNodeExtraCosts(costs, sizex, sizez, synced);
 	medResBuf.SetNodeExtraCosts(costs, sizex, sizez, synced);
 	lowResBuf.SetNodeExtraCosts(costs, sizex, sizez, synced);
+
+	if (synced)
+		SetFlowFieldsObsolete();
+
 	return true;
 }
 
@@ -4,6 +4,7 @@
 #define PATHMANAGER_H
 
 #include <map>
+#include <vector>
 #include <boost/cstdint.hpp> /* Replace with <stdint.h> if appropriate */
 
 #include "Sim/Path/IPathManager.h"
@@ -14,6 +15,7 @@ class CSolidObject;
 class CPathFinder;
 class CPathEstimator;
 class CPathFinderDef;
+class CPathFlowField;
 struct MoveData;
 class CMoveMath;
 
@@ -101,6 +103,7 @@ private:
 			, moveData(moveData)
 			, finalGoal(ZeroVector)
 			, caller(NULL)
+			, flowField(NULL)
 		{}
 
 		~MultiPath() { delete peDef; }
@@ -119,11 +122,30 @@ private:
 		// Additional information.
 		float3 finalGoal;
 		CSolidObject* caller;
+
+		/// shared field the med-res waypoints are read from, NULL once at its goal block
+		CPathFlowField* flowField;
+	};
+
+	/// (pathType, goal block of the med-res estimator)
+	typedef std::pair<unsigned int, int> FlowFieldKey;
+
+	struct GroupRequests {
+		GroupRequests(): firstFrame(0), numRequests(0) {}
+
+		int firstFrame;
+		unsigned int numRequests;
 	};
 
 	unsigned int Store(MultiPath* path);
 	void LowRes2MedRes(MultiPath& path, const float3& startPos, int ownerId, bool synced) const;
 	void MedRes2MaxRes(MultiPath& path, const float3& startPos, int ownerId, bool synced) const;
+	IPath::SearchResult FlowField2MedRes(MultiPath& path, const float3& startPos, bool synced) const;
+
+	/// counts the request, @return the field to share if it belongs to a large enough group
+	CPathFlowField* GetGroupFlowField(const MoveData& moveData, const float3& startPos, const float3& goalPos, bool synced);
+	void UpdateFlowFields();
+	void SetFlowFieldsObsolete();
 
 	CPathFinder* maxResPF;
 	CPathEstimator* medResPE;
@@ -131,6 +153,15 @@ private:
 
 	std::map<unsigned int, MultiPath*> pathMap;
 	unsigned int nextPathId;
+
+	std::map<FlowFieldKey, CPathFlowField*> flowFields;
+	std::map<FlowFieldKey, GroupRequests> groupRequests;
+	std::vector<float> edgeCosts;
+
+	/// the mod rule movement.pathFlowFieldMinGroupSize, 0 disables flow fields
+	unsigned int flowFieldMinGroupSize;
+	unsigned int numFlowFieldPaths;
+	unsigned int numFlowFieldCalcs;
 };
 
 #endif
@@ -17,6 +17,7 @@
 #include "Rendering/GL/myGL.h"
 #include "Rendering/Textures/ColorMap.h"
 #include "Rendering/Textures/TextureAtlas.h"
+#include "Sim/Projectiles/ParticlePool.h"
 #include "Sim/Projectiles/ProjectileHandler.h"
 #include "Sim/Projectiles/Unsynced/BubbleProjectile.h"
 #include "Sim/Projectiles/Unsynced/DirtProjectile.h"
@@ -704,6 +705,7 @@ unsigned int CCustomExplosionGenerator::Load(CExplosionGeneratorHandler* h, cons
 			const string className = spawnTable.GetString("class", spawnName);
 
 			psi.projectileClass = h->projectileClasses.GetClass(className);
+			psi.particlePool = CParticlePools::GetInstance().GetPool(psi.projectileClass);
 			psi.flags = GetFlagsFromTable(spawnTable);
 			psi.count = spawnTable.GetInt("count", 1);
 
@@ -864,7 +866,16 @@ bool CCustomExplosionGenerator::Explosion(
 		}
 
 		for (int c = 0; c < psi.count; c++) {
-			CExpGenSpawnable* projectile = (CExpGenSpawnable*) (psi.projectileClass)->CreateInstance();
+			CExpGenSpawnable* projectile = NULL;
+
+			if (psi.particlePool != NULL) {
+				// as creg::Class::CreateInstance, but in the memory of the pool
+				void* mem = psi.particlePool->Alloc();
+				(psi.projectileClass)->binder->constructor(mem);
+				projectile = (CExpGenSpawnable*) mem;
+			} else {
+				projectile = (CExpGenSpawnable*) (psi.projectileClass)->CreateInstance();
+			}
 
 			ExecuteExplosionCode(&psi.code[0], damage, (char*) projectile, c, dir);
 			projectile->Init(pos, owner);
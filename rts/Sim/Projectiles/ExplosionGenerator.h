@@ -15,6 +15,7 @@ class LuaTable;
 class float3;
 class CUnit;
 class IExplosionGenerator;
+class IParticlePool;
 
 
 class CExpGenSpawnable: public CWorldObject
@@ -105,17 +106,21 @@ protected:
 	struct ProjectileSpawnInfo {
 		ProjectileSpawnInfo()
 			: projectileClass(NULL)
+			, particlePool(NULL)
 			, count(0)
 			, flags(0)
 		{}
 		ProjectileSpawnInfo(const ProjectileSpawnInfo& psi)
 			: projectileClass(psi.projectileClass)
+			, particlePool(psi.particlePool)
 			, code(psi.code)
 			, count(psi.count)
 			, flags(psi.flags)
 		{}
 
 		creg::Class* projectileClass;
+		/// where instances of projectileClass are allocated, NULL for the heap
+		IParticlePool* particlePool;
 
 		/// parsed explosion script code
 		std::vector<char> code;
@@ -0,0 +1,51 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "ParticlePool.h"
+
+
+CParticlePools& CParticlePools::GetInstance()
+{
+	// the pools are static members of the particle types and
+	// register themselves during static initialization
+	static CParticlePools instance;
+	return instance;
+}
+
+
+IParticlePool* CParticlePools::GetPool(const creg::Class* cls) const
+{
+	for (size_t i = 0; i < pools.size(); ++i) {
+		if (pools[i]->GetClass() == cls)
+			return pools[i];
+	}
+
+	return NULL;
+}
+
+IParticlePool* CParticlePools::FindPool(const void* p) const
+{
+	for (size_t i = 0; i < pools.size(); ++i) {
+		if (pools[i]->Owns(p))
+			return pools[i];
+	}
+
+	return NULL;
+}
+
+size_t CParticlePools::GetNumParticles() const
+{
+	size_t numParticles = 0;
+
+	for (size_t i = 0; i < pools.size(); ++i) {
+		numParticles += pools[i]->GetNumParticles();
+	}
+
+	return numParticles;
+}
+
+void CParticlePools::GetParticles(std::vector<CProjectile*>* particles) const
+{
+	for (size_t i = 0; i < pools.size(); ++i) {
+		pools[i]->GetParticles(particles);
+	}
+}
@@ -0,0 +1,330 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef PARTICLE_POOL_H
+#define PARTICLE_POOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <typeinfo>
+#include <vector>
+
+#include "lib/gml/gmlcnf.h"
+
+// the render thread deletes projectiles too, and mmgr wants to see all allocations
+#if !defined(USE_MMGR) && !(defined(USE_GML) && GML_ENABLE_SIM)
+	#define PARTICLE_POOLS_ENABLED 1
+#else
+	#define PARTICLE_POOLS_ENABLED 0
+#endif
+
+class CProjectile;
+namespace creg {
+	class Class;
+}
+
+/**
+ * Storage of the simple unsynced particle types (smoke, dirt, heat clouds,
+ * ...), one pool per type.
+ *
+ * The particles of a type are allocated in contiguous chunks instead of one
+ * by one on the heap, and CProjectileHandler updates them per type in tight
+ * loops over these chunks (without virtual dispatch, chunks in parallel)
+ * instead of keeping them in unsyncedProjectiles.
+ * They get no projectile id (as with UNSYNCED_PROJ_NOEVENT). Savegames store
+ * them with the unsyncedProjectiles; loaded ones are allocated by creg and
+ * live on in that container like the unpooled types.
+ *
+ * A type opts in with PARTICLE_POOL_ALLOCATOR in its declaration and
+ * PARTICLE_POOL in its source file; its Update() has to be thread-safe
+ * (see CProjectile::IsUpdateThreadSafe).
+ */
+class IParticlePool
+{
+public:
+	virtual ~IParticlePool() {}
+
+	/// @return memory for one particle of the pooled type
+	virtual void* Alloc() = 0;
+	/// @return true if the particle was allocated by this pool
+	virtual bool Owns(const void* p) const = 0;
+
+	/// called when the particle is constructed, from now on it gets updated
+	virtual void Insert(CProjectile* p) = 0;
+	/**
+	 * First step of the update: hands the particles flagged with deleteMe
+	 * over to the caller and updates those of derived types.
+	 */
+	virtual void BeginUpdate(std::vector<CProjectile*>* deleted) = 0;
+	/// updates the particles in one chunk; different chunks may be updated in parallel
+	virtual void UpdateChunk(int chunk) = 0;
+	virtual int GetNumChunks() const = 0;
+
+	/// deletes all particles
+	virtual void Clear() = 0;
+
+	/// appends the particles that are updated by the pool
+	virtual void GetParticles(std::vector<CProjectile*>* particles) const = 0;
+
+	virtual size_t GetNumParticles() const = 0;
+	virtual creg::Class* GetClass() const = 0;
+};
+
+
+/// all particle pools
+class CParticlePools
+{
+public:
+	static CParticlePools& GetInstance();
+
+	void AddPool(IParticlePool* pool) { pools.push_back(pool); }
+	const std::vector<IParticlePool*>& GetPools() const { return pools; }
+
+	/// @return the pool of the given (exact) class, NULL if it has none
+	IParticlePool* GetPool(const creg::Class* cls) const;
+	/// @return the pool the particle was allocated from, NULL if allocated on the heap
+	IParticlePool* FindPool(const void* p) const;
+
+	size_t GetNumParticles() const;
+	void GetParticles(std::vector<CProjectile*>* particles) const;
+
+private:
+	std::vector<IParticlePool*> pools;
+};
+
+
+template<typename T>
+class CParticlePool: public IParticlePool
+{
+public:
+	/// particles per chunk
+	static const int CHUNK_SIZE = 256;
+
+	CParticlePool(): numParticles(0) {
+#if PARTICLE_POOLS_ENABLED
+		CParticlePools::GetInstance().AddPool(this);
+#endif
+	}
+	~CParticlePool() {
+		// the particles are gone by now (see CProjectileHandler), only free the memory
+		for (size_t c = 0; c < chunks.size(); ++c) {
+			::operator delete(chunks[c]->mem);
+			delete chunks[c];
+		}
+	}
+
+	/// for T::operator new; derived types of a different size are not pooled
+	void* Alloc(size_t size) {
+		if (size != sizeof(T))
+			return ::operator new(size);
+
+		return Alloc();
+	}
+	/// for T::operator delete
+	void Free(void* p, size_t size) {
+		if (size != sizeof(T) || !Owns(p)) {
+			::operator delete(p);
+			return;
+		}
+
+		Chunk* chunk = FindChunk(p);
+		unsigned char& state = chunk->state[(static_cast<char*>(p) - chunk->mem) / sizeof(T)];
+
+		if (state >= SLOT_LIVE_NEW)
+			--numParticles;
+
+		state = SLOT_FREE;
+		freeSlots.push_back(p);
+	}
+
+	void* Alloc() {
+		if (freeSlots.empty())
+			AddChunk();
+
+		void* p = freeSlots.back();
+		Chunk* chunk = FindChunk(p);
+
+		freeSlots.pop_back();
+		chunk->state[(static_cast<char*>(p) - chunk->mem) / sizeof(T)] = SLOT_ALLOCATED;
+		return p;
+	}
+
+	bool Owns(const void* p) const {
+		return (FindChunk(p) != NULL);
+	}
+
+	void Insert(CProjectile* p) {
+		char* cp = reinterpret_cast<char*>(static_cast<T*>(p));
+		Chunk* chunk = FindChunk(cp);
+
+		chunk->state[(cp - chunk->mem) / sizeof(T)] = SLOT_LIVE_NEW;
+		++numParticles;
+	}
+
+	void BeginUpdate(std::vector<CProjectile*>* deleted) {
+		derived.clear();
+
+		for (size_t c = 0; c < chunks.size(); ++c) {
+			Chunk* chunk = chunks[c];
+
+			for (int i = 0; i < CHUNK_SIZE; ++i) {
+				unsigned char& state = chunk->state[i];
+
+				if (state < SLOT_LIVE_NEW)
+					continue;
+
+				T* p = reinterpret_cast<T*>(chunk->mem + i * sizeof(T));
+
+				if (p->deleteMe) {
+					state = SLOT_ALLOCATED;
+					--numParticles;
+					deleted->push_back(p);
+					continue;
+				}
+
+				if (state == SLOT_LIVE_NEW) {
+					// the type is only known once the particle is fully
+					// constructed; a derived type of the same size would
+					// also end up here, give it its own Update()
+					state = (typeid(*p) == typeid(T))? SLOT_LIVE: SLOT_LIVE_DERIVED;
+				}
+				if (state == SLOT_LIVE_DERIVED) {
+					derived.push_back(p);
+				}
+			}
+		}
+
+		// these may spawn particles into this pool, so not while walking the chunks
+		for (size_t n = 0; n < derived.size(); ++n) {
+			derived[n]->Update();
+		}
+	}
+
+	void UpdateChunk(int c) {
+		Chunk* chunk = chunks[c];
+
+		for (int i = 0; i < CHUNK_SIZE; ++i) {
+			if (chunk->state[i] != SLOT_LIVE)
+				continue;
+
+			T* p = reinterpret_cast<T*>(chunk->mem + i * sizeof(T));
+			p->T::Update();
+		}
+	}
+
+	int GetNumChunks() const { return chunks.size(); }
+
+	void Clear() {
+		for (size_t c = 0; c < chunks.size(); ++c) {
+			Chunk* chunk = chunks[c];
+
+			for (int i = 0; i < CHUNK_SIZE; ++i) {
+				if (chunk->state[i] < SLOT_LIVE_NEW)
+					continue;
+
+				delete reinterpret_cast<T*>(chunk->mem + i * sizeof(T));
+			}
+		}
+	}
+
+	void GetParticles(std::vector<CProjectile*>* particles) const {
+		for (size_t c = 0; c < chunks.size(); ++c) {
+			const Chunk* chunk = chunks[c];
+
+			for (int i = 0; i < CHUNK_SIZE; ++i) {
+				if (chunk->state[i] < SLOT_LIVE_NEW)
+					continue;
+
+				particles->push_back(reinterpret_cast<T*>(chunk->mem + i * sizeof(T)));
+			}
+		}
+	}
+
+	size_t GetNumParticles() const { return numParticles; }
+	creg::Class* GetClass() const { return T::StaticClass(); }
+
+private:
+	enum SlotState {
+		SLOT_FREE         = 0,
+		SLOT_ALLOCATED    = 1, ///< not constructed yet, or already removed
+		SLOT_LIVE_NEW     = 2, ///< inserted, not updated yet
+		SLOT_LIVE         = 3,
+		SLOT_LIVE_DERIVED = 4,
+	};
+
+	struct Chunk {
+		char* mem;
+		unsigned char state[CHUNK_SIZE];
+	};
+
+	static bool ChunkLess(const Chunk* a, const Chunk* b) { return (a->mem < b->mem); }
+
+	void AddChunk() {
+		Chunk* chunk = new Chunk();
+		chunk->mem = static_cast<char*>(::operator new(CHUNK_SIZE * sizeof(T)));
+		std::fill(chunk->state, chunk->state + CHUNK_SIZE, (unsigned char) SLOT_FREE);
+
+		// sorted by address for FindChunk, and so updates walk memory in order
+		chunks.insert(std::upper_bound(chunks.begin(), chunks.end(), chunk, ChunkLess), chunk);
+
+		// hand out the lowest addresses first
+		for (int i = CHUNK_SIZE - 1; i >= 0; --i) {
+			freeSlots.push_back(chunk->mem + i * sizeof(T));
+		}
+	}
+
+	Chunk* FindChunk(const void* p) const {
+		const char* cp = static_cast<const char*>(p);
+
+		// last chunk starting at or before p
+		size_t lo = 0;
+		size_t hi = chunks.size();
+
+		while (lo < hi) {
+			const size_t mid = (lo + hi) / 2;
+
+			if (chunks[mid]->mem <= cp) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+
+		if (lo == 0)
+			return NULL;
+
+		Chunk* chunk = chunks[lo - 1];
+
+		if (cp >= chunk->mem + CHUNK_SIZE * sizeof(T))
+			return NULL;
+
+		return chunk;
+	}
+
+private:
+	std::vector<Chunk*> chunks;
+	std::vector<void*> freeSlots;
+	std::vector<T*> derived;
+	size_t numParticles;
+};
+
+
+#if PARTICLE_POOLS_ENABLED
+	/// put into the declaration of a pooled particle type
+	/// (placement new is used by creg, and would be hidden otherwise)
+	#define PARTICLE_POOL_ALLOCATOR(TCls) \
+		static CParticlePool<TCls> particlePool; \
+		inline void* operator new(size_t size) { return particlePool.Alloc(size); } \
+		inline void operator delete(void* p, size_t size) { particlePool.Free(p, size); } \
+		inline void* operator new(size_t, void* p) { return p; } \
+		inline void operator delete(void*, void*) {}
+#else
+	#define PARTICLE_POOL_ALLOCATOR(TCls) \
+		static CParticlePool<TCls> particlePool;
+#endif
+
+/// put into the source file of a pooled particle type
+#define PARTICLE_POOL(TCls) \
+	CParticlePool<TCls> TCls::particlePool
+
+#endif // PARTICLE_POOL_H
@@ -35,6 +35,11 @@ public:
 	virtual void Collision(CUnit* unit);
 	virtual void Collision(CFeature* feature);
 	virtual void Update();
+	/**
+	 * true if Update() changes nothing but this projectile, so
+	 * unsynced ones can be updated in parallel (see ProjectileHandler)
+	 */
+	virtual bool IsUpdateThreadSafe() const { return false; }
 	virtual void Init(const float3& pos, CUnit* owner);
 
 	virtual void Draw() {}
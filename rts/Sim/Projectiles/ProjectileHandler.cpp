@@ -1,8 +1,10 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
 #include <algorithm>
+#include <boost/bind.hpp>
 #include "System/mmgr.h"
 
+#include "ParticlePool.h"
 #include "Projectile.h"
 #include "ProjectileHandler.h"
 #include "Game/TraceRay.h"
@@ -20,6 +22,7 @@
 #include "System/Config/ConfigHandler.h"
 #include "System/EventHandler.h"
 #include "System/Log/ILog.h"
+#include "System/ThreadPool.h"
 #include "System/TimeProfiler.h"
 #include "System/creg/STL_Map.h"
 #include "System/creg/STL_List.h"
@@ -43,13 +46,21 @@ CR_REG_METADATA(GroundFlashContainer, (
 	CR_POSTLOAD(PostLoad)
 ));
 
+CR_BIND_TEMPLATE(ProjectileMap, )
+CR_REG_METADATA(ProjectileMap, (
+	CR_MEMBER(values),
+	CR_MEMBER(generations),
+	CR_MEMBER(nextFree),
+	CR_MEMBER(numUsed),
+	CR_MEMBER(freeHead),
+	CR_MEMBER(freeTail)
+));
+
 CR_BIND(CProjectileHandler, );
 CR_REG_METADATA(CProjectileHandler, (
 	CR_MEMBER(syncedProjectiles),
 	CR_MEMBER(unsyncedProjectiles),
 	CR_MEMBER(syncedProjectileIDs),
-	CR_MEMBER(freeSyncedIDs),
-	CR_MEMBER(maxUsedSyncedID),
 	CR_MEMBER(groundFlashes),
 	CR_RESERVED(32),
 	CR_SERIALIZER(Serialize),
@@ -86,13 +97,8 @@ CProjectileHandler::CProjectileHandler()
 	numPerlinProjectiles   = 0;
 
 	// preload some IDs
-	for (int i = 0; i < 16384; i++) {
-		freeSyncedIDs.push_back(i);
-		freeUnsyncedIDs.push_back(i);
-	}
-
-	maxUsedSyncedID = freeSyncedIDs.size();
-	maxUsedUnsyncedID = freeUnsyncedIDs.size();
+	syncedProjectileIDs.AddSlots(16384);
+	unsyncedProjectileIDs.AddSlots(16384);
 }
 
 CProjectileHandler::~CProjectileHandler()
@@ -101,11 +107,13 @@ CProjectileHandler::~CProjectileHandler()
 	syncedProjectiles.clear(); // synced first, to avoid callback crashes
 	unsyncedProjectiles.clear();
 
-	freeSyncedIDs.clear();
-	freeUnsyncedIDs.clear();
+	const std::vector<IParticlePool*>& pools = CParticlePools::GetInstance().GetPools();
+	for (size_t n = 0; n < pools.size(); ++n) {
+		pools[n]->Clear();
+	}
 
-	syncedProjectileIDs.clear();
-	unsyncedProjectileIDs.clear();
+	syncedProjectileIDs.Clear();
+	unsyncedProjectileIDs.Clear();
 
 	ph = NULL;
 }
@@ -113,8 +121,13 @@ CProjectileHandler::~CProjectileHandler()
 void CProjectileHandler::Serialize(creg::ISerializer* s)
 {
 	if (s->IsWriting()) {
+		// pooled particles are saved as unsynced projectiles, and
+		// loaded into unsyncedProjectiles (outside of their pools)
+		std::vector<CProjectile*> particles;
+		CParticlePools::GetInstance().GetParticles(&particles);
+
 		int ssize = int(syncedProjectiles.size());
-		int usize = int(unsyncedProjectiles.size());
+		int usize = int(unsyncedProjectiles.size() + particles.size());
 
 		s->Serialize(&ssize, sizeof(int));
 		for (ProjectileContainer::iterator it = syncedProjectiles.begin(); it != syncedProjectiles.end(); ++it) {
@@ -127,6 +140,10 @@ void CProjectileHandler::Serialize(creg::ISerializer* s)
 			void** ptr = (void**) &*it;
 			s->SerializeObjectPtr(ptr, (*it)->GetClass());
 		}
+		for (std::vector<CProjectile*>::iterator it = particles.begin(); it != particles.end(); ++it) {
+			void** ptr = (void**) &*it;
+			s->SerializeObjectPtr(ptr, (*it)->GetClass());
+		}
 	} else {
 		int ssize, usize;
 
@@ -157,38 +174,70 @@ void CProjectileHandler::PostLoad()
 
 
 
+#define VECTOR_SANITY_CHECK(v)                              \
+	assert(!math::isnan(v.x) && !math::isinf(v.x)); \
+	assert(!math::isnan(v.y) && !math::isinf(v.y)); \
+	assert(!math::isnan(v.z) && !math::isinf(v.z));
+#define MAPPOS_SANITY_CHECK(v)                 \
+	assert(v.x >= -(float3::maxxpos * 16.0f)); \
+	assert(v.x <=  (float3::maxxpos * 16.0f)); \
+	assert(v.z >= -(float3::maxzpos * 16.0f)); \
+	assert(v.z <=  (float3::maxzpos * 16.0f)); \
+	assert(v.y >= -MAX_PROJECTILE_HEIGHT);     \
+	assert(v.y <=  MAX_PROJECTILE_HEIGHT);
+#define PROJECTILE_SANITY_CHECK(p) \
+	VECTOR_SANITY_CHECK(p->pos);   \
+	MAPPOS_SANITY_CHECK(p->pos);
+
+
+// fewer projectiles than this are not worth starting threads for
+static const size_t MIN_PARALLEL_PROJECTILES = 512;
+// projectiles per work item of the parallel phases
+static const size_t PROJECTILE_BLOCK_SIZE = 128;
+
+static int GetNumProjectileBlocks(size_t numProjectiles)
+{
+	return ((numProjectiles + PROJECTILE_BLOCK_SIZE - 1) / PROJECTILE_BLOCK_SIZE);
+}
+
+static void UpdateProjectileBlock(const std::vector<CProjectile*>* projectiles, int block)
+{
+	const size_t begin = block * PROJECTILE_BLOCK_SIZE;
+	const size_t end = std::min(begin + PROJECTILE_BLOCK_SIZE, projectiles->size());
+
+	for (size_t i = begin; i < end; ++i) {
+		CProjectile* p = (*projectiles)[i];
+
+		PROJECTILE_SANITY_CHECK(p);
+
+		p->Update();
+
+		PROJECTILE_SANITY_CHECK(p);
+		GML_GET_TICKS(p->lastProjUpdate);
+	}
+}
+
+
 void CProjectileHandler::UpdateProjectileContainer(ProjectileContainer& pc, bool synced) {
 	ProjectileContainer::iterator pci = pc.begin();
 
-	#define VECTOR_SANITY_CHECK(v)                              \
-		assert(!math::isnan(v.x) && !math::isinf(v.x)); \
-		assert(!math::isnan(v.y) && !math::isinf(v.y)); \
-		assert(!math::isnan(v.z) && !math::isinf(v.z));
-	#define MAPPOS_SANITY_CHECK(v)                 \
-		assert(v.x >= -(float3::maxxpos * 16.0f)); \
-		assert(v.x <=  (float3::maxxpos * 16.0f)); \
-		assert(v.z >= -(float3::maxzpos * 16.0f)); \
-		assert(v.z <=  (float3::maxzpos * 16.0f)); \
-		assert(v.y >= -MAX_PROJECTILE_HEIGHT);     \
-		assert(v.y <=  MAX_PROJECTILE_HEIGHT);
-	#define PROJECTILE_SANITY_CHECK(p) \
-		VECTOR_SANITY_CHECK(p->pos);   \
-		MAPPOS_SANITY_CHECK(p->pos);
+	// unsynced projectiles with a thread-safe Update() are only collected in
+	// the loop and updated in parallel after it, everything else is serial
+	static std::vector<CProjectile*> parallelProjectiles;
+	const bool parallel = (!synced && pc.size() >= MIN_PARALLEL_PROJECTILES);
+
+	parallelProjectiles.clear();
 
 	while (pci != pc.end()) {
 		CProjectile* p = *pci;
 
 		if (p->deleteMe) {
-			ProjectileMap::iterator pIt;
-
 			if (p->synced) {
-				//! iterator is always valid
-				pIt = syncedProjectileIDs.find(p->id);
-
-				eventHandler.ProjectileDestroyed((pIt->second).first, (pIt->second).second);
-				syncedProjectileIDs.erase(pIt);
+				//! id is always valid
+				const ProjectileMapPair& pp = syncedProjectileIDs[p->id];
 
-				freeSyncedIDs.push_back(p->id);
+				eventHandler.ProjectileDestroyed(pp.first, pp.second);
+				syncedProjectileIDs.Erase(p->id);
 
 				//! push_back this projectile for deletion
 				pci = pc.erase_delete_synced(pci);
@@ -196,12 +245,10 @@ void CProjectileHandler::UpdateProjectileContainer(ProjectileContainer& pc, bool
 #if UNSYNCED_PROJ_NOEVENT
 				eventHandler.UnsyncedProjectileDestroyed(p);
 #else
-				pIt = unsyncedProjectileIDs.find(p->id);
+				const ProjectileMapPair& pp = unsyncedProjectileIDs[p->id];
 
-				eventHandler.ProjectileDestroyed((pIt->second).first, (pIt->second).second);
-				unsyncedProjectileIDs.erase(pIt);
-
-				freeUnsyncedIDs.push_back(p->id);
+				eventHandler.ProjectileDestroyed(pp.first, pp.second);
+				unsyncedProjectileIDs.Erase(p->id);
 #endif
 #if DETACH_SYNCED
 				pci = pc.erase_detach(pci);
@@ -209,6 +256,10 @@ void CProjectileHandler::UpdateProjectileContainer(ProjectileContainer& pc, bool
 				pci = pc.erase_delete(pci);
 #endif
 			}
+		} else if (parallel && p->IsUpdateThreadSafe()) {
+			// unsynced, so no need for qf->MovedProjectile
+			parallelProjectiles.push_back(p);
+			++pci;
 		} else {
 			PROJECTILE_SANITY_CHECK(p);
 
@@ -221,6 +272,49 @@ void CProjectileHandler::UpdateProjectileContainer(ProjectileContainer& pc, bool
 			++pci;
 		}
 	}
+
+	if (!parallelProjectiles.empty()) {
+		ThreadPool::for_mt(0, GetNumProjectileBlocks(parallelProjectiles.size()), boost::bind(&UpdateProjectileBlock, &parallelProjectiles, _1));
+	}
+}
+
+typedef std::pair<IParticlePool*, int> ParticleChunk;
+
+static void UpdateParticleChunk(const std::vector<ParticleChunk>* chunks, int n)
+{
+	(*chunks)[n].first->UpdateChunk((*chunks)[n].second);
+}
+
+void CProjectileHandler::UpdateParticlePools() {
+	const std::vector<IParticlePool*>& pools = CParticlePools::GetInstance().GetPools();
+
+	static std::vector<CProjectile*> deleted;
+	static std::vector<ParticleChunk> chunks;
+
+	deleted.clear();
+	chunks.clear();
+
+	for (size_t n = 0; n < pools.size(); ++n) {
+		pools[n]->BeginUpdate(&deleted);
+
+		for (int c = 0; c < pools[n]->GetNumChunks(); ++c) {
+			chunks.push_back(ParticleChunk(pools[n], c));
+		}
+	}
+
+	for (size_t n = 0; n < deleted.size(); ++n) {
+		// pools are disabled with GML_ENABLE_SIM, so no need to Detach
+		eventHandler.UnsyncedProjectileDestroyed(deleted[n]);
+		delete deleted[n];
+	}
+
+	if (CParticlePools::GetInstance().GetNumParticles() >= MIN_PARALLEL_PROJECTILES) {
+		ThreadPool::for_mt(0, chunks.size(), boost::bind(&UpdateParticleChunk, &chunks, _1));
+	} else {
+		for (size_t n = 0; n < chunks.size(); ++n) {
+			UpdateParticleChunk(&chunks, n);
+		}
+	}
 }
 
 
@@ -235,6 +329,7 @@ void CProjectileHandler::Update()
 
 		UpdateProjectileContainer(syncedProjectiles, true);
 		UpdateProjectileContainer(unsyncedProjectiles, false);
+		UpdateParticlePools();
 
 
 		{
@@ -313,43 +408,42 @@ void CProjectileHandler::Update()
 
 void CProjectileHandler::AddProjectile(CProjectile* p)
 {
-	std::list<int>* freeIDs = NULL;
-	std::map<int, ProjectileMapPair>* proIDs = NULL;
-	int* maxUsedID = NULL;
-	int newID = 0;
+	ProjectileMap* proIDs = NULL;
 
 	if (p->synced) {
 		syncedProjectiles.push(p);
-		freeIDs = &freeSyncedIDs;
 		proIDs = &syncedProjectileIDs;
-		maxUsedID = &maxUsedSyncedID;
 	} else {
-		unsyncedProjectiles.push(p);
 #if UNSYNCED_PROJ_NOEVENT
+		IParticlePool* pool = CParticlePools::GetInstance().FindPool(p);
+
+		// pooled particles are updated by their pool
+		if (pool != NULL) {
+			pool->Insert(p);
+		} else {
+			unsyncedProjectiles.push(p);
+		}
+
 		eventHandler.UnsyncedProjectileCreated(p);
 		return;
 #endif
-		freeIDs = &freeUnsyncedIDs;
+		unsyncedProjectiles.push(p);
 		proIDs = &unsyncedProjectileIDs;
-		maxUsedID = &maxUsedUnsyncedID;
 	}
 
-	if (!freeIDs->empty()) {
-		newID = freeIDs->front();
-		freeIDs->pop_front();
-	} else {
-		(*maxUsedID)++;
-		newID = *maxUsedID;
-	}
+	const ProjectileMapPair pp(p, p->owner() ? p->owner()->allyteam : -1);
 
-	if ((*maxUsedID) > (1 << 24)) {
-		LOG_L(L_WARNING, "Lua %s projectile IDs are now out of range", (p->synced? "synced": "unsynced"));
-	}
+	if (proIDs->GetNumFree() == 0) {
+		// all ids are alive, the new one is GetSize() (16384 is
+		// the first, the old free-id list skipped it for 16385)
+		proIDs->AddSlots(1);
 
-	ProjectileMapPair pp(p, p->owner() ? p->owner()->allyteam : -1);
+		if (proIDs->GetSize() > (1 << 24)) {
+			LOG_L(L_WARNING, "Lua %s projectile IDs are now out of range", (p->synced? "synced": "unsynced"));
+		}
+	}
 
-	p->id = newID;
-	(*proIDs)[p->id] = pp;
+	p->id = proIDs->Insert(pp);
 
 	eventHandler.ProjectileCreated(pp.first, pp.second);
 }
@@ -357,21 +451,21 @@ void CProjectileHandler::AddProjectile(CProjectile* p)
 
 
 
-void CProjectileHandler::CheckUnitCollisions(
-	CProjectile* p,
-	std::vector<CUnit*>& tempUnits,
-	CUnit** endUnit,
+/// @return the first unit in [begin, end) the projectile hits moving from ppos0 to ppos1
+static CUnit* DetectUnitCollision(
+	const CProjectile* p,
+	CUnit* const* begin,
+	CUnit* const* end,
 	const float3& ppos0,
-	const float3& ppos1)
+	const float3& ppos1,
+	CollisionQuery* q,
+	CCollisionHandler::HitTestCounts* counts)
 {
-	CollisionQuery q;
+	const CUnit* attacker = p->owner();
 
-	for (CUnit** ui = &tempUnits[0]; ui != endUnit; ++ui) {
+	for (CUnit* const* ui = begin; ui != end; ++ui) {
 		CUnit* unit = *ui;
 
-		const CUnit* attacker = p->owner();
-		const bool raytraced = (unit->collisionVolume->GetTestType() == CollisionVolume::COLVOL_HITTEST_CONT);
-
 		// if this unit fired this projectile, always ignore
 		if (attacker == unit) {
 			continue;
@@ -387,30 +481,113 @@ void CProjectileHandler::CheckUnitCollisions(
 			if (unit->IsNeutral()) { continue; }
 		}
 
-		if (CCollisionHandler::DetectHit(unit, ppos0, ppos1, &q)) {
-			if (q.lmp != NULL) {
-				unit->SetLastAttackedPiece(q.lmp, gs->frameNum);
-			}
+		if (CCollisionHandler::DetectHit(unit, ppos0, ppos1, q, counts)) {
+			return unit;
+		}
+	}
 
-			// The current projectile <p> won't reach the raytraced surface impact
-			// position until ::Update() is called (same frame). This is a problem
-			// when dealing with fast low-AOE projectiles since they would do almost
-			// no damage if detonated outside the collision volume. Therefore, smuggle
-			// a bit with its position now (rather than rolling it back in ::Update()
-			// and waiting for the next-frame CheckUnitCol(), which is problematic
-			// for noExplode projectiles).
-
-			// const float3& pimpp = (q.b0)? q.p0: q.p1;
-			const float3 pimpp =
-				(q.b0 && q.b1)? ( q.p0 +  q.p1) * 0.5f:
-				(q.b0        )? ( q.p0 + ppos1) * 0.5f:
-								(ppos0 +  q.p1) * 0.5f;
-
-			p->pos = (raytraced)? pimpp: ppos0;
-			p->Collision(unit);
-			p->pos = (raytraced)? ppos0: p->pos;
-			break;
+	return NULL;
+}
+
+/// @return the first feature in [begin, end) the projectile hits moving from ppos0 to ppos1
+static CFeature* DetectFeatureCollision(
+	const CProjectile* p,
+	CFeature* const* begin,
+	CFeature* const* end,
+	const float3& ppos0,
+	const float3& ppos1,
+	CollisionQuery* q,
+	CCollisionHandler::HitTestCounts* counts)
+{
+	if (p->GetCollisionFlags() & Collision::NOFEATURES) {
+		return NULL;
+	}
+
+	for (CFeature* const* fi = begin; fi != end; ++fi) {
+		CFeature* feature = *fi;
+
+		// geothermals do not have a collision volume, skip them
+		if (!feature->blocking || feature->def->geoThermal) {
+			continue;
 		}
+
+		if (CCollisionHandler::DetectHit(feature, ppos0, ppos1, q, counts)) {
+			return feature;
+		}
+	}
+
+	return NULL;
+}
+
+static void ApplyUnitCollision(
+	CProjectile* p,
+	CUnit* unit,
+	const CollisionQuery& q,
+	const float3& ppos0,
+	const float3& ppos1)
+{
+	const bool raytraced = (unit->collisionVolume->GetTestType() == CollisionVolume::COLVOL_HITTEST_CONT);
+
+	if (q.lmp != NULL) {
+		unit->SetLastAttackedPiece(q.lmp, gs->frameNum);
+	}
+
+	// The current projectile <p> won't reach the raytraced surface impact
+	// position until ::Update() is called (same frame). This is a problem
+	// when dealing with fast low-AOE projectiles since they would do almost
+	// no damage if detonated outside the collision volume. Therefore, smuggle
+	// a bit with its position now (rather than rolling it back in ::Update()
+	// and waiting for the next-frame CheckUnitCol(), which is problematic
+	// for noExplode projectiles).
+
+	// const float3& pimpp = (q.b0)? q.p0: q.p1;
+	const float3 pimpp =
+		(q.b0 && q.b1)? ( q.p0 +  q.p1) * 0.5f:
+		(q.b0        )? ( q.p0 + ppos1) * 0.5f:
+						(ppos0 +  q.p1) * 0.5f;
+
+	p->pos = (raytraced)? pimpp: ppos0;
+	p->Collision(unit);
+	p->pos = (raytraced)? ppos0: p->pos;
+}
+
+static void ApplyFeatureCollision(
+	CProjectile* p,
+	CFeature* feature,
+	const CollisionQuery& q,
+	const float3& ppos0,
+	const float3& ppos1)
+{
+	const bool raytraced =
+		(feature->collisionVolume &&
+		feature->collisionVolume->GetTestType() == CollisionVolume::COLVOL_HITTEST_CONT);
+
+	const float3 pimpp =
+		(q.b0 && q.b1)? (q.p0 + q.p1) * 0.5f:
+		(q.b0        )? (q.p0 + ppos1) * 0.5f:
+						(ppos0 + q.p1) * 0.5f;
+
+	p->pos = (raytraced)? pimpp: ppos0;
+	p->Collision(feature);
+	p->pos = (raytraced)? ppos0: p->pos;
+}
+
+
+void CProjectileHandler::CheckUnitCollisions(
+	CProjectile* p,
+	std::vector<CUnit*>& tempUnits,
+	CUnit** endUnit,
+	const float3& ppos0,
+	const float3& ppos1)
+{
+	CollisionQuery q;
+	CCollisionHandler::HitTestCounts counts;
+	CUnit* unit = DetectUnitCollision(p, &tempUnits[0], endUnit, ppos0, ppos1, &q, &counts);
+
+	CCollisionHandler::AddHitTestCounts(counts);
+
+	if (unit != NULL) {
+		ApplyUnitCollision(p, unit, q, ppos0, ppos1);
 	}
 }
 
@@ -422,57 +599,224 @@ void CProjectileHandler::CheckFeatureCollisions(
 	const float3& ppos1)
 {
 	CollisionQuery q;
+	CCollisionHandler::HitTestCounts counts;
+	CFeature* feature = DetectFeatureCollision(p, &tempFeatures[0], endFeature, ppos0, ppos1, &q, &counts);
 
-	if (p->GetCollisionFlags() & Collision::NOFEATURES) {
-		return;
+	CCollisionHandler::AddHitTestCounts(counts);
+
+	if (feature != NULL) {
+		ApplyFeatureCollision(p, feature, q, ppos0, ppos1);
 	}
+}
 
-	for (CFeature** fi = &tempFeatures[0]; fi != endFeature; ++fi) {
-		CFeature* feature = *fi;
+void CProjectileHandler::CheckUnitFeatureCollisions(CProjectile* p) {
+	static std::vector<CUnit*> tempUnits(uh->MaxUnits(), NULL);
+	static std::vector<CFeature*> tempFeatures(uh->MaxUnits(), NULL);
 
-		// geothermals do not have a collision volume, skip them
-		if (!feature->blocking || feature->def->geoThermal) {
-			continue;
+	const float3 ppos0 = p->pos;
+	const float3 ppos1 = p->pos + p->speed;
+	const float speedf = p->speed.Length();
+
+	CUnit** endUnit = &tempUnits[0];
+	CFeature** endFeature = &tempFeatures[0];
+
+	qf->GetUnitsAndFeaturesExact(p->pos, p->radius + speedf, endUnit, endFeature);
+
+	CheckUnitCollisions(p, tempUnits, endUnit, ppos0, ppos1);
+	if (p->checkCol) // already collided with unit?
+		CheckFeatureCollisions(p, tempFeatures, endFeature, ppos0, ppos1);
+}
+
+
+/**
+ * Result slot of the parallel collision detection of one projectile:
+ * the first unit and the first feature it hits this frame, as seen
+ * at the start of the collision phase.
+ */
+struct CollisionCandidates {
+	float3 ppos0;
+	float3 pspeed;
+	CUnit* unit;
+	CFeature* feature;
+	CollisionQuery unitQuery;
+	CollisionQuery featureQuery;
+};
+
+static void DetectCollisionsBlock(
+	const std::vector<CProjectile*>* projectiles,
+	std::vector<CollisionCandidates>* candidates,
+	std::vector<CCollisionHandler::HitTestCounts>* blockCounts,
+	int block)
+{
+	CCollisionHandler::HitTestCounts* counts = &(*blockCounts)[block];
+
+	// one set of buffers per work item, the threads must not share them
+	std::vector<int> quads;
+	std::vector<CUnit*> units;
+	std::vector<CFeature*> features;
+
+	const size_t begin = block * PROJECTILE_BLOCK_SIZE;
+	const size_t end = std::min(begin + PROJECTILE_BLOCK_SIZE, projectiles->size());
+
+	for (size_t i = begin; i < end; ++i) {
+		const CProjectile* p = (*projectiles)[i];
+		CollisionCandidates& c = (*candidates)[i];
+
+		const float3 ppos1 = p->pos + p->speed;
+		const float speedf = p->speed.Length();
+
+		c.ppos0 = p->pos;
+		c.pspeed = p->speed;
+		c.unitQuery = CollisionQuery();
+		c.featureQuery = CollisionQuery();
+
+		qf->GetUnitsAndFeaturesExact(p->pos, p->radius + speedf, quads, units, features);
+
+		c.unit = (units.empty())? NULL: DetectUnitCollision(p, &units[0], &units[0] + units.size(), c.ppos0, ppos1, &c.unitQuery, counts);
+		c.feature = (features.empty())? NULL: DetectFeatureCollision(p, &features[0], &features[0] + features.size(), c.ppos0, ppos1, &c.featureQuery, counts);
+	}
+}
+
+/// @return true if units or features the projectile could hit were added, removed or moved
+static bool CollisionCandidatesChanged(const CProjectile* p, const CollisionCandidates& c, unsigned int numObjectChanges)
+{
+	static std::vector<int> quads;
+
+	return qf->ObjectsChangedSince(c.ppos0, p->radius + c.pspeed.Length(), numObjectChanges, quads);
+}
+
+/**
+ * Applies the collisions found by DetectCollisionsBlock, after testing the
+ * hit objects again (their team or collision volume may have been changed
+ * by Lua without moving them).
+ * @return false if the unit candidate is no longer valid, nothing applied
+ */
+static bool ApplyCollisionCandidates(CProjectile* p, const CollisionCandidates& c, unsigned int numObjectChanges)
+{
+	const float3 ppos1 = c.ppos0 + c.pspeed;
+
+	CCollisionHandler::HitTestCounts counts;
+	CollisionQuery unitQuery;
+	CollisionQuery featureQuery;
+
+	if (c.unit != NULL) {
+		CUnit* unit = DetectUnitCollision(p, &c.unit, &c.unit + 1, c.ppos0, ppos1, &unitQuery, &counts);
+
+		if (unit == NULL) {
+			CCollisionHandler::AddHitTestCounts(counts);
+			return false;
 		}
 
-		const bool raytraced =
-			(feature->collisionVolume &&
-			feature->collisionVolume->GetTestType() == CollisionVolume::COLVOL_HITTEST_CONT);
+		ApplyUnitCollision(p, unit, unitQuery, c.ppos0, ppos1);
+	}
+
+	if (p->checkCol) { // already collided with unit?
+		const bool changed = CollisionCandidatesChanged(p, c, numObjectChanges);
 
-		if (CCollisionHandler::DetectHit(feature, ppos0, ppos1, &q)) {
-			const float3 pimpp =
-				(q.b0 && q.b1)? (q.p0 + q.p1) * 0.5f:
-				(q.b0        )? (q.p0 + ppos1) * 0.5f:
-								(ppos0 + q.p1) * 0.5f;
+		CFeature* feature = NULL;
 
-			p->pos = (raytraced)? pimpp: ppos0;
-			p->Collision(feature);
-			p->pos = (raytraced)? ppos0: p->pos;
-			break;
+		if (c.feature != NULL && !changed) {
+			feature = DetectFeatureCollision(p, &c.feature, &c.feature + 1, c.ppos0, ppos1, &featureQuery, &counts);
+		}
+
+		if (feature == NULL && (c.feature != NULL || changed)) {
+			// the unit collision changed the features around, or the
+			// candidate itself: look for the first hit among all again
+			static std::vector<int> quads;
+			static std::vector<CUnit*> units;
+			static std::vector<CFeature*> features;
+
+			featureQuery = CollisionQuery();
+			qf->GetUnitsAndFeaturesExact(c.ppos0, p->radius + c.pspeed.Length(), quads, units, features);
+
+			if (!features.empty()) {
+				feature = DetectFeatureCollision(p, &features[0], &features[0] + features.size(), c.ppos0, ppos1, &featureQuery, &counts);
+			}
+		}
+
+		if (feature != NULL) {
+			ApplyFeatureCollision(p, feature, featureQuery, c.ppos0, ppos1);
 		}
 	}
+
+	CCollisionHandler::AddHitTestCounts(counts);
+	return true;
 }
 
 void CProjectileHandler::CheckUnitFeatureCollisions(ProjectileContainer& pc) {
-	static std::vector<CUnit*> tempUnits(uh->MaxUnits(), NULL);
-	static std::vector<CFeature*> tempFeatures(uh->MaxUnits(), NULL);
+	ProjectileContainer::iterator pci = pc.begin();
 
-	for (ProjectileContainer::iterator pci = pc.begin(); pci != pc.end(); ++pci) {
-		CProjectile* p = *pci;
+	if (pc.size() >= MIN_PARALLEL_PROJECTILES) {
+		// compute phase: find the hits of all projectiles in parallel;
+		// this only reads the simulation state, so the results do not
+		// depend on the number of threads or their timing
+		static std::vector<CProjectile*> projectiles;
+		static std::vector<CollisionCandidates> candidates;
+		static std::vector<CCollisionHandler::HitTestCounts> blockCounts;
 
-		if (p->checkCol && !p->deleteMe) {
-			const float3 ppos0 = p->pos;
-			const float3 ppos1 = p->pos + p->speed;
-			const float speedf = p->speed.Length();
+		projectiles.clear();
+
+		for (; pci != pc.end(); ++pci) {
+			CProjectile* p = *pci;
+
+			if (p->checkCol && !p->deleteMe) {
+				projectiles.push_back(p);
+			}
+		}
+
+		const int numBlocks = GetNumProjectileBlocks(projectiles.size());
 
-			CUnit** endUnit = &tempUnits[0];
-			CFeature** endFeature = &tempFeatures[0];
+		candidates.resize(projectiles.size());
+		blockCounts.assign(numBlocks, CCollisionHandler::HitTestCounts());
+		ThreadPool::for_mt(0, numBlocks, boost::bind(&DetectCollisionsBlock, &projectiles, &candidates, &blockCounts, _1));
 
-			qf->GetUnitsAndFeaturesExact(p->pos, p->radius + speedf, endUnit, endFeature);
+		for (int b = 0; b < numBlocks; ++b) {
+			CCollisionHandler::AddHitTestCounts(blockCounts[b]);
+		}
+
+		// projectiles created by the collisions below are appended
+		// to the container, and checked serially after this phase
+		pci = pc.end();
+		--pci;
+
+		// the candidates are only valid as long as no unit or feature
+		// around the projectile was added, removed or moved (eg. a wreck
+		// spawned by a death, or a unit moved by Lua in UnitDamaged)
+		// since they were found
+		const unsigned int numObjectChanges = qf->GetNumObjectChanges();
+
+		// apply phase: damage, explosions, ... in container order
+		for (size_t i = 0; i < projectiles.size(); ++i) {
+			CProjectile* p = projectiles[i];
+			const CollisionCandidates& c = candidates[i];
+
+			if (!p->checkCol || p->deleteMe) {
+				continue;
+			}
 
-			CheckUnitCollisions(p, tempUnits, endUnit, ppos0, ppos1);
-			if (p->checkCol) // already collided with unit?
-				CheckFeatureCollisions(p, tempFeatures, endFeature, ppos0, ppos1);
+			const bool moved =
+				(p->pos.x != c.ppos0.x || p->pos.y != c.ppos0.y || p->pos.z != c.ppos0.z) ||
+				(p->speed.x != c.pspeed.x || p->speed.y != c.pspeed.y || p->speed.z != c.pspeed.z);
+
+			if (moved || CollisionCandidatesChanged(p, c, numObjectChanges)) {
+				// changed by an earlier collision, results are stale
+				CheckUnitFeatureCollisions(p);
+				continue;
+			}
+
+			if (!ApplyCollisionCandidates(p, c, numObjectChanges)) {
+				CheckUnitFeatureCollisions(p);
+			}
+		}
+
+		++pci;
+	}
+
+	for (; pci != pc.end(); ++pci) {
+		CProjectile* p = *pci;
+
+		if (p->checkCol && !p->deleteMe) {
+			CheckUnitFeatureCollisions(p);
 		}
 	}
 }
@@ -10,6 +10,7 @@
 #include "lib/gml/ThreadSafeContainers.h"
 
 #include "System/MemPool.h"
+#include "System/SlotMap.h"
 #include "System/float3.h"
 
 #define UNSYNCED_PROJ_NOEVENT 1 // bypass id and event handling for unsynced projectiles (faster)
@@ -31,7 +32,7 @@ struct projdetach {
 };
 
 typedef std::pair<CProjectile*, int> ProjectileMapPair;
-typedef std::map<int, ProjectileMapPair> ProjectileMap;
+typedef CSlotMap<ProjectileMapPair> ProjectileMap;
 typedef ThreadListSim<std::list<CProjectile*>, std::set<CProjectile*>, CProjectile*, projdetach> ProjectileContainer;
 typedef ThreadListSimRender<std::list<CGroundFlash*>, std::set<CGroundFlash*>, CGroundFlash*> GroundFlashContainer;
 #if defined(USE_GML) && GML_ENABLE_SIM
@@ -53,22 +54,21 @@ public:
 	void PostLoad();
 
 	inline const ProjectileMapPair* GetMapPairBySyncedID(int id) const {
-		ProjectileMap::const_iterator it = syncedProjectileIDs.find(id);
-		if (it == syncedProjectileIDs.end()) {
+		if (!syncedProjectileIDs.IsUsed(id)) {
 			return NULL;
 		}
-		return &(it->second);
+		return &syncedProjectileIDs[id];
 	}
 	inline const ProjectileMapPair* GetMapPairByUnsyncedID(int id) const {
-		ProjectileMap::const_iterator it = unsyncedProjectileIDs.find(id);
-		if (it == unsyncedProjectileIDs.end()) {
+		if (!unsyncedProjectileIDs.IsUsed(id)) {
 			return NULL;
 		}
-		return &(it->second);
+		return &unsyncedProjectileIDs[id];
 	}
 
 	void CheckUnitCollisions(CProjectile*, std::vector<CUnit*>&, CUnit**, const float3&, const float3&);
 	void CheckFeatureCollisions(CProjectile*, std::vector<CFeature*>&, CFeature**, const float3&, const float3&);
+	void CheckUnitFeatureCollisions(CProjectile*);
 	void CheckUnitFeatureCollisions(ProjectileContainer&);
 	void CheckGroundCollisions(ProjectileContainer&);
 	void CheckCollisions();
@@ -78,6 +78,7 @@ public:
 
 	void Update();
 	void UpdateProjectileContainer(ProjectileContainer&, bool);
+	void UpdateParticlePools();
 	void UpdateParticleSaturation() {
 		particleSaturation     = (maxParticles     > 0)? (currentParticles     / float(maxParticles    )): 1.0f;
 		nanoParticleSaturation = (maxNanoParticles > 0)? (currentNanoParticles / float(maxNanoParticles)): 1.0f;
@@ -94,12 +95,8 @@ public:
 	FlyingPieceContainer flyingPiecesS3O;     //! unsynced
 	GroundFlashContainer groundFlashes;       //! unsynced
 
-	int maxUsedSyncedID;
-	int maxUsedUnsyncedID;
-	std::list<int> freeSyncedIDs;             //! available synced (weapon, piece) projectile ID's
-	std::list<int> freeUnsyncedIDs;           //! available unsynced projectile ID's
-	ProjectileMap syncedProjectileIDs;        //! ID ==> <projectile, allyteam> map for living synced projectiles
-	ProjectileMap unsyncedProjectileIDs;      //! ID ==> <projectile, allyteam> map for living unsynced projectiles
+	ProjectileMap syncedProjectileIDs;        //! ID ==> <projectile, allyteam> map for living synced projectiles, hands out the synced (weapon, piece) projectile ID's
+	ProjectileMap unsyncedProjectileIDs;      //! ID ==> <projectile, allyteam> map for living unsynced projectiles, hands out the unsynced projectile ID's
 
 	int maxParticles;              // different effects should start to cut down on unnececary(unsynced) particles when this number is reached
 	int maxNanoParticles;
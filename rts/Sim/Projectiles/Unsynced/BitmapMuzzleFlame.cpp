@@ -11,6 +11,7 @@
 #include "Sim/Projectiles/ProjectileHandler.h"
 
 CR_BIND_DERIVED(CBitmapMuzzleFlame, CProjectile, );
+PARTICLE_POOL(CBitmapMuzzleFlame);
 
 CR_REG_METADATA(CBitmapMuzzleFlame,
 (
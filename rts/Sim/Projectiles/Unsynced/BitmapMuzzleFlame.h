@@ -4,6 +4,7 @@
 #define BITMAP_MUZZLE_FLAME_H
 
 #include "Sim/Projectiles/Projectile.h"
+#include "Sim/Projectiles/ParticlePool.h"
 
 class CColorMap;
 struct AtlasedTexture;
@@ -11,6 +12,7 @@ struct AtlasedTexture;
 class CBitmapMuzzleFlame : public CProjectile
 {
 	CR_DECLARE(CBitmapMuzzleFlame);
+	PARTICLE_POOL_ALLOCATOR(CBitmapMuzzleFlame)
 
 public:
 	CBitmapMuzzleFlame();
@@ -18,6 +20,7 @@ public:
 
 	void Draw();
 	void Update();
+	bool IsUpdateThreadSafe() const { return true; }
 
 	virtual void Init(const float3& pos, CUnit* owner);
 
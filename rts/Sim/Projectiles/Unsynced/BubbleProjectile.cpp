@@ -11,6 +11,7 @@
 #include "Sim/Projectiles/ProjectileHandler.h"
 
 CR_BIND_DERIVED(CBubbleProjectile, CProjectile, (ZeroVector, ZeroVector, 0.0f, 0.0f, 0.0f, NULL, 0.0f));
+PARTICLE_POOL(CBubbleProjectile);
 
 CR_REG_METADATA(CBubbleProjectile, (
 	CR_MEMBER(ttl),
@@ -4,16 +4,19 @@
 #define _BUBBLE_PROJECTILE_H
 
 #include "Sim/Projectiles/Projectile.h"
+#include "Sim/Projectiles/ParticlePool.h"
 
 class CBubbleProjectile : public CProjectile
 {
 	CR_DECLARE(CBubbleProjectile);
+	PARTICLE_POOL_ALLOCATOR(CBubbleProjectile)
 public:
 	CBubbleProjectile(float3 pos,float3 speed, float ttl, float startSize,
 			float sizeExpansion, CUnit* owner, float alpha);
 	virtual ~CBubbleProjectile();
 
 	void Update();
+	bool IsUpdateThreadSafe() const { return true; }
 	void Draw();
 
 private:
@@ -12,6 +12,7 @@
 #include "Rendering/Textures/TextureAtlas.h"
 
 CR_BIND_DERIVED(CDirtProjectile, CProjectile, );
+PARTICLE_POOL(CDirtProjectile);
 
 CR_REG_METADATA(CDirtProjectile,
 (
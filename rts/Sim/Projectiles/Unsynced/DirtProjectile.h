@@ -4,12 +4,14 @@
 #define _DIRT_PROJECTILE_H
 
 #include "Sim/Projectiles/Projectile.h"
+#include "Sim/Projectiles/ParticlePool.h"
 
 struct AtlasedTexture;
 
 class CDirtProjectile : public CProjectile
 {
 	CR_DECLARE(CDirtProjectile);
+	PARTICLE_POOL_ALLOCATOR(CDirtProjectile)
 public:
 	CDirtProjectile();
 	CDirtProjectile(const float3& pos, const float3& speed, const float ttl,
@@ -19,6 +21,7 @@ public:
 
 	virtual void Draw();
 	virtual void Update();
+	virtual bool IsUpdateThreadSafe() const { return true; }
 
 private:
 	float alpha;
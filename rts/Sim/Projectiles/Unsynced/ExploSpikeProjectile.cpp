@@ -11,6 +11,7 @@
 #include "Rendering/Textures/TextureAtlas.h"
 
 CR_BIND_DERIVED(CExploSpikeProjectile, CProjectile, );
+PARTICLE_POOL(CExploSpikeProjectile);
 
 CR_REG_METADATA(CExploSpikeProjectile,
 (
@@ -4,10 +4,12 @@
 #define EXPLO_SPIKE_PROJECTILE_H
 
 #include "Sim/Projectiles/Projectile.h"
+#include "Sim/Projectiles/ParticlePool.h"
 
 class CExploSpikeProjectile : public CProjectile
 {
 	CR_DECLARE(CExploSpikeProjectile);
+	PARTICLE_POOL_ALLOCATOR(CExploSpikeProjectile)
 
 	/// used only by creg
 	CExploSpikeProjectile();
@@ -18,6 +20,7 @@ public:
 
 	void Draw();
 	void Update();
+	bool IsUpdateThreadSafe() const { return true; }
 
 	virtual void Init(const float3& pos, CUnit* owner);
 
@@ -9,6 +9,7 @@
 #include "Sim/Projectiles/ProjectileHandler.h"
 
 CR_BIND_DERIVED(CGenericParticleProjectile, CProjectile, (ZeroVector, ZeroVector, NULL));
+PARTICLE_POOL(CGenericParticleProjectile);
 
 CR_REG_METADATA(CGenericParticleProjectile,(
 	CR_MEMBER(gravity),
@@ -4,6 +4,7 @@
 #define GENERIC_PARTICLE_PROJECTILE_H
 
 #include "Sim/Projectiles/Projectile.h"
+#include "Sim/Projectiles/ParticlePool.h"
 #include "Rendering/Textures/TextureAtlas.h"
 
 class CColorMap;
@@ -11,6 +12,7 @@ class CColorMap;
 class CGenericParticleProjectile : public CProjectile
 {
 	CR_DECLARE(CGenericParticleProjectile);
+	PARTICLE_POOL_ALLOCATOR(CGenericParticleProjectile)
 
 public:
 	CGenericParticleProjectile(const float3& pos, const float3& speed,
@@ -19,6 +21,7 @@ public:
 
 	virtual void Draw();
 	virtual void Update();
+	virtual bool IsUpdateThreadSafe() const { return true; }
 
 	float3 gravity;
 
@@ -15,6 +15,7 @@ public:
 
 	void Draw();
 	void Update();
+	bool IsUpdateThreadSafe() const { return true; }
 
 	void SetColor(float r, float g, float b, float a) {
 		this->r = r;
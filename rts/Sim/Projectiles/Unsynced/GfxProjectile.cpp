@@ -12,6 +12,7 @@
 #include "Sim/Projectiles/ProjectileHandler.h"
 
 CR_BIND_DERIVED(CGfxProjectile, CProjectile, );
+PARTICLE_POOL(CGfxProjectile);
 
 CR_REG_METADATA(CGfxProjectile,
 (
@@ -4,10 +4,12 @@
 #define GFX_PROJECTILE_H
 
 #include "Sim/Projectiles/Projectile.h"
+#include "Sim/Projectiles/ParticlePool.h"
 
 class CGfxProjectile : public CProjectile
 {
 	CR_DECLARE(CGfxProjectile);
+	PARTICLE_POOL_ALLOCATOR(CGfxProjectile)
 
 public:
 	CGfxProjectile();
@@ -16,6 +18,7 @@ public:
 	virtual ~CGfxProjectile();
 
 	void Update();
+	bool IsUpdateThreadSafe() const { return true; }
 	void Draw();
 	virtual void DrawOnMinimap(CVertexArray& lines, CVertexArray& points);
 
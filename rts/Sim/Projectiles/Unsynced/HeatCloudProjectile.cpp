@@ -10,6 +10,7 @@
 #include "Rendering/Textures/TextureAtlas.h"
 
 CR_BIND_DERIVED(CHeatCloudProjectile, CProjectile, );
+PARTICLE_POOL(CHeatCloudProjectile);
 
 CR_REG_METADATA(CHeatCloudProjectile,
 (
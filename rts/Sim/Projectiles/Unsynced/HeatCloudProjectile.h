@@ -4,12 +4,14 @@
 #define HEAT_CLOUD_PROJECTILE_H
 
 #include "Sim/Projectiles/Projectile.h"
+#include "Sim/Projectiles/ParticlePool.h"
 
 struct AtlasedTexture;
 
 class CHeatCloudProjectile : public CProjectile
 {
 	CR_DECLARE(CHeatCloudProjectile);
+	PARTICLE_POOL_ALLOCATOR(CHeatCloudProjectile)
 public:
 	CHeatCloudProjectile();
 	/// projectile starts at size 0 and ends at size \<size\>
@@ -19,6 +21,7 @@ public:
 
 	virtual void Draw();
 	virtual void Update();
+	virtual bool IsUpdateThreadSafe() const { return true; }
 
 private:
 	float heat;
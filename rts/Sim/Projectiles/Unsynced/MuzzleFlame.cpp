@@ -11,6 +11,7 @@
 
 
 CR_BIND_DERIVED(CMuzzleFlame, CProjectile, (ZeroVector, ZeroVector, ZeroVector, 0));
+PARTICLE_POOL(CMuzzleFlame);
 
 CR_REG_METADATA(CMuzzleFlame,(
 	CR_SERIALIZER(creg_Serialize), // randSmokeDir
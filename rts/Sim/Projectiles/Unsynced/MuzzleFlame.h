@@ -4,10 +4,12 @@
 #define MUZZLE_FLAME_H
 
 #include "Sim/Projectiles/Projectile.h"
+#include "Sim/Projectiles/ParticlePool.h"
 
 class CMuzzleFlame : public CProjectile
 {
 	CR_DECLARE(CMuzzleFlame);
+	PARTICLE_POOL_ALLOCATOR(CMuzzleFlame)
 
 	void creg_Serialize(creg::ISerializer& s);
 public:
@@ -17,6 +19,7 @@ public:
 
 	void Draw();
 	void Update();
+	bool IsUpdateThreadSafe() const { return true; }
 
 private:
 	float3 dir;
@@ -12,6 +12,7 @@
 #include "System/float3.h"
 
 CR_BIND_DERIVED(CSimpleParticleSystem, CProjectile, );
+PARTICLE_POOL(CSimpleParticleSystem);
 
 CR_REG_METADATA(CSimpleParticleSystem,
 (
@@ -4,6 +4,7 @@
 #define SIMPLE_PARTICLE_SYSTEM_H
 
 #include "Sim/Projectiles/Projectile.h"
+#include "Sim/Projectiles/ParticlePool.h"
 #include "Rendering/Textures/TextureAtlas.h"
 #include "System/float3.h"
 
@@ -13,6 +14,7 @@ class CColorMap;
 class CSimpleParticleSystem : public CProjectile
 {
 	CR_DECLARE(CSimpleParticleSystem);
+	PARTICLE_POOL_ALLOCATOR(CSimpleParticleSystem)
 	CR_DECLARE_SUB(Particle);
 
 public:
@@ -21,6 +23,7 @@ public:
 
 	virtual void Draw();
 	virtual void Update();
+	virtual bool IsUpdateThreadSafe() const { return true; }
 	virtual void Init(const float3& explosionPos, CUnit* owner);
 
 protected:
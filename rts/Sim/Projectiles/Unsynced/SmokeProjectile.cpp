@@ -14,6 +14,7 @@
 #include "Sim/Misc/Wind.h"
 
 CR_BIND_DERIVED(CSmokeProjectile, CProjectile, );
+PARTICLE_POOL(CSmokeProjectile);
 
 CR_REG_METADATA(CSmokeProjectile,
 (
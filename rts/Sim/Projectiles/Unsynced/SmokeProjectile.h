@@ -4,6 +4,7 @@
 #define SMOKE_PROJECTILE_H
 
 #include "Sim/Projectiles/Projectile.h"
+#include "Sim/Projectiles/ParticlePool.h"
 #include "System/float3.h"
 
 class CUnit;
@@ -11,6 +12,7 @@ class CUnit;
 class CSmokeProjectile : public CProjectile
 {
 	CR_DECLARE(CSmokeProjectile)
+	PARTICLE_POOL_ALLOCATOR(CSmokeProjectile)
 
 public:
 	CSmokeProjectile();
@@ -18,6 +20,7 @@ public:
 			float startSize, float sizeExpansion, CUnit* owner, float color);
 
 	void Update();
+	bool IsUpdateThreadSafe() const { return true; }
 	void Draw();
 	void Init(const float3& pos, CUnit* owner);
 
@@ -14,6 +14,7 @@
 #include "Sim/Misc/Wind.h"
 
 CR_BIND_DERIVED(CSmokeProjectile2, CProjectile, );
+PARTICLE_POOL(CSmokeProjectile2);
 
 CR_REG_METADATA(CSmokeProjectile2,
 (
@@ -4,6 +4,7 @@
 #define SMOKE_PROJECTILE_2_H
 
 #include "Sim/Projectiles/Projectile.h"
+#include "Sim/Projectiles/ParticlePool.h"
 #include "System/float3.h"
 
 class CUnit;
@@ -11,6 +12,7 @@ class CUnit;
 class CSmokeProjectile2 : public CProjectile
 {
 	CR_DECLARE(CSmokeProjectile2);
+	PARTICLE_POOL_ALLOCATOR(CSmokeProjectile2)
 
 public:
 	CSmokeProjectile2();
@@ -19,6 +21,7 @@ public:
 			float sizeExpansion, CUnit* owner, float color = 0.7f);
 
 	void Update();
+	bool IsUpdateThreadSafe() const { return true; }
 	void Draw();
 	void Init(const float3& pos, CUnit* owner);
 
@@ -4,17 +4,20 @@
 #define SMOKE_TRAIL_PROJECTILE_H
 
 #include "Sim/Projectiles/Projectile.h"
+#include "Sim/Projectiles/ParticlePool.h"
 
 struct AtlasedTexture;
 
 class CSmokeTrailProjectile : public CProjectile
 {
 	CR_DECLARE(CSmokeTrailProjectile);
+	PARTICLE_POOL_ALLOCATOR(CSmokeTrailProjectile)
 public:
 	CSmokeTrailProjectile(const float3& pos1, const float3& pos2, const float3& dir1, const float3& dir2, CUnit* owner, bool firstSegment, bool lastSegment, float size = 1, int time = 80, float color = 0.7f, bool drawTrail = true, CProjectile* drawCallback = 0, AtlasedTexture* texture = 0);
 	virtual ~CSmokeTrailProjectile();
 
 	void Update();
+	bool IsUpdateThreadSafe() const { return true; }
 	void Draw();
 
 private:
@@ -13,6 +13,7 @@
 using std::min;
 
 CR_BIND_DERIVED(CSpherePartProjectile, CProjectile, (ZeroVector, 0, 0, 0.0f, 0.0f, 0, NULL, ZeroVector));
+PARTICLE_POOL(CSpherePartProjectile);
 
 CR_REG_METADATA(CSpherePartProjectile, (
 	CR_MEMBER(centerPos),
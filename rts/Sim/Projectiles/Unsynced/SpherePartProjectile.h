@@ -4,10 +4,12 @@
 #define SPHERE_PART_PROJECTILE_H
 
 #include "Sim/Projectiles/Projectile.h"
+#include "Sim/Projectiles/ParticlePool.h"
 
 class CSpherePartProjectile : public CProjectile
 {
 	CR_DECLARE(CSpherePartProjectile);
+	PARTICLE_POOL_ALLOCATOR(CSpherePartProjectile)
 
 public:
 	CSpherePartProjectile(const float3& centerPos, int xpart, int ypart,
@@ -17,6 +19,7 @@ public:
 
 	void Draw();
 	void Update();
+	bool IsUpdateThreadSafe() const { return true; }
 	static void CreateSphere(float3 pos, float alpha, int ttl,
 			float expansionSpeed , CUnit* owner,
 			float3 color = float3(0.8, 0.8, 0.6));
@@ -6,6 +6,7 @@
 #include "Rendering/GL/myGL.h"
 
 CR_BIND_DERIVED(CTracerProjectile, CProjectile, )
+PARTICLE_POOL(CTracerProjectile);
 
 CR_REG_METADATA(CTracerProjectile, 
 (
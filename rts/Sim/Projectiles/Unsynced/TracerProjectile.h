@@ -4,11 +4,13 @@
 #define TRACER_PROJECTILE_H
 
 #include "Sim/Projectiles/Projectile.h"
+#include "Sim/Projectiles/ParticlePool.h"
 
 class CTracerProjectile : public CProjectile
 {
 public:
 	CR_DECLARE(CTracerProjectile);
+	PARTICLE_POOL_ALLOCATOR(CTracerProjectile)
 
 	CTracerProjectile();
 	CTracerProjectile(const float3& pos, const float3& speed, const float range,
@@ -17,6 +19,7 @@ public:
 
 	void Draw();
 	void Update();
+	bool IsUpdateThreadSafe() const { return true; }
 	void Init(const float3& pos, CUnit *owner);
 
 private:
@@ -13,6 +13,7 @@
 #include "Sim/Misc/Wind.h"
 
 CR_BIND_DERIVED(CWakeProjectile, CProjectile, (ZeroVector, ZeroVector, 0.0f, 0.0f, NULL, 0.0f, 0.0f, 0.0f));
+PARTICLE_POOL(CWakeProjectile);
 
 CR_REG_METADATA(CWakeProjectile,(
 	CR_MEMBER(alpha),
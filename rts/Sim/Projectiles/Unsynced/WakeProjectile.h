@@ -4,10 +4,12 @@
 #define WAKE_PROJECTILE_H
 
 #include "Sim/Projectiles/Projectile.h"
+#include "Sim/Projectiles/ParticlePool.h"
 
 class CWakeProjectile : public CProjectile
 {
 	CR_DECLARE(CWakeProjectile);
+	PARTICLE_POOL_ALLOCATOR(CWakeProjectile)
 public:
 	CWakeProjectile(const float3& pos, const float3& speed, float startSize,
 			float sizeExpansion, CUnit* owner, float alpha, float alphaFalloff,
@@ -15,6 +17,7 @@ public:
 	virtual ~CWakeProjectile();
 
 	void Update();
+	bool IsUpdateThreadSafe() const { return true; }
 	void Draw();
 
 private:
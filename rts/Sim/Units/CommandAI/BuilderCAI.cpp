@@ -59,9 +59,9 @@ CR_REG_METADATA(CBuilderCAI , (
 				));
 
 // not adding to members, should repopulate itself
-CUnitSet CBuilderCAI::reclaimers;
-CUnitSet CBuilderCAI::featureReclaimers;
-CUnitSet CBuilderCAI::resurrecters;
+CTargetReservations CBuilderCAI::reclaimers;
+CTargetReservations CBuilderCAI::featureReclaimers;
+CTargetReservations CBuilderCAI::resurrecters;
 
 
 CBuilderCAI::CBuilderCAI():
@@ -835,7 +835,7 @@ void CBuilderCAI::ExecuteReclaim(Command& c)
 					FinishCommand();
 					RemoveUnitFromFeatureReclaimers(owner);
 				} else {
-					AddUnitToFeatureReclaimers(owner);
+					AddUnitToFeatureReclaimers(owner, feature->id);
 				}
 			} else {
 				StopMove();
@@ -872,7 +872,7 @@ void CBuilderCAI::ExecuteReclaim(Command& c)
 					StopMove();
 					FinishCommand();
 				} else {
-					AddUnitToReclaimers(owner);
+					AddUnitToReclaimers(owner, unit->id);
 				}
 			} else {
 				RemoveUnitFromReclaimers(owner);
@@ -952,7 +952,7 @@ void CBuilderCAI::ExecuteResurrect(Command& c)
 					FinishCommand();
 				}
 				else {
-					AddUnitToResurrecters(owner);
+					AddUnitToResurrecters(owner, feature->id);
 				}
 			} else {
 				RemoveUnitFromResurrecters(owner);
@@ -1174,128 +1174,110 @@ int CBuilderCAI::GetDefaultCmd(const CUnit* pointed, const CFeature* feature)
 }
 
 
-void CBuilderCAI::AddUnitToReclaimers(CUnit* unit)
+void CBuilderCAI::AddUnitToReclaimers(CUnit* unit, int unitID)
 {
-	reclaimers.insert(unit);
+	reclaimers.Add(unit->id, unitID);
 }
 
 
 void CBuilderCAI::RemoveUnitFromReclaimers(CUnit* unit)
 {
-	reclaimers.erase(unit);
+	reclaimers.Remove(unit->id);
 }
 
 
-void CBuilderCAI::AddUnitToFeatureReclaimers(CUnit* unit)
+void CBuilderCAI::AddUnitToFeatureReclaimers(CUnit* unit, int featureID)
 {
-	featureReclaimers.insert(unit);
+	featureReclaimers.Add(unit->id, featureID);
 }
 
 void CBuilderCAI::RemoveUnitFromFeatureReclaimers(CUnit* unit)
 {
-	featureReclaimers.erase(unit);
+	featureReclaimers.Remove(unit->id);
 }
 
-void CBuilderCAI::AddUnitToResurrecters(CUnit* unit)
+void CBuilderCAI::AddUnitToResurrecters(CUnit* unit, int featureID)
 {
-	resurrecters.insert(unit);
+	resurrecters.Add(unit->id, featureID);
 }
 
 void CBuilderCAI::RemoveUnitFromResurrecters(CUnit* unit)
 {
-	resurrecters.erase(unit);
+	resurrecters.Remove(unit->id);
+}
+
+void CBuilderCAI::ClearTargetReservations()
+{
+	reclaimers.Clear();
+	featureReclaimers.Clear();
+	resurrecters.Clear();
 }
 
 
+/**
+ * The target of a builder is the one of the reclaim (resurrect) command at
+ * the front of its queue, where feature ids are offset by MaxUnits.
+ */
+class CBuilderTargets : public CTargetReservations::IWorkerState
+{
+public:
+	CBuilderTargets(int cmdID, int cmdTargetOffset, const CUnit* friendUnit):
+		cmdID(cmdID),
+		cmdTargetOffset(cmdTargetOffset),
+		friendUnit(friendUnit)
+	{}
+
+	int GetTarget(int workerID) const {
+		const CUnit* worker = uh->GetUnitUnsafe(workerID);
+
+		if (worker == NULL || worker->commandAI->commandQue.empty())
+			return -1;
+
+		const Command& c = worker->commandAI->commandQue.front();
+		const bool validParams = (c.params.size() == 1 || (cmdID == CMD_RECLAIM && c.params.size() == 5));
+
+		if (c.GetID() != cmdID || !validParams)
+			return -1;
+
+		// a unit is no feature and vice versa
+		const int cmdTargetID = (int)c.params[0];
+		const bool sameKind = (cmdTargetOffset > 0)? (cmdTargetID >= cmdTargetOffset): (cmdTargetID >= 0 && static_cast<unsigned int>(cmdTargetID) < uh->MaxUnits());
+
+		return (sameKind? (cmdTargetID - cmdTargetOffset): -1);
+	}
+
+	bool Counts(int workerID) const {
+		return (!friendUnit || teamHandler->Ally(friendUnit->allyteam, uh->GetUnitUnsafe(workerID)->allyteam));
+	}
+
+private:
+	int cmdID;
+	int cmdTargetOffset;
+	const CUnit* friendUnit;
+};
+
+
 /**
  * Checks if a unit is being reclaimed by a friendly con.
  *
- * We assume that there will not be a lot of reclaimers, because performance
- * would suck if there were. Ideally, reclaimers should be assigned on a
- * per-unit basis, but this requires tracking of deaths, which albeit
- * already done, is not exactly simple to follow.
- *
- * TODO easy: store reclaiming units per allyteam
- * TODO harder: update reclaimers as they start/finish reclaims and/or die
+ * Only the builders that reserved the unit are looked at, so this stays
+ * cheap even with many reclaimers (e.g. area-reclaim with lots of cons).
  */
 bool CBuilderCAI::IsUnitBeingReclaimed(CUnit* unit, CUnit *friendUnit)
 {
-	bool retval = false;
-	std::list<CUnit*> rm;
-
-	for (CUnitSet::iterator it = reclaimers.begin(); it != reclaimers.end(); ++it) {
-		if ((*it)->commandAI->commandQue.empty()) {
-			rm.push_back(*it);
-			continue;
-		}
-		const Command& c = (*it)->commandAI->commandQue.front();
-		if (c.GetID() != CMD_RECLAIM || (c.params.size() != 1 && c.params.size() != 5)) {
-			rm.push_back(*it);
-			continue;
-		}
-		const int cmdUnitId = (int)c.params[0];
-		if (cmdUnitId == unit->id && (!friendUnit || teamHandler->Ally(friendUnit->allyteam, (*it)->allyteam))) {
-			retval = true;
-			break;
-		}
-	}
-	for (std::list<CUnit*>::iterator it = rm.begin(); it != rm.end(); ++it)
-		RemoveUnitFromReclaimers(*it);
-	return retval;
+	return reclaimers.IsReserved(unit->id, CBuilderTargets(CMD_RECLAIM, 0, friendUnit));
 }
 
 
 bool CBuilderCAI::IsFeatureBeingReclaimed(int featureId, CUnit *friendUnit)
 {
-	bool retval = false;
-	std::list<CUnit*> rm;
-
-	for (CUnitSet::iterator it = featureReclaimers.begin(); it != featureReclaimers.end(); ++it) {
-		if ((*it)->commandAI->commandQue.empty()) {
-			rm.push_back(*it);
-			continue;
-		}
-		const Command& c = (*it)->commandAI->commandQue.front();
-		if (c.GetID() != CMD_RECLAIM || (c.params.size() != 1 && c.params.size() != 5)) {
-			rm.push_back(*it);
-			continue;
-		}
-		const int cmdFeatureId = (int)c.params[0];
-		if (cmdFeatureId-uh->MaxUnits() == featureId && (!friendUnit || teamHandler->Ally(friendUnit->allyteam, (*it)->allyteam))) {
-			retval = true;
-			break;
-		}
-	}
-	for (std::list<CUnit*>::iterator it = rm.begin(); it != rm.end(); ++it)
-		RemoveUnitFromFeatureReclaimers(*it);
-	return retval;
+	return featureReclaimers.IsReserved(featureId, CBuilderTargets(CMD_RECLAIM, uh->MaxUnits(), friendUnit));
 }
 
 
 bool CBuilderCAI::IsFeatureBeingResurrected(int featureId, CUnit *friendUnit)
 {
-	bool retval = false;
-	std::list<CUnit*> rm;
-
-	for (CUnitSet::iterator it = resurrecters.begin(); it != resurrecters.end(); ++it) {
-		if ((*it)->commandAI->commandQue.empty()) {
-			rm.push_back(*it);
-			continue;
-		}
-		const Command& c = (*it)->commandAI->commandQue.front();
-		if (c.GetID() != CMD_RESURRECT || c.params.size() != 1) {
-			rm.push_back(*it);
-			continue;
-		}
-		const int cmdFeatureId = (int)c.params[0];
-		if (cmdFeatureId-uh->MaxUnits() == featureId && (!friendUnit || teamHandler->Ally(friendUnit->allyteam, (*it)->allyteam))) {
-			retval = true;
-			break;
-		}
-	}
-	for (std::list<CUnit*>::iterator it = rm.begin(); it != rm.end(); ++it)
-		RemoveUnitFromResurrecters(*it);
-	return retval;
+	return resurrecters.IsReserved(featureId, CBuilderTargets(CMD_RESURRECT, uh->MaxUnits(), friendUnit));
 }
 
 
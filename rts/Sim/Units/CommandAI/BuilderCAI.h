@@ -4,6 +4,7 @@
 #define _BUILDER_CAI_H_
 
 #include "MobileCAI.h"
+#include "TargetReservations.h"
 #include "Sim/Units/UnitSet.h"
 #include "Sim/Units/BuildInfo.h"
 
@@ -99,9 +100,12 @@ public:
 	}
 
 public:
-	static CUnitSet reclaimers;
-	static CUnitSet featureReclaimers;
-	static CUnitSet resurrecters;
+	/// builders by the id of the unit they reclaim
+	static CTargetReservations reclaimers;
+	/// builders by the id of the feature they reclaim
+	static CTargetReservations featureReclaimers;
+	/// builders by the id of the feature they resurrect
+	static CTargetReservations resurrecters;
 
 private:
 
@@ -112,17 +116,21 @@ private:
 	void ReclaimFeature(CFeature* f);
 
 	/// fix for patrolling cons repairing/resurrecting stuff that's being reclaimed
-	static void AddUnitToReclaimers(CUnit*);
+	static void AddUnitToReclaimers(CUnit*, int unitID);
 	static void RemoveUnitFromReclaimers(CUnit*);
 
 	/// fix for cons wandering away from their target circle
-	static void AddUnitToFeatureReclaimers(CUnit*);
+	static void AddUnitToFeatureReclaimers(CUnit*, int featureID);
 	static void RemoveUnitFromFeatureReclaimers(CUnit*);
 
 	/// fix for patrolling cons reclaiming stuff that is being resurrected
-	static void AddUnitToResurrecters(CUnit*);
+	static void AddUnitToResurrecters(CUnit*, int featureID);
 	static void RemoveUnitFromResurrecters(CUnit*);
+
 public:
+	/// forgets all reservations, the unit ids are reused by the next game
+	static void ClearTargetReservations();
+
 	/**
 	 * Checks if a unit is being reclaimed by a friendly con.
 	 */
@@ -1,6 +1,16 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
 #include "Command.h"
+#include "System/Log/ILog.h"
+#include "System/Platform/CrashHandler.h"
+#include "System/maindefines.h"
+
+#include <algorithm>
+
+CR_BIND(CommandParams, );
+CR_REG_METADATA(CommandParams, (
+	CR_SERIALIZER(Serialize)
+));
 
 CR_BIND(Command, );
 CR_REG_METADATA(Command, (
@@ -28,3 +38,48 @@ CR_REG_METADATA(CommandDescription, (
 	CR_MEMBER(params),
 	CR_RESERVED(32)
 ));
+
+
+const CommandParams::size_type CommandParams::INLINE_PARAMS;
+
+void CommandParams::Grow(size_type n)
+{
+	n = std::max(n, size_type(maxParams * 2));
+
+	float* newData = new float[n];
+
+	if (numParams > 0)
+		memcpy(newData, data, numParams * sizeof(float));
+	if (data != inlineData)
+		delete[] data;
+
+	data = newData;
+	maxParams = n;
+}
+
+float& CommandParams::SafeElement(size_type idx) const
+{
+	static float def = 0.0f;
+
+	if (showError) {
+		showError = false;
+		LOG_L(L_ERROR, "[%s] index "_STPF_" out of bounds! (size "_STPF_")", __FUNCTION__, idx, size());
+		CrashHandler::OutputStacktrace();
+	}
+
+	// a caller might have written to it
+	def = 0.0f;
+	return def;
+}
+
+void CommandParams::Serialize(creg::ISerializer& s)
+{
+	int n = numParams;
+	s.SerializeInt(&n, sizeof(int));
+
+	if (!s.IsWriting())
+		resize(n);
+
+	if (n > 0)
+		s.Serialize(data, n * sizeof(float));
+}
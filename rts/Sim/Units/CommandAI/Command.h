@@ -4,10 +4,11 @@
 #define COMMAND_H
 
 #include <string>
+#include <vector>
 #include <climits> // for INT_MAX
+#include <cstring>
 
 #include "System/creg/creg_cond.h"
-#include "System/SafeVector.h"
 
 // ID's lower than 0 are reserved for build options (cmd -x = unitdefs[x])
 #define CMD_STOP                   0
@@ -105,6 +106,146 @@ enum {
 	FIRESTATE_FIREATWILL =  2,
 };
 
+/**
+ * Parameters of a Command.
+ * Nearly every command has at most INLINE_PARAMS of them; those are stored
+ * within the Command itself, so copying a command (into a queue, over the
+ * network, to every unit of a selection) does not allocate. Only longer
+ * ones (e.g. unit lists of some custom commands) go to the heap.
+ * Like safe_vector, out-of-range reads are logged once and yield 0.
+ */
+class CommandParams
+{
+	CR_DECLARE_STRUCT(CommandParams);
+
+public:
+	typedef float value_type;
+	typedef size_t size_type;
+	typedef float* iterator;
+	typedef const float* const_iterator;
+
+	static const size_type INLINE_PARAMS = 8;
+
+	CommandParams()
+		: data(inlineData)
+		, numParams(0)
+		, maxParams(INLINE_PARAMS)
+		, showError(true)
+	{}
+
+	CommandParams(const CommandParams& p)
+		: data(inlineData)
+		, numParams(0)
+		, maxParams(INLINE_PARAMS)
+		, showError(true)
+	{
+		assign(p.begin(), p.end());
+	}
+
+	~CommandParams() {
+		if (data != inlineData)
+			delete[] data;
+	}
+
+	CommandParams& operator = (const CommandParams& p) {
+		if (this != &p)
+			assign(p.begin(), p.end());
+		return *this;
+	}
+
+	bool operator == (const CommandParams& p) const {
+		return (numParams == p.numParams) && (numParams == 0 || memcmp(data, p.data, numParams * sizeof(float)) == 0);
+	}
+	bool operator != (const CommandParams& p) const { return !(*this == p); }
+
+	void assign(const float* first, const float* last) {
+		numParams = 0;
+		reserve(last - first);
+
+		if (first != last)
+			memcpy(data, first, (last - first) * sizeof(float));
+
+		numParams = last - first;
+	}
+
+	size_type size() const { return numParams; }
+	bool empty() const { return (numParams == 0); }
+
+	void reserve(size_type n) {
+		if (n > maxParams)
+			Grow(n);
+	}
+
+	void resize(size_type n, float value = 0.0f) {
+		reserve(n);
+
+		for (size_type i = numParams; i < n; i++)
+			data[i] = value;
+
+		numParams = n;
+	}
+
+	void clear() { numParams = 0; }
+
+	void push_back(float value) {
+		if (numParams == maxParams)
+			Grow(maxParams * 2);
+
+		data[numParams++] = value;
+	}
+	void pop_back() { numParams--; }
+
+	iterator insert(iterator pos, float value) {
+		const size_type idx = pos - data;
+
+		if (numParams == maxParams)
+			Grow(maxParams * 2);
+
+		memmove(&data[idx + 1], &data[idx], (numParams - idx) * sizeof(float));
+		data[idx] = value;
+		numParams++;
+		return &data[idx];
+	}
+	iterator erase(iterator pos) { return erase(pos, pos + 1); }
+	iterator erase(iterator first, iterator last) {
+		memmove(first, last, (end() - last) * sizeof(float));
+		numParams -= (last - first);
+		return first;
+	}
+
+	const float& operator[] (size_type i) const { return (i < numParams)? data[i]: SafeElement(i); }
+	      float& operator[] (size_type i)       { return (i < numParams)? data[i]: SafeElement(i); }
+	const float& at(size_type i) const { return (*this)[i]; }
+	      float& at(size_type i)       { return (*this)[i]; }
+
+	const float& front() const { return data[0]; }
+	      float& front()       { return data[0]; }
+	const float& back() const { return data[numParams - 1]; }
+	      float& back()       { return data[numParams - 1]; }
+
+	const_iterator begin() const { return data; }
+	      iterator begin()       { return data; }
+	const_iterator end() const { return data + numParams; }
+	      iterator end()       { return data + numParams; }
+
+	void Serialize(creg::ISerializer& s);
+
+private:
+	void Grow(size_type n);
+	float& SafeElement(size_type idx) const;
+
+private:
+	/// inlineData or a heap array of maxParams floats
+	float* data;
+	float inlineData[INLINE_PARAMS];
+
+	unsigned int numParams;
+	unsigned int maxParams;
+
+	mutable bool showError;
+};
+
+
 struct Command
 {
 private:
@@ -161,8 +302,6 @@ public:
 		return *this;
 	}
 
-	~Command() { params.clear(); }
-
 	bool IsAreaCommand() const {
 		if (id == CMD_REPAIR ||
 			id == CMD_RECLAIM ||
@@ -185,7 +324,6 @@ public:
 	void AddParam(float par) { params.push_back(par); }
 	const float& GetParam(size_t idx) const { return params[idx]; }
 
-	/// const safe_vector<float>& GetParams() const { return params; }
 	const size_t GetParamsCount() const { return params.size(); }
 
 	void SetID(int id) 
@@ -206,7 +344,7 @@ public:
 	unsigned char options;
 
 	/// command parameters
-	safe_vector<float> params;
+	CommandParams params;
 
 	/// unique id within a CCommandQueue
 	unsigned int tag;
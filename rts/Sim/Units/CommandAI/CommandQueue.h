@@ -7,8 +7,12 @@
 
 #include <deque>
 #include "Command.h"
+#include "System/PoolAllocator.h"
 
-/// A wrapper class for std::deque<Command> to keep track of commands
+/**
+ * A wrapper class for std::deque<Command> to keep track of commands.
+ * Every unit has at least one queue, their storage comes from a pool.
+ */
 class CCommandQueue {
 
 	friend class CCommandAI;
@@ -30,7 +34,7 @@ class CCommandQueue {
 		/// limit to a float's integer range
 		static const int maxTagValue = (1 << 24); // 16777216
 
-		typedef std::deque<Command> basis;
+		typedef std::deque<Command, pool_allocator<Command> > basis;
 
 		typedef basis::size_type              size_type;
 		typedef basis::iterator               iterator;
@@ -110,7 +114,7 @@ class CCommandQueue {
 		inline void SetQueueType(QueueType type) { queueType = type; }
 
 	private:
-		std::deque<Command> queue;
+		basis queue;
 		QueueType queueType;
 		int tagCounter;
 };
@@ -0,0 +1,88 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/mmgr.h"
+
+#include "TargetReservations.h"
+
+#include <utility>
+#include <vector>
+
+void CTargetReservations::Add(int workerID, int targetID)
+{
+	std::map<int, int>::iterator wit = workerTargets.find(workerID);
+
+	if (wit != workerTargets.end()) {
+		if (wit->second == targetID)
+			return;
+
+		Remove(workerID);
+	}
+
+	workerTargets[workerID] = targetID;
+	targetWorkers[targetID].insert(workerID);
+}
+
+void CTargetReservations::Remove(int workerID)
+{
+	std::map<int, int>::iterator wit = workerTargets.find(workerID);
+
+	if (wit == workerTargets.end())
+		return;
+
+	std::map<int, WorkerSet>::iterator tit = targetWorkers.find(wit->second);
+
+	tit->second.erase(workerID);
+
+	if (tit->second.empty())
+		targetWorkers.erase(tit);
+
+	workerTargets.erase(wit);
+}
+
+void CTargetReservations::Clear()
+{
+	targetWorkers.clear();
+	workerTargets.clear();
+}
+
+const CTargetReservations::WorkerSet* CTargetReservations::GetWorkers(int targetID) const
+{
+	std::map<int, WorkerSet>::const_iterator tit = targetWorkers.find(targetID);
+
+	if (tit == targetWorkers.end())
+		return NULL;
+
+	return &tit->second;
+}
+
+bool CTargetReservations::IsReserved(int targetID, const IWorkerState& state)
+{
+	const WorkerSet* workers = GetWorkers(targetID);
+
+	if (workers == NULL)
+		return false;
+
+	bool retval = false;
+	std::vector< std::pair<int, int> > moved;
+
+	for (WorkerSet::const_iterator it = workers->begin(); it != workers->end(); ++it) {
+		const int workerTarget = state.GetTarget(*it);
+
+		if (workerTarget != targetID) {
+			moved.push_back(std::make_pair(*it, workerTarget));
+			continue;
+		}
+		if (state.Counts(*it)) {
+			retval = true;
+			break;
+		}
+	}
+	for (std::vector< std::pair<int, int> >::const_iterator it = moved.begin(); it != moved.end(); ++it) {
+		if (it->second < 0) {
+			Remove(it->first);
+		} else {
+			Add(it->first, it->second);
+		}
+	}
+	return retval;
+}
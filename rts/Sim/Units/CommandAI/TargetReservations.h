@@ -0,0 +1,59 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _TARGET_RESERVATIONS_H_
+#define _TARGET_RESERVATIONS_H_
+
+#include <cstddef>
+#include <map>
+#include <set>
+
+/**
+ * Index of which workers (unit ids) are busy with which target (unit or
+ * feature id), e.g. all builders reclaiming a feature.
+ * Lets "is anyone else working on this" checks look at the workers of one
+ * target only, instead of at every worker.
+ * Each worker has at most one target, adding it again moves it over.
+ */
+class CTargetReservations
+{
+public:
+	typedef std::set<int> WorkerSet;
+
+	/// what the workers are busy with right now
+	class IWorkerState
+	{
+	public:
+		virtual ~IWorkerState() {}
+
+		/// @return the target the worker works on now, or -1 if none
+		virtual int GetTarget(int workerID) const = 0;
+		/// @return if the worker counts as reserving its target (e.g. is allied)
+		virtual bool Counts(int workerID) const = 0;
+	};
+
+	/**
+	 * Checks the workers added for the target against their current state:
+	 * those that switched to another target are moved over to it, those
+	 * without one are removed.
+	 * @return if a worker that counts still works on the target
+	 */
+	bool IsReserved(int targetID, const IWorkerState& state);
+
+	void Add(int workerID, int targetID);
+	void Remove(int workerID);
+	void Clear();
+
+	/**
+	 * @return the workers added for the target, or NULL if there are none
+	 *   (it is up to the caller to check if they still work on it)
+	 */
+	const WorkerSet* GetWorkers(int targetID) const;
+
+	unsigned int GetNumWorkers() const { return workerTargets.size(); }
+
+private:
+	std::map<int, WorkerSet> targetWorkers;
+	std::map<int, int> workerTargets;
+};
+
+#endif // _TARGET_RESERVATIONS_H_
@@ -9,6 +9,8 @@
 #include "UnitScriptLog.h"
 #include "System/FileSystem/FileHandler.h"
 
+#include <algorithm>
+
 #ifndef _CONSOLE
 #include "System/TimeProfiler.h"
 #endif
@@ -28,8 +30,129 @@ int GCurrentTime;
 /******************************************************************************/
 
 
+CCobSleepWheel::CCobSleepWheel()
+	: curTime(0)
+	, numThreads(0)
+{
+}
+
+
+void CCobSleepWheel::AddThread(CCobThread* thread)
+{
+	Insert(thread, thread->GetWakeTime());
+	numThreads += 1;
+}
+
+
+void CCobSleepWheel::Insert(CCobThread* thread, int wakeTime)
+{
+	// threads that should already have woken up go into the
+	// slot that is released next, just like a heap would pop
+	// them before any thread with a later wake-time
+	wakeTime = std::max(wakeTime, curTime);
+
+	if ((wakeTime >> L1_SHIFT) == (curTime >> L1_SHIFT)) {
+		level0[wakeTime & (L0_SLOTS - 1)].push_back(thread);
+	} else if ((wakeTime >> L2_SHIFT) == (curTime >> L2_SHIFT)) {
+		level1[(wakeTime >> L1_SHIFT) & (LN_SLOTS - 1)].push_back(thread);
+	} else if ((wakeTime >> L3_SHIFT) == (curTime >> L3_SHIFT)) {
+		level2[(wakeTime >> L2_SHIFT) & (LN_SLOTS - 1)].push_back(thread);
+	} else {
+		overflow.push_back(thread);
+	}
+}
+
+
+void CCobSleepWheel::Cascade(std::vector<CCobThread*>& slot)
+{
+	if (slot.empty())
+		return;
+
+	// re-insert relative to the new curTime; the lower level
+	// slots they land in are still empty at this point, so the
+	// insertion order of threads with equal wake-times is kept
+	std::vector<CCobThread*> threads;
+	threads.swap(slot);
+
+	for (std::vector<CCobThread*>::const_iterator it = threads.begin(); it != threads.end(); ++it) {
+		Insert(*it, (*it)->GetWakeTime());
+	}
+}
+
+
+void CCobSleepWheel::Advance()
+{
+	curTime += 1;
+
+	if ((curTime & (L0_SLOTS - 1)) != 0)
+		return;
+
+	if ((curTime & ((1 << L2_SHIFT) - 1)) == 0) {
+		if ((curTime & ((1 << L3_SHIFT) - 1)) == 0) {
+			Cascade(overflow);
+		}
+		Cascade(level2[(curTime >> L2_SHIFT) & (LN_SLOTS - 1)]);
+	}
+
+	Cascade(level1[(curTime >> L1_SHIFT) & (LN_SLOTS - 1)]);
+}
+
+
+bool CCobSleepWheel::PopExpired(int time, std::vector<CCobThread*>& threads)
+{
+	while (curTime < time) {
+		if (numThreads == 0) {
+			// nothing to cascade, so we can skip ahead directly
+			curTime = time;
+			break;
+		}
+
+		std::vector<CCobThread*>& slot = level0[curTime & (L0_SLOTS - 1)];
+
+		if (!slot.empty()) {
+			// do not advance yet, threads released now might add
+			// other threads that are already due into this slot
+			threads.insert(threads.end(), slot.begin(), slot.end());
+			numThreads -= slot.size();
+			slot.clear();
+			return true;
+		}
+
+		Advance();
+	}
+
+	return false;
+}
+
+
+void CCobSleepWheel::Clear(std::vector<CCobThread*>& threads)
+{
+	for (int i = 0; i < L0_SLOTS; i++) {
+		threads.insert(threads.end(), level0[i].begin(), level0[i].end());
+		level0[i].clear();
+	}
+	for (int i = 0; i < LN_SLOTS; i++) {
+		threads.insert(threads.end(), level1[i].begin(), level1[i].end());
+		threads.insert(threads.end(), level2[i].begin(), level2[i].end());
+		level1[i].clear();
+		level2[i].clear();
+	}
+
+	threads.insert(threads.end(), overflow.begin(), overflow.end());
+	overflow.clear();
+
+	numThreads = 0;
+}
+
+
+/******************************************************************************/
+/******************************************************************************/
+
+
 CCobEngine::CCobEngine()
 	: curThread(NULL)
+	, numRunnableThreads(0)
+	, numSleepingThreads(0)
 {
 	GCurrentTime = 0;
 }
@@ -38,17 +161,18 @@ CCobEngine::CCobEngine()
 CCobEngine::~CCobEngine()
 {
 	//Should delete all things that the scheduler knows
-	for (std::list<CCobThread *>::iterator i = running.begin(); i != running.end(); ++i) {
+	for (std::vector<CCobThread*>::iterator i = running.begin(); i != running.end(); ++i) {
 		delete *i;
 	}
-	for (std::list<CCobThread *>::iterator i = wantToRun.begin(); i != wantToRun.end(); ++i) {
+	for (std::vector<CCobThread*>::iterator i = wantToRun.begin(); i != wantToRun.end(); ++i) {
 		delete *i;
 	}
-	while (sleeping.size() > 0) {
-		CCobThread *tmp;
-		tmp = sleeping.top();
-		sleeping.pop();
-		delete tmp;
+
+	waking.clear();
+	sleeping.Clear(waking);
+
+	for (std::vector<CCobThread*>::iterator i = waking.begin(); i != waking.end(); ++i) {
+		delete *i;
 	}
 }
 
@@ -67,10 +191,10 @@ void CCobEngine::AddThread(CCobThread *thread)
 {
 	switch (thread->state) {
 		case CCobThread::Run:
-			wantToRun.push_front(thread);
+			wantToRun.push_back(thread);
 			break;
 		case CCobThread::Sleep:
-			sleeping.push(thread);
+			sleeping.AddThread(thread);
 			break;
 		default:
 			LOG_L(L_ERROR, "thread added to scheduler with unknown state (%d)", thread->state);
@@ -95,11 +219,12 @@ void CCobEngine::Tick(int deltaTime)
 	SCOPED_TIMER("CobEngine::Tick");
 
 	GCurrentTime += deltaTime;
+	numRunnableThreads = running.size();
 
 	LOG_L(L_DEBUG, "----");
 
 	// Advance all running threads
-	for (std::list<CCobThread*>::iterator i = running.begin(); i != running.end(); ++i) {
+	for (std::vector<CCobThread*>::iterator i = running.begin(); i != running.end(); ++i) {
 		//LOG_L(L_DEBUG, "Now 1running %d: %s", GCurrentTime, (*i)->GetName().c_str());
 #ifdef _CONSOLE
 		printf("----\n");
@@ -114,19 +239,15 @@ void CCobEngine::Tick(int deltaTime)
 	running.clear();
 
 	// The threads that just ran may have added new threads that should run next tick
-	for (std::list<CCobThread *>::iterator i = wantToRun.begin(); i != wantToRun.end(); ++i) {
-		running.push_front(*i);
-	}
-
-	wantToRun.clear();
+	// (swapping keeps both buffers allocated, and they run in the order they were added)
+	running.swap(wantToRun);
 
 	//Check on the sleeping threads
-	if (!sleeping.empty()) {
-		CCobThread* cur = sleeping.top();
+	while (sleeping.PopExpired(GCurrentTime, waking)) {
+		numRunnableThreads += waking.size();
 
-		while ((cur != NULL) && (cur->GetWakeTime() < GCurrentTime)) {
-			// Start with removing the executing thread from the queue
-			sleeping.pop();
+		for (std::vector<CCobThread*>::iterator i = waking.begin(); i != waking.end(); ++i) {
+			CCobThread* cur = *i;
 
 			//Run forward again. This can quite possibly readd the thread to the sleeping array again
 			//But it will not interfere since it is guaranteed to sleep > 0 ms
@@ -142,13 +263,14 @@ void CCobEngine::Tick(int deltaTime)
 			} else {
 				LOG_L(L_ERROR, "Sleeping thread strange state %d", cur->state);
 			}
-
-			if (!sleeping.empty())
-				cur = sleeping.top();
-			else
-				cur = NULL;
 		}
+
+		waking.clear();
 	}
+
+	numSleepingThreads = sleeping.size();
+
+	LOG_L(L_DEBUG, "[CobEngine::%s] runnable=%u sleeping=%u", __FUNCTION__, unsigned(numRunnableThreads), unsigned(numSleepingThreads));
 }
 
 
@@ -11,8 +11,7 @@
 
 #include "CobThread.h"
 
-#include <list>
-#include <queue>
+#include <vector>
 #include <map>
 
 class CCobThread;
@@ -20,25 +19,79 @@ class CCobInstance;
 class CCobFile;
 
 
-class CCobThreadPtr_less : public std::binary_function<CCobThread*, CCobThread*, bool> {
+/**
+ * Hierarchical timer wheel holding the sleeping threads, keyed on their
+ * wake-time (in milliseconds).
+ * Threads are released in order of increasing wake-time, and in the order
+ * they were added for equal wake-times; adding a thread is O(1), and every
+ * thread is moved at most once per level before being released.
+ */
+class CCobSleepWheel
+{
 public:
-	bool operator() (const CCobThread* const& a, const CCobThread* const& b) const {
-		return a->GetWakeTime() > b->GetWakeTime();
-	}
+	CCobSleepWheel();
+
+	void AddThread(CCobThread* thread);
+	/**
+	 * Moves all threads from the earliest non-empty slot with a wake-time
+	 * smaller than time into threads.
+	 * @return false if no such threads are left
+	 */
+	bool PopExpired(int time, std::vector<CCobThread*>& threads);
+	/// Moves every thread still in the wheel into threads
+	void Clear(std::vector<CCobThread*>& threads);
+
+	size_t size() const { return numThreads; }
+	bool empty() const { return (numThreads == 0); }
+
+private:
+	void Insert(CCobThread* thread, int wakeTime);
+	void Cascade(std::vector<CCobThread*>& slot);
+	void Advance();
+
+	enum {
+		L0_BITS  =  8,
+		LN_BITS  =  6,
+		L0_SLOTS = (1 << L0_BITS),
+		LN_SLOTS = (1 << LN_BITS),
+		L1_SHIFT = L0_BITS,
+		L2_SHIFT = L0_BITS + LN_BITS,
+		L3_SHIFT = L0_BITS + LN_BITS * 2,
+	};
+
+	/// 1ms per slot
+	std::vector<CCobThread*> level0[L0_SLOTS];
+	/// 256ms per slot
+	std::vector<CCobThread*> level1[LN_SLOTS];
+	/// 16.384s per slot
+	std::vector<CCobThread*> level2[LN_SLOTS];
+	/// everything more than ~17 minutes ahead
+	std::vector<CCobThread*> overflow;
+
+	/// all threads with wake-time < curTime have been released
+	int curTime;
+	size_t numThreads;
 };
 
 
 class CCobEngine
 {
 protected:
-	std::list<CCobThread*> running;
+	std::vector<CCobThread*> running;
 	/**
 	 * Threads are added here if they are in Running.
 	 * And moved to real running after running is empty.
 	 */
-	std::list<CCobThread*> wantToRun;
-	std::priority_queue<CCobThread*, std::vector<CCobThread*>, CCobThreadPtr_less> sleeping;
+	std::vector<CCobThread*> wantToRun;
+	CCobSleepWheel sleeping;
+	/// scratch buffer for threads released from sleeping
+	std::vector<CCobThread*> waking;
 	CCobThread* curThread;
+
+	/// number of threads that ran / were asleep during the last Tick
+	size_t numRunnableThreads;
+	size_t numSleepingThreads;
+
 	void TickThread(int deltaTime, CCobThread* thread);
 public:
 	CCobEngine();
@@ -46,6 +99,9 @@ public:
 	void AddThread(CCobThread* thread);
 	void Tick(int deltaTime);
 	void ShowScriptError(const std::string& msg);
+
+	size_t GetNumRunnableThreads() const { return numRunnableThreads; }
+	size_t GetNumSleepingThreads() const { return numSleepingThreads; }
 };
 
 
@@ -6,6 +6,7 @@
 #include "CobFile.h"
 #include "CobInstance.h"
 #include "CobThread.h"
+#include "UnitScriptEngine.h"
 #include "UnitScriptLog.h"
 
 #ifndef _CONSOLE
@@ -76,15 +77,16 @@ CCobInstance::~CCobInstance()
 	//this may be dangerous, is it really desired?
 	//Destroy();
 
-	for (int animType = ATurn; animType <= AMove; animType++) {
-		for (std::list<AnimInfo *>::iterator i = anims[animType].begin(); i != anims[animType].end(); ++i) {
-			// All threads blocking on animations can be killed safely from here since the scheduler does not
-			// know about them
-			for (std::list<IAnimListener *>::iterator j = (*i)->listeners.begin(); j != (*i)->listeners.end(); ++j) {
-				delete *j;
-			}
-			// the anims are deleted in ~CUnitScript
+	for (std::vector<int>::const_iterator i = animIndices.begin(); i != animIndices.end(); ++i) {
+		std::vector<IAnimListener*>& listeners = GUnitScriptEngine.GetAnim(*i).listeners;
+
+		// All threads blocking on animations can be killed safely from here since the scheduler does not
+		// know about them
+		for (std::vector<IAnimListener*>::iterator j = listeners.begin(); j != listeners.end(); ++j) {
+			delete *j;
 		}
+		// the anims are removed in ~CUnitScript
+		listeners.clear();
 	}
 
 	// Can't delete the thread here because that would confuse the scheduler to no end
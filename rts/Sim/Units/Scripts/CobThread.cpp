@@ -14,6 +14,34 @@
 #include <sstream>
 
 
+#if !defined(USE_MMGR)
+// every unit runs several looping animation threads, which are started
+// and killed all the time; keep the memory of dead threads around and
+// hand it out again instead of going through the system allocator
+static std::vector<void*> freeThreadMem;
+
+void* CCobThread::operator new(size_t size)
+{
+	if (size != sizeof(CCobThread) || freeThreadMem.empty())
+		return ::operator new(size);
+
+	void* p = freeThreadMem.back();
+	freeThreadMem.pop_back();
+	return p;
+}
+
+void CCobThread::operator delete(void* p, size_t size)
+{
+	if (size != sizeof(CCobThread)) {
+		::operator delete(p);
+		return;
+	}
+
+	freeThreadMem.push_back(p);
+}
+#endif
+
+
 CCobThread::CCobThread(CCobFile& script, CCobInstance* owner)
 	: script(script)
 	, owner(owner)
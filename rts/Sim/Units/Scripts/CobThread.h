@@ -21,6 +21,12 @@ public:
 	/// Inform the vultures that we finally croaked
 	~CCobThread();
 
+#if !defined(USE_MMGR)
+	/// threads are recycled through a free-list, see CobThread.cpp
+	void* operator new(size_t size);
+	void operator delete(void* p, size_t size);
+#endif
+
 	/**
 	 * Returns false if this thread is dead and needs to be killed.
 	 */
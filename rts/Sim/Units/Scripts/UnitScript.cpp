@@ -83,20 +83,10 @@ CUnitScript::CUnitScript(CUnit* unit, const std::vector<LocalModelPiece*>& piece
 
 CUnitScript::~CUnitScript()
 {
-	bool haveAnimations = false;
-
-	for (int animType = ATurn; animType <= AMove; animType++) {
-		for (std::list<AnimInfo*>::iterator i = anims[animType].begin(); i != anims[animType].end(); ++i) {
-			// anim listeners are not owned by the anim in general, so don't delete them here
-			delete *i;
-		}
-
-		haveAnimations = (haveAnimations || !anims[animType].empty());
+	// anim listeners are not owned by the anim in general, so don't delete them here
+	while (!animIndices.empty()) {
+		GUnitScriptEngine.RemoveAnim(animIndices.back());
 	}
-
-	// Remove us from possible animation ticking
-	if (haveAnimations)
-		GUnitScriptEngine.RemoveInstance(this);
 }
 
 
@@ -107,227 +97,42 @@ CUnitScript::~CUnitScript()
  * @brief Unblocks all threads waiting on an animation
  * @param anim AnimInfo the corresponding animation
  */
-void CUnitScript::UnblockAll(AnimInfo* anim)
-{
-	std::list<IAnimListener *>::iterator li;
-
-	for (li = anim->listeners.begin(); li != anim->listeners.end(); ++li) {
-		(*li)->AnimFinished(anim->type, anim->piece, anim->axis);
-	}
-}
-
-
-/**
- * @brief Updates move animations
- * @param cur float value to update
- * @param dest float final value
- * @param speed float max increment per tick
- * @return returns true if destination was reached, false otherwise
- */
-bool CUnitScript::MoveToward(float &cur, float dest, float speed)
-{
-	const float delta = dest - cur;
-
-	if (math::fabsf(delta) <= speed) {
-		cur = dest;
-		return true;
-	}
-
-	if (delta > 0.0f) {
-		cur += speed;
-	} else {
-		cur -= speed;
-	}
-
-	return false;
-}
-
-
-/**
- * @brief Updates turn animations
- * @param cur float value to update
- * @param dest float final value
- * @param speed float max increment per tick
- * @return returns true if destination was reached, false otherwise
- */
-bool CUnitScript::TurnToward(float &cur, float dest, float speed)
-{
-	float delta = dest - cur;
-
-	// clamp: -pi .. 0 .. +pi (remainder(x,TWOPI) would do the same but is slower due to streflop)
-	if (delta > PI) {
-		delta -= TWOPI;
-	} else if (delta<=-PI) {
-		delta += TWOPI;
-	}
-
-	if (math::fabsf(delta) <= speed) {
-		cur = dest;
-		return true;
-	}
-
-	if (delta > 0.0f) {
-		cur += speed;
-	} else {
-		cur -= speed;
-	}
-
-	ClampRad(&cur);
-
-	return false;
-}
-
-
-/**
- * @brief Updates spin animations
- * @param cur float value to update
- * @param dest float the final desired speed (NOT the final angle!)
- * @param speed float is updated if it is not equal to dest
- * @param divisor int is the deltatime, it is not added before the call because speed may have to be updated
- * @return true if the desired speed is 0 and it is reached, false otherwise
- */
-bool CUnitScript::DoSpin(float &cur, float dest, float &speed, float accel, int divisor)
+void CUnitScript::UnblockAll(const AnimInfo& anim)
 {
-	const float delta = dest - speed;
+	std::vector<IAnimListener*>::const_iterator li;
 
-	// Check if we are not at the final speed and
-	// make sure we dont go past desired speed
-	if (math::fabsf(delta) <= accel) {
-		speed = dest;
-		if (speed == 0.0f)
-			return true;
+	for (li = anim.listeners.begin(); li != anim.listeners.end(); ++li) {
+		(*li)->AnimFinished(anim.type, anim.piece, anim.axis);
 	}
-	else {
-		if (delta > 0.0f) {
-			// accelerations are defined in speed/frame (at GAME_SPEED fps)
-			speed += accel * (float(GAME_SPEED) / divisor);
-		} else {
-			speed -= accel * (float(GAME_SPEED) / divisor);
-		}
-	}
-
-	cur += (speed / divisor);
-	ClampRad(&cur);
-
-	return false;
 }
 
 
-
-void CUnitScript::TickAnims(int deltaTime, AnimType type, std::list< std::list<AnimInfo*>::iterator >& doneAnims) {
-	switch (type) {
-		case AMove: {
-			for (std::list<AnimInfo*>::iterator it = anims[type].begin(); it != anims[type].end(); ++it) {
-				AnimInfo* ai = *it;
-
-				// NOTE: we should not need to copy-and-set here, because
-				// MoveToward/TurnToward/DoSpin modify pos/rot by reference
-				float3 pos = pieces[ai->piece]->GetPosition();
-
-				if (MoveToward(pos[ai->axis], ai->dest, ai->speed / (1000 / deltaTime))) {
-					ai->done = true; doneAnims.push_back(it);
-				}
-
-				pieces[ai->piece]->SetPosition(pos);
-			}
-		} break;
-
-		case ATurn: {
-			for (std::list<AnimInfo*>::iterator it = anims[type].begin(); it != anims[type].end(); ++it) {
-				AnimInfo* ai = *it;
-				float3 rot = pieces[ai->piece]->GetRotation();
-
-				if (TurnToward(rot[ai->axis], ai->dest, ai->speed / (1000 / deltaTime))) {
-					ai->done = true; doneAnims.push_back(it);
-				}
-
-				pieces[ai->piece]->SetRotation(rot);
-			}
-		} break;
-
-		case ASpin: {
-			for (std::list<AnimInfo*>::iterator it = anims[type].begin(); it != anims[type].end(); ++it) {
-				AnimInfo* ai = *it;
-				float3 rot = pieces[ai->piece]->GetRotation();
-
-				if (DoSpin(rot[ai->axis], ai->dest, ai->speed, ai->accel, 1000 / deltaTime)) {
-					ai->done = true; doneAnims.push_back(it);
-				}
-
-				pieces[ai->piece]->SetRotation(rot);
-			}
-		} break;
-
-		default: {
-		} break;
-	}
-}
-
-/**
- * @brief Called by the engine when we are registered as animating.
-          If we return false there are no active animations left.
- * @param deltaTime int delta time to update
- * @return true if there are still active animations
- */
-bool CUnitScript::Tick(int deltaTime)
+int CUnitScript::FindAnim(AnimType type, int piece, int axis) const
 {
-	typedef std::list<AnimInfo*>::iterator AnimInfoIt;
-
-	// list of _iterators_ to finished animations,
-	// so we can get rid of them in constant time
-	std::list<AnimInfoIt> doneAnims;
-
-	for (int animType = ATurn; animType <= AMove; animType++) {
-		TickAnims(deltaTime, AnimType(animType), doneAnims);
-	}
-
-	//! Tell listeners to unblock, and remove finished animations from the unit/script.
-	//! NOTE:
-	//!     removing a finished animation _must_ happen before notifying its listeners,
-	//!     otherwise the callback function (AnimFinished()) can call AddAnimListener()
-	//!     and append it to the listeners-list again (causing an endless loop)!
-	//! NOTE: UnblockAll might result in new anims being added
-	for (std::list<AnimInfoIt>::const_iterator it = doneAnims.begin(); it != doneAnims.end(); ++it) {
-		AnimInfoIt animInfoIt = *it;
-		AnimInfo* animInfo = *animInfoIt;
+	for (std::vector<int>::const_iterator i = animIndices.begin(); i != animIndices.end(); ++i) {
+		const AnimInfo& ai = GUnitScriptEngine.GetAnim(*i);
 
-		anims[animInfo->type].erase(animInfoIt);
-		UnblockAll(animInfo);
-		delete animInfo;
+		if ((ai.type == type) && (ai.piece == piece) && (ai.axis == axis))
+			return *i;
 	}
 
-	return (HaveAnimations());
+	return -1;
 }
 
-
-
-std::list<CUnitScript::AnimInfo*>::iterator CUnitScript::FindAnim(AnimType type, int piece, int axis)
+void CUnitScript::RemoveAnim(int animIndex)
 {
-	for (std::list<AnimInfo*>::iterator i = anims[type].begin(); i != anims[type].end(); ++i) {
-		if (((*i)->piece == piece) && ((*i)->axis == axis))
-			return i;
-	}
-
-	return anims[type].end();
-}
+	if (animIndex != -1) {
+		AnimInfo ai;
+		ai.type  = GUnitScriptEngine.GetAnim(animIndex).type;
+		ai.piece = GUnitScriptEngine.GetAnim(animIndex).piece;
+		ai.axis  = GUnitScriptEngine.GetAnim(animIndex).axis;
+		ai.listeners.swap(GUnitScriptEngine.GetAnim(animIndex).listeners);
 
-void CUnitScript::RemoveAnim(AnimType type, const std::list<AnimInfo*>::iterator& animInfoIt)
-{
-	if (animInfoIt != anims[type].end()) {
-		AnimInfo* ai = *animInfoIt;
-		anims[type].erase(animInfoIt);
- 
-		// If this was the last animation, remove from currently animating list
-		// FIXME: this could be done in a cleaner way
-		if (!HaveAnimations()) {
-			GUnitScriptEngine.RemoveInstance(this);
-		}
+		GUnitScriptEngine.RemoveAnim(animIndex);
 
 		//! We need to unblock threads waiting on this animation, otherwise they will be lost in the void
 		//! NOTE: UnblockAll might result in new anims being added
 		UnblockAll(ai);
-
-		delete ai;
 	}
 }
 
@@ -353,8 +158,7 @@ void CUnitScript::AddAnim(AnimType type, int piece, int axis, float speed, float
 		}
 	}
 
-	std::list<AnimInfo*>::iterator animInfoIt;
-	AnimInfo* ai = NULL;
+	int animIndex = -1;
 	AnimType overrideType = ANone;
 
 	// first find an animation of a type we override
@@ -364,65 +168,55 @@ void CUnitScript::AddAnim(AnimType type, int piece, int axis, float speed, float
 	switch (type) {
 		case ATurn: {
 			overrideType = ASpin;
-			animInfoIt = FindAnim(overrideType, piece, axis);
+			animIndex = FindAnim(overrideType, piece, axis);
 		} break;
 		case ASpin: {
 			overrideType = ATurn;
-			animInfoIt = FindAnim(overrideType, piece, axis);
+			animIndex = FindAnim(overrideType, piece, axis);
 		} break;
 		case AMove: {
 			// ensure we never remove an animation of this type
 			overrideType = AMove;
-			animInfoIt = anims[overrideType].end();
+			animIndex = -1;
 		} break;
 		default: {
 		} break;
 	}
 
-	if (animInfoIt != anims[overrideType].end())
-		RemoveAnim(overrideType, animInfoIt);
+	if (animIndex != -1)
+		RemoveAnim(animIndex);
 
 	// now find an animation of our own type
-	animInfoIt = FindAnim(type, piece, axis);
+	// (done after removing the overridden one, which invalidates indices)
+	animIndex = FindAnim(type, piece, axis);
 
-	if (animInfoIt == anims[type].end()) {
-		// If we were not animating before, inform the engine of this so it can schedule us
-		// FIXME: this could be done in a cleaner way
-		if (!HaveAnimations()) {
-			GUnitScriptEngine.AddInstance(this);
-		}
-
-		ai = new AnimInfo();
-		ai->type = type;
-		ai->piece = piece;
-		ai->axis = axis;
-		anims[type].push_back(ai);
-	} else {
-		ai = *animInfoIt;
+	if (animIndex == -1) {
+		animIndex = GUnitScriptEngine.AddAnim(this, type, piece, axis);
 	}
 
-	ai->dest  = destf;
-	ai->speed = speed;
-	ai->accel = accel;
-	ai->done = false;
+	AnimInfo& ai = GUnitScriptEngine.GetAnim(animIndex);
+	ai.dest  = destf;
+	ai.speed = speed;
+	ai.accel = accel;
+	ai.done = false;
 }
 
 
 void CUnitScript::Spin(int piece, int axis, float speed, float accel)
 {
-	std::list<AnimInfo*>::iterator animInfoIt = FindAnim(ASpin, piece, axis);
+	const int animIndex = FindAnim(ASpin, piece, axis);
 
 	//If we are already spinning, we may have to decelerate to the new speed
-	if (animInfoIt != anims[ASpin].end()) {
-		AnimInfo* ai = *animInfoIt;
-		ai->dest = speed;
+	if (animIndex != -1) {
+		AnimInfo& ai = GUnitScriptEngine.GetAnim(animIndex);
+		ai.dest = speed;
 
 		if (accel > 0) {
-			ai->accel = accel;
+			ai.accel = accel;
 		} else {
 			//Go there instantly. Or have a defaul accel?
-			ai->speed = speed;
-			ai->accel = 0;
+			ai.speed = speed;
+			ai.accel = 0;
 		}
 	} else {
 		//No accel means we start at desired speed instantly
@@ -436,17 +230,17 @@ void CUnitScript::Spin(int piece, int axis, float speed, float accel)
 
 void CUnitScript::StopSpin(int piece, int axis, float decel)
 {
-	std::list<AnimInfo*>::iterator animInfoIt = FindAnim(ASpin, piece, axis);
+	const int animIndex = FindAnim(ASpin, piece, axis);
 
 	if (decel <= 0) {
-		RemoveAnim(ASpin, animInfoIt);
+		RemoveAnim(animIndex);
 	} else {
-		if (animInfoIt == anims[ASpin].end())
+		if (animIndex == -1)
 			return;
 
-		AnimInfo* ai = *animInfoIt;
-		ai->dest = 0;
-		ai->accel = decel;
+		AnimInfo& ai = GUnitScriptEngine.GetAnim(animIndex);
+		ai.dest = 0;
+		ai.accel = decel;
 	}
 }
 
@@ -733,13 +527,13 @@ void CUnitScript::DropUnit(int u)
 //Returns true if there was an animation to listen to
 bool CUnitScript::AddAnimListener(AnimType type, int piece, int axis, IAnimListener *listener)
 {
-	std::list<AnimInfo*>::iterator animInfoIt = FindAnim(type, piece, axis);
+	const int animIndex = FindAnim(type, piece, axis);
 
-	if (animInfoIt != anims[type].end()) {
-		AnimInfo* ai = *animInfoIt;
+	if (animIndex != -1) {
+		AnimInfo& ai = GUnitScriptEngine.GetAnim(animIndex);
 
-		if (!ai->done) {
-			ai->listeners.push_back(listener);
+		if (!ai.done) {
+			ai.listeners.push_back(listener);
 			return true;
 		}
 
@@ -752,7 +546,7 @@ bool CUnitScript::AddAnimListener(AnimType type, int piece, int axis, IAnimListe
 		// is to treat the animation as if it did not exist and
 		// simply disregard the WaitFor* (no side-effects)
 		//
-		// listener->AnimFinished(ai->type, ai->piece, ai->axis);
+		// listener->AnimFinished(ai.type, ai.piece, ai.axis);
 	}
 
 	return false;
@@ -7,7 +7,6 @@
 
 #include <string>
 #include <vector>
-#include <list>
 
 #include "System/Object.h"
 #include "Rendering/Models/3DModel.h"
@@ -19,6 +18,8 @@ class CPlasmaRepulser;
 
 class CUnitScript : public CObject
 {
+	friend class CUnitScriptEngine;
+
 public:
 	enum AnimType {ANone = -1, ATurn = 0, ASpin = 1, AMove = 2};
 
@@ -63,6 +64,7 @@ protected:
 	bool yardOpen;
 	bool busy;
 
+	/// entry in GUnitScriptEngine's animation table
 	struct AnimInfo {
 		AnimType type;
 		int axis;
@@ -71,23 +73,23 @@ protected:
 		float dest;     // means final position when turning or moving, final speed when spinning
 		float accel;    // used for spinning, can be negative
 		bool done;
-		std::list<IAnimListener*> listeners;
+		CUnitScript* script;
+		int scriptIndex; // position of this anim in script->animIndices
+		std::vector<IAnimListener*> listeners;
 	};
 
-	std::list<AnimInfo*> anims[AMove + 1];
+	/// indices of our animations in GUnitScriptEngine's animation table
+	std::vector<int> animIndices;
 
 	bool hasSetSFXOccupy;
 	bool hasRockUnit;
 	bool hasStartBuilding;
 
-	void UnblockAll(AnimInfo* anim);
-
-	bool MoveToward(float &cur, float dest, float speed);
-	bool TurnToward(float &cur, float dest, float speed);
-	bool DoSpin(float &cur, float dest, float &speed, float accel, int divisor);
+	static void UnblockAll(const AnimInfo& anim);
 
-	std::list<AnimInfo*>::iterator FindAnim(AnimType anim, int piece, int axis);
-	void RemoveAnim(AnimType type, const std::list<AnimInfo*>::iterator& animInfoIt);
+	/// @return index into the animation table, or -1 if not animating
+	int FindAnim(AnimType anim, int piece, int axis) const;
+	void RemoveAnim(int animIndex);
 	void AddAnim(AnimType type, int piece, int axis, float speed, float dest, float accel);
 
 	virtual void ShowScriptError(const std::string& msg) = 0;
@@ -140,9 +142,6 @@ public:
 	      CUnit* GetUnit()       { return unit; }
 	const CUnit* GetUnit() const { return unit; }
 
-	bool Tick(int deltaTime);
-	void TickAnims(int deltaTime, AnimType type, std::list< std::list<AnimInfo*>::iterator >& doneAnims);
-
 	// animation, used by CCobThread
 	void Spin(int piece, int axis, float speed, float accel);
 	void StopSpin(int piece, int axis, float decel);
@@ -164,11 +163,11 @@ public:
 	int GetUnitVal(int val, int p1, int p2, int p3, int p4);
 	void SetUnitVal(int val, int param);
 
-	bool IsInAnimation(AnimType type, int piece, int axis) {
-		return (FindAnim(type, piece, axis) != anims[type].end());
+	bool IsInAnimation(AnimType type, int piece, int axis) const {
+		return (FindAnim(type, piece, axis) != -1);
 	}
 	bool HaveAnimations() const {
-		return (!anims[ATurn].empty() || !anims[ASpin].empty() || !anims[AMove].empty());
+		return (!animIndices.empty());
 	}
 
 	// checks for callin existence
@@ -6,6 +6,9 @@
 #include "UnitScript.h"
 #include "UnitScriptLog.h"
 
+#include "Sim/Misc/GlobalConstants.h"
+#include "System/FastMath.h"
+#include "System/myMath.h"
 #include "System/FileSystem/FileHandler.h"
 
 #ifndef _CONSOLE
@@ -26,7 +29,7 @@ CUnitScriptEngine GUnitScriptEngine;
 /******************************************************************************/
 
 
-CUnitScriptEngine::CUnitScriptEngine() : currentScript(NULL)
+CUnitScriptEngine::CUnitScriptEngine()
 {
 }
 
@@ -36,61 +39,271 @@ CUnitScriptEngine::~CUnitScriptEngine()
 }
 
 
-void CUnitScriptEngine::CheckForDuplicates(const char* name, CUnitScript* instance)
+void CUnitScriptEngine::MoveAnimInfo(AnimInfo& dst, AnimInfo& src)
 {
-	int found = 0;
+	dst.type        = src.type;
+	dst.axis        = src.axis;
+	dst.piece       = src.piece;
+	dst.speed       = src.speed;
+	dst.dest        = src.dest;
+	dst.accel       = src.accel;
+	dst.done        = src.done;
+	dst.script      = src.script;
+	dst.scriptIndex = src.scriptIndex;
 
-	for (std::list<CUnitScript*>::iterator i = animating.begin(); i != animating.end(); ++i) {
-		if (*i == instance)
-			found++;
+	dst.listeners.clear();
+	dst.listeners.swap(src.listeners);
+}
+
+
+/**
+ * @brief Updates move animations
+ * @param cur float value to update
+ * @param dest float final value
+ * @param speed float max increment per tick
+ * @return returns true if destination was reached, false otherwise
+ */
+bool CUnitScriptEngine::MoveToward(float &cur, float dest, float speed)
+{
+	const float delta = dest - cur;
+
+	if (math::fabsf(delta) <= speed) {
+		cur = dest;
+		return true;
 	}
 
-	if (found > 1)
-		LOG_L(L_WARNING, "%s found duplicates %d", name, found);
+	if (delta > 0.0f) {
+		cur += speed;
+	} else {
+		cur -= speed;
+	}
+
+	return false;
 }
 
 
-void CUnitScriptEngine::AddInstance(CUnitScript *instance)
+/**
+ * @brief Updates turn animations
+ * @param cur float value to update
+ * @param dest float final value
+ * @param speed float max increment per tick
+ * @return returns true if destination was reached, false otherwise
+ */
+bool CUnitScriptEngine::TurnToward(float &cur, float dest, float speed)
 {
-	if (instance != currentScript)
-		animating.push_front(instance);
+	float delta = dest - cur;
 
-	// Error checking
-#ifdef _DEBUG
-	CheckForDuplicates(__FUNCTION__, instance);
-#endif
+	// clamp: -pi .. 0 .. +pi (remainder(x,TWOPI) would do the same but is slower due to streflop)
+	if (delta > PI) {
+		delta -= TWOPI;
+	} else if (delta<=-PI) {
+		delta += TWOPI;
+	}
+
+	if (math::fabsf(delta) <= speed) {
+		cur = dest;
+		return true;
+	}
+
+	if (delta > 0.0f) {
+		cur += speed;
+	} else {
+		cur -= speed;
+	}
+
+	ClampRad(&cur);
+
+	return false;
 }
 
 
-void CUnitScriptEngine::RemoveInstance(CUnitScript *instance)
+/**
+ * @brief Updates spin animations
+ * @param cur float value to update
+ * @param dest float the final desired speed (NOT the final angle!)
+ * @param speed float is updated if it is not equal to dest
+ * @param divisor int is the deltatime, it is not added before the call because speed may have to be updated
+ * @return true if the desired speed is 0 and it is reached, false otherwise
+ */
+bool CUnitScriptEngine::DoSpin(float &cur, float dest, float &speed, float accel, int divisor)
 {
-	// Error checking
-#ifdef _DEBUG
-	CheckForDuplicates(__FUNCTION__, instance);
-#endif
+	const float delta = dest - speed;
 
-	//This is slow. would be better if instance was a hashlist perhaps
-	if (instance != currentScript)
-		animating.remove(instance);
+	// Check if we are not at the final speed and
+	// make sure we dont go past desired speed
+	if (math::fabsf(delta) <= accel) {
+		speed = dest;
+		if (speed == 0.0f)
+			return true;
+	}
+	else {
+		if (delta > 0.0f) {
+			// accelerations are defined in speed/frame (at GAME_SPEED fps)
+			speed += accel * (float(GAME_SPEED) / divisor);
+		} else {
+			speed -= accel * (float(GAME_SPEED) / divisor);
+		}
+	}
+
+	cur += (speed / divisor);
+	ClampRad(&cur);
+
+	return false;
 }
 
 
-void CUnitScriptEngine::Tick(int deltaTime)
+int CUnitScriptEngine::AddAnim(CUnitScript* script, AnimType type, int piece, int axis)
 {
-	SCOPED_TIMER("UnitScriptEngine::Tick");
+	const int animIndex = anims.size();
 
-	// Tick all instances that have registered themselves as animating
-	for (std::list<CUnitScript*>::iterator it = animating.begin(); it != animating.end(); ) {
-		currentScript = *it;
+	anims.push_back(AnimInfo());
 
-		if (currentScript->Tick(deltaTime)) {
-			++it;
-		} else {
-			it = animating.erase(it);
+	AnimInfo& ai = anims.back();
+	ai.type = type;
+	ai.axis = axis;
+	ai.piece = piece;
+	ai.speed = 0.0f;
+	ai.dest = 0.0f;
+	ai.accel = 0.0f;
+	ai.done = false;
+	ai.script = script;
+	ai.scriptIndex = script->animIndices.size();
+
+	script->animIndices.push_back(animIndex);
+	return animIndex;
+}
+
+
+void CUnitScriptEngine::RemoveAnim(int animIndex)
+{
+	AnimInfo& ai = anims[animIndex];
+	CUnitScript* script = ai.script;
+
+	// unlink from the owning script (order there does not matter)
+	std::vector<int>& scriptAnims = script->animIndices;
+	const int lastScriptIndex = scriptAnims.size() - 1;
+
+	if (ai.scriptIndex != lastScriptIndex) {
+		scriptAnims[ai.scriptIndex] = scriptAnims[lastScriptIndex];
+		anims[scriptAnims[ai.scriptIndex]].scriptIndex = ai.scriptIndex;
+	}
+
+	scriptAnims.pop_back();
+
+	// fill the gap in the table with its last entry
+	const int lastAnimIndex = anims.size() - 1;
+
+	if (animIndex != lastAnimIndex) {
+		MoveAnimInfo(ai, anims[lastAnimIndex]);
+		ai.script->animIndices[ai.scriptIndex] = animIndex;
+	}
+
+	anims.pop_back();
+}
+
+
+void CUnitScriptEngine::TickAnims(int deltaTime)
+{
+	const int tickRate = (1000 / deltaTime);
+
+	// NOTE: this is not split into per-type SIMD passes over separate arrays;
+	// the results have to end up in the pieces anyway, and doing the math on
+	// arrays and then storing it there measured slower than this single pass
+	// (see test/engine/Sim/Units/Scripts/TestUnitScriptEngine.cpp)
+	for (std::vector<AnimInfo>::iterator it = anims.begin(); it != anims.end(); ++it) {
+		AnimInfo& ai = *it;
+		LocalModelPiece* lmp = ai.script->pieces[ai.piece];
+
+		// NOTE: we should not need to copy-and-set here, because
+		// MoveToward/TurnToward/DoSpin modify pos/rot by reference
+		switch (ai.type) {
+			case CUnitScript::AMove: {
+				float3 pos = lmp->GetPosition();
+				ai.done = MoveToward(pos[ai.axis], ai.dest, ai.speed / tickRate);
+				lmp->SetPosition(pos);
+			} break;
+
+			case CUnitScript::ATurn: {
+				float3 rot = lmp->GetRotation();
+				ai.done = TurnToward(rot[ai.axis], ai.dest, ai.speed / tickRate);
+				lmp->SetRotation(rot);
+			} break;
+
+			case CUnitScript::ASpin: {
+				float3 rot = lmp->GetRotation();
+				ai.done = DoSpin(rot[ai.axis], ai.dest, ai.speed, ai.accel, tickRate);
+				lmp->SetRotation(rot);
+			} break;
+
+			default: {
+			} break;
 		}
 	}
+}
+
+
+void CUnitScriptEngine::RemoveFinishedAnims()
+{
+	// compact the table in a single stable pass; finished anims are
+	// moved to finishedAnims so their listeners can be notified once
+	// the table is consistent again
+	size_t numAnims = 0;
+
+	for (size_t n = 0; n < anims.size(); n++) {
+		AnimInfo& ai = anims[n];
+
+		if (ai.done) {
+			std::vector<int>& scriptAnims = ai.script->animIndices;
+			const int lastScriptIndex = scriptAnims.size() - 1;
+
+			// entries before n have already been moved and their indices
+			// updated, entries after n are still at their old positions
+			if (ai.scriptIndex != lastScriptIndex) {
+				scriptAnims[ai.scriptIndex] = scriptAnims[lastScriptIndex];
+				anims[scriptAnims[ai.scriptIndex]].scriptIndex = ai.scriptIndex;
+			}
+
+			scriptAnims.pop_back();
+
+			finishedAnims.push_back(AnimInfo());
+			MoveAnimInfo(finishedAnims.back(), ai);
+			continue;
+		}
+
+		if (n != numAnims) {
+			MoveAnimInfo(anims[numAnims], ai);
+			anims[numAnims].script->animIndices[anims[numAnims].scriptIndex] = numAnims;
+		}
+
+		numAnims++;
+	}
+
+	anims.resize(numAnims);
+}
+
+
+void CUnitScriptEngine::NotifyFinishedAnims()
+{
+	//! NOTE:
+	//!     removing a finished animation _must_ happen before notifying its listeners,
+	//!     otherwise the callback function (AnimFinished()) can call AddAnimListener()
+	//!     and append it to the listeners-list again (causing an endless loop)!
+	//! NOTE: UnblockAll might result in new anims being added
+	for (std::vector<AnimInfo>::const_iterator it = finishedAnims.begin(); it != finishedAnims.end(); ++it) {
+		CUnitScript::UnblockAll(*it);
+	}
+
+	finishedAnims.clear();
+}
+
+
+void CUnitScriptEngine::Tick(int deltaTime)
+{
+	SCOPED_TIMER("UnitScriptEngine::Tick");
 
-	currentScript = NULL;
+	TickAnims(deltaTime);
+	RemoveFinishedAnims();
+	NotifyFinishedAnims();
 }
 
 
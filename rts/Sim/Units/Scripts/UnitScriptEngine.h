@@ -5,27 +5,56 @@
 #ifndef UNIT_SCRIPT_ENGINE_H
 #define UNIT_SCRIPT_ENGINE_H
 
-#include <list>
+#include <vector>
 
-class CUnit;
-class CUnitScript;
+#include "UnitScript.h"
 
 
+/**
+ * Owns the Turn/Spin/Move animations of all unit scripts in a single
+ * contiguous table, which is advanced in one pass per Tick.
+ * Scripts refer to their entries by index (CUnitScript::animIndices).
+ */
 class CUnitScriptEngine
 {
-protected:
-	std::list<CUnitScript*> animating; // hash would be optimal, but not crucial
-	void CheckForDuplicates(const char* name, CUnitScript* instance);
-
 public:
+	typedef CUnitScript::AnimInfo AnimInfo;
+	typedef CUnitScript::AnimType AnimType;
+
 	CUnitScriptEngine();
 	~CUnitScriptEngine();
-	void AddInstance(CUnitScript* instance);
-	void RemoveInstance(CUnitScript* instance);
+
+	/// appends a new animation for script, returns its index
+	int AddAnim(CUnitScript* script, AnimType type, int piece, int axis);
+	/**
+	 * Removes an animation without notifying its listeners.
+	 * The last entry of the table takes its place, so any index
+	 * obtained before this call must be considered invalid.
+	 */
+	void RemoveAnim(int animIndex);
+
+	      AnimInfo& GetAnim(int animIndex)       { return anims[animIndex]; }
+	const AnimInfo& GetAnim(int animIndex) const { return anims[animIndex]; }
+
+	size_t GetNumAnims() const { return anims.size(); }
+
 	void Tick(int deltaTime);
 
+	/// the per-tick steps of the Move, Turn and Spin animations
+	static bool MoveToward(float &cur, float dest, float speed);
+	static bool TurnToward(float &cur, float dest, float speed);
+	static bool DoSpin(float &cur, float dest, float &speed, float accel, int divisor);
+
 private:
-	CUnitScript* currentScript;
+	static void MoveAnimInfo(AnimInfo& dst, AnimInfo& src);
+
+	void TickAnims(int deltaTime);
+	void RemoveFinishedAnims();
+	void NotifyFinishedAnims();
+
+	std::vector<AnimInfo> anims;
+	/// anims that completed during the current Tick, notified in table order
+	std::vector<AnimInfo> finishedAnims;
 };
 
 extern CUnitScriptEngine GUnitScriptEngine;
@@ -567,6 +567,7 @@ void CUnit::ForcedMove(const float3& newPos)
 	}
 
 	qf->MovedUnit(this);
+	qf->JumpedUnit(this);
 	loshandler->MoveUnit(this, false);
 	radarhandler->MoveUnit(this);
 }
@@ -1,5 +1,6 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
+#include <algorithm>
 #include <cassert>
 #include "System/mmgr.h"
 
@@ -37,11 +38,22 @@
 
 CUnitHandler* uh = NULL;
 
+typedef CSlotMap<CUnit*> CUnitIDMap;
+
+CR_BIND_TEMPLATE(CUnitIDMap, )
+CR_REG_METADATA(CUnitIDMap, (
+	CR_MEMBER(values),
+	CR_MEMBER(generations),
+	CR_MEMBER(nextFree),
+	CR_MEMBER(numUsed),
+	CR_MEMBER(freeHead),
+	CR_MEMBER(freeTail)
+));
+
 CR_BIND(CUnitHandler, );
 CR_REG_METADATA(CUnitHandler, (
 	CR_MEMBER(activeUnits),
 	CR_MEMBER(units),
-	CR_MEMBER(freeUnitIDs),
 	CR_MEMBER(maxUnits),
 	CR_MEMBER(maxUnitRadius),
 	CR_MEMBER(unitsToBeRemoved),
@@ -74,13 +86,12 @@ CUnitHandler::CUnitHandler()
 		maxUnits += teamHandler->Team(n)->maxUnits;
 	}
 
-	units.resize(maxUnits, NULL);
 	unitsByDefs.resize(teamHandler->ActiveTeams(), std::vector<CUnitSet>(unitDefHandler->unitDefs.size()));
 
 	{
-		std::vector<unsigned int> freeIDs(units.size());
+		std::vector<int> freeIDs(maxUnits);
 
-		// id's are used as indices, so they must lie in [0, units.size() - 1]
+		// id's are used as indices, so they must lie in [0, maxUnits - 1]
 		// (furthermore all id's are treated equally, none have special status)
 		for (unsigned int id = 0; id < freeIDs.size(); id++) {
 			freeIDs[id] = id;
@@ -93,7 +104,9 @@ CUnitHandler::CUnitHandler()
 
 		std::random_shuffle(freeIDs.begin(), freeIDs.end(), rng);
 		std::random_shuffle(freeIDs.begin(), freeIDs.end(), rng);
-		std::copy(freeIDs.begin(), freeIDs.end(), std::front_inserter(freeUnitIDs));
+		std::reverse(freeIDs.begin(), freeIDs.end());
+
+		units.AddSlots(freeIDs);
 	}
 
 	slowUpdateIterator = activeUnits.end();
@@ -115,7 +128,7 @@ CUnitHandler::~CUnitHandler()
 
 bool CUnitHandler::AddUnit(CUnit *unit)
 {
-	if (freeUnitIDs.empty()) {
+	if (units.GetNumFree() == 0) {
 		// should be unreachable (all code that goes through
 		// UnitLoader::LoadUnit --> Unit::PreInit checks the
 		// unit limit first)
@@ -123,8 +136,7 @@ bool CUnitHandler::AddUnit(CUnit *unit)
 		return false;
 	}
 
-	unit->id = freeUnitIDs.front();
-	units[unit->id] = unit;
+	unit->id = units.Insert(unit);
 
 	std::list<CUnit*>::iterator ui = activeUnits.begin();
 
@@ -139,7 +151,6 @@ bool CUnitHandler::AddUnit(CUnit *unit)
 	}
 
 	activeUnits.insert(ui, unit);
-	freeUnitIDs.pop_front();
 
 	teamHandler->Team(unit->team)->AddUnit(unit, CTeam::AddBuilt);
 	unitsByDefs[unit->team][unit->unitDef->id].insert(unit);
@@ -174,8 +185,7 @@ void CUnitHandler::DeleteUnitNow(CUnit* delUnit)
 			#endif
 
 			activeUnits.erase(usi);
-			units[delUnit->id] = 0;
-			freeUnitIDs.push_back(delUnit->id);
+			units.Erase(delUnit->id);
 			teamHandler->Team(delTeam)->RemoveUnit(delUnit, CTeam::RemoveDied);
 
 			unitsByDefs[delTeam][delType].erase(delUnit);
@@ -254,6 +264,11 @@ void CUnitHandler::Update()
 
 	{
 		SCOPED_TIMER("Unit::MoveType::Update");
+
+		// the parallel part of the movement, the collisions found
+		// there are resolved one unit after another in Update()
+		AMoveType::PrepareUpdates(activeUnits);
+
 		std::list<CUnit*>::iterator usi;
 		for (usi = activeUnits.begin(); usi != activeUnits.end(); ++usi) {
 			CUnit* unit = *usi;
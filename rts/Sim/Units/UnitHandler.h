@@ -9,6 +9,7 @@
 #include "UnitDef.h"
 #include "UnitSet.h"
 #include "CommandAI/Command.h"
+#include "System/SlotMap.h"
 
 class CUnit;
 class CBuilderCAI;
@@ -69,14 +70,13 @@ public:
 	std::vector< std::vector<CUnitSet> > unitsByDefs; ///< units sorted by team and unitDef
 
 	std::list<CUnit*> activeUnits;                    ///< used to get all active units
-	std::vector<CUnit*> units;                        ///< used to get units from IDs (0 if not created)
+	CSlotMap<CUnit*> units;                           ///< used to get units from IDs (0 if not created), hands out the IDs
 	std::list<CBuilderCAI*> builderCAIs;
 
 	float maxUnitRadius;                              ///< largest radius of any unit added so far
 	bool morphUnitToFeature;
 
 private:
-	std::list<unsigned int> freeUnitIDs;
 	std::vector<CUnit*> unitsToBeRemoved;            ///< units that will be removed at start of next update
 	std::list<CUnit*>::iterator slowUpdateIterator;
 
@@ -326,17 +326,20 @@ void CBuilder::Update()
 						}
 						u->health *= 0.05f;
 
-						CBuilderCAI *cai = (CBuilderCAI *)commandAI;
-						for (CUnitSet::iterator it = cai->resurrecters.begin(); it != cai->resurrecters.end(); ++it) {
-							CBuilder *bld = (CBuilder *)*it;
-							if (bld->commandAI->commandQue.empty())
-								continue;
-							const Command& c = bld->commandAI->commandQue.front();
-							if (c.GetID() != CMD_RESURRECT || c.params.size() != 1)
-								continue;
-							const int cmdFeatureId = (int)c.params[0];
-							if (cmdFeatureId - uh->MaxUnits() == curResurrect->id && teamHandler->Ally(allyteam, bld->allyteam))
-								bld->lastResurrected = u->id; // all units that were rezzing shall assist the repair too
+						const CTargetReservations::WorkerSet* rezzers = CBuilderCAI::resurrecters.GetWorkers(curResurrect->id);
+						// all units that were rezzing shall assist the repair too
+						if (rezzers != NULL) {
+							for (CTargetReservations::WorkerSet::const_iterator it = rezzers->begin(); it != rezzers->end(); ++it) {
+								CBuilder *bld = (CBuilder *)uh->GetUnitUnsafe(*it);
+								if (bld == NULL || bld->commandAI->commandQue.empty())
+									continue;
+								const Command& c = bld->commandAI->commandQue.front();
+								if (c.GetID() != CMD_RESURRECT || c.params.size() != 1)
+									continue;
+								const int cmdFeatureId = (int)c.params[0];
+								if ((cmdFeatureId - static_cast<int>(uh->MaxUnits())) == curResurrect->id && teamHandler->Ally(allyteam, bld->allyteam))
+									bld->lastResurrected = u->id;
+							}
 						}
 
 						curResurrect->resurrectProgress=0;
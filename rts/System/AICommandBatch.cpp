@@ -0,0 +1,210 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/AICommandBatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <boost/cstdint.hpp>
+
+#include "System/mmgr.h"
+
+#include "System/BaseNetProtocol.h"
+#include "System/Net/PackPacket.h"
+#include "System/Net/UnpackPacket.h"
+
+const unsigned int CAICommandBatch::MAX_PACKET_SIZE;
+const unsigned int CAICommandBatch::MAX_PARAMS;
+const unsigned int CAICommandBatch::MAX_DELTA_PARAMS;
+const float CAICommandBatch::DELTA_SCALE = 0.125f;
+
+/// header: msgID, size, playerNum, cmdID, options, numParams, numDeltaParams, numUnits
+static const unsigned int HEADER_SIZE = 1 + 2 + 1 + 4 + 1 + 1 + 1 + 2;
+
+
+static inline bool SameBits(float a, float b)
+{
+	return (std::memcmp(&a, &b, sizeof(float)) == 0);
+}
+
+/// used by both, sender and receivers, so they get the same result
+static float DecodeParam(float base, short delta)
+{
+	return (base + delta * CAICommandBatch::DELTA_SCALE);
+}
+
+static bool EncodeParam(float base, float param, short* delta)
+{
+	const float scaled = (param - base) / CAICommandBatch::DELTA_SCALE;
+
+	// also false for NaN
+	if (!(scaled >= -32768.0f && scaled <= 32767.0f))
+		return false;
+
+	*delta = static_cast<short>(std::floor(scaled + 0.5f));
+
+	// only accept params that are not changed by the transfer
+	return SameBits(DecodeParam(base, *delta), param);
+}
+
+
+CAICommandBatch::CAICommandBatch()
+	: playerNum(0)
+	, cmdID(0)
+	, options(0)
+	, numParams(0)
+	, numDeltaParams(0)
+{
+}
+
+void CAICommandBatch::Clear()
+{
+	unitIDs.clear();
+	deltas.clear();
+	numParams = 0;
+	numDeltaParams = 0;
+}
+
+size_t CAICommandBatch::GetPacketSize(size_t numUnits, unsigned int numDeltas) const
+{
+	return (HEADER_SIZE + (numParams * sizeof(float)) + numUnits * (sizeof(short) * (1 + numDeltas)));
+}
+
+
+bool CAICommandBatch::Add(unsigned char cmdPlayerNum, short unitID, int cmdCmdID, unsigned char cmdOptions, const float* cmdParams, unsigned int cmdNumParams)
+{
+	if (cmdNumParams > MAX_PARAMS)
+		return false;
+
+	if (unitIDs.empty()) {
+		// the first order becomes the template
+		playerNum = cmdPlayerNum;
+		cmdID = cmdCmdID;
+		options = cmdOptions;
+		numParams = cmdNumParams;
+		numDeltaParams = 0;
+		std::copy(cmdParams, cmdParams + cmdNumParams, params);
+
+		unitIDs.push_back(unitID);
+		deltas.clear();
+		return true;
+	}
+
+	if (cmdPlayerNum != playerNum || cmdCmdID != cmdID || cmdOptions != options || cmdNumParams != numParams)
+		return false;
+
+	const unsigned int maxDeltaParams = std::min(numParams, MAX_DELTA_PARAMS);
+
+	short unitDeltas[MAX_DELTA_PARAMS] = {0};
+	bool needDeltas = false;
+
+	for (unsigned int i = 0; i < numParams; ++i) {
+		if (SameBits(cmdParams[i], params[i]))
+			continue;
+		if (i >= maxDeltaParams)
+			return false;
+		if (!EncodeParam(params[i], cmdParams[i], &unitDeltas[i]))
+			return false;
+
+		needDeltas = true;
+	}
+
+	const unsigned int newNumDeltaParams = (needDeltas)? maxDeltaParams: numDeltaParams;
+
+	if (GetPacketSize(unitIDs.size() + 1, newNumDeltaParams) > MAX_PACKET_SIZE)
+		return false;
+
+	if (newNumDeltaParams != numDeltaParams) {
+		// all orders so far were equal to the template
+		deltas.assign(unitIDs.size() * newNumDeltaParams, 0);
+		numDeltaParams = newNumDeltaParams;
+	}
+
+	unitIDs.push_back(unitID);
+	deltas.insert(deltas.end(), unitDeltas, unitDeltas + numDeltaParams);
+	return true;
+}
+
+
+boost::shared_ptr<const netcode::RawPacket> CAICommandBatch::Pack() const
+{
+	const size_t size = GetPacketSize();
+
+	netcode::PackPacket* packet = new netcode::PackPacket(size, NETMSG_AICOMMANDS_BATCH);
+	*packet << static_cast<boost::uint16_t>(size) << playerNum << cmdID << options;
+	*packet << static_cast<unsigned char>(numParams);
+
+	for (unsigned int i = 0; i < numParams; ++i) {
+		*packet << params[i];
+	}
+
+	*packet << static_cast<unsigned char>(numDeltaParams) << static_cast<boost::uint16_t>(unitIDs.size());
+
+	for (size_t n = 0; n < unitIDs.size(); ++n) {
+		*packet << unitIDs[n];
+
+		for (unsigned int i = 0; i < numDeltaParams; ++i) {
+			*packet << deltas[n * numDeltaParams + i];
+		}
+	}
+
+	return boost::shared_ptr<const netcode::RawPacket>(packet);
+}
+
+void CAICommandBatch::Unpack(boost::shared_ptr<const netcode::RawPacket> packet)
+{
+	Clear();
+
+	netcode::UnpackPacket pckt(packet, 1);
+
+	boost::uint16_t size;
+	pckt >> size;
+	if (size != packet->length)
+		throw netcode::UnpackPacketException("Invalid message size");
+
+	pckt >> playerNum;
+	pckt >> cmdID;
+	pckt >> options;
+
+	unsigned char packetNumParams;
+	pckt >> packetNumParams;
+	if (packetNumParams > MAX_PARAMS)
+		throw netcode::UnpackPacketException("Too many command params");
+
+	numParams = packetNumParams;
+
+	for (unsigned int i = 0; i < numParams; ++i) {
+		pckt >> params[i];
+	}
+
+	unsigned char packetNumDeltaParams;
+	boost::uint16_t numUnits;
+	pckt >> packetNumDeltaParams;
+	pckt >> numUnits;
+
+	if (packetNumDeltaParams > std::min(numParams, MAX_DELTA_PARAMS))
+		throw netcode::UnpackPacketException("Too many delta params");
+	if (numUnits == 0 || GetPacketSize(numUnits, packetNumDeltaParams) != size)
+		throw netcode::UnpackPacketException("Invalid number of units");
+
+	numDeltaParams = packetNumDeltaParams;
+	unitIDs.resize(numUnits);
+	deltas.resize(numUnits * numDeltaParams);
+
+	for (size_t n = 0; n < numUnits; ++n) {
+		pckt >> unitIDs[n];
+
+		for (unsigned int i = 0; i < numDeltaParams; ++i) {
+			pckt >> deltas[n * numDeltaParams + i];
+		}
+	}
+}
+
+void CAICommandBatch::GetUnitParams(size_t n, float* unitParams) const
+{
+	std::copy(params, params + numParams, unitParams);
+
+	for (unsigned int i = 0; i < numDeltaParams; ++i) {
+		unitParams[i] = DecodeParam(params[i], deltas[n * numDeltaParams + i]);
+	}
+}
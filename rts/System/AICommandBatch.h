@@ -0,0 +1,79 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef AI_COMMAND_BATCH_H
+#define AI_COMMAND_BATCH_H
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+namespace netcode
+{
+	class RawPacket;
+}
+
+/**
+ * Collects consecutive orders for single units (as given by AIs and
+ * Spring.GiveOrderToUnit) into one NETMSG_AICOMMANDS_BATCH message.
+ *
+ * A batch holds one command template (the first order) plus the unitID of
+ * every ordered unit. When the orders differ in their first
+ * MAX_DELTA_PARAMS params (usually a position), each unit also gets a
+ * short delta per param, in steps of DELTA_SCALE elmos.
+ * Orders are only accepted when their params are decoded back bit-exactly,
+ * so every client applies the same commands as if they were sent one by one.
+ */
+class CAICommandBatch
+{
+public:
+	/// same limit as the NETMSG_AICOMMANDS packets of CSelectedUnits
+	static const unsigned int MAX_PACKET_SIZE = 8192;
+	static const unsigned int MAX_PARAMS = 16;
+	static const unsigned int MAX_DELTA_PARAMS = 3;
+	static const float DELTA_SCALE;
+
+	CAICommandBatch();
+
+	/**
+	 * @brief Append the order for one unit
+	 * @return false if the order does not fit into this batch (e.g. another
+	 *   command, params too far away or the packet would become too big),
+	 *   then the batch has to be sent and cleared first
+	 *   (an empty batch accepts all orders with at most MAX_PARAMS params)
+	 */
+	bool Add(unsigned char playerNum, short unitID, int cmdID, unsigned char options, const float* params, unsigned int numParams);
+	void Clear();
+
+	bool Empty() const { return unitIDs.empty(); }
+	size_t GetNumUnits() const { return unitIDs.size(); }
+	size_t GetPacketSize() const { return GetPacketSize(unitIDs.size(), numDeltaParams); }
+
+	/// @return a NETMSG_AICOMMANDS_BATCH message holding all orders
+	boost::shared_ptr<const netcode::RawPacket> Pack() const;
+	/// @throws netcode::UnpackPacketException if the message is invalid
+	void Unpack(boost::shared_ptr<const netcode::RawPacket> packet);
+
+	unsigned char GetPlayerNum() const { return playerNum; }
+	int GetCommandID() const { return cmdID; }
+	unsigned char GetOptions() const { return options; }
+	unsigned int GetNumParams() const { return numParams; }
+	short GetUnitID(size_t n) const { return unitIDs[n]; }
+	/// writes GetNumParams() params of the order for the n-th unit
+	void GetUnitParams(size_t n, float* unitParams) const;
+
+private:
+	size_t GetPacketSize(size_t numUnits, unsigned int numDeltas) const;
+
+private:
+	unsigned char playerNum;
+	int cmdID;
+	unsigned char options;
+	unsigned int numParams;
+	unsigned int numDeltaParams;
+	float params[MAX_PARAMS];
+
+	std::vector<short> unitIDs;
+	/// numDeltaParams entries per unit
+	std::vector<short> deltas;
+};
+
+#endif // AI_COMMAND_BATCH_H
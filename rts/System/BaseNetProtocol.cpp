@@ -90,11 +90,14 @@ PacketType CBaseNetProtocol::SendPathCheckSum(uchar myPlayerNum, boost::uint32_t
 }
 
 
-PacketType CBaseNetProtocol::SendCommand(uchar myPlayerNum, int id, uchar options, const std::vector<float>& params)
+PacketType CBaseNetProtocol::SendCommand(uchar myPlayerNum, int id, uchar options, const float* params, size_t numParams)
 {
-	unsigned size = 9 + params.size() * sizeof(float);
+	unsigned size = 9 + numParams * sizeof(float);
 	PackPacket* packet = new PackPacket(size, NETMSG_COMMAND);
-	*packet << static_cast<unsigned short>(size) << myPlayerNum << id << options << params;
+	*packet << static_cast<unsigned short>(size) << myPlayerNum << id << options;
+	for (size_t i = 0; i < numParams; ++i) {
+		*packet << params[i];
+	}
 	return PacketType(packet);
 }
 
@@ -116,10 +119,10 @@ PacketType CBaseNetProtocol::SendPause(uchar myPlayerNum, uchar bPaused)
 
 
 
-PacketType CBaseNetProtocol::SendAICommand(uchar myPlayerNum, short unitID, int id, int aiCommandId, uchar options, const std::vector<float>& params)
+PacketType CBaseNetProtocol::SendAICommand(uchar myPlayerNum, short unitID, int id, int aiCommandId, uchar options, const float* params, size_t numParams)
 {
 	int cmdTypeId = NETMSG_AICOMMAND;
-	unsigned size = 11 + (params.size() * sizeof(float));
+	unsigned size = 11 + (numParams * sizeof(float));
 	if (aiCommandId != -1) {
 		cmdTypeId = NETMSG_AICOMMAND_TRACKED;
 		size += 4;
@@ -129,7 +132,9 @@ PacketType CBaseNetProtocol::SendAICommand(uchar myPlayerNum, short unitID, int
 	if (cmdTypeId == NETMSG_AICOMMAND_TRACKED) {
 		*packet << aiCommandId;
 	}
-	*packet << params;
+	for (size_t i = 0; i < numParams; ++i) {
+		*packet << params[i];
+	}
 	return PacketType(packet);
 }
 
@@ -284,6 +289,14 @@ PacketType CBaseNetProtocol::SendSyncResponse(int frameNum, uint checksum)
 	return PacketType(packet);
 }
 
+PacketType CBaseNetProtocol::SendSyncState(uchar myPlayerNum, int frameNum, const std::vector<boost::uint32_t>& hashes)
+{
+	const unsigned size = 2 + sizeof(int) + hashes.size() * sizeof(boost::uint32_t) + 1;
+	PackPacket* packet = new PackPacket(size, NETMSG_SYNCSTATE);
+	*packet << static_cast<uchar>(size) << myPlayerNum << frameNum << hashes;
+	return PacketType(packet);
+}
+
 PacketType CBaseNetProtocol::SendSystemMessage(uchar myPlayerNum, std::string message)
 {
 	if (message.size() > 65000)
@@ -478,6 +491,7 @@ CBaseNetProtocol::CBaseNetProtocol()
 	proto->AddType(NETMSG_AICOMMAND, -2);
 	proto->AddType(NETMSG_AICOMMAND_TRACKED, -2);
 	proto->AddType(NETMSG_AICOMMANDS, -2);
+	proto->AddType(NETMSG_AICOMMANDS_BATCH, -2);
 	proto->AddType(NETMSG_AISHARE, -2);
 
 	proto->AddType(NETMSG_USER_SPEED, 6);
@@ -494,6 +508,7 @@ CBaseNetProtocol::CBaseNetProtocol()
 	proto->AddType(NETMSG_GAMEOVER, -1);
 	proto->AddType(NETMSG_MAPDRAW, -1);
 	proto->AddType(NETMSG_SYNCRESPONSE, 9);
+	proto->AddType(NETMSG_SYNCSTATE, -1);
 	proto->AddType(NETMSG_SYSTEMMSG, -2);
 	proto->AddType(NETMSG_STARTPOS, 16);
 	proto->AddType(NETMSG_PLAYERINFO, 10);
@@ -14,7 +14,7 @@ namespace netcode
 }
 struct PlayerStatistics;
 
-const unsigned short NETWORK_VERSION = 4;
+const unsigned short NETWORK_VERSION = 5;
 
 /*
  * Comment behind NETMSG enumeration constant gives the extra data belonging to
@@ -51,6 +51,9 @@ enum NETMSG {
 	                              // short unitIDCount;  unitIDCount * short(unitID)
 	                              // short commandCount; commandCount * { int id; uchar options; std::vector<float> params }
 	NETMSG_AISHARE          = 16, // uchar myPlayerNum, uchar sourceTeam, uchar destTeam, float metal, float energy, std::vector<short> unitIDs
+	NETMSG_AICOMMANDS_BATCH = 17, // /* ushort messageSize */, uchar myPlayerNum; int id; uchar options; uchar paramCount; paramCount * float(param);
+	                              // uchar deltaCount; ushort unitCount; unitCount * { short unitID; deltaCount * short(delta) }
+	                              // (unit i gets param j + delta[i][j] * CAICommandBatch::DELTA_SCALE for j < deltaCount, see AICommandBatch.h)
 
 	NETMSG_USER_SPEED       = 19, // uchar myPlayerNum, float userSpeed;
 	NETMSG_INTERNAL_SPEED   = 20, // float internalSpeed;
@@ -66,6 +69,7 @@ enum NETMSG {
 	                              // uchar messageSize = 12, myPlayerNum, command = MapDrawAction::NET_LINE; short x1, z1, x2, z2;
 	                              // /*messageSize*/   uchar myPlayerNum, command = MapDrawAction::NET_POINT; short x, z; std::string label;
 	NETMSG_SYNCRESPONSE     = 33, // uchar myPlayerNum; int frameNum; uint checksum;
+	NETMSG_SYNCSTATE        = 34, // /* uchar messageSize */, uchar myPlayerNum; int frameNum; std::vector<uint> hashes (one per CSyncStateHashes::Subsystem)
 	NETMSG_SYSTEMMSG        = 35, // uchar myPlayerNum, std::string message;
 	NETMSG_STARTPOS         = 36, // uchar myPlayerNum, uchar myTeam, ready /*0: not ready, 1: ready, 2: don't update readiness*/; float x, y, z;
 	NETMSG_PLAYERINFO       = 38, // uchar myPlayerNum; float cpuUsage; int ping /*in frames*/;
@@ -153,11 +157,11 @@ public:
 	PacketType SendRandSeed(uint randSeed);
 	PacketType SendGameID(const uchar* buf);
 	PacketType SendPathCheckSum(uchar myPlayerNum, boost::uint32_t checksum);
-	PacketType SendCommand(uchar myPlayerNum, int id, uchar options, const std::vector<float>& params);
+	PacketType SendCommand(uchar myPlayerNum, int id, uchar options, const float* params, size_t numParams);
 	PacketType SendSelect(uchar myPlayerNum, const std::vector<short>& selectedUnitIDs);
 	PacketType SendPause(uchar myPlayerNum, uchar bPaused);
 
-	PacketType SendAICommand(uchar myPlayerNum, short unitID, int id, int aiCommandId, uchar options, const std::vector<float>& params);
+	PacketType SendAICommand(uchar myPlayerNum, short unitID, int id, int aiCommandId, uchar options, const float* params, size_t numParams);
 	PacketType SendAIShare(uchar myPlayerNum, uchar sourceTeam, uchar destTeam, float metal, float energy, const std::vector<short>& unitIDs);
 
 	PacketType SendUserSpeed(uchar myPlayerNum, float userSpeed);
@@ -178,6 +182,7 @@ public:
 	PacketType SendMapDrawLine(uchar myPlayerNum, short x1, short z1, short x2, short z2, bool);
 	PacketType SendMapDrawPoint(uchar myPlayerNum, short x, short z, const std::string& label, bool);
 	PacketType SendSyncResponse(int frameNum, uint checksum);
+	PacketType SendSyncState(uchar myPlayerNum, int frameNum, const std::vector<boost::uint32_t>& hashes);
 	PacketType SendSystemMessage(uchar myPlayerNum, std::string message);
 	PacketType SendStartPos(uchar myPlayerNum, uchar teamNum, uchar ready, float x, float y, float z);
 	PacketType SendPlayerInfo(uchar myPlayerNum, float cpuUsage, int ping);
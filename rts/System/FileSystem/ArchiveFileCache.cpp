@@ -0,0 +1,137 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "ArchiveFileCache.h"
+
+#include "System/Config/ConfigHandler.h"
+
+CONFIG(int, ArchiveCacheSize)
+	.defaultValue(256)
+	.minimumValue(0)
+	.description("Maximum amount of decompressed archive contents (in MB) kept in memory; 0 disables the cache.");
+
+CArchiveFileCache archiveFileCache;
+
+
+CArchiveFileCache::CArchiveFileCache(): budgetRead(false)
+{
+}
+
+
+void CArchiveFileCache::ReadBudget()
+{
+	if (budgetRead)
+		return;
+
+	// archives may be read before the config is loaded, in
+	// which case the default applies until the next call
+	if (configHandler == NULL) {
+		stats.maxBytes = 256 * 1024 * 1024;
+		return;
+	}
+
+	stats.maxBytes = size_t(configHandler->GetInt("ArchiveCacheSize")) * 1024 * 1024;
+	budgetRead = true;
+}
+
+
+bool CArchiveFileCache::GetFile(const IArchive* archive, unsigned int fid, std::vector<boost::uint8_t>& buffer)
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+
+	const FileMap::iterator it = fileIndex.find(FileKey(archive, fid));
+
+	if (it == fileIndex.end()) {
+		stats.misses++;
+		return false;
+	}
+
+	// move to the front of the LRU list
+	files.splice(files.begin(), files, it->second);
+
+	buffer = it->second->data;
+	stats.hits++;
+	return true;
+}
+
+
+bool CArchiveFileCache::HasFile(const IArchive* archive, unsigned int fid)
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+	return (fileIndex.find(FileKey(archive, fid)) != fileIndex.end());
+}
+
+
+void CArchiveFileCache::AddFile(const IArchive* archive, unsigned int fid, const std::vector<boost::uint8_t>& data)
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+
+	ReadBudget();
+
+	if (stats.maxBytes == 0 || data.size() > stats.maxBytes)
+		return;
+
+	const FileKey key(archive, fid);
+
+	// another thread may have added it while we were decompressing
+	if (fileIndex.find(key) != fileIndex.end())
+		return;
+
+	Evict(data.size());
+
+	files.push_front(FileEntry());
+	files.front().key = key;
+	files.front().data = data;
+	fileIndex[key] = files.begin();
+
+	stats.numFiles += 1;
+	stats.numBytes += data.size();
+}
+
+
+void CArchiveFileCache::RemoveArchive(const IArchive* archive)
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+
+	// keys are ordered by archive first, so all its files form one range
+	const FileMap::iterator begin = fileIndex.lower_bound(FileKey(archive, 0));
+	FileMap::iterator it = begin;
+
+	for (; it != fileIndex.end() && it->first.first == archive; ++it) {
+		stats.numFiles -= 1;
+		stats.numBytes -= it->second->data.size();
+		files.erase(it->second);
+	}
+
+	fileIndex.erase(begin, it);
+}
+
+
+bool CArchiveFileCache::IsEnabled()
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+
+	ReadBudget();
+	return (stats.maxBytes > 0);
+}
+
+
+CArchiveFileCache::Stats CArchiveFileCache::GetStats()
+{
+	boost::mutex::scoped_lock lock(cacheMutex);
+	return stats;
+}
+
+
+void CArchiveFileCache::Evict(size_t bytesNeeded)
+{
+	while (!files.empty() && (stats.numBytes + bytesNeeded) > stats.maxBytes) {
+		const FileEntry& entry = files.back();
+
+		stats.numFiles -= 1;
+		stats.numBytes -= entry.data.size();
+		stats.evictions += 1;
+
+		fileIndex.erase(entry.key);
+		files.pop_back();
+	}
+}
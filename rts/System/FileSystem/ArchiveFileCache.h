@@ -0,0 +1,77 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _ARCHIVE_FILE_CACHE_H
+#define _ARCHIVE_FILE_CACHE_H
+
+#include <list>
+#include <map>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+
+class IArchive;
+
+/**
+ * Size-bounded cache of decompressed archive contents, shared by all
+ * archives that are expensive to read from.
+ * When the budget (config: ArchiveCacheSize, in MB) is exceeded, the least
+ * recently used files are dropped.
+ * All methods are threadsafe.
+ */
+class CArchiveFileCache
+{
+public:
+	struct Stats {
+		Stats(): hits(0), misses(0), evictions(0), numFiles(0), numBytes(0), maxBytes(0) {}
+
+		unsigned int hits;
+		unsigned int misses;
+		unsigned int evictions;
+		unsigned int numFiles;
+		size_t numBytes;
+		size_t maxBytes;
+	};
+
+	CArchiveFileCache();
+
+	/// @return true if the file was found, in which case buffer holds its contents
+	bool GetFile(const IArchive* archive, unsigned int fid, std::vector<boost::uint8_t>& buffer);
+	/// @return true if the file is cached; does not count as a hit or miss
+	bool HasFile(const IArchive* archive, unsigned int fid);
+	/// Stores a copy of data, evicting older files if required
+	void AddFile(const IArchive* archive, unsigned int fid, const std::vector<boost::uint8_t>& data);
+	/// Drops all files of an archive, called when the archive gets deleted
+	void RemoveArchive(const IArchive* archive);
+
+	/// @return false if the budget is 0, so callers can skip needless work
+	bool IsEnabled();
+	Stats GetStats();
+
+private:
+	typedef std::pair<const IArchive*, unsigned int> FileKey;
+
+	struct FileEntry {
+		FileKey key;
+		std::vector<boost::uint8_t> data;
+	};
+
+	typedef std::list<FileEntry> FileList;
+	typedef std::map<FileKey, FileList::iterator> FileMap;
+
+	void ReadBudget();
+	void Evict(size_t bytesNeeded);
+
+private:
+	boost::mutex cacheMutex;
+
+	/// most recently used files first
+	FileList files;
+	FileMap fileIndex;
+
+	bool budgetRead;
+	Stats stats;
+};
+
+extern CArchiveFileCache archiveFileCache;
+
+#endif // _ARCHIVE_FILE_CACHE_H
@@ -6,6 +6,9 @@
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include "System/mmgr.h"
 
@@ -23,7 +26,7 @@
 #include "System/CRC.h"
 #include "System/Util.h"
 #include "System/Exceptions.h"
-#include "System/OpenMP_cond.h"
+#include "System/ThreadPool.h"
 #if       !defined(DEDICATED) && !defined(UNITSYNC)
 #include "System/Platform/Watchdog.h"
 #endif // !defined(DEDICATED) && !defined(UNITSYNC)
@@ -46,7 +49,7 @@ LOG_REGISTER_SECTION_GLOBAL(LOG_SECTION_ARCHIVESCANNER)
  * but mapping them all, every time to make the list is)
  */
 
-const int INTERNAL_VER = 9;
+const int INTERNAL_VER = 10;
 CArchiveScanner* archiveScanner = NULL;
 
 
@@ -371,23 +374,80 @@ const std::string& CArchiveScanner::GetFilename() const
 }
 
 
+static inline int ElapsedMilliSecs(const boost::posix_time::ptime& since)
+{
+	return (boost::posix_time::microsec_clock::universal_time() - since).total_milliseconds();
+}
+
+
 void CArchiveScanner::ScanDirs(const std::vector<std::string>& scanDirs, bool doChecksum)
 {
-	// add the archives
+	isDirty = true;
+
+	boost::posix_time::ptime phaseStart = boost::posix_time::microsec_clock::universal_time();
+
+	// phase 1: collect the archives in all directories
+	std::vector<std::string> archives;
 	std::vector<std::string>::const_iterator dir;
 	for (dir = scanDirs.begin(); dir != scanDirs.end(); ++dir) {
 		if (FileSystem::DirExists(*dir)) {
 			LOG("Scanning: %s", dir->c_str());
-			Scan(*dir, doChecksum);
+			FindArchives(*dir, archives);
 		}
 	}
+
+	const int findTime = ElapsedMilliSecs(phaseStart);
+	phaseStart = boost::posix_time::microsec_clock::universal_time();
+
+	// phase 2: check the cached info, only new and changed archives are opened
+	// an archive found twice is scanned from the directory that comes last,
+	// same as when the second find simply replaced the first
+	std::map<std::string, size_t> lastFound;
+	for (size_t n = 0; n < archives.size(); n++) {
+		lastFound[StringToLower(FileSystem::GetFilename(archives[n]))] = n;
+	}
+
+	std::vector<ArchiveScanJob> jobs;
+	for (size_t n = 0; n < archives.size(); n++) {
+		if (lastFound[StringToLower(FileSystem::GetFilename(archives[n]))] != n) {
+			continue;
+		}
+
+		ArchiveScanJob job;
+		if (CheckCachedArchive(archives[n], doChecksum, job)) {
+			jobs.push_back(job);
+		}
+	}
+
+	const int checkTime = ElapsedMilliSecs(phaseStart);
+	phaseStart = boost::posix_time::microsec_clock::universal_time();
+
+	// phase 3: open archives and compute checksums, each worker uses its own
+	// IArchive instances
+	ThreadPool::for_mt(0, jobs.size(), boost::bind(&CArchiveScanner::ScanArchive, this, boost::ref(jobs), doChecksum, _1));
+
+	const int scanTime = ElapsedMilliSecs(phaseStart);
+	phaseStart = boost::posix_time::microsec_clock::universal_time();
+
+	// phase 4: merge the results in the order the archives were found
+	unsigned int numBroken = 0;
+	for (std::vector<ArchiveScanJob>::const_iterator it = jobs.begin(); it != jobs.end(); ++it) {
+		MergeArchive(*it);
+		numBroken += (!it->error.empty());
+	}
+
+	ResolveReplaces();
+
+	const int mergeTime = ElapsedMilliSecs(phaseStart);
+
+	LOG_S(LOG_SECTION_ARCHIVESCANNER,
+			"Scanned "_STPF_" archives ("_STPF_" (re)opened, %u broken): find %ims, check %ims, scan %ims, merge %ims",
+			archives.size(), jobs.size(), numBroken, findTime, checkTime, scanTime, mergeTime);
 }
 
 
-void CArchiveScanner::Scan(const std::string& curPath, bool doChecksum)
+void CArchiveScanner::FindArchives(const std::string& curPath, std::vector<std::string>& archives) const
 {
-	isDirty = true;
-
 	const int flags = (FileQueryFlags::INCLUDE_DIRS | FileQueryFlags::RECURSE);
 	const std::vector<std::string> &found = dataDirsAccess.FindFiles(curPath, "*", flags);
 
@@ -414,15 +474,16 @@ void CArchiveScanner::Scan(const std::string& curPath, bool doChecksum)
 			continue;
 		}
 
-#if       !defined(DEDICATED) && !defined(UNITSYNC)
-		Watchdog::ClearTimer(WDT_MAIN);
-#endif // !defined(DEDICATED) && !defined(UNITSYNC)
 		// Is this an archive we should look into?
 		if (archiveLoader.IsArchiveFile(fullName)) {
-			ScanArchive(fullName, doChecksum);
+			archives.push_back(fullName);
 		}
 	}
+}
+
 
+void CArchiveScanner::ResolveReplaces()
+{
 	// Now we'll have to parse the replaces-stuff found in the mods
 	for (std::map<std::string, ArchiveInfo>::iterator aii = archiveInfos.begin(); aii != archiveInfos.end(); ++aii) {
 		for (std::vector<std::string>::const_iterator i = aii->second.archiveData.GetReplaces().begin(); i != aii->second.archiveData.GetReplaces().end(); ++i) {
@@ -441,6 +502,7 @@ void CArchiveScanner::Scan(const std::string& curPath, bool doChecksum)
 			ar->second.path = "";
 			ar->second.origName = lcname;
 			ar->second.modified = 1;
+			ar->second.size = 0;
 			ArchiveData empty;
 			ar->second.archiveData = empty;
 			ar->second.updated = true;
@@ -460,7 +522,7 @@ static void AddDependency(std::vector<std::string>& deps, const std::string& dep
 	deps.push_back(dependency);
 }
 
-void CArchiveScanner::ScanArchive(const std::string& fullName, bool doChecksum)
+bool CArchiveScanner::CheckCachedArchive(const std::string& fullName, bool doChecksum, ArchiveScanJob& job)
 {
 	struct stat info;
 	stat(fullName.c_str(), &info);
@@ -469,160 +531,202 @@ void CArchiveScanner::ScanArchive(const std::string& fullName, bool doChecksum)
 	const std::string fpath = FileSystem::GetDirectory(fullName);
 	const std::string lcfn  = StringToLower(fn);
 
+	const unsigned int modified = info.st_mtime;
+	const unsigned int size     = info.st_size;
+
 	//! Determine whether this archive has earlier be found to be broken
 	std::map<std::string, BrokenArchive>::iterator bai = brokenArchives.find(lcfn);
 	if (bai != brokenArchives.end()) {
-		if ((unsigned)info.st_mtime == bai->second.modified && fpath == bai->second.path) {
+		if (modified == bai->second.modified && size == bai->second.size && fpath == bai->second.path) {
 			bai->second.updated = true;
-			return;
+			return false;
 		}
 	}
 
-	//! Determine whether to rely on the cached info or not
-	bool cached = false;
+	job.fullName = fullName;
+	job.lcfn     = lcfn;
+	job.modified = modified;
+	job.size     = size;
+	job.cached   = false;
+	job.opened   = true;
 
+	//! Determine whether to rely on the cached info or not
 	std::map<std::string, ArchiveInfo>::iterator aii = archiveInfos.find(lcfn);
 	if (aii != archiveInfos.end()) {
 
 		//! This archive may have been obsoleted, do not process it if so
 		if (aii->second.replaced.length() > 0) {
-			return;
+			return false;
 		}
 
-		if ((unsigned)info.st_mtime == aii->second.modified && fpath == aii->second.path) {
-			cached = true;
+		if (modified == aii->second.modified && size == aii->second.size && fpath == aii->second.path) {
 			aii->second.updated = true;
+
+			//! only the checksum may still be missing
+			if (!doChecksum || (aii->second.checksum != 0))
+				return false;
+
+			job.cached = true;
+			job.info = aii->second;
+			return true;
 		}
 
 		//! If we are here, we could have invalid info in the cache
 		//! Force a reread if it's a directory archive, as st_mtime only
 		//! reflects changes to the directory itself, not the contents.
-		if (!cached) {
-			archiveInfos.erase(aii);
-		}
+		archiveInfos.erase(aii);
 	}
 
+	job.info.path = fpath;
+	job.info.modified = modified;
+	job.info.size = size;
+	job.info.origName = fn;
+	job.info.updated = true;
+	job.info.checksum = 0;
+	return true;
+}
+
+void CArchiveScanner::ScanArchive(std::vector<ArchiveScanJob>& jobs, bool doChecksum, int jobIdx)
+{
+	ArchiveScanJob& job = jobs[jobIdx];
+	const std::string& fullName = job.fullName;
+	ArchiveInfo& ai = job.info;
+
+#if       !defined(DEDICATED) && !defined(UNITSYNC)
+	Watchdog::ClearTimer(WDT_MAIN);
+#endif // !defined(DEDICATED) && !defined(UNITSYNC)
+
 	//! Time to parse the info we are interested in
-	if (cached) {
-		//! If cached is true, aii will point to the archive
-		if (doChecksum && (aii->second.checksum == 0))
-			aii->second.checksum = GetCRC(fullName);
-	} else {
-		IArchive* ar = archiveLoader.OpenArchive(fullName);
-		if (!ar || !ar->IsOpen()) {
-			LOG("Unable to open archive: %s", fullName.c_str());
-			return;
-		}
+	if (job.cached) {
+		ai.checksum = GetCRC(fullName);
+		return;
+	}
 
-		ArchiveInfo ai;
-		std::string error = "";
-
-		std::string mapfile;
-		bool hasModinfo = ar->FileExists("modinfo.lua");
-		bool hasMapinfo = ar->FileExists("mapinfo.lua");
-		
-		//! check for smf/sm3 and if the uncompression of important files is too costy
-		for (unsigned fid = 0; fid != ar->NumFiles(); ++fid)
-		{
-			std::string name;
-			int size;
-			ar->FileInfo(fid, name, size);
-			const std::string lowerName = StringToLower(name);
-			const std::string ext = FileSystem::GetExtension(lowerName);
-
-			if ((ext == "smf") || (ext == "sm3")) {
-				mapfile = name;
-			}
+	IArchive* ar = archiveLoader.OpenArchive(fullName);
+	if (!ar || !ar->IsOpen()) {
+		LOG("Unable to open archive: %s", fullName.c_str());
+		delete ar;
+		job.opened = false;
+		return;
+	}
 
-			const unsigned char metaFileClass = GetMetaFileClass(lowerName);
-			if ((metaFileClass != 0) && !(ar->HasLowReadingCost(fid))) {
-				//! is a meta-file and not cheap to read
-				if (metaFileClass == 1) {
-					//! 1st class
-					error = "Unpacking/reading cost for meta file " + name
-							+ " is too high, please repack the archive (make sure to use a non-solid algorithm, if applicable)";
-					break;
-				} else if (metaFileClass == 2) {
-					//! 2nd class
-					LOG_SL(LOG_SECTION_ARCHIVESCANNER, L_WARNING,
-							"Archive %s: The cost for reading a 2nd class meta-file is too high: %s",
-							fullName.c_str(), name.c_str());
-				}
-			}
+	std::string& error = job.error;
+
+	std::string mapfile;
+	bool hasModinfo = ar->FileExists("modinfo.lua");
+	bool hasMapinfo = ar->FileExists("mapinfo.lua");
+
+	//! check for smf/sm3 and if the uncompression of important files is too costy
+	for (unsigned fid = 0; fid != ar->NumFiles(); ++fid)
+	{
+		std::string name;
+		int size;
+		ar->FileInfo(fid, name, size);
+		const std::string lowerName = StringToLower(name);
+		const std::string ext = FileSystem::GetExtension(lowerName);
+
+		if ((ext == "smf") || (ext == "sm3")) {
+			mapfile = name;
 		}
 
-		if (!error.empty()) {
-			//! we already have an error, no further evaluation required
-		} if (hasMapinfo || !mapfile.empty()) {
-			//! it is a map
-			if (hasMapinfo) {
-				ScanArchiveLua(ar, "mapinfo.lua", ai, error);
-			} else if (hasModinfo) {
-				//! backwards-compat for modinfo.lua in maps
-				ScanArchiveLua(ar, "modinfo.lua", ai, error);
-			}
-			if (ai.archiveData.GetName().empty()) {
-				//! FIXME The name will never be empty, if version is set (see HACK in ArchiveData)
-				ai.archiveData.SetInfoItemValueString("name", FileSystem::GetBasename(mapfile));
-			}
-			if (ai.archiveData.GetMapFile().empty()) {
-				ai.archiveData.SetInfoItemValueString("mapfile", mapfile);
+		const unsigned char metaFileClass = GetMetaFileClass(lowerName);
+		if ((metaFileClass != 0) && !(ar->HasLowReadingCost(fid))) {
+			//! is a meta-file and not cheap to read
+			if (metaFileClass == 1) {
+				//! 1st class
+				error = "Unpacking/reading cost for meta file " + name
+						+ " is too high, please repack the archive (make sure to use a non-solid algorithm, if applicable)";
+				break;
+			} else if (metaFileClass == 2) {
+				//! 2nd class
+				LOG_SL(LOG_SECTION_ARCHIVESCANNER, L_WARNING,
+						"Archive %s: The cost for reading a 2nd class meta-file is too high: %s",
+						fullName.c_str(), name.c_str());
 			}
-			AddDependency(ai.archiveData.GetDependencies(), "Map Helper v1");
-			ai.archiveData.SetInfoItemValueInteger("modType", modtype::map);
+		}
+	}
 
-			LOG_S(LOG_SECTION_ARCHIVESCANNER, "Found new map: %s",
-					ai.archiveData.GetName().c_str());
+	if (!error.empty()) {
+		//! we already have an error, no further evaluation required
+	} if (hasMapinfo || !mapfile.empty()) {
+		//! it is a map
+		if (hasMapinfo) {
+			ScanArchiveLua(ar, "mapinfo.lua", ai, error);
 		} else if (hasModinfo) {
-			//! it is a mod
+			//! backwards-compat for modinfo.lua in maps
 			ScanArchiveLua(ar, "modinfo.lua", ai, error);
-			if (ai.archiveData.GetModType() == modtype::primary) {
-				AddDependency(ai.archiveData.GetDependencies(), "Spring content v1");
-			}
-
-			LOG_S(LOG_SECTION_ARCHIVESCANNER, "Found new game: %s",
-					ai.archiveData.GetName().c_str());
-		} else {
-			//! neither a map nor a mod: error
-			error = "missing modinfo.lua/mapinfo.lua";
+		}
+		if (ai.archiveData.GetName().empty()) {
+			//! FIXME The name will never be empty, if version is set (see HACK in ArchiveData)
+			ai.archiveData.SetInfoItemValueString("name", FileSystem::GetBasename(mapfile));
+		}
+		if (ai.archiveData.GetMapFile().empty()) {
+			ai.archiveData.SetInfoItemValueString("mapfile", mapfile);
+		}
+		AddDependency(ai.archiveData.GetDependencies(), "Map Helper v1");
+		ai.archiveData.SetInfoItemValueInteger("modType", modtype::map);
+
+		LOG_S(LOG_SECTION_ARCHIVESCANNER, "Found new map: %s",
+				ai.archiveData.GetName().c_str());
+	} else if (hasModinfo) {
+		//! it is a mod
+		ScanArchiveLua(ar, "modinfo.lua", ai, error);
+		if (ai.archiveData.GetModType() == modtype::primary) {
+			AddDependency(ai.archiveData.GetDependencies(), "Spring content v1");
 		}
 
-		delete ar;
+		LOG_S(LOG_SECTION_ARCHIVESCANNER, "Found new game: %s",
+				ai.archiveData.GetName().c_str());
+	} else {
+		//! neither a map nor a mod: error
+		error = "missing modinfo.lua/mapinfo.lua";
+	}
 
-		if (!error.empty()) {
-			//! for some reason, the archive is marked as broken
-			LOG_L(L_WARNING, "Failed to scan %s (%s)",
-					fullName.c_str(), error.c_str());
-
-			//! record it as broken, so we don't need to look inside everytime
-			BrokenArchive ba;
-			ba.path = fpath;
-			ba.modified = info.st_mtime;
-			ba.updated = true;
-			ba.problem = error;
-			brokenArchives[lcfn] = ba;
-			return;
-		}
+	delete ar;
 
-		ai.path = fpath;
-		ai.modified = info.st_mtime;
-		ai.origName = fn;
-		ai.updated = true;
-
-		//! Optionally calculate a checksum for the file
-		//! To prevent reading all files in all directory (.sdd) archives
-		//! every time this function is called, directory archive checksums
-		//! are calculated on the fly.
-		if (doChecksum) {
-			ai.checksum = GetCRC(fullName);
-		} else {
-			ai.checksum = 0;
-		}
+	if (!error.empty()) {
+		return;
+	}
 
-		archiveInfos[lcfn] = ai;
+	//! Optionally calculate a checksum for the file
+	//! To prevent reading all files in all directory (.sdd) archives
+	//! every time this function is called, directory archive checksums
+	//! are calculated on the fly.
+	if (doChecksum) {
+		ai.checksum = GetCRC(fullName);
 	}
 }
 
+void CArchiveScanner::MergeArchive(const ArchiveScanJob& job)
+{
+	if (!job.opened) {
+		return;
+	}
+
+	if (job.cached) {
+		archiveInfos[job.lcfn].checksum = job.info.checksum;
+		return;
+	}
+
+	if (!job.error.empty()) {
+		//! for some reason, the archive is marked as broken
+		LOG_L(L_WARNING, "Failed to scan %s (%s)",
+				job.fullName.c_str(), job.error.c_str());
+
+		//! record it as broken, so we don't need to look inside everytime
+		BrokenArchive ba;
+		ba.path = job.info.path;
+		ba.modified = job.modified;
+		ba.size = job.size;
+		ba.updated = true;
+		ba.problem = job.error;
+		brokenArchives[job.lcfn] = ba;
+		return;
+	}
+
+	archiveInfos[job.lcfn] = job.info;
+}
+
 bool CArchiveScanner::ScanArchiveLua(IArchive* ar, const std::string& fileName, ArchiveInfo& ai,  std::string& err)
 {
 	std::vector<boost::uint8_t> buf;
@@ -630,6 +734,10 @@ bool CArchiveScanner::ScanArchiveLua(IArchive* ar, const std::string& fileName,
 		return false;
 	}
 
+	// LuaParser is not reentrant (it keeps a static current-parser pointer)
+	static boost::mutex luaParserMutex;
+	boost::mutex::scoped_lock lock(luaParserMutex);
+
 	const std::string cleanbuf((char*)(&buf[0]), buf.size());
 	LuaParser p(cleanbuf, SPRING_VFS_MOD);
 	if (!p.Execute()) {
@@ -719,13 +827,11 @@ unsigned int CArchiveScanner::GetCRC(const std::string& arcName)
 	}
 
 	//! Compute CRCs of the files
-	//! Hint: Multithreading only speedups `.sdd` loading. For those the CRC generation is extremely slow -
-	//!       it has to load the full file to calc it! For the other formats (sd7, sdz, sdp) the CRC is saved
-	//!       in the metainformation of the container and so the loading is much faster. Neither does any of our
-	//!       current (2011) packing libraries support multithreading :/
-	int i;
-	#pragma omp parallel for private(i)
-	for (i=0; i<crcs.size(); ++i) {
+	//! Hint: For `.sdd` the CRC generation is extremely slow - it has to load the full file to calc it!
+	//!       For the other formats (sd7, sdz, sdp) the CRC is saved in the metainformation of the
+	//!       container and so the loading is much faster.
+	//!       This runs on the ScanDirs worker threads, which already process several archives at once.
+	for (size_t i = 0; i < crcs.size(); ++i) {
 		CRCPair& crcp = crcs[i];
 		const unsigned int nameCRC = CRC().Update(crcp.filename->data(), crcp.filename->size()).GetDigest();
 		const unsigned fid = ar->FindFile(*crcp.filename);
@@ -741,9 +847,6 @@ unsigned int CArchiveScanner::GetCRC(const std::string& arcName)
 	for (std::vector<CRCPair>::iterator it = crcs.begin(); it != crcs.end(); ++it) {
 		crc.Update(it->nameCRC);
 		crc.Update(it->dataCRC);
-	#if !defined(DEDICATED) && !defined(UNITSYNC)
-		Watchdog::ClearTimer();
-	#endif
 	}
 
 	delete ignore;
@@ -790,6 +893,7 @@ void CArchiveScanner::ReadCacheData(const std::string& filename)
 		// library uses 32-bit floats to represent numbers, which can only
 		// represent 2^24 consecutive integers
 		ai.modified = strtoul(curArchive.GetString("modified", "0").c_str(), 0, 10);
+		ai.size     = strtoul(curArchive.GetString("size", "0").c_str(), 0, 10);
 		ai.checksum = strtoul(curArchive.GetString("checksum", "0").c_str(), 0, 10);
 		ai.updated = false;
 
@@ -813,6 +917,7 @@ void CArchiveScanner::ReadCacheData(const std::string& filename)
 
 		ba.path = curArchive.GetString("path", "");
 		ba.modified = strtoul(curArchive.GetString("modified", "0").c_str(), 0, 10);
+		ba.size = strtoul(curArchive.GetString("size", "0").c_str(), 0, 10);
 		ba.updated = false;
 		ba.problem = curArchive.GetString("problem", "unknown");
 
@@ -890,6 +995,7 @@ void CArchiveScanner::WriteCacheData(const std::string& filename)
 		SafeStr(out, "\t\t\tname = ",              arcInfo.origName);
 		SafeStr(out, "\t\t\tpath = ",              arcInfo.path);
 		fprintf(out, "\t\t\tmodified = \"%u\",\n", arcInfo.modified);
+		fprintf(out, "\t\t\tsize = \"%u\",\n", arcInfo.size);
 		fprintf(out, "\t\t\tchecksum = \"%u\",\n", arcInfo.checksum);
 		SafeStr(out, "\t\t\treplaced = ",          arcInfo.replaced);
 
@@ -949,6 +1055,7 @@ void CArchiveScanner::WriteCacheData(const std::string& filename)
 		SafeStr(out, "\t\t\tname = ", bai->first);
 		SafeStr(out, "\t\t\tpath = ", ba.path);
 		fprintf(out, "\t\t\tmodified = \"%u\",\n", ba.modified);
+		fprintf(out, "\t\t\tsize = \"%u\",\n", ba.size);
 		SafeStr(out, "\t\t\tproblem = ", ba.problem);
 		fprintf(out, "\t\t},\n");
 	}
@@ -152,6 +152,7 @@ private:
 		std::string path;
 		std::string origName;     ///< Could be useful to have the non-lowercased name around
 		unsigned int modified;
+		unsigned int size;        ///< lower 32 bits of the file size, only used to detect changes
 		ArchiveData archiveData;
 		unsigned int checksum;
 		bool updated;
@@ -161,15 +162,41 @@ private:
 	{
 		std::string path;
 		unsigned int modified;
+		unsigned int size;
 		bool updated;
 		std::string problem;
 	};
+	/// an archive that has to be opened, filled in by the worker threads
+	struct ArchiveScanJob
+	{
+		std::string fullName;
+		std::string lcfn;
+		unsigned int modified;
+		unsigned int size;
+		bool cached;              ///< info is up to date, only the checksum is missing
+		bool opened;              ///< false if the archive could not be opened
+		ArchiveInfo info;
+		std::string error;        ///< if not empty, the archive is broken
+	};
 
 private:
 	void ScanDirs(const std::vector<std::string>& dirs, bool checksum = false);
-	void Scan(const std::string& curPath, bool doChecksum);
-
-	void ScanArchive(const std::string& fullName, bool checksum = false);
+	void FindArchives(const std::string& curPath, std::vector<std::string>& archives) const;
+	/**
+	 * Checks the cached info of an archive against its mtime, size and path.
+	 * @return true if the archive has to be (partially) scanned again, in
+	 *   which case job is filled in
+	 */
+	bool CheckCachedArchive(const std::string& fullName, bool doChecksum, ArchiveScanJob& job);
+	/**
+	 * Opens the archive of a job and reads its meta-data and/or checksum.
+	 * Runs on worker threads, so it must not touch archiveInfos or
+	 * brokenArchives; see MergeArchive.
+	 */
+	void ScanArchive(std::vector<ArchiveScanJob>& jobs, bool doChecksum, int jobIdx);
+	void MergeArchive(const ArchiveScanJob& job);
+	/// apply the replaces-stuff found in the mods
+	void ResolveReplaces();
 	/// scan mapinfo / modinfo lua files
 	bool ScanArchiveLua(IArchive* ar, const std::string& fileName, ArchiveInfo& ai, std::string& err);
 
@@ -2,6 +2,11 @@
 
 
 #include "BufferedArchive.h"
+#include "ArchiveFileCache.h"
+#include "System/ThreadPool.h"
+
+#include <cassert>
+#include <boost/bind.hpp>
 
 
 CBufferedArchive::CBufferedArchive(const std::string& name)
@@ -11,22 +16,63 @@ CBufferedArchive::CBufferedArchive(const std::string& name)
 
 CBufferedArchive::~CBufferedArchive()
 {
+	archiveFileCache.RemoveArchive(this);
 }
 
 bool CBufferedArchive::GetFile(unsigned int fid, std::vector<boost::uint8_t>& buffer)
 {
-	boost::mutex::scoped_lock lck(archiveLock);
 	assert(IsFileId(fid));
 
-	if (fid >= cache.size()) {
-		cache.resize(fid + 1);
+	if (archiveFileCache.GetFile(this, fid, buffer)) {
+		return true;
+	}
+
+	if (!GetFileImpl(fid, buffer)) {
+		return false;
 	}
-	
-	if (!cache[fid].populated) {
-		cache[fid].exists = GetFileImpl(fid, cache[fid].data);
-		cache[fid].populated = true;
+
+	archiveFileCache.AddFile(this, fid, buffer);
+	return true;
+}
+
+void CBufferedArchive::Prefetch(const std::vector<unsigned int>& fids)
+{
+	if (!archiveFileCache.IsEnabled()) {
+		return;
 	}
 
-	buffer = cache[fid].data;
-	return cache[fid].exists;
+	const size_t maxBytes = archiveFileCache.GetStats().maxBytes / 2;
+	size_t numBytes = 0;
+
+	std::vector<unsigned int> missing;
+	missing.reserve(fids.size());
+
+	for (std::vector<unsigned int>::const_iterator it = fids.begin(); it != fids.end(); ++it) {
+		if (!IsFileId(*it) || archiveFileCache.HasFile(this, *it)) {
+			continue;
+		}
+
+		std::string name;
+		int size;
+		FileInfo(*it, name, size);
+
+		if ((numBytes + size) > maxBytes) {
+			break;
+		}
+
+		numBytes += size;
+		missing.push_back(*it);
+	}
+
+	ThreadPool::for_mt(0, missing.size(), boost::bind(&CBufferedArchive::PrefetchFile, this, &missing, _1));
+}
+
+void CBufferedArchive::PrefetchFile(const std::vector<unsigned int>* fids, int idx)
+{
+	const unsigned int fid = (*fids)[idx];
+	std::vector<boost::uint8_t> buffer;
+
+	if (GetFileImpl(fid, buffer)) {
+		archiveFileCache.AddFile(this, fid, buffer);
+	}
 }
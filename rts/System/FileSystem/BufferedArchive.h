@@ -3,14 +3,12 @@
 #ifndef _BUFFERED_ARCHIVE_H
 #define _BUFFERED_ARCHIVE_H
 
-#include <map>
-#include <boost/thread/mutex.hpp>
-
 #include "IArchive.h"
 
 /**
- * Provides a helper implementation for archive types that can only uncompress
- * one file to memory at a time.
+ * Provides a helper implementation for archive types that have to uncompress
+ * a file completely to memory; the results are kept in the shared, size
+ * bounded archiveFileCache.
  */
 class CBufferedArchive : public IArchive
 {
@@ -19,19 +17,23 @@ public:
 	virtual ~CBufferedArchive();
 
 	virtual bool GetFile(unsigned int fid, std::vector<boost::uint8_t>& buffer);
+	/**
+	 * Decompresses the given files on all cores into the archiveFileCache.
+	 * Stops at half of the cache budget, so the prefetched files do not
+	 * evict each other before they are used.
+	 */
+	virtual void Prefetch(const std::vector<unsigned int>& fids);
 
 protected:
+	/**
+	 * Reads a file from the archive, bypassing the cache.
+	 * May be called by several threads at once, so implementations
+	 * have to be threadsafe.
+	 */
 	virtual bool GetFileImpl(unsigned int fid, std::vector<boost::uint8_t>& buffer) = 0;
 
-	boost::mutex archiveLock; // neither 7zip nor zlib are threadsafe
-	struct FileBuffer
-	{
-		FileBuffer() : populated(false), exists(false) {};
-		bool populated; // cause a file may be 0 bytes big
-		bool exists;
-		std::vector<boost::uint8_t> data;
-	};
-	std::vector<FileBuffer> cache; // cache[fileId]
+private:
+	void PrefetchFile(const std::vector<unsigned int>* fids, int idx);
 };
 
 #endif // _BUFFERED_ARCHIVE_H
@@ -81,12 +81,8 @@ bool CFileHandler::TryReadFromModFS(const string& fileName)
 	}
 
 	const string file = StringToLower(fileName);
-	if (vfsHandler->LoadFile(file, fileBuffer)) {
-		//! did we allocated more mem than needed
-		//! (e.g. because of incorrect usage of std::vector)?
-		assert(fileBuffer.size() == fileBuffer.capacity()); 
-
-		fileSize = fileBuffer.size();
+	if (vfsHandler->LoadFileView(file, fileView)) {
+		fileSize = fileView.GetSize();
 		return true;
 	}
 	else
@@ -154,13 +150,13 @@ int CFileHandler::Read(void* buf, int length)
 		ifs->read((char*)buf, length);
 		return ifs->gcount ();
 	}
-	else if (!fileBuffer.empty()) {
+	else if (!fileView.Empty()) {
 		if ((length + filePos) > fileSize) {
 			length = fileSize - filePos;
 		}
 		if (length > 0) {
-			assert(fileBuffer.size() >= (filePos + length));
-			memcpy(buf, &fileBuffer[filePos], length);
+			assert(fileView.GetSize() >= size_t(filePos + length));
+			memcpy(buf, fileView.GetData() + filePos, length);
 			filePos += length;
 		}
 		return length;
@@ -181,7 +177,7 @@ void CFileHandler::Seek(int length, std::ios_base::seekdir where)
 		ifs->clear();
 		ifs->seekg(length, where);
 	}
-	else if (!fileBuffer.empty())
+	else if (!fileView.Empty())
 	{
 		if (where == std::ios_base::beg)
 		{
@@ -206,9 +202,9 @@ int CFileHandler::Peek() const
 	if (ifs) {
 		return ifs->peek();
 	}
-	else if (!fileBuffer.empty()) {
+	else if (!fileView.Empty()) {
 		if (filePos < fileSize) {
-			return fileBuffer.at(filePos);
+			return fileView.GetData()[filePos];
 		} else {
 			return EOF;
 		}
@@ -224,7 +220,7 @@ bool CFileHandler::Eof() const
 	if (ifs) {
 		return ifs->eof();
 	}
-	if (!fileBuffer.empty()) {
+	if (!fileView.Empty()) {
 		return (filePos >= fileSize);
 	}
 	return true;
@@ -237,6 +233,16 @@ int CFileHandler::FileSize() const
 }
 
 
+const boost::uint8_t* CFileHandler::GetData(int pos, int length) const
+{
+	if (ifs || fileView.Empty() || pos < 0 || length < 0 || (pos + length) > fileSize) {
+		return NULL;
+	}
+
+	return (fileView.GetData() + pos);
+}
+
+
 int CFileHandler::GetPos() const
 {
 	GML_RECMUTEX_LOCK(file); // GetPos
@@ -10,6 +10,7 @@
 #include <boost/cstdint.hpp>
 
 #include "VFSModes.h"
+#include "FileView.h"
 
 /**
  * This is for direct VFS file content access.
@@ -38,6 +39,14 @@ public:
 	int GetPos() const;
 	int FileSize() const;
 
+	/**
+	 * Direct access to the file contents, without copying them.
+	 * Only available for files read from the VFS; files opened on the raw
+	 * filesystem are streamed and have to use Read.
+	 * @return pointer to length bytes starting at pos, or NULL
+	 */
+	const boost::uint8_t* GetData(int pos, int length) const;
+
 	bool LoadStringData(std::string& data);
 	std::string GetFileExt() const;
 
@@ -71,7 +80,7 @@ private:
 
 	std::string fileName;
 	std::ifstream* ifs;
-	std::vector<boost::uint8_t> fileBuffer;
+	CFileView fileView;
 	int filePos;
 	int fileSize;
 };
@@ -0,0 +1,179 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "FileView.h"
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+
+struct CFileView::Storage
+{
+	Storage(): mapBase(NULL), mapSize(0) {}
+	~Storage() { Unmap(); }
+
+	/// @return pointer to the first requested byte, or NULL
+	const boost::uint8_t* Map(const std::string& filePath, size_t offset, size_t size);
+	void Unmap();
+
+	void* mapBase;
+	size_t mapSize;
+
+	std::vector<boost::uint8_t> buffer;
+};
+
+
+#ifdef _WIN32
+
+const boost::uint8_t* CFileView::Storage::Map(const std::string& filePath, size_t offset, size_t size)
+{
+	HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	LARGE_INTEGER fileSize;
+	HANDLE mapping = NULL;
+
+	if (GetFileSizeEx(file, &fileSize) && (boost::uint64_t(offset) + size) <= boost::uint64_t(fileSize.QuadPart)) {
+		mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	}
+
+	// the view keeps the mapping (and file) alive on its own
+	CloseHandle(file);
+
+	if (mapping == NULL)
+		return NULL;
+
+	// views have to start at a multiple of the allocation granularity
+	SYSTEM_INFO sysInfo;
+	GetSystemInfo(&sysInfo);
+
+	const size_t alignedOffset = offset - (offset % sysInfo.dwAllocationGranularity);
+	const size_t alignedSize = size + (offset - alignedOffset);
+	const boost::uint64_t viewOffset = alignedOffset;
+
+	mapBase = MapViewOfFile(mapping, FILE_MAP_READ, DWORD(viewOffset >> 32), DWORD(viewOffset & 0xFFFFFFFF), alignedSize);
+	CloseHandle(mapping);
+
+	if (mapBase == NULL)
+		return NULL;
+
+	mapSize = alignedSize;
+	return (reinterpret_cast<const boost::uint8_t*>(mapBase) + (offset - alignedOffset));
+}
+
+void CFileView::Storage::Unmap()
+{
+	if (mapBase != NULL) {
+		UnmapViewOfFile(mapBase);
+	}
+
+	mapBase = NULL;
+	mapSize = 0;
+}
+
+#else
+
+const boost::uint8_t* CFileView::Storage::Map(const std::string& filePath, size_t offset, size_t size)
+{
+	const int fd = open(filePath.c_str(), O_RDONLY);
+
+	if (fd < 0)
+		return NULL;
+
+	struct stat info;
+
+	if (fstat(fd, &info) != 0 || (boost::uint64_t(offset) + size) > boost::uint64_t(info.st_size)) {
+		close(fd);
+		return NULL;
+	}
+
+	// mappings have to start at a multiple of the page size
+	const size_t pageSize = sysconf(_SC_PAGESIZE);
+	const size_t alignedOffset = offset - (offset % pageSize);
+	const size_t alignedSize = size + (offset - alignedOffset);
+
+	void* base = mmap(NULL, alignedSize, PROT_READ, MAP_SHARED, fd, alignedOffset);
+
+	// the mapping stays valid after the descriptor is closed
+	close(fd);
+
+	if (base == MAP_FAILED)
+		return NULL;
+
+	mapBase = base;
+	mapSize = alignedSize;
+	return (reinterpret_cast<const boost::uint8_t*>(mapBase) + (offset - alignedOffset));
+}
+
+void CFileView::Storage::Unmap()
+{
+	if (mapBase != NULL) {
+		munmap(mapBase, mapSize);
+	}
+
+	mapBase = NULL;
+	mapSize = 0;
+}
+
+#endif
+
+
+
+CFileView::CFileView(): data(NULL), size(0)
+{
+}
+
+
+bool CFileView::MapFile(const std::string& filePath, size_t offset, size_t size)
+{
+	Clear();
+
+	// zero-sized mappings are not allowed
+	if (size == 0)
+		return false;
+
+	boost::shared_ptr<Storage> newStorage(new Storage());
+	const boost::uint8_t* newData = newStorage->Map(filePath, offset, size);
+
+	if (newData == NULL)
+		return false;
+
+	storage = newStorage;
+	data = newData;
+	this->size = size;
+	return true;
+}
+
+
+void CFileView::SetBuffer(std::vector<boost::uint8_t>& buffer)
+{
+	Clear();
+
+	storage.reset(new Storage());
+	storage->buffer.swap(buffer);
+
+	data = (storage->buffer.empty())? NULL: &storage->buffer[0];
+	size = storage->buffer.size();
+}
+
+
+void CFileView::Clear()
+{
+	storage.reset();
+
+	data = NULL;
+	size = 0;
+}
+
+
+bool CFileView::IsMapped() const
+{
+	return (storage && storage->mapBase != NULL);
+}
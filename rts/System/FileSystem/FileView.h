@@ -0,0 +1,46 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _FILE_VIEW_H
+#define _FILE_VIEW_H
+
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+/**
+ * Read-only view of the contents of a file.
+ * Stored zip entries are memory-mapped instead of being copied; everything
+ * else (including loose files of directory archives, which may change on
+ * disk while mapped) ends up in a buffer owned by the view.
+ * Copies share the underlying mapping or buffer.
+ */
+class CFileView
+{
+public:
+	CFileView();
+
+	/**
+	 * Maps size bytes starting at offset of a file on the real filesystem.
+	 * @return false if the file could not be mapped, the view is empty then
+	 */
+	bool MapFile(const std::string& filePath, size_t offset, size_t size);
+	/// Takes over the contents of buffer (buffer is empty afterwards)
+	void SetBuffer(std::vector<boost::uint8_t>& buffer);
+	void Clear();
+
+	const boost::uint8_t* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+	bool Empty() const { return (size == 0); }
+	bool IsMapped() const;
+
+private:
+	struct Storage;
+
+	boost::shared_ptr<Storage> storage;
+
+	const boost::uint8_t* data;
+	size_t size;
+};
+
+#endif // _FILE_VIEW_H
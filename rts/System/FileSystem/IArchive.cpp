@@ -1,6 +1,7 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
 #include "IArchive.h"
+#include "FileView.h"
 
 #include "System/CRC.h"
 #include "System/Util.h"
@@ -40,6 +41,10 @@ bool IArchive::HasLowReadingCost(unsigned int fid) const
 	return true;
 }
 
+void IArchive::Prefetch(const std::vector<unsigned int>& fids)
+{
+}
+
 unsigned int IArchive::GetCrc32(unsigned int fid)
 {
 	CRC crc;
@@ -51,6 +56,19 @@ unsigned int IArchive::GetCrc32(unsigned int fid)
 	return crc.GetDigest();
 }
 
+bool IArchive::GetFileView(unsigned int fid, CFileView& view)
+{
+	std::vector<boost::uint8_t> buffer;
+
+	if (!GetFile(fid, buffer)) {
+		view.Clear();
+		return false;
+	}
+
+	view.SetBuffer(buffer);
+	return true;
+}
+
 bool IArchive::GetFile(const std::string& name, std::vector<boost::uint8_t>& buffer)
 {
 	const unsigned int fid = FindFile(name);
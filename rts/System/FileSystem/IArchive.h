@@ -8,6 +8,8 @@
 #include <map>
 #include <boost/cstdint.hpp>
 
+class CFileView;
+
 /**
  * @brief Abstraction of different archive types
  *
@@ -72,6 +74,13 @@ public:
 	 * @see GetFile(unsigned int fid, std::vector<boost::uint8_t>& buffer)
 	 */
 	bool GetFile(const std::string& name, std::vector<boost::uint8_t>& buffer);
+	/**
+	 * Fetches a read-only view of the content of a file by its ID.
+	 * Archives that store a file uncompressed map it into memory,
+	 * the default implementation copies it via GetFile.
+	 * @return true if the file was found and could be read
+	 */
+	virtual bool GetFileView(unsigned int fid, CFileView& view);
 	/**
 	 * Fetches the name and size in bytes of a file by its ID.
 	 */
@@ -92,6 +101,13 @@ public:
 	 * Fetches the CRC32 hash of a file by its ID.
 	 */
 	virtual unsigned int GetCrc32(unsigned int fid);
+	/**
+	 * Hints that the given files are going to be read soon.
+	 * Archives that have to decompress files may do so ahead of time,
+	 * the default implementation does nothing.
+	 * @param fids file IDs in [0, NumFiles())
+	 */
+	virtual void Prefetch(const std::vector<unsigned int>& fids);
 
 
 protected:
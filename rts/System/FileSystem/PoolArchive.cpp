@@ -8,6 +8,7 @@
 #include <sstream>
 #include <string>
 #include <cstring>
+#include <cassert>
 #include <iostream>
 
 #include "DataDirsAccess.h"
@@ -28,7 +29,7 @@ IArchive* CPoolArchiveFactory::DoCreateArchive(const std::string& filePath) cons
 }
 
 
-static unsigned int parse_int32(unsigned char c[4])
+static unsigned int parse_int32(const unsigned char c[4])
 {
 	unsigned int i = 0;
 	i = c[0] << 24 | i;
@@ -38,50 +39,64 @@ static unsigned int parse_int32(unsigned char c[4])
 	return i;
 }
 
-static bool gz_really_read(gzFile file, voidp buf, unsigned int len)
+/// reads and decompresses a whole gzip file in large chunks
+static bool gz_read_file(const std::string& path, std::vector<unsigned char>& buffer)
 {
-	return gzread(file, (char*)buf, len) == len;
+	gzFile in = gzopen(path.c_str(), "rb");
+	if (in == NULL)
+		return false;
+
+	const int chunkSize = 64 * 1024;
+	size_t numRead = 0;
+	int bytesRead = 0;
+
+	do {
+		buffer.resize(numRead + chunkSize);
+		bytesRead = gzread(in, (char*)&buffer[numRead], chunkSize);
+		numRead += std::max(bytesRead, 0);
+	} while (bytesRead == chunkSize);
+
+	gzclose(in);
+	buffer.resize(numRead);
+	return (bytesRead >= 0);
 }
 
 CPoolArchive::CPoolArchive(const std::string& name)
 	: CBufferedArchive(name)
 	, isOpen(false)
 {
-	char c_name[255];
-	unsigned char c_md5[16];
-	unsigned char c_crc32[4];
-	unsigned char c_size[4];
+	std::vector<unsigned char> index;
 
-	gzFile in = gzopen(name.c_str(), "rb");
-	if (in == NULL) {
+	if (!gz_read_file(name, index)) {
 		LOG_L(L_ERROR, "Error opening %s", name.c_str());
 		return;
 	}
 
-	while (true) {
-		if (gzeof(in)) {
-			isOpen = true;
-			break;
-		}
+	// md5 + crc32 + size
+	const size_t entryTail = 16 + 4 + 4;
+	size_t pos = 0;
+
+	while (pos < index.size()) {
+		const size_t length = index[pos];
 
-		int length = gzgetc(in);
-		if (length == -1) break;
+		if ((pos + 1 + length + entryTail) > index.size()) break;
 
-		if (!gz_really_read(in, &c_name, length)) break;
-		if (!gz_really_read(in, &c_md5, 16)) break;
-		if (!gz_really_read(in, &c_crc32, 4)) break;
-		if (!gz_really_read(in, &c_size, 4)) break;
+		const unsigned char* entry = &index[pos + 1];
 
 		FileData* f = new FileData;
-		f->name = std::string(c_name, length);
-		std::memcpy(&f->md5, &c_md5, 16);
-		f->crc32 = parse_int32(c_crc32);
-		f->size = parse_int32(c_size);
+		f->name = std::string((const char*)entry, length);
+		std::memcpy(&f->md5, entry + length, 16);
+		f->crc32 = parse_int32(entry + length + 16);
+		f->size = parse_int32(entry + length + 20);
 
 		files.push_back(f);
 		lcNameIndex[f->name] = files.size() - 1;
+
+		pos += (1 + length + entryTail);
 	}
-	gzclose(in);
+
+	// a truncated last entry means a broken index
+	isOpen = (pos == index.size());
 }
 
 CPoolArchive::~CPoolArchive()
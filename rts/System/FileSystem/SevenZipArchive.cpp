@@ -14,6 +14,7 @@ extern "C" {
 #include "lib/7z/7zCrc.h"
 }
 
+#include "ArchiveFileCache.h"
 #include "System/Util.h"
 #include "System/mmgr.h"
 #include "System/Log/ILog.h"
@@ -102,6 +103,8 @@ CSevenZipArchive::CSevenZipArchive(const std::string& name) :
 		folderUnpackSizes[fi] = SzFolder_GetUnpackSize(db.db.Folders + fi);
 	}
 
+	fileIndexToFid.resize(db.db.NumFiles, -1);
+
 	// Get contents of archive and store name->int mapping
 	for (unsigned int i = 0; i < db.db.NumFiles; ++i) {
 		CSzFileItem* f = db.db.Files + i;
@@ -126,6 +129,7 @@ CSevenZipArchive::CSevenZipArchive(const std::string& name) :
 			StringToLowerInPlace(fileName);
 			fileData.push_back(fd);
 			lcNameIndex[fileName] = fileData.size()-1;
+			fileIndexToFid[i] = fileData.size()-1;
 		}
 	}
 
@@ -134,6 +138,8 @@ CSevenZipArchive::CSevenZipArchive(const std::string& name) :
 
 CSevenZipArchive::~CSevenZipArchive()
 {
+	archiveFileCache.RemoveArchive(this);
+
 	if (outBuffer) {
 		IAlloc_Free(&allocImp, outBuffer);
 	}
@@ -155,22 +161,82 @@ unsigned int CSevenZipArchive::NumFiles() const
 
 bool CSevenZipArchive::GetFile(unsigned int fid, std::vector<boost::uint8_t>& buffer)
 {
-	boost::mutex::scoped_lock lck(archiveLock);
 	assert(IsFileId(fid));
-	
+
+	if (archiveFileCache.GetFile(this, fid, buffer)) {
+		return true;
+	}
+
+	boost::mutex::scoped_lock lck(archiveLock);
+
+	// the block may have been decoded (and sliced) while we were waiting
+	if (archiveFileCache.GetFile(this, fid, buffer)) {
+		return true;
+	}
+
 	// Get 7zip to decompress it
 	size_t offset;
 	size_t outSizeProcessed;
 	SRes res;
 
+	const UInt32 oldBlockIndex = blockIndex;
+
 	res = SzAr_Extract(&db, &lookStream.s, fileData[fid].fp, &blockIndex, &outBuffer, &outBufferSize, &offset, &outSizeProcessed, &allocImp, &allocTempImp);
-	if (res == SZ_OK) {
-		buffer.resize(outSizeProcessed);
-		memcpy(&buffer[0], (char*)outBuffer+offset, outSizeProcessed);
-		return true;
-	} else {
+	if (res != SZ_OK) {
 		return false;
 	}
+
+	buffer.resize(outSizeProcessed);
+	if (outSizeProcessed > 0) {
+		memcpy(&buffer[0], (char*)outBuffer+offset, outSizeProcessed);
+	}
+
+	archiveFileCache.AddFile(this, fid, buffer);
+
+	// a solid block is decoded as a whole, keep the other files in it
+	// too instead of decoding the block again when they are requested
+	if (blockIndex != oldBlockIndex) {
+		CacheBlockFiles(blockIndex, fid);
+	}
+
+	return true;
+}
+
+void CSevenZipArchive::CacheBlockFiles(UInt32 folderIndex, unsigned int skipFid)
+{
+	if (folderIndex == ((UInt32)-1) || !archiveFileCache.IsEnabled()) {
+		return;
+	}
+
+	// same layout SzAr_Extract assumes: the files of a folder are stored
+	// back to back in file-index order, starting at FolderStartFileIndex
+	std::vector<boost::uint8_t> buffer;
+	size_t offset = 0;
+
+	for (UInt32 i = db.FolderStartFileIndex[folderIndex]; i < db.db.NumFiles; ++i) {
+		if (db.FileIndexToFolderIndexMap[i] != folderIndex) {
+			break;
+		}
+
+		const CSzFileItem* f = db.db.Files + i;
+		const size_t size = f->Size;
+		const int fid = fileIndexToFid[i];
+
+		if ((offset + size) > outBufferSize) {
+			break;
+		}
+
+		if (fid >= 0 && fid != int(skipFid)) {
+			const Byte* data = outBuffer + offset;
+
+			if (!f->FileCRCDefined || CrcCalc(data, size) == f->FileCRC) {
+				buffer.assign(data, data + size);
+				archiveFileCache.AddFile(this, fid, buffer);
+			}
+		}
+
+		offset += size;
+	}
 }
 
 void CSevenZipArchive::FileInfo(unsigned int fid, std::string& name, int& size) const
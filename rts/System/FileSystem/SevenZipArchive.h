@@ -43,7 +43,10 @@ public:
 	virtual unsigned GetCrc32(unsigned int fid);
 
 private:
-	boost::mutex archiveLock;
+	/// Hands all files of the solid block in outBuffer to archiveFileCache
+	void CacheBlockFiles(UInt32 folderIndex, unsigned int skipFid);
+
+	boost::mutex archiveLock; // 7zip is not threadsafe
 	UInt32 blockIndex;
 	Byte* outBuffer;
 	size_t outBufferSize;
@@ -94,6 +97,8 @@ private:
 		int packedSize;
 	};
 	std::vector<FileData> fileData;
+	/// maps 7zip file indices to our fids (-1 for directories)
+	std::vector<int> fileIndexToFid;
 
 	CFileInStream archiveStream;
 	CSzArEx db;
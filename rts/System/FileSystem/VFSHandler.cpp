@@ -8,9 +8,11 @@
 #include <set>
 #include <cstring>
 
+#include "ArchiveFileCache.h"
 #include "ArchiveLoader.h"
 #include "IArchive.h"
 #include "FileSystem.h"
+#include "FileView.h"
 #include "ArchiveScanner.h"
 #include "System/Exceptions.h"
 #include "System/Log/ILog.h"
@@ -122,6 +124,11 @@ CVFSHandler::~CVFSHandler()
 {
 	LOG_L(L_DEBUG, "CVFSHandler::~CVFSHandler()");
 
+	const CArchiveFileCache::Stats stats = archiveFileCache.GetStats();
+	LOG("[VFS] archive file-cache: %u hits, %u misses, %u evictions, %u files (%u of %u KB) cached",
+			stats.hits, stats.misses, stats.evictions, stats.numFiles,
+			(unsigned int) (stats.numBytes / 1024), (unsigned int) (stats.maxBytes / 1024));
+
 	for (std::map<std::string, IArchive*>::iterator i = archives.begin(); i != archives.end(); ++i) {
 		delete i->second;
 	}
@@ -166,6 +173,74 @@ bool CVFSHandler::LoadFile(const std::string& filePath, std::vector<boost::uint8
 	return true;
 }
 
+bool CVFSHandler::LoadFileView(const std::string& filePath, CFileView& view)
+{
+	LOG_L(L_DEBUG, "LoadFileView(filePath = \"%s\", )", filePath.c_str());
+
+	const std::string normalizedPath = GetNormalizedPath(filePath);
+
+	const FileData* fileData = GetFileData(normalizedPath);
+	if (fileData == NULL) {
+		LOG_L(L_DEBUG, "LoadFileView: File '%s' does not exist in VFS.", filePath.c_str());
+		return false;
+	}
+
+	const unsigned int fid = fileData->ar->FindFile(normalizedPath);
+	if (!fileData->ar->IsFileId(fid) || !fileData->ar->GetFileView(fid, view))
+	{
+		LOG_L(L_DEBUG, "LoadFileView: File '%s' does not exist in archive.", filePath.c_str());
+		return false;
+	}
+	return true;
+}
+
+std::string CVFSHandler::GetFileArchiveName(const std::string& filePath)
+{
+	const std::string normalizedPath = GetNormalizedPath(filePath);
+
+	const FileData* fileData = GetFileData(normalizedPath);
+	if (fileData == NULL) {
+		return "";
+	}
+
+	return fileData->ar->GetArchiveName();
+}
+
+void CVFSHandler::PrefetchDirs(const std::vector<std::string>& rawDirs)
+{
+	std::map<IArchive*, std::vector<unsigned int> > archiveFiles;
+	unsigned int numFiles = 0;
+
+	for (std::vector<std::string>::const_iterator di = rawDirs.begin(); di != rawDirs.end(); ++di) {
+		std::string dir = GetNormalizedPath(*di);
+
+		if (dir.empty()) {
+			continue;
+		}
+		if (dir[dir.length() - 1] != '/') {
+			dir += "/";
+		}
+
+		std::map<std::string, FileData>::const_iterator fi;
+		for (fi = files.lower_bound(dir); fi != files.end(); ++fi) {
+			if (fi->first.compare(0, dir.length(), dir) != 0) {
+				break;
+			}
+
+			IArchive* ar = fi->second.ar;
+			archiveFiles[ar].push_back(ar->FindFile(fi->first));
+			numFiles++;
+		}
+	}
+
+	LOG("[%s] %u files in %u archives", __FUNCTION__, numFiles, (unsigned int) archiveFiles.size());
+
+	std::map<IArchive*, std::vector<unsigned int> >::const_iterator ai;
+	for (ai = archiveFiles.begin(); ai != archiveFiles.end(); ++ai) {
+		ai->first->Prefetch(ai->second);
+	}
+}
+
 bool CVFSHandler::FileExists(const std::string& filePath)
 {
 	LOG_L(L_DEBUG, "FileExists(filePath = \"%s\", )", filePath.c_str());
@@ -9,6 +9,7 @@
 #include <boost/cstdint.hpp>
 
 class IArchive;
+class CFileView;
 
 /**
  * Main API for accessing the Virtual File System (VFS).
@@ -37,6 +38,30 @@ public:
 	 * @return true if the file exists in the VFS and was successfully read
 	 */
 	bool LoadFile(const std::string& filePath, std::vector<boost::uint8_t>& buffer);
+	/**
+	 * Like LoadFile, but avoids copying uncompressed content.
+	 * @param filePath raw file path, for example "maps/myMap.smf",
+	 *   case-insensitive
+	 * @return true if the file exists in the VFS and was successfully read
+	 * @see CFileView
+	 */
+	bool LoadFileView(const std::string& filePath, CFileView& view);
+	/**
+	 * Returns the name of the archive a file is read from.
+	 * @param filePath raw file path, for example "maps/myMap.smf",
+	 *   case-insensitive
+	 * @return the archive name, or an empty string if the file does not
+	 *   exist in the VFS
+	 */
+	std::string GetFileArchiveName(const std::string& filePath);
+	/**
+	 * Lets the archives decompress all files in the given (virtual)
+	 * directories and their sub-directories ahead of use.
+	 * @param dirs raw directory paths, for example "gamedata/",
+	 *   case-insensitive
+	 * @see IArchive::Prefetch
+	 */
+	void PrefetchDirs(const std::vector<std::string>& dirs);
 
 	/**
 	 * Returns all the files in the given (virtual) directory without the
@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <stdexcept>
 
+#include "FileView.h"
 #include "System/Util.h"
 #include "System/mmgr.h"
 #include "System/Log/ILog.h"
@@ -59,18 +60,49 @@ CZipArchive::CZipArchive(const std::string& archiveName)
 		fd.size = info.uncompressed_size;
 		fd.origName = fName;
 		fd.crc = info.crc;
+		fd.stored = (info.compression_method == 0) && ((info.flag & 1) == 0);
 		fileData.push_back(fd);
 		lcNameIndex[fLowerName] = fileData.size() - 1;
 	}
+
+	freeHandles.push_back(zip);
 }
 
 CZipArchive::~CZipArchive()
 {
-	if (zip) {
-		unzClose(zip);
+	// all handles are back in the pool by now (zip included)
+	for (std::vector<unzFile>::iterator it = freeHandles.begin(); it != freeHandles.end(); ++it) {
+		unzClose(*it);
 	}
 }
 
+unzFile CZipArchive::AcquireHandle()
+{
+	{
+		boost::mutex::scoped_lock lck(handlesMutex);
+
+		if (!freeHandles.empty()) {
+			const unzFile handle = freeHandles.back();
+			freeHandles.pop_back();
+			return handle;
+		}
+	}
+
+#ifdef USEWIN32IOAPI
+	zlib_filefunc_def ffunc;
+	fill_win32_filefunc(&ffunc);
+	return unzOpen2(GetArchiveName().c_str(), &ffunc);
+#else
+	return unzOpen(GetArchiveName().c_str());
+#endif
+}
+
+void CZipArchive::ReleaseHandle(unzFile handle)
+{
+	boost::mutex::scoped_lock lck(handlesMutex);
+	freeHandles.push_back(handle);
+}
+
 bool CZipArchive::IsOpen()
 {
 	return (zip != NULL);
@@ -96,9 +128,55 @@ unsigned int CZipArchive::GetCrc32(unsigned int fid)
 	return fileData[fid].crc;
 }
 
+bool CZipArchive::GetFileView(unsigned int fid, CFileView& view)
+{
+	assert(IsFileId(fid));
+
+	const FileData& fd = fileData[fid];
+
+	if (!zip || !fd.stored || fd.size <= 0) {
+		return CBufferedArchive::GetFileView(fid, view);
+	}
+
+	unzFile handle = AcquireHandle();
+
+	if (!handle) {
+		return false;
+	}
+
+	// open in raw mode, we only want the position of the data
+	int method = 0;
+	unsigned long dataPos = 0;
+
+	unzGoToFilePos(handle, &fileData[fid].fp);
+
+	if (unzOpenCurrentFile2(handle, &method, NULL, 1) == UNZ_OK) {
+		dataPos = unzGetCurrentFileZStreamPos(handle);
+		unzCloseCurrentFile(handle);
+	}
+
+	ReleaseHandle(handle);
+
+	if (dataPos != 0 && view.MapFile(GetArchiveName(), dataPos, fd.size)) {
+		// unzReadCurrentFile checks this for buffered reads, so do the same
+		// once here instead of trusting the mapped bytes on every access
+		const uLong crc = crc32(crc32(0L, Z_NULL, 0), view.GetData(), view.GetSize());
+
+		if (crc == fd.crc) {
+			return true;
+		}
+
+		LOG_L(L_WARNING, "CRC error in %s of %s (stored entry)", fd.origName.c_str(), GetArchiveName().c_str());
+		view.Clear();
+		return false;
+	}
+
+	return CBufferedArchive::GetFileView(fid, view);
+}
+
 // To simplify things, files are always read completely into memory from
 // the zip-file, since zlib does not provide any way of reading more
-// than one file at a time
+// than one file at a time per handle
 bool CZipArchive::GetFileImpl(unsigned int fid, std::vector<boost::uint8_t>& buffer)
 {
 	// Prevent opening files on missing/invalid archives
@@ -107,26 +185,35 @@ bool CZipArchive::GetFileImpl(unsigned int fid, std::vector<boost::uint8_t>& buf
 	}
 	assert(IsFileId(fid));
 
-	unzGoToFilePos(zip, &fileData[fid].fp);
+	unzFile handle = AcquireHandle();
+
+	if (!handle) {
+		return false;
+	}
+
+	unzGoToFilePos(handle, &fileData[fid].fp);
 
 	unz_file_info fi;
-	unzGetCurrentFileInfo(zip, &fi, NULL, 0, NULL, 0, NULL, 0);
+	unzGetCurrentFileInfo(handle, &fi, NULL, 0, NULL, 0, NULL, 0);
 
-	if (unzOpenCurrentFile(zip) != UNZ_OK) {
+	if (unzOpenCurrentFile(handle) != UNZ_OK) {
+		ReleaseHandle(handle);
 		return false;
 	}
 
 	buffer.resize(fi.uncompressed_size);
 
 	bool ret = true;
-	if (!buffer.empty() && unzReadCurrentFile(zip, &buffer[0], fi.uncompressed_size) != fi.uncompressed_size) {
+	if (!buffer.empty() && unzReadCurrentFile(handle, &buffer[0], fi.uncompressed_size) != fi.uncompressed_size) {
 		ret = false;
 	}
 
-	if (unzCloseCurrentFile(zip) == UNZ_CRCERROR) {
+	if (unzCloseCurrentFile(handle) == UNZ_CRCERROR) {
 		ret = false;
 	}
 
+	ReleaseHandle(handle);
+
 	if (!ret) {
 		buffer.clear();
 	}
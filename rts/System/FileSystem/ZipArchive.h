@@ -17,6 +17,7 @@
 
 #include <string>
 #include <vector>
+#include <boost/thread/mutex.hpp>
 
 
 /**
@@ -45,15 +46,29 @@ public:
 	virtual unsigned int NumFiles() const;
 	virtual void FileInfo(unsigned int fid, std::string& name, int& size) const;
 	virtual unsigned int GetCrc32(unsigned int fid);
+	/// stored (uncompressed) entries are mapped directly from the zip-file, their CRC is checked when mapping
+	virtual bool GetFileView(unsigned int fid, CFileView& view);
 
 protected:
+	/// the handle used to build the file index, also the first in the pool
 	unzFile zip;
 
+	/**
+	 * zlib handles can only read one file at a time, so each concurrent
+	 * reader gets its own handle; idle ones are kept here for reuse.
+	 */
+	std::vector<unzFile> freeHandles;
+	boost::mutex handlesMutex;
+
+	unzFile AcquireHandle();
+	void ReleaseHandle(unzFile handle);
+
 	struct FileData {
 		unz_file_pos fp;
 		int size;
 		std::string origName;
 		unsigned int crc;
+		bool stored; ///< neither compressed nor encrypted
 	};
 	std::vector<FileData> fileData;
 	
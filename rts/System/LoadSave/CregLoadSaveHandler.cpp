@@ -1,10 +1,12 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
 #include <fstream>
+#include <sstream>
 #include "System/mmgr.h"
 
 #include "ExternalAI/EngineOutHandler.h"
 #include "CregLoadSaveHandler.h"
+#include "SaveFileWriter.h"
 #include "Map/ReadMap.h"
 #include "Game/Game.h"
 #include "Game/GameSetup.h"
@@ -26,15 +28,33 @@
 #include "Sim/Units/CommandAI/BuilderCAI.h"
 #include "Sim/Units/Groups/GroupHandler.h"
 
+#include "System/Platform/byteorder.h"
 #include "System/Platform/errorhandler.h"
+#include "System/Config/ConfigHandler.h"
 #include "System/FileSystem/DataDirsAccess.h"
 #include "System/FileSystem/FileQueryFlags.h"
+#include "System/FileSystem/FileSystem.h"
 #include "System/creg/Serializer.h"
 #include "System/Exceptions.h"
+#include "System/TimeProfiler.h"
 #include "System/Log/ILog.h"
 
+#include <zlib.h>
+
+CONFIG(bool, SaveGameCompression)
+	.defaultValue(true)
+	.description("Compress savegames with zlib while they are being written.");
+
+/**
+ * After the script, mod and map strings a savegame contains
+ *   [SAVE_FILE_ID] [compressed flag] [payload] [payload size]
+ * where the payload (deflated if the flag is set) is
+ *   [creg package] [AI data] [package size] [AI data size]
+ */
+#define SAVE_FILE_ID "SSF2"
+
 CCregLoadSaveHandler::CCregLoadSaveHandler()
-	: ifs(NULL)
+	: saveFileOffset(0)
 {}
 
 CCregLoadSaveHandler::~CCregLoadSaveHandler()
@@ -69,15 +89,29 @@ static void WriteString(std::ostream& s, std::string& str)
 	s.write(&c, sizeof(char));
 }
 
-static void ReadString(std::istream& s, std::string& str)
+static void ReadString(const CFileView& file, size_t& offset, std::string& str)
 {
-	char c;
-	// read until string-termination NULL char is encountered
-	s.read(&c, sizeof(char));
-	while (c != '\0') {
-		str += c;
-		s.read(&c, sizeof(char));
-	}
+	const char* begin = (const char*)file.GetData() + offset;
+	const char* end = (const char*)memchr(begin, '\0', file.GetSize() - offset);
+
+	if (end == NULL)
+		throw content_error("Savegame is truncated");
+
+	str.assign(begin, end);
+	offset += (end - begin) + 1;
+}
+
+static void WriteUInt32(std::ostream& s, boost::uint32_t value)
+{
+	value = swabDWord(value);
+	s.write((const char*)&value, sizeof(value));
+}
+
+static boost::uint32_t ReadUInt32(const boost::uint8_t* data)
+{
+	boost::uint32_t value;
+	memcpy(&value, data, sizeof(value));
+	return swabDWord(value);
 }
 
 void CGameStateCollector::Serialize(creg::ISerializer& s)
@@ -124,6 +158,8 @@ void CCregLoadSaveHandler::SaveGame(const std::string& file)
 {
 	LOG("Saving game");
 	try {
+		ScopedOnceTimer timer("CregLoadSaveHandler::SaveGame");
+
 		std::ofstream ofs(dataDirsAccess.LocateFile(file, FileQueryFlags::WRITE).c_str(), std::ios::out|std::ios::binary);
 		if (ofs.bad() || !ofs.is_open()) {
 			throw content_error("Unable to save game to file \"" + file + "\"");
@@ -136,14 +172,47 @@ void CCregLoadSaveHandler::SaveGame(const std::string& file)
 		WriteString(ofs, modName);
 		WriteString(ofs, mapName);
 
+		const bool compress = configHandler->GetBool("SaveGameCompression");
+		const char compressFlag = compress? 1: 0;
+
+		ofs.write(SAVE_FILE_ID, 4);
+		ofs.write(&compressFlag, sizeof(char));
+
+		// the package is compressed and written
+		// while the rest of it is still serialized
+		CSaveFileWriter writer(&ofs, compress);
+		creg::CChunkedBuffer buffer(creg::CChunkedBuffer::DEFAULT_CHUNK_SIZE, &writer);
+
 		CGameStateCollector* gsc = new CGameStateCollector();
 
 		creg::COutputStreamSerializer os;
-		os.SavePackage(&ofs, gsc, gsc->GetClass());
-		PrintSize("Game",ofs.tellp());
-		int aistart = ofs.tellp();
-		eoh->Save(&ofs);
-		PrintSize("AIs", ((int)ofs.tellp())-aistart);
+		os.SavePackage(&buffer, gsc, gsc->GetClass());
+		delete gsc;
+
+		const boost::uint32_t packageSize = swabDWord(boost::uint32_t(buffer.GetSize()));
+		PrintSize("Game", buffer.GetSize());
+
+		std::ostringstream aiData;
+		eoh->Save(&aiData);
+
+		const std::string& aiDataStr = aiData.str();
+		const boost::uint32_t aiSize = swabDWord(boost::uint32_t(aiDataStr.size()));
+		PrintSize("AIs", aiDataStr.size());
+
+		buffer.Write(aiDataStr.data(), aiDataStr.size());
+		buffer.Write(&packageSize, sizeof(packageSize));
+		buffer.Write(&aiSize, sizeof(aiSize));
+		buffer.Flush();
+
+		if (!writer.Finish()) {
+			throw content_error("Unable to write savegame \"" + file + "\"");
+		}
+
+		WriteUInt32(ofs, buffer.GetSize());
+
+		if (!ofs.good()) {
+			throw content_error("Unable to write savegame \"" + file + "\"");
+		}
 	} catch (const content_error& ex) {
 		LOG_L(L_ERROR, "Save failed(content error): %s", ex.what());
 	} catch (const std::exception& ex) {
@@ -158,19 +227,16 @@ void CCregLoadSaveHandler::SaveGame(const std::string& file)
 /// this just loads the mapname and some other early stuff
 void CCregLoadSaveHandler::LoadGameStartInfo(const std::string& file)
 {
-	const std::string file2 = FindSaveFile(file);
-	ifs = new std::ifstream (dataDirsAccess.LocateFile(file2).c_str(), std::ios::in|std::ios::binary);
-
-	// in case these contained values alredy
-	// (this is the case when loading a game through the spring menu eg),
-	// we set them to empty strings, as ReadString() does append,
-	// and we would end up with the correct value but two times
-	// eg: "AbcAbc" instead of "Abc"
-	scriptText = "";
-	modName = "";
-	mapName = "";
-
-	ReadString(*ifs, scriptText);
+	const std::string file2 = dataDirsAccess.LocateFile(FindSaveFile(file));
+
+	// the whole file is mapped, LoadGame reads the game state from it in place
+	if (!saveFile.MapFile(file2, 0, FileSystem::GetFileSize(file2))) {
+		throw content_error("Unable to load savegame \"" + file + "\"");
+	}
+
+	saveFileOffset = 0;
+
+	ReadString(saveFile, saveFileOffset, scriptText);
 	if (!scriptText.empty() && !gameSetup) {
 		CGameSetup* temp = new CGameSetup();
 		if (!temp->Init(scriptText)) {
@@ -182,26 +248,75 @@ void CCregLoadSaveHandler::LoadGameStartInfo(const std::string& file)
 		}
 	}
 
-	ReadString(*ifs, modName);
-	ReadString(*ifs, mapName);
+	ReadString(saveFile, saveFileOffset, modName);
+	ReadString(saveFile, saveFileOffset, mapName);
 }
 
 /// this should be called on frame 0 when the game has started
 void CCregLoadSaveHandler::LoadGame()
 {
+	ScopedOnceTimer timer("CregLoadSaveHandler::LoadGame");
+
+	const boost::uint8_t* fileData = saveFile.GetData() + saveFileOffset;
+	const size_t fileSize = saveFile.GetSize() - saveFileOffset;
+
+	// id, compressed flag, payload size
+	if (fileSize < (4 + 1 + 4) || memcmp(fileData, SAVE_FILE_ID, 4) != 0) {
+		throw content_error("Savegame was written by an incompatible version");
+	}
+
+	const bool compressed = (fileData[4] != 0);
+	const boost::uint8_t* storedData = fileData + 4 + 1;
+	const size_t storedSize = fileSize - (4 + 1 + 4);
+	const size_t payloadSize = ReadUInt32(fileData + fileSize - 4);
+
+	std::vector<boost::uint8_t> inflated;
+	const boost::uint8_t* payload = storedData;
+
+	if (compressed) {
+		// the size is known up-front, so this inflates in a single pass
+		inflated.resize(payloadSize);
+		uLongf inflatedSize = payloadSize;
+
+		if (payloadSize > 0 && uncompress(&inflated[0], &inflatedSize, storedData, storedSize) != Z_OK) {
+			throw content_error("Savegame is corrupt");
+		}
+		if (inflatedSize != payloadSize) {
+			throw content_error("Savegame is corrupt");
+		}
+
+		payload = (payloadSize > 0)? &inflated[0]: NULL;
+	} else if (storedSize != payloadSize) {
+		throw content_error("Savegame is truncated");
+	}
+
+	if (payloadSize < (4 + 4)) {
+		throw content_error("Savegame is truncated");
+	}
+
+	const size_t packageSize = ReadUInt32(payload + payloadSize - 8);
+	const size_t aiSize = ReadUInt32(payload + payloadSize - 4);
+
+	if ((packageSize + aiSize + 8) != payloadSize) {
+		throw content_error("Savegame is corrupt");
+	}
+
 	creg::CInputStreamSerializer inputStream;
 	void* pGSC = NULL;
 	creg::Class* gsccls = NULL;
-	inputStream.LoadPackage(ifs, pGSC, gsccls);
+	inputStream.LoadPackage(payload, packageSize, pGSC, gsccls);
 
 	assert (pGSC && gsccls == CGameStateCollector::StaticClass());
 
 	CGameStateCollector* gsc = (CGameStateCollector*)pGSC;
 	delete gsc; // the only job of gsc is to collect gamestate data
 	gsc = NULL;
-	eoh->Load(ifs);
-	delete ifs;
-	ifs = NULL;
+
+	std::istringstream aiData(std::string((const char*)payload + packageSize, aiSize));
+	eoh->Load(&aiData);
+
+	saveFile.Clear();
+	saveFileOffset = 0;
 	//for (int a=0; a < teamHandler->ActiveTeams(); a++) { // For old savegames
 	//	if (teamHandler->Team(a)->isDead && eoh->IsSkirmishAI(a)) {
 	//		eoh->DestroySkirmishAI(skirmishAIId(a), 2 /* = team died */);
@@ -4,8 +4,8 @@
 #define CREG_LOAD_SAVE_HANDLER_H
 
 #include <string>
-#include <fstream>
 #include "LoadSaveHandler.h"
+#include "System/FileSystem/FileView.h"
 
 class CLoadInterface;
 
@@ -20,7 +20,10 @@ public:
 	void LoadGame(); 
 
 protected:
-	std::ifstream* ifs;
+	/// the whole savegame, mapped by LoadGameStartInfo
+	CFileView saveFile;
+	/// where the game state starts, after the strings read by LoadGameStartInfo
+	size_t saveFileOffset;
 };
 
 #endif // CREG_LOAD_SAVE_HANDLER_H
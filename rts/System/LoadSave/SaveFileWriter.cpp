@@ -0,0 +1,157 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "SaveFileWriter.h"
+#include "System/Log/ILog.h"
+
+#include <ostream>
+#include <zlib.h>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+CSaveFileWriter::CSaveFileWriter(std::ostream* stream, bool compress)
+	: stream(stream)
+	, compress(compress)
+	, thread(NULL)
+	, finishing(false)
+	, failed(false)
+	, zStream(NULL)
+{
+	if (compress) {
+		zStream = new z_stream();
+		zBuffer.resize(creg::CChunkedBuffer::DEFAULT_CHUNK_SIZE);
+
+		// favour speed, most of the state compresses well anyway
+		if (deflateInit(zStream, Z_BEST_SPEED) != Z_OK) {
+			LOG_L(L_ERROR, "[%s] deflateInit failed", __FUNCTION__);
+			delete zStream;
+			zStream = NULL;
+			failed = true;
+			return;
+		}
+	}
+
+	thread = new boost::thread(boost::bind(&CSaveFileWriter::WriterThread, this));
+}
+
+CSaveFileWriter::~CSaveFileWriter()
+{
+	Finish();
+
+	if (zStream != NULL) {
+		deflateEnd(zStream);
+		delete zStream;
+	}
+}
+
+
+void CSaveFileWriter::ConsumeChunk(std::vector<boost::uint8_t>& chunk)
+{
+	boost::mutex::scoped_lock lock(mutex);
+
+	while (queue.size() >= MAX_QUEUED_CHUNKS && !failed) {
+		queueCond.wait(lock);
+	}
+
+	// still serialize everything, Finish reports the error
+	if (failed)
+		return;
+
+	queue.push_back(std::vector<boost::uint8_t>());
+	queue.back().swap(chunk);
+	queueCond.notify_all();
+}
+
+bool CSaveFileWriter::Finish()
+{
+	if (thread != NULL) {
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			finishing = true;
+			queueCond.notify_all();
+		}
+
+		thread->join();
+		delete thread;
+		thread = NULL;
+	}
+
+	return !failed;
+}
+
+
+void CSaveFileWriter::WriterThread()
+{
+	std::vector<boost::uint8_t> chunk;
+
+	while (true) {
+		bool last = false;
+
+		{
+			boost::mutex::scoped_lock lock(mutex);
+
+			while (queue.empty() && !finishing) {
+				queueCond.wait(lock);
+			}
+
+			if (queue.empty()) {
+				last = true;
+				chunk.clear();
+			} else {
+				chunk.swap(queue.front());
+				queue.pop_front();
+			}
+
+			// wake up a waiting producer
+			queueCond.notify_all();
+		}
+
+		if (!WriteChunk(chunk, last)) {
+			boost::mutex::scoped_lock lock(mutex);
+			failed = true;
+			queue.clear();
+			queueCond.notify_all();
+			return;
+		}
+
+		if (last)
+			return;
+	}
+}
+
+bool CSaveFileWriter::WriteChunk(const std::vector<boost::uint8_t>& chunk, bool last)
+{
+	if (!compress) {
+		if (!chunk.empty())
+			stream->write((const char*)&chunk[0], chunk.size());
+
+		if (last)
+			stream->flush();
+
+		return stream->good();
+	}
+
+	zStream->next_in = chunk.empty()? NULL: const_cast<Bytef*>(&chunk[0]);
+	zStream->avail_in = chunk.size();
+
+	const int flush = last? Z_FINISH: Z_NO_FLUSH;
+	int ret = Z_OK;
+
+	do {
+		zStream->next_out = &zBuffer[0];
+		zStream->avail_out = zBuffer.size();
+
+		ret = deflate(zStream, flush);
+
+		if (ret == Z_STREAM_ERROR) {
+			LOG_L(L_ERROR, "[%s] deflate failed", __FUNCTION__);
+			return false;
+		}
+
+		stream->write((const char*)&zBuffer[0], zBuffer.size() - zStream->avail_out);
+	} while (last? (ret != Z_STREAM_END): (zStream->avail_out == 0));
+
+	if (last)
+		stream->flush();
+
+	return stream->good();
+}
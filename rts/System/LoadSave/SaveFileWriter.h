@@ -0,0 +1,63 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef SAVE_FILE_WRITER_H
+#define SAVE_FILE_WRITER_H
+
+#include <deque>
+#include <iosfwd>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "System/creg/ChunkedBuffer.h"
+
+namespace boost {
+	class thread;
+}
+
+/**
+ * Receives the chunks of a savegame while it is being serialized and
+ * (optionally deflates and) writes them to a stream on a background thread.
+ * Only a few chunks are queued, the serializing thread waits when the
+ * writer falls behind so memory use stays bounded.
+ */
+class CSaveFileWriter : public creg::CChunkedBuffer::IConsumer
+{
+public:
+	/// the stream must not be used by anyone else until Finish returned
+	CSaveFileWriter(std::ostream* stream, bool compress);
+	~CSaveFileWriter();
+
+	void ConsumeChunk(std::vector<boost::uint8_t>& chunk);
+
+	/**
+	 * Writes all queued chunks (and the end of the deflate stream)
+	 * and stops the background thread.
+	 * @return false if compressing or writing failed
+	 */
+	bool Finish();
+
+private:
+	void WriterThread();
+	bool WriteChunk(const std::vector<boost::uint8_t>& chunk, bool last);
+
+private:
+	static const size_t MAX_QUEUED_CHUNKS = 4;
+
+	std::ostream* stream;
+	const bool compress;
+
+	boost::thread* thread;
+	boost::mutex mutex;
+	boost::condition_variable queueCond;
+	std::deque< std::vector<boost::uint8_t> > queue;
+	bool finishing;
+	bool failed;
+
+	/// only used by the background thread
+	struct z_stream_s* zStream;
+	std::vector<boost::uint8_t> zBuffer;
+};
+
+#endif // SAVE_FILE_WRITER_H
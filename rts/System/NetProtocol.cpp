@@ -136,6 +136,7 @@ void CNetProtocol::Send(boost::shared_ptr<const netcode::RawPacket> pkt)
 {
 	GML_STDMUTEX_LOCK(net); // Send
 
+	FlushAICommands();
 	serverConn->SendData(pkt);
 }
 
@@ -145,6 +146,43 @@ void CNetProtocol::Send(const netcode::RawPacket* pkt)
 	Send(ptr);
 }
 
+void CNetProtocol::SendAICommand(unsigned char myPlayerNum, short unitID, int id, int aiCommandId, unsigned char options, const float* params, size_t numParams)
+{
+	GML_STDMUTEX_LOCK(net); // SendAICommand
+
+	if (aiCommandId == -1) {
+		if (aiCommandBatch.Add(myPlayerNum, unitID, id, options, params, numParams))
+			return;
+
+		FlushAICommands();
+
+		if (aiCommandBatch.Add(myPlayerNum, unitID, id, options, params, numParams))
+			return;
+	}
+
+	FlushAICommands();
+	serverConn->SendData(CBaseNetProtocol::Get().SendAICommand(myPlayerNum, unitID, id, aiCommandId, options, params, numParams));
+}
+
+void CNetProtocol::FlushAICommands()
+{
+	if (aiCommandBatch.Empty())
+		return;
+
+	if (aiCommandBatch.GetNumUnits() == 1) {
+		// a plain NETMSG_AICOMMAND is smaller
+		float params[CAICommandBatch::MAX_PARAMS];
+		aiCommandBatch.GetUnitParams(0, params);
+
+		serverConn->SendData(CBaseNetProtocol::Get().SendAICommand(aiCommandBatch.GetPlayerNum(), aiCommandBatch.GetUnitID(0),
+			aiCommandBatch.GetCommandID(), -1, aiCommandBatch.GetOptions(), params, aiCommandBatch.GetNumParams()));
+	} else {
+		serverConn->SendData(aiCommandBatch.Pack());
+	}
+
+	aiCommandBatch.Clear();
+}
+
 void CNetProtocol::UpdateLoop()
 {
 	loading = true;
@@ -158,6 +196,7 @@ void CNetProtocol::Update()
 {
 	GML_STDMUTEX_LOCK(net); // Update
 
+	FlushAICommands();
 	serverConn->Update();
 }
 
@@ -169,6 +208,7 @@ void CNetProtocol::DisableDemoRecording()
 void CNetProtocol::Close(bool flush) {
 	GML_STDMUTEX_LOCK(net); // Close
 
+	FlushAICommands();
 	serverConn->Close(flush);
 }
 
@@ -8,6 +8,7 @@
 #include <boost/shared_ptr.hpp>
 
 #include "System/BaseNetProtocol.h" // not used in here, but in all files including this one
+#include "System/AICommandBatch.h"
 
 class CDemoRecorder;
 namespace netcode
@@ -85,6 +86,16 @@ public:
 	/// @overload
 	void Send(const netcode::RawPacket* pkt);
 
+	/**
+	 * @brief Send an order for a single unit given by an AI or Lua
+	 *
+	 * Untracked orders (aiCommandId == -1) are collected into a
+	 * NETMSG_AICOMMANDS_BATCH while they fit, the batch is sent before any
+	 * other message and on each Update, so the order of all messages
+	 * is kept.
+	 */
+	void SendAICommand(unsigned char myPlayerNum, short unitID, int id, int aiCommandId, unsigned char options, const float* params, size_t numParams);
+
 	CDemoRecorder* GetDemoRecorder() const { return record.get(); }
 
 	/**
@@ -103,8 +114,13 @@ public:
 
 	volatile bool loading;
 
+private:
+	/// sends the pending AI orders, the caller has to hold the net mutex
+	void FlushAICommands();
+
 private:
 	boost::scoped_ptr<netcode::CConnection> serverConn;
+	CAICommandBatch aiCommandBatch;
 	boost::scoped_ptr<CDemoRecorder> record;
 	bool disableDemo;
 };
@@ -0,0 +1,63 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/PoolAllocator.h"
+
+#include <boost/thread/mutex.hpp>
+
+static const size_t NUM_SIZE_CLASSES = CPoolAllocatorStorage::MAX_BLOCK_SIZE / CPoolAllocatorStorage::SIZE_CLASS_BYTES;
+
+/// first free block of each size class, a free block stores the next one
+static void* freeBlocks[NUM_SIZE_CLASSES + 1];
+
+/// never destroyed, containers may still free blocks during static destruction
+static boost::mutex& GetPoolMutex()
+{
+	static boost::mutex* mutex = new boost::mutex();
+	return *mutex;
+}
+
+static inline size_t GetSizeClass(size_t numBytes)
+{
+	return (numBytes + CPoolAllocatorStorage::SIZE_CLASS_BYTES - 1) / CPoolAllocatorStorage::SIZE_CLASS_BYTES;
+}
+
+
+void* CPoolAllocatorStorage::Alloc(size_t numBytes)
+{
+	if (numBytes == 0 || numBytes > MAX_BLOCK_SIZE)
+		return ::operator new(numBytes);
+
+	const size_t sizeClass = GetSizeClass(numBytes);
+
+	{
+		boost::mutex::scoped_lock lock(GetPoolMutex());
+
+		void* p = freeBlocks[sizeClass];
+
+		if (p != NULL) {
+			freeBlocks[sizeClass] = *static_cast<void**>(p);
+			return p;
+		}
+	}
+
+	// all blocks of a class have the same size, so they can be reused for any request of it
+	return ::operator new(sizeClass * SIZE_CLASS_BYTES);
+}
+
+void CPoolAllocatorStorage::Free(void* p, size_t numBytes)
+{
+	if (p == NULL)
+		return;
+
+	if (numBytes == 0 || numBytes > MAX_BLOCK_SIZE) {
+		::operator delete(p);
+		return;
+	}
+
+	const size_t sizeClass = GetSizeClass(numBytes);
+
+	boost::mutex::scoped_lock lock(GetPoolMutex());
+
+	*static_cast<void**>(p) = freeBlocks[sizeClass];
+	freeBlocks[sizeClass] = p;
+}
@@ -0,0 +1,72 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _POOL_ALLOCATOR_H_
+#define _POOL_ALLOCATOR_H_
+
+#include <cstddef>
+#include <new>
+
+/**
+ * Backing store of pool_allocator.
+ * Freed blocks are kept in free lists (one per size class) instead of being
+ * returned to the heap, like CMemPool does, but for larger blocks and safe
+ * to use from several threads.
+ * Blocks bigger than MAX_BLOCK_SIZE bypass the pool.
+ */
+class CPoolAllocatorStorage
+{
+public:
+	static const size_t SIZE_CLASS_BYTES = 16;
+	static const size_t MAX_BLOCK_SIZE = 1024;
+
+	static void* Alloc(size_t numBytes);
+	static void Free(void* p, size_t numBytes);
+};
+
+
+/**
+ * STL allocator on top of CPoolAllocatorStorage.
+ * For containers that are created and destroyed often and then make a few
+ * small, equally sized allocations, e.g. the std::deque of every command
+ * queue (its map and first block are allocated on construction already).
+ */
+template<typename T>
+class pool_allocator
+{
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template<typename U> struct rebind { typedef pool_allocator<U> other; };
+
+	pool_allocator() {}
+	pool_allocator(const pool_allocator&) {}
+	template<typename U> pool_allocator(const pool_allocator<U>&) {}
+
+	pointer address(reference x) const { return &x; }
+	const_pointer address(const_reference x) const { return &x; }
+
+	pointer allocate(size_type n, const void* = 0) {
+		return static_cast<pointer>(CPoolAllocatorStorage::Alloc(n * sizeof(T)));
+	}
+	void deallocate(pointer p, size_type n) {
+		CPoolAllocatorStorage::Free(p, n * sizeof(T));
+	}
+
+	size_type max_size() const { return (size_t(-1) / sizeof(T)); }
+
+	void construct(pointer p, const T& val) { new (p) T(val); }
+	void destroy(pointer p) { p->~T(); }
+};
+
+template<typename T, typename U>
+inline bool operator == (const pool_allocator<T>&, const pool_allocator<U>&) { return true; }
+template<typename T, typename U>
+inline bool operator != (const pool_allocator<T>&, const pool_allocator<U>&) { return false; }
+
+#endif // _POOL_ALLOCATOR_H_
@@ -0,0 +1,148 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef SLOT_MAP_H
+#define SLOT_MAP_H
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include "System/creg/creg_cond.h"
+
+/**
+ * @brief maps small integer ids to values, and hands out the ids
+ *
+ * Replaces the combination of a std::map<int, T> (or a vector indexed by
+ * id) and a std::list of free ids: the values are stored contiguously by
+ * id and the free ids are linked through the slots, so allocating, looking
+ * up and releasing an id are all O(1) without any allocation.
+ *
+ * Released ids are queued at the back of the free list and ids are taken
+ * from its front, so the order in which ids are reused only depends on the
+ * order of the calls (as required for synced ids).
+ * Every slot also counts how often its id was released, so a holder of an
+ * (id, generation) pair can tell whether the id was reused in the meantime.
+ */
+template<typename T>
+class CSlotMap
+{
+	CR_DECLARE_STRUCT(CSlotMap);
+
+public:
+	CSlotMap(): numUsed(0), freeHead(FREE_END), freeTail(FREE_END) {}
+
+	/// adds the ids [GetSize(), GetSize() + n), queued for use in ascending order
+	void AddSlots(int n) {
+		for (int i = 0; i < n; ++i) {
+			const int id = values.size();
+
+			values.push_back(T());
+			generations.push_back(0);
+			nextFree.push_back(SLOT_USED);
+			PushFree(id);
+		}
+	}
+	/**
+	 * adds the ids [GetSize(), GetSize() + newIDs.size()), queued for use in
+	 * the order given (e.g. shuffled so ids do not reveal counts)
+	 */
+	void AddSlots(const std::vector<int>& newIDs) {
+		const int first = values.size();
+
+		values.resize(first + newIDs.size(), T());
+		generations.resize(first + newIDs.size(), 0);
+		nextFree.resize(first + newIDs.size(), SLOT_USED);
+
+		for (size_t i = 0; i < newIDs.size(); ++i) {
+			assert(newIDs[i] >= first && newIDs[i] < GetSize() && nextFree[newIDs[i]] == SLOT_USED);
+			PushFree(newIDs[i]);
+		}
+	}
+
+	/// @return the id the value was stored under, -1 if all ids are in use
+	int Insert(const T& value) {
+		if (freeHead == FREE_END)
+			return -1;
+
+		const int id = freeHead;
+
+		freeHead = nextFree[id];
+		if (freeHead == FREE_END)
+			freeTail = FREE_END;
+
+		nextFree[id] = SLOT_USED;
+		values[id] = value;
+		++numUsed;
+		return id;
+	}
+	/// releases the id, it gets reused after all other currently free ones
+	void Erase(int id) {
+		assert(IsUsed(id));
+
+		values[id] = T();
+		generations[id]++;
+		--numUsed;
+		PushFree(id);
+	}
+
+	/// @return true if the id is in use (false for out-of-range ids)
+	bool IsUsed(int id) const {
+		return (id >= 0 && id < GetSize() && nextFree[id] == SLOT_USED);
+	}
+	/// @return how often the id was released
+	unsigned int GetGeneration(int id) const { return generations[id]; }
+	/// @return true if the id is in use and was not released since it had the given generation
+	bool IsCurrent(int id, unsigned int generation) const {
+		return (IsUsed(id) && generations[id] == generation);
+	}
+
+	/// the value stored under the id, T() for free ids; the id must be in [0, GetSize())
+	const T& operator[] (int id) const { return values[id]; }
+	T& operator[] (int id) { return values[id]; }
+
+	/// all ids are below this
+	int GetSize() const { return values.size(); }
+	int GetNumUsed() const { return numUsed; }
+	int GetNumFree() const { return (GetSize() - numUsed); }
+
+	void Clear() {
+		values.clear();
+		generations.clear();
+		nextFree.clear();
+
+		numUsed = 0;
+		freeHead = FREE_END;
+		freeTail = FREE_END;
+	}
+
+private:
+	enum {
+		FREE_END  = -1, ///< nextFree of the last free slot
+		SLOT_USED = -2, ///< nextFree of slots in use
+	};
+
+	void PushFree(int id) {
+		nextFree[id] = FREE_END;
+
+		if (freeTail == FREE_END) {
+			freeHead = id;
+		} else {
+			nextFree[freeTail] = id;
+		}
+
+		freeTail = id;
+	}
+
+public:
+	// public for the creg registration of the instantiations
+	std::vector<T> values;
+	std::vector<unsigned int> generations;
+	/// per slot the next free id, or SLOT_USED
+	std::vector<int> nextFree;
+
+	int numUsed;
+	int freeHead;
+	int freeTail;
+};
+
+#endif // SLOT_MAP_H
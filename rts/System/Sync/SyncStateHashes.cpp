@@ -0,0 +1,59 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "SyncStateHashes.h"
+
+const int CSyncStateHashes::NUM_FRAMES;
+
+static const char* subsystemNames[CSyncStateHashes::NUM_SUBSYSTEMS] = {
+	"units",
+	"features",
+	"projectiles",
+	"teams",
+	"heightmap",
+	"paths",
+};
+
+
+const char* CSyncStateHashes::GetSubsystemName(int subsystem)
+{
+	if (subsystem < 0 || subsystem >= NUM_SUBSYSTEMS)
+		return "unknown";
+
+	return subsystemNames[subsystem];
+}
+
+
+std::vector< std::vector<int> > CSyncStateHashes::FindDesyncs(const std::map<int, Hashes>& playerHashes, int refPlayer)
+{
+	std::vector< std::vector<int> > desyncs(NUM_SUBSYSTEMS);
+	std::map<int, Hashes>::const_iterator ref = playerHashes.find(refPlayer);
+
+	for (int s = 0; s < NUM_SUBSYSTEMS; ++s) {
+		boost::uint32_t correctHash = 0;
+
+		if (ref != playerHashes.end()) {
+			correctHash = ref->second[s];
+		} else {
+			// democracy, on a tie the lower hash wins
+			std::map<boost::uint32_t, int> counts;
+			int maxCount = 0;
+
+			for (std::map<int, Hashes>::const_iterator it = playerHashes.begin(); it != playerHashes.end(); ++it) {
+				counts[it->second[s]]++;
+			}
+			for (std::map<boost::uint32_t, int>::const_iterator it = counts.begin(); it != counts.end(); ++it) {
+				if (it->second > maxCount) {
+					maxCount = it->second;
+					correctHash = it->first;
+				}
+			}
+		}
+
+		for (std::map<int, Hashes>::const_iterator it = playerHashes.begin(); it != playerHashes.end(); ++it) {
+			if (it->second[s] != correctHash)
+				desyncs[s].push_back(it->first);
+		}
+	}
+
+	return desyncs;
+}
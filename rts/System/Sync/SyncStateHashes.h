@@ -0,0 +1,50 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef SYNC_STATE_HASHES_H
+#define SYNC_STATE_HASHES_H
+
+#include <map>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+/**
+ * @brief hashes of the synced state, one per subsystem
+ *
+ * Unlike the CSyncChecker checksum (which needs a SYNCCHECK build and only
+ * tells that something desynced), these are computed in every build by
+ * CSyncStateHasher and sent to the server (NETMSG_SYNCSTATE) once per
+ * round of NUM_FRAMES frames. The server compares them per subsystem, so a
+ * desync is narrowed down to e.g. the units or the heightmap right away.
+ */
+class CSyncStateHashes
+{
+public:
+	enum Subsystem {
+		SUBSYS_UNITS       = 0,
+		SUBSYS_FEATURES    = 1,
+		SUBSYS_PROJECTILES = 2,
+		SUBSYS_TEAMS       = 3,
+		SUBSYS_HEIGHTMAP   = 4,
+		SUBSYS_PATHS       = 5,
+		NUM_SUBSYSTEMS
+	};
+
+	/// the hashing of one round is spread over this many frames (10 seconds)
+	static const int NUM_FRAMES = 300;
+
+	typedef std::vector<boost::uint32_t> Hashes;
+
+	static const char* GetSubsystemName(int subsystem);
+
+	/**
+	 * @brief compares the hashes all players sent for one round
+	 * @param playerHashes hashes by player number
+	 * @param refPlayer player whose hashes are known to be correct (the
+	 *   local client of the server), -1 to use the most common hash of each
+	 *   subsystem instead
+	 * @return for each subsystem, the players whose hash differs
+	 */
+	static std::vector< std::vector<int> > FindDesyncs(const std::map<int, Hashes>& playerHashes, int refPlayer);
+};
+
+#endif // SYNC_STATE_HASHES_H
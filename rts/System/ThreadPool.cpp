@@ -0,0 +1,88 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "ThreadPool.h"
+#include "lib/streflop/streflop_cond.h"
+#include "System/Config/ConfigHandler.h"
+
+#include <algorithm>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/version.hpp>
+#include <boost/detail/atomic_count.hpp>
+
+
+namespace ThreadPool {
+
+int GetNumThreads()
+{
+	int numThreads = 0;
+
+	// the key is only declared in the engine, not in unitsync or the server
+	if (configHandler != NULL && configHandler->IsSet("HardwareThreadCount"))
+		numThreads = std::max(0, configHandler->GetInt("HardwareThreadCount"));
+
+	if (numThreads == 0) {
+		// auto-detect
+		#if (BOOST_VERSION >= 103500)
+		numThreads = boost::thread::hardware_concurrency();
+		#endif
+	}
+
+	return std::max(1, numThreads);
+}
+
+
+static void WorkerLoop(int end, boost::detail::atomic_count* next, const boost::function<void(int)>* func)
+{
+	// atomic_count starts at start - 1 and is pre-incremented
+	for (int i = ++(*next); i < end; i = ++(*next)) {
+		(*func)(i);
+	}
+}
+
+static void WorkerThread(int end, boost::detail::atomic_count* next, const boost::function<void(int)>* func)
+{
+#ifdef STREFLOP_H
+	// new threads start with the default FPU state, work items may be synced
+	streflop_init<streflop::Simple>();
+#endif
+
+	WorkerLoop(end, next, func);
+}
+
+
+void for_mt(int start, int end, const boost::function<void(int)>& func, int numThreads)
+{
+	if (start >= end)
+		return;
+
+	if (numThreads <= 0)
+		numThreads = GetNumThreads();
+
+	numThreads = std::min(numThreads, end - start);
+
+	if (numThreads == 1) {
+		for (int i = start; i < end; i++) {
+			func(i);
+		}
+		return;
+	}
+
+	boost::detail::atomic_count next(start - 1);
+	std::vector<boost::thread*> threads(numThreads - 1, NULL);
+
+	for (size_t n = 0; n < threads.size(); n++) {
+		threads[n] = new boost::thread(boost::bind(&WorkerThread, end, &next, &func));
+	}
+
+	// use the current thread as worker zero
+	WorkerLoop(end, &next, &func);
+
+	for (size_t n = 0; n < threads.size(); n++) {
+		threads[n]->join();
+		delete threads[n];
+	}
+}
+
+}
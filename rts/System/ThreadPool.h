@@ -0,0 +1,32 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <boost/function.hpp>
+
+/**
+ * Minimal helpers for spreading independent work items over all cores
+ * during loading; worker threads only live for the duration of a call.
+ */
+namespace ThreadPool {
+	/**
+	 * @brief number of threads to use for parallel work
+	 * Taken from the HardwareThreadCount config-value if set,
+	 * otherwise the number of cores reported by the system.
+	 */
+	int GetNumThreads();
+
+	/**
+	 * @brief calls func(i) for every i in [start, end)
+	 * Items are handed out one at a time to numThreads threads (the
+	 * calling thread included), so uneven items balance themselves.
+	 * Returns when all items have been processed.
+	 * Worker threads get the same (streflop) FPU state as the sim thread,
+	 * so func may do synced computations.
+	 * @param numThreads 0 means GetNumThreads()
+	 */
+	void for_mt(int start, int end, const boost::function<void(int)>& func, int numThreads = 0);
+}
+
+#endif // THREAD_POOL_H
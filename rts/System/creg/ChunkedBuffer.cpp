@@ -0,0 +1,99 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "ChunkedBuffer.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace creg;
+
+CChunkedBuffer::CChunkedBuffer(size_t chunkSize, IConsumer* consumer)
+	: chunkSize(chunkSize)
+	, consumer(consumer)
+	, chunk(chunkSize)
+	, chunkPos(0)
+	, totalSize(0)
+{
+	assert(chunkSize > 0);
+}
+
+
+void CChunkedBuffer::WriteSlow(const boost::uint8_t* data, size_t size)
+{
+	while (size > 0) {
+		if (chunkPos == chunkSize)
+			FinishChunk();
+
+		const size_t n = std::min(size, chunkSize - chunkPos);
+
+		memcpy(&chunk[chunkPos], data, n);
+		chunkPos += n;
+		totalSize += n;
+		data += n;
+		size -= n;
+	}
+}
+
+void CChunkedBuffer::FinishChunk()
+{
+	chunk.resize(chunkPos);
+
+	if (consumer != NULL) {
+		consumer->ConsumeChunk(chunk);
+	} else {
+		chunks.push_back(std::vector<boost::uint8_t>());
+		chunks.back().swap(chunk);
+	}
+
+	chunk.clear();
+	chunk.resize(chunkSize);
+	chunkPos = 0;
+}
+
+
+void CChunkedBuffer::Flush()
+{
+	if (consumer != NULL && chunkPos > 0) {
+		FinishChunk();
+	}
+}
+
+
+void CChunkedBuffer::CopyTo(boost::uint8_t* dst) const
+{
+	assert(consumer == NULL);
+
+	for (std::deque< std::vector<boost::uint8_t> >::const_iterator it = chunks.begin(); it != chunks.end(); ++it) {
+		if (!it->empty()) {
+			memcpy(dst, &(*it)[0], it->size());
+			dst += it->size();
+		}
+	}
+
+	if (chunkPos > 0) {
+		memcpy(dst, &chunk[0], chunkPos);
+	}
+}
+
+void CChunkedBuffer::Release(std::vector<boost::uint8_t>& data)
+{
+	assert(consumer == NULL);
+
+	if (chunks.empty()) {
+		// everything fits into the current chunk, no copy needed
+		chunk.resize(chunkPos);
+		data.swap(chunk);
+	} else {
+		data.resize(totalSize);
+
+		if (totalSize > 0) {
+			CopyTo(&data[0]);
+		}
+	}
+
+	chunks.clear();
+	chunk.clear();
+	chunk.resize(chunkSize);
+	chunkPos = 0;
+	totalSize = 0;
+}
@@ -0,0 +1,78 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef CREG_CHUNKED_BUFFER_H
+#define CREG_CHUNKED_BUFFER_H
+
+#include <deque>
+#include <vector>
+#include <cstring>
+#include <boost/cstdint.hpp>
+
+namespace creg {
+
+	/**
+	 * Output buffer made of fixed-size chunks, growing it never copies what
+	 * was written before.
+	 * With a consumer, every full chunk is handed over as soon as it is
+	 * complete (for example to compress and write it on another thread)
+	 * instead of being kept.
+	 */
+	class CChunkedBuffer
+	{
+	public:
+		class IConsumer {
+		public:
+			virtual ~IConsumer() {}
+			/// takes over the contents of chunk (by swapping it)
+			virtual void ConsumeChunk(std::vector<boost::uint8_t>& chunk) = 0;
+		};
+
+		static const size_t DEFAULT_CHUNK_SIZE = 1024 * 1024;
+
+		CChunkedBuffer(size_t chunkSize = DEFAULT_CHUNK_SIZE, IConsumer* consumer = NULL);
+
+		void Write(const void* data, size_t size) {
+			// chunk[chunkPos] does not exist once the chunk is full
+			if (size == 0)
+				return;
+
+			if (size <= (chunkSize - chunkPos)) {
+				memcpy(&chunk[chunkPos], data, size);
+				chunkPos += size;
+				totalSize += size;
+				return;
+			}
+
+			WriteSlow(reinterpret_cast<const boost::uint8_t*>(data), size);
+		}
+
+		/// number of bytes written so far, including the ones that were consumed
+		size_t GetSize() const { return totalSize; }
+
+		/// hands the partially filled last chunk to the consumer
+		void Flush();
+
+		/// Copies everything that was written to dst (GetSize() bytes), needs no consumer
+		void CopyTo(boost::uint8_t* dst) const;
+		/// Swaps everything that was written into one vector, empties the buffer
+		void Release(std::vector<boost::uint8_t>& data);
+
+	private:
+		void WriteSlow(const boost::uint8_t* data, size_t size);
+		void FinishChunk();
+
+	private:
+		const size_t chunkSize;
+		IConsumer* consumer;
+
+		/// full chunks, only without consumer
+		std::deque< std::vector<boost::uint8_t> > chunks;
+
+		std::vector<boost::uint8_t> chunk;
+		size_t chunkPos;
+		size_t totalSize;
+	};
+
+}
+
+#endif // CREG_CHUNKED_BUFFER_H
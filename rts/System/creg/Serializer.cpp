@@ -11,7 +11,7 @@
 #include "System/Platform/byteorder.h"
 #include "System/Exceptions.h"
 
-#include <fstream>
+#include <iostream>
 #include <assert.h>
 #include <stdexcept>
 #include <map>
@@ -24,68 +24,39 @@ using std::string;
 using std::map;
 using std::vector;
 
-#define CREG_PACKAGE_FILE_ID "CRPK"
+#define CREG_PACKAGE_FILE_ID "CRP2"
 
 // File format structures
 
 #pragma pack(push,1)
 
+/**
+ * Stored at the end of a package, all offsets are relative to the start of
+ * the package. The object data always starts at offset 0.
+ */
 struct PackageHeader
 {
 	char magic[4];
-	int objDataOffset;
+	int objClassRefOffset; // a class ref is: zero-term class string + member hashes
+	int numObjClassRefs;
 	int objTableOffset;
 	int numObjects;
-	int objClassRefOffset; // a class ref is: zero-term class string + checksum DWORD
-	int numObjClassRefs;
 	unsigned int metadataChecksum;
+	int packageSize;
 
 	void SwapBytes ()
 	{
-		swabDWordInPlace(objDataOffset);
-		swabDWordInPlace(objTableOffset);
 		swabDWordInPlace(objClassRefOffset);
 		swabDWordInPlace(numObjClassRefs);
+		swabDWordInPlace(objTableOffset);
 		swabDWordInPlace(numObjects);
 		swabDWordInPlace(metadataChecksum);
+		swabDWordInPlace(packageSize);
 	}
 };
 
-struct PackageObject
-{
-	unsigned short classRefIndex;
-	char isEmbedded;
-
-	void SwapBytes() {
-		swabWordInPlace(classRefIndex);
-	}
-};
-
-COMPILE_TIME_ASSERT(sizeof(PackageObject) == 3, test_size);
-
 #pragma pack(pop)
 
-static string ReadZStr(std::istream& file)
-{
-	std::string str;
-
-	char c;
-	while(!file.eof()) {
-		file >> c;
-		if (!c) break;
-		str += c;
-	}
-
-	return str;
-}
-
-static void WriteZStr(std::ostream& file, const string& str)
-{
-	int c;
-	c = str.length ();
-	file.write(str.c_str(), c + 1);
-}
-
 static int MakeStrHash(const char* str)
 {
 	int result = 0xDA38E7AB;
@@ -101,75 +72,73 @@ static int MakeStrHash(const char* str)
 	return result;
 }
 
-void WriteVarSizeUInt(std::ostream* stream, unsigned int val)
-{
-	if (val < 0x80) {
-		unsigned char a = val;
-		stream->write((char*)&a, sizeof(char));
-	} else if (val < 0x4000) {
-		unsigned char a = (val & 0x7F) | 0x80;
-		unsigned char b = val >> 7;
-		stream->write((char*)&a, sizeof(char));
-		stream->write((char*)&b, sizeof(char));
-	} else if (val < 0x40000000) {
-		unsigned char a = (val & 0x7F) | 0x80;
-		unsigned char b = ((val >> 7) & 0x7F) | 0x80;
-		unsigned short c = swabWord(val >> 14);
-		stream->write((char*)&a, sizeof(char));
-		stream->write((char*)&b, sizeof(char));
-		stream->write((char*)&c, sizeof(short));
-	} else throw "Cannot save varible-size int";
-}
-
-void ReadVarSizeUInt(std::istream* stream, unsigned int* buf)
-{
-	unsigned char a;
-	stream->read ((char*)&a, sizeof(char));
-	if (a & 0x80) {
-		unsigned char b;
-		stream->read((char*)&b, sizeof(char));
-		if (b & 0x80) {
-			unsigned short c;
-			stream->read ((char*)&c, sizeof(short));
-			*buf = (a & 0x7F) | ((b & 0x7F) << 7) | (c << 14);
-		} else {
-			*buf = (a & 0x7F) | ((b & 0x7F) << 7);
-		}
-	} else {
-		*buf = a & 0x7F;
-	}
-}
-
 //-------------------------------------------------------------------------
 // Base output serializer
 //-------------------------------------------------------------------------
-COutputStreamSerializer::COutputStreamSerializer ()
+COutputStreamSerializer::COutputStreamSerializer()
+	: buffer(NULL)
 {
-	stream = NULL;
 }
 
-bool COutputStreamSerializer::IsWriting ()
+bool COutputStreamSerializer::IsWriting()
 {
 	return true;
 }
 
+void COutputStreamSerializer::WriteVarSizeUInt(unsigned int val)
+{
+	boost::uint8_t buf[4];
+
+	if (val < 0x80) {
+		buf[0] = val;
+		buffer->Write(buf, 1);
+	} else if (val < 0x4000) {
+		buf[0] = (val & 0x7F) | 0x80;
+		buf[1] = val >> 7;
+		buffer->Write(buf, 2);
+	} else if (val < 0x40000000) {
+		const boost::uint16_t c = swabWord(boost::uint16_t(val >> 14));
+
+		buf[0] = (val & 0x7F) | 0x80;
+		buf[1] = ((val >> 7) & 0x7F) | 0x80;
+		memcpy(&buf[2], &c, sizeof(c));
+		buffer->Write(buf, 4);
+	} else {
+		throw std::runtime_error("Cannot save variable-size int");
+	}
+}
+
 COutputStreamSerializer::ObjectRef* COutputStreamSerializer::FindObjectRef(void* inst, creg::Class* objClass, bool isEmbedded)
 {
-	std::vector<ObjectRef*>* refs = &(ptrToId[inst]);
-	for (std::vector<ObjectRef*>::iterator i = refs->begin(); i != refs->end(); ++i) {
-		if ((*i)->isThisObject(inst, objClass, isEmbedded))
-			return *i;
+	const SPRING_HASH_MAP<void*, ObjectRef*>::const_iterator it = ptrToId.find(inst);
+
+	if (it == ptrToId.end())
+		return NULL;
+
+	for (ObjectRef* ref = it->second; ref != NULL; ref = ref->next) {
+		if (ref->isThisObject(inst, objClass, isEmbedded))
+			return ref;
 	}
+
 	return NULL;
 }
 
-void COutputStreamSerializer::SerializeObject(Class* c, void* ptr, ObjectRef* objr)
+COutputStreamSerializer::ObjectRef* COutputStreamSerializer::AddObjectRef(void* inst, creg::Class* objClass, bool isEmbedded)
 {
-	if (c->base)
-		SerializeObject(c->base, ptr, objr);
+	objects.push_back(ObjectRef(inst, objects.size(), isEmbedded, objClass));
+
+	ObjectRef* obj = &objects.back();
+	ObjectRef*& first = ptrToId[inst];
 
-	ObjectMemberGroup omg;
-	omg.membersClass = c;
+	obj->next = first;
+	first = obj;
+	return obj;
+}
+
+void COutputStreamSerializer::SerializeObject(Class* c, void* ptr)
+{
+	if (c->base)
+		SerializeObject(c->base, ptr);
 
 	for (uint a = 0; a < c->members.size(); a++)
 	{
@@ -177,216 +146,164 @@ void COutputStreamSerializer::SerializeObject(Class* c, void* ptr, ObjectRef* ob
 		if (m->flags & CM_NoSerialize)
 			continue;
 
-		ObjectMember om;
-		om.member = m;
-		om.memberId = a;
 		void* memberAddr = ((char*)ptr) + m->offset;
-		unsigned mstart = stream->tellp();
-		m->type->Serialize (this, memberAddr);
-		unsigned mend = stream->tellp();
-		om.size = mend - mstart;
-		omg.members.push_back(om);
-		omg.size += om.size;
+		m->type->Serialize(this, memberAddr);
 	}
 
-
 	if (c->serializeProc) {
-		ObjectMember om;
-		om.member = NULL;
-		om.memberId = -1;
-		unsigned mstart = stream->tellp();
-		_DummyStruct *obj = (_DummyStruct*)ptr;
+		_DummyStruct* obj = (_DummyStruct*)ptr;
 		(obj->*(c->serializeProc))(*this);
-		unsigned mend = stream->tellp();
-		om.size = mend - mstart;
-		omg.members.push_back(om);
-		omg.size += om.size;
 	}
-
-	objr->memberGroups.push_back(omg);
 }
 
 void COutputStreamSerializer::SerializeObjectInstance(void* inst, creg::Class* objClass)
 {
 	// register the object, and mark it as embedded if a pointer was already referencing it
-	ObjectRef* obj = FindObjectRef(inst,objClass,true);
+	ObjectRef* obj = FindObjectRef(inst, objClass, true);
 	if (!obj) {
-		obj = &*objects.insert(objects.end(), ObjectRef(inst, objects.size(), true, objClass));
-		ptrToId[inst].push_back(obj);
+		obj = AddObjectRef(inst, objClass, true);
 	} else if (obj->isEmbedded) {
-		throw "Reserialization of embedded object";
-	} else {
-		std::vector<ObjectRef*>::iterator pos;
-		for (pos = pendingObjects.begin(); (pos != pendingObjects.end()) && ((*pos) != obj); ++pos);
-		if (pos == pendingObjects.end()) {
-			throw "Object pointer was serialized";
-		} else {
-			pendingObjects.erase(pos);
-		}
+		throw std::runtime_error("Reserialization of embedded object");
+	} else if (obj->isSaved) {
+		throw std::runtime_error("Object pointer was serialized");
 	}
+	// if it is still pending, it gets skipped in SavePackage now
 	obj->class_ = objClass;
 	obj->isEmbedded = true;
-
-//	printf("writepos of %s (%d): %d\n", objClass->name.c_str(), obj->id,(int)stream->tellp());
+	obj->isSaved = true;
 
 	// write an object ID
-	WriteVarSizeUInt(stream, obj->id);
+	WriteVarSizeUInt(obj->id);
 
 	// write the object
-	SerializeObject(objClass, inst, obj);
+	SerializeObject(objClass, inst);
 }
 
 void COutputStreamSerializer::SerializeObjectPtr(void** ptr, creg::Class* objClass)
 {
 	if (*ptr) {
-		// valid pointer, write a one and the object ID
-		int id;
+		// valid pointer, write the object ID
 		ObjectRef* obj = FindObjectRef(*ptr, objClass, false);
 		if (!obj) {
-			obj = &*objects.insert(objects.end(), ObjectRef(*ptr, objects.size(), false, objClass));
-			ptrToId[*ptr].push_back(obj);
-			id = obj->id;
+			obj = AddObjectRef(*ptr, objClass, false);
 			pendingObjects.push_back(obj);
-		} else {
-			id = obj->id;
 		}
 
-//		*stream << (char)1;
-		WriteVarSizeUInt(stream, id);
+		WriteVarSizeUInt(obj->id);
 	} else {
 		// null pointer, write a zero
-		WriteVarSizeUInt(stream, 0);
-//		*stream << (char)0;
+		WriteVarSizeUInt(0);
 	}
 }
 
 void COutputStreamSerializer::Serialize(void* data, int byteSize)
 {
-	stream->write((char*)data, byteSize);
+	buffer->Write(data, byteSize);
 }
 
 void COutputStreamSerializer::SerializeInt(void* data, int byteSize)
 {
-	char buf[4];
 	switch (byteSize) {
 		case 1: {
-			*(char*)buf = *(char*) data;
+			buffer->Write(data, 1);
 			break;
 		}
 		case 2: {
-			*(short*)buf = swabWord(*(short*) data);
+			boost::uint16_t buf;
+			memcpy(&buf, data, sizeof(buf));
+			buf = swabWord(buf);
+			buffer->Write(&buf, sizeof(buf));
 			break;
 		}
 		case 4: {
-			*(long*)buf = swabDWord(*(long*) data);
+			boost::uint32_t buf;
+			memcpy(&buf, data, sizeof(buf));
+			buf = swabDWord(buf);
+			buffer->Write(&buf, sizeof(buf));
 			break;
 		}
 		default: {
-			throw "Unknown int type";
+			throw std::runtime_error("Unknown int type");
 		}
 	}
-	stream->write((char*)data, byteSize);
 }
 
 
-struct COutputStreamSerializer::ClassRef
+void COutputStreamSerializer::SavePackage(std::ostream* s, void* rootObj, Class* rootObjClass)
 {
-	int index;
-	creg::Class* class_;
-};
+	CChunkedBuffer buf;
+	SavePackage(&buf, rootObj, rootObjClass);
 
-void COutputStreamSerializer::SavePackage(std::ostream* s, void* rootObj, Class* rootObjClass)
+	std::vector<boost::uint8_t> data;
+	buf.Release(data);
+
+	const boost::uint32_t size = swabDWord(boost::uint32_t(data.size()));
+	s->write((const char*)&size, sizeof(size));
+	s->write((const char*)&data[0], data.size());
+}
+
+void COutputStreamSerializer::SavePackage(CChunkedBuffer* buf, void* rootObj, Class* rootObjClass)
 {
 	PackageHeader ph;
 
-	stream = s;
-	unsigned startOffset = stream->tellp();
-
-	stream->seekp (startOffset + sizeof (PackageHeader));
-	ph.objDataOffset = (int)stream->tellp();
+	buffer = buf;
+	const size_t startOffset = buffer->GetSize();
 
 	// Insert dummy object with id 0
-	ObjectRef* obj = &*objects.insert(objects.end(), ObjectRef(0, 0, true, 0));
-	obj->classIndex = 0;
+	objects.push_back(ObjectRef(NULL, 0, true, NULL));
+	objects.back().isSaved = true;
 
 	// Insert the first object that will provide references to everything
-	obj = &*objects.insert(objects.end(), ObjectRef(rootObj, objects.size(), false, rootObjClass));
-	ptrToId[rootObj].push_back(obj);
-	pendingObjects.push_back (obj);
+	pendingObjects.push_back(AddObjectRef(rootObj, rootObjClass, false));
 
-	map<creg::Class*, int> classSizes;
-	// Save until all the referenced objects have been stored
-	while (!pendingObjects.empty())
-	{
-		const std::vector <ObjectRef*>& po = pendingObjects;
-		pendingObjects.clear ();
-
-		for (std::vector<ObjectRef*>::const_iterator i = po.begin(); i != po.end(); ++i)
-		{
-			ObjectRef* obj = *i;
-			const unsigned objstart = stream->tellp();
-			SerializeObject(obj->class_, obj->ptr, obj);
-			const unsigned objend = stream->tellp();
-			const int sz = objend - objstart;
-			classSizes[obj->class_] += sz;
-		}
+	// Save until all the referenced objects have been stored. Objects are
+	// only ever appended, so this saves the non-embedded ones in the order
+	// of their ids, which is the order the loader expects them in.
+	for (size_t i = 0; i < pendingObjects.size(); i++) {
+		ObjectRef* obj = pendingObjects[i];
+
+		// the object turned out to be embedded in another one
+		if (obj->isSaved)
+			continue;
+
+		obj->isSaved = true;
+		SerializeObject(obj->class_, obj->ptr);
 	}
 
 	// Collect a set of all used classes
-	map<creg::Class*, ClassRef> classMap;
-	vector<ClassRef*> classRefs;
-	map<int, int> classObjects;
-	for (std::list<ObjectRef>::iterator i = objects.begin(); i != objects.end(); ++i) {
+	map<creg::Class*, int> classMap;
+	vector<creg::Class*> classRefs;
+	for (std::deque<ObjectRef>::iterator i = objects.begin(); i != objects.end(); ++i) {
 		if (i->ptr == NULL) continue; //Object with id 0 - dummy
-		//printf("Obj: %s\n", oi->second.class_->name.c_str());
-		map<creg::Class*, ClassRef>::iterator cr = classMap.find(i->class_);
-		if (cr == classMap.end()) {
-			ClassRef* pRef = &classMap[i->class_];
-			pRef->index = classRefs.size();
-			pRef->class_ = i->class_;
 
-			classRefs.push_back(pRef);
-			i->classIndex = pRef->index;
-
-			for (creg::Class* c = i->class_->base;c;c = c->base) {
-				map<creg::Class*, ClassRef>::iterator cr = classMap.find(c);
-				if (cr == classMap.end()) {
-					ClassRef* pRef = &classMap[c];
-					pRef->index = classRefs.size();
-					pRef->class_ = c;
-
-					classRefs.push_back(pRef);
+		map<creg::Class*, int>::iterator cr = classMap.find(i->class_);
+		if (cr == classMap.end()) {
+			i->classIndex = classRefs.size();
+			classMap[i->class_] = i->classIndex;
+			classRefs.push_back(i->class_);
+
+			for (creg::Class* c = i->class_->base; c; c = c->base) {
+				if (classMap.find(c) == classMap.end()) {
+					classMap[c] = classRefs.size();
+					classRefs.push_back(c);
 				}
 			}
 		} else {
-			i->classIndex = cr->second.index;
-		}
-		classObjects[i->classIndex]++;
-	}
-
-/*
-	if (LOG_IS_ENABLED(L_DEBUG)) {
-		for (std::map<int, int>::iterator i = classObjects.begin(); i != classObjects.end(); i++) {
-			LOG_L(L_DEBUG, "%20s %10u %10u",
-					classRefs[i->first]->class_->name.c_str(),
-					i->second,
-					classSizes[classRefs[i->first]->class_]);
+			i->classIndex = cr->second;
 		}
 	}
-*/
 
 	// Write the class references
 	ph.numObjClassRefs = classRefs.size();
-	ph.objClassRefOffset = (int)stream->tellp();
+	ph.objClassRefOffset = buffer->GetSize() - startOffset;
 	for (uint a = 0; a < classRefs.size(); a++) {
-		WriteZStr(*stream, classRefs[a]->class_->name);
-		// write a checksum (unused atm)
-//		int checksum = swabDWord(0);
-//		stream->write ((char*)&checksum, sizeof(int));
-		int cnt = classRefs[a]->class_->members.size();
-		WriteVarSizeUInt(stream, cnt);
+		const std::string& className = classRefs[a]->name;
+		buffer->Write(className.c_str(), className.length() + 1);
+
+		const int cnt = classRefs[a]->members.size();
+		WriteVarSizeUInt(cnt);
 		for (int b = 0; b < cnt; b++) {
-			creg::Class::Member* m = classRefs[a]->class_->members[b];
+			creg::Class::Member* m = classRefs[a]->members[b];
 			const int namehash = swabDWord(MakeStrHash(m->name));
 			std::string typeName = m->type->GetName();
 			const int typehash1 = MakeStrHash(typeName.c_str());
@@ -395,69 +312,32 @@ void COutputStreamSerializer::SavePackage(std::ostream* s, void* rootObj, Class*
 					^ ((typehash1 >> 8) & 0xFF)
 					^ ((typehash1 >> 16) & 0xFF)
 					^ ((typehash1 >> 24) & 0xFF);
-			stream->write((char*)&namehash, sizeof(int));
-			stream->write((char*)&typehash2, sizeof(char));
+			buffer->Write(&namehash, sizeof(int));
+			buffer->Write(&typehash2, sizeof(char));
 		}
 	}
 
 	// Write object info
-	ph.objTableOffset = (int)stream->tellp();
+	ph.objTableOffset = buffer->GetSize() - startOffset;
 	ph.numObjects = objects.size();
-	for (std::list<ObjectRef>::iterator i = objects.begin(); i != objects.end(); ++i) {
-		int classRefIndex = i->classIndex;
-		char isEmbedded = i->isEmbedded ? 1 : 0;
-		WriteVarSizeUInt(stream, classRefIndex);
-		stream->write((char*)&isEmbedded, sizeof(char));
-		char mgcnt = i->memberGroups.size();
-		WriteVarSizeUInt(stream, mgcnt);
-		std::vector<COutputStreamSerializer::ObjectMemberGroup>::iterator j;
-		for (j = i->memberGroups.begin(); j != i->memberGroups.end(); ++j) {
-			map<creg::Class*, ClassRef>::iterator cr = classMap.find(j->membersClass);
-			if (cr == classMap.end()) throw "Cannot find member class ref";
-			int cid = cr->second.index;
-			WriteVarSizeUInt(stream,cid);
-			unsigned int mcnt = j->members.size();
-			WriteVarSizeUInt(stream,mcnt);
-			bool hasSerializerMember = false;
-			char groupFlags = 0;
-			if (!j->members.empty() && (j->members.back().memberId == -1)) {
-				groupFlags |= 0x01;
-				hasSerializerMember = true;
-			}
-			stream->write ((char*)&groupFlags, sizeof(char));
-			int midx = 0;
-			std::vector<COutputStreamSerializer::ObjectMember>::iterator k;
-			for (k = j->members.begin(); k != j->members.end(); ++k, ++midx) {
-				if ((k->memberId != midx) && (!hasSerializerMember || k != (j->members.end() - 1))) {
-					throw "Invalid member id";
-				}
-				WriteVarSizeUInt(stream,k->size);
-			}
-		}
+	for (std::deque<ObjectRef>::iterator i = objects.begin(); i != objects.end(); ++i) {
+		const char isEmbedded = i->isEmbedded ? 1 : 0;
+		WriteVarSizeUInt(i->classIndex);
+		buffer->Write(&isEmbedded, sizeof(char));
 	}
 
 	// Calculate a checksum for metadata verification
 	ph.metadataChecksum = 0;
-	for (uint a = 0; a < classRefs.size(); a++)
-	{
-		Class* c = classRefs[a]->class_;
-		c->CalculateChecksum(ph.metadataChecksum);
+	for (uint a = 0; a < classRefs.size(); a++) {
+		classRefs[a]->CalculateChecksum(ph.metadataChecksum);
 	}
-//	printf("Checksum: %d\n", ph.metadataChecksum);
 
-	int endOffset = stream->tellp();
-	stream->seekp(startOffset);
+	ph.packageSize = (buffer->GetSize() - startOffset) + sizeof(PackageHeader);
 	memcpy(ph.magic, CREG_PACKAGE_FILE_ID, 4);
 	ph.SwapBytes();
-	stream->write((const char *)&ph, sizeof(PackageHeader));
+	buffer->Write(&ph, sizeof(PackageHeader));
 
-/*
-	LOG_L(L_DEBUG,
-			"Number of objects saved: %d\nNumber of classes involved: %d\n",
-			objects.size(), classRefs.size());
-*/
-
-	stream->seekp(endOffset);
+	buffer = NULL;
 	ptrToId.clear();
 	pendingObjects.clear();
 	objects.clear();
@@ -468,14 +348,15 @@ void COutputStreamSerializer::SavePackage(std::ostream* s, void* rootObj, Class*
 //-------------------------------------------------------------------------
 
 CInputStreamSerializer::CInputStreamSerializer()
-	: stream(NULL)
+	: readPos(NULL)
+	, readEnd(NULL)
 {
 }
 
 CInputStreamSerializer::~CInputStreamSerializer()
 {
 	for (std::vector<StoredObject>::iterator it = objects.begin(); it != objects.end(); ++it) {
-		if (it->obj) {
+		if (it->obj && !it->isEmbedded) {
 			ClassBinder* binder = classRefs[it->classRef]->binder;
 			binder->class_->DeleteInstance(it->obj);
 		}
@@ -488,6 +369,26 @@ bool CInputStreamSerializer::IsWriting()
 	return false;
 }
 
+unsigned int CInputStreamSerializer::ReadVarSizeUInt()
+{
+	boost::uint8_t a;
+	Read(&a, sizeof(a));
+
+	if (!(a & 0x80))
+		return a;
+
+	boost::uint8_t b;
+	Read(&b, sizeof(b));
+
+	if (!(b & 0x80))
+		return (a & 0x7F) | (b << 7);
+
+	boost::uint16_t c;
+	Read(&c, sizeof(c));
+	c = swabWord(c);
+	return (a & 0x7F) | ((b & 0x7F) << 7) | (c << 14);
+}
+
 void CInputStreamSerializer::SerializeObject(Class* c, void* ptr)
 {
 	if (c->base)
@@ -511,34 +412,43 @@ void CInputStreamSerializer::SerializeObject(Class* c, void* ptr)
 
 void CInputStreamSerializer::Serialize(void* data, int byteSize)
 {
-	stream->read ((char*)data, byteSize);
+	Read(data, byteSize);
 }
 
 void CInputStreamSerializer::SerializeInt(void* data, int byteSize)
 {
-	stream->read ((char*)data, byteSize);
 	switch (byteSize) {
-		case 2:{
-			*(short*) data = swabWord(*(short*) data);
+		case 1: {
+			Read(data, 1);
+			break;
+		}
+		case 2: {
+			boost::uint16_t buf;
+			Read(&buf, sizeof(buf));
+			buf = swabWord(buf);
+			memcpy(data, &buf, sizeof(buf));
 			break;
 		}
-		case 4:{
-			*(long*) data = swabDWord(*(long*) data);
+		case 4: {
+			boost::uint32_t buf;
+			Read(&buf, sizeof(buf));
+			buf = swabDWord(buf);
+			memcpy(data, &buf, sizeof(buf));
 			break;
 		}
-		default: throw "Unknown int type";
+		default: throw std::runtime_error("Unknown int type");
 	}
 }
 
 void CInputStreamSerializer::SerializeObjectPtr(void** ptr, creg::Class* cls)
 {
-//	char v;
-//	printf("reading ptr %s* at %d\n", cls->name.c_str(), (int)stream->tellg());
-//	*stream >> v;
-	unsigned int id;
-	ReadVarSizeUInt(stream, &id);
+	const unsigned int id = ReadVarSizeUInt();
+
 	if (id) {
-		StoredObject& o = objects [id];
+		if (id >= objects.size())
+			throw std::runtime_error("Invalid object reference in package");
+
+		StoredObject& o = objects[id];
 		if (o.obj) *ptr = o.obj;
 		else {
 			// The object is not yet available, so it needs fixing afterwards
@@ -546,7 +456,7 @@ void CInputStreamSerializer::SerializeObjectPtr(void** ptr, creg::Class* cls)
 			UnfixedPtr ufp;
 			ufp.objID = id;
 			ufp.ptrAddr = ptr;
-			unfixedPointers.push_back (ufp);
+			unfixedPointers.push_back(ufp);
 		}
 	} else
 		*ptr = NULL;
@@ -555,13 +465,14 @@ void CInputStreamSerializer::SerializeObjectPtr(void** ptr, creg::Class* cls)
 // Serialize an instance of an object embedded into another object
 void CInputStreamSerializer::SerializeObjectInstance(void* inst, creg::Class* cls)
 {
-	unsigned int id;
-	ReadVarSizeUInt(stream, &id);
+	const unsigned int id = ReadVarSizeUInt();
 
 	if (id == 0)
 		return; // this is old save game and it has not this object - skip it
 
-//	printf ("readpos of embedded %s (%d): %d\n", cls->name.c_str(), id, ((int)stream->tellg())-4);
+	if (id >= objects.size())
+		throw std::runtime_error("Invalid embedded object in package");
+
 	StoredObject& o = objects[id];
 	assert(!o.obj);
 	assert(o.isEmbedded);
@@ -581,33 +492,61 @@ void CInputStreamSerializer::AddPostLoadCallback(void (*cb)(void*), void* ud)
 }
 
 void CInputStreamSerializer::LoadPackage(std::istream* s, void*& root, creg::Class*& rootCls)
+{
+	boost::uint32_t size = 0;
+	s->read((char*)&size, sizeof(size));
+	size = swabDWord(size);
+
+	std::vector<boost::uint8_t> data(size);
+
+	if (size > 0)
+		s->read((char*)&data[0], size);
+	if (!s->good())
+		throw std::runtime_error("Unexpected end of object package");
+
+	LoadPackage((size > 0)? &data[0]: NULL, size, root, rootCls);
+}
+
+void CInputStreamSerializer::LoadPackage(const boost::uint8_t* data, size_t size, void*& root, creg::Class*& rootCls)
 {
 	PackageHeader ph;
 
-	stream = s;
-	s->read((char*)&ph, sizeof(PackageHeader));
+	if (size < sizeof(PackageHeader))
+		throw std::runtime_error("Object package is too small");
 
-	if (memcmp (ph.magic, CREG_PACKAGE_FILE_ID, 4))
-		throw std::runtime_error ("Incorrect object package file ID");
+	memcpy(&ph, data + size - sizeof(PackageHeader), sizeof(PackageHeader));
+	ph.SwapBytes();
+
+	if (memcmp(ph.magic, CREG_PACKAGE_FILE_ID, 4))
+		throw std::runtime_error("Incorrect object package file ID");
+	if (ph.packageSize != int(size))
+		throw std::runtime_error("Object package size mismatch");
+	if (ph.objClassRefOffset < 0 || ph.objTableOffset < ph.objClassRefOffset || ph.objTableOffset > int(size - sizeof(PackageHeader)))
+		throw std::runtime_error("Corrupt object package header");
 
 	// Load references
-	classRefs.resize (ph.numObjClassRefs);
-	s->seekg (ph.objClassRefOffset);
+	readPos = data + ph.objClassRefOffset;
+	readEnd = data + ph.objTableOffset;
+	classRefs.resize(ph.numObjClassRefs);
 	for (int a = 0; a < ph.numObjClassRefs; a++)
 	{
-		string className = ReadZStr(*s);
-		creg::Class *class_ = System::GetClass(className);
+		const boost::uint8_t* strEnd = (const boost::uint8_t*) memchr(readPos, 0, readEnd - readPos);
+		if (strEnd == NULL)
+			throw std::runtime_error("Unexpected end of object package");
+
+		const string className((const char*)readPos, strEnd - readPos);
+		readPos = strEnd + 1;
+
+		creg::Class* class_ = System::GetClass(className);
 		if (!class_)
-			throw std::runtime_error ("Package file contains reference to unknown class " + className);
-		unsigned int cnt;
-		ReadVarSizeUInt(stream, &cnt);
-		for (unsigned int b = 0; b < cnt; b++) {
-			int namehash;
-			stream->read((char*)&namehash, sizeof(int));
-			char typehash;
-			stream->read((char*)&typehash, sizeof(char));
-		}
+			throw std::runtime_error("Package file contains reference to unknown class " + className);
+
+		// member name and type hashes, unused atm
+		const unsigned int cnt = ReadVarSizeUInt();
+		if (cnt * (sizeof(int) + sizeof(char)) > size_t(readEnd - readPos))
+			throw std::runtime_error("Unexpected end of object package");
 
+		readPos += cnt * (sizeof(int) + sizeof(char));
 		classRefs[a] = class_;
 	}
 
@@ -619,45 +558,35 @@ void CInputStreamSerializer::LoadPackage(std::istream* s, void*& root, creg::Cla
 		throw std::runtime_error ("Metadata checksum error: Package file was saved with a different version");
 
 	// Create all non-embedded objects
-	s->seekg(ph.objTableOffset);
-	objects.resize (ph.numObjects);
+	readPos = data + ph.objTableOffset;
+	readEnd = data + size - sizeof(PackageHeader);
+	objects.resize(ph.numObjects);
 	for (int a = 0; a < ph.numObjects; a++)
 	{
-		unsigned int classRefIndex;
+		const unsigned int classRefIndex = ReadVarSizeUInt();
 		char isEmbedded;
-		ReadVarSizeUInt(stream,&classRefIndex);
-		stream->read((char*)&isEmbedded, sizeof(char));
-		unsigned int mgcnt;
-		ReadVarSizeUInt(stream, &mgcnt);
-		for (unsigned int b = 0; b < mgcnt; b++) {
-			unsigned int cid, mcnt;
-			char groupFlags;
-			ReadVarSizeUInt(stream, &cid);
-			ReadVarSizeUInt(stream, &mcnt);
-			stream->read ((char*)&groupFlags, sizeof(char));
-			for (unsigned int c = 0; c < mcnt; c++) {
-				unsigned int size;
-				ReadVarSizeUInt(stream, &size);
-			}
-		}
+		Read(&isEmbedded, sizeof(char));
+
+		if (classRefIndex >= classRefs.size())
+			throw std::runtime_error("Invalid class reference in package");
 
 		objects[a].obj = NULL;
+		objects[a].isEmbedded = !!isEmbedded;
+		objects[a].classRef = classRefIndex;
+
 		if (!isEmbedded) {
 			// Allocate and construct
 			ClassBinder* binder = classRefs[classRefIndex]->binder;
-			void* inst = binder->class_->CreateInstance ();
-			objects [a].obj = inst;
-		} else objects[a].obj = NULL;
-		objects [a].isEmbedded = !!isEmbedded;
-		objects [a].classRef = classRefIndex;
+			objects[a].obj = binder->class_->CreateInstance();
+		}
 	}
 
-	int endOffset = s->tellg();
-
-//	printf ("Loading %d objects (at %d)\n", objects.size(), (int)stream->tellg());
+	if (objects.size() < 2 || objects[1].isEmbedded)
+		throw std::runtime_error("Object package has no root object");
 
-	// Read the object data using serialization
-	s->seekg(ph.objDataOffset);
+	// Read the object data using serialization, in one pass
+	readPos = data;
+	readEnd = data + ph.objClassRefOffset;
 	for (uint a = 0; a < objects.size(); a++)
 	{
 		if (!objects[a].isEmbedded) {
@@ -678,32 +607,32 @@ void CInputStreamSerializer::LoadPackage(std::istream* s, void*& root, creg::Cla
 	}
 
 	// Run post load functions on all objects
+	std::vector<Class*> hierarchy;
 	for (uint a = 1; a < objects.size(); a++) {
 		StoredObject& o = objects[a];
+		if (o.obj == NULL)
+			continue;
+
 		Class* c = classRefs[objects[a].classRef];
-		std::vector<Class*> hierarchy;
+		hierarchy.clear();
 		for (Class* c2 = c; c2; c2 = c2->base)
-			hierarchy.insert(hierarchy.end(), c2);
+			hierarchy.push_back(c2);
 		for (std::vector<Class*>::reverse_iterator i = hierarchy.rbegin(); i != hierarchy.rend(); ++i) {
 			if ((*i)->postLoadProc) {
-				_DummyStruct *ds = (_DummyStruct*)o.obj;
+				_DummyStruct* ds = (_DummyStruct*)o.obj;
 				(ds->*(*i)->postLoadProc)();
 			}
 		}
-/*		
-		if (c->postLoadProc) {
-			_DummyStruct *ds = (_DummyStruct*)o.obj;
-			(ds->*c->postLoadProc)();
-		}
-*/
 	}
 
 	// The first object is the root object
 	root = objects[1].obj;
 	rootCls = classRefs[objects[1].classRef];
 
-	s->seekg(endOffset);
+	readPos = NULL;
+	readEnd = NULL;
 	unfixedPointers.clear();
+	callbacks.clear();
 	objects.clear();
 }
 
@@ -769,7 +698,7 @@ static void savetest()
 	c->embeddedPtr = &o->embedded;
 	o->embeddedPtr = &c->embedded;
 	creg::COutputStreamSerializer ss;
-	std::ofstream file("test.p", ios::out | ios::binary);
+	std::ofstream file("test.p", std::ios::out | std::ios::binary);
 	ss.SavePackage(&file, o, o->GetClass());
 }
 
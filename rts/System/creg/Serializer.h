@@ -4,119 +4,114 @@
 #define SERIALIZER_IMPL_H
 
 #include "ISerializer.h"
-#include <map>
+#include "ChunkedBuffer.h"
+#include "STL_Map.h"
+#include <deque>
+#include <iosfwd>
+#include <stdexcept>
 #include <vector>
-#include <list>
 
 namespace creg {
 
 	/**
 	 * Output stream serializer
 	 * Usage: create an instance of this class and call SavePackage
+	 *
+	 * A package is laid out as
+	 *   [object data] [class references] [object table] [package header]
+	 * with all offsets relative to its start, so the object data can be
+	 * streamed out while it is still being serialized.
 	 * @see SavePackage
 	 */
 	class COutputStreamSerializer : public ISerializer
 	{
 	protected:
-		struct ObjectMember {
-			creg::Class::Member* member;
-			int memberId;
-			int size;
-		};
-		struct ObjectMemberGroup {
-			creg::Class *membersClass;
-			std::vector<COutputStreamSerializer::ObjectMember> members;
-			int size;
-		};
 		struct ObjectRef {
-			ObjectRef() {
-				ptr = 0;
-				id=0;
-				classIndex=0;
-				isEmbedded=false;
-				class_=0;
-			}
-			ObjectRef(void *ptr,int id,bool isEmbedded,creg::Class *class_) {
-				this->ptr = ptr;
-				this->id=id;
-				classIndex=0;
-				this->isEmbedded=isEmbedded;
-				this->class_=class_;
-			}
-			ObjectRef(const ObjectRef&src) :memberGroups(src.memberGroups){
-				ptr=src.ptr;
-				id=src.id;
-				classIndex=src.classIndex;
-				isEmbedded=src.isEmbedded;
-				class_=src.class_;
-			}
-			void *ptr;
+			ObjectRef(void* ptr, int id, bool isEmbedded, creg::Class* class_)
+				: ptr(ptr)
+				, id(id)
+				, classIndex(0)
+				, isEmbedded(isEmbedded)
+				, isSaved(false)
+				, class_(class_)
+				, next(NULL)
+			{}
+
+			void* ptr;
 			int id, classIndex;
 			bool isEmbedded;
-			creg::Class *class_;
-			std::vector<COutputStreamSerializer::ObjectMemberGroup> memberGroups;
-			bool isThisObject(void *objPtr,creg::Class *objClass,bool objEmbedded) const
+			/// the data of the object was written already
+			bool isSaved;
+			creg::Class* class_;
+			/// next object at the same address (e.g. a member embedded at offset 0)
+			ObjectRef* next;
+
+			bool isThisObject(void* objPtr, creg::Class* objClass, bool objEmbedded) const
 			{
-				if (ptr!=objPtr) return false;
-				if (class_==objClass) return true;
-				if (isEmbedded&&objEmbedded) return false;
+				if (ptr != objPtr) return false;
+				if (class_ == objClass) return true;
+				if (isEmbedded && objEmbedded) return false;
 				if (!objEmbedded) {
-					for (creg::Class *base=class_->base;base;base=base->base)
-						if (base==objClass) return true;
-				} 
+					for (creg::Class* base = class_->base; base; base = base->base)
+						if (base == objClass) return true;
+				}
 				if (!isEmbedded) {
-					for (creg::Class *base=objClass->base;base;base=base->base)
-						if (base==class_) return true;
+					for (creg::Class* base = objClass->base; base; base = base->base)
+						if (base == class_) return true;
 				}
 				return false;
 			}
 		};
 
-		// Temporary class reference
-		struct ClassRef;
+		CChunkedBuffer* buffer;
+		/// first ObjectRef at each address
+		SPRING_HASH_MAP<void*, ObjectRef*> ptrToId;
+		/// indexed by id, a deque keeps the references stable
+		std::deque<ObjectRef> objects;
+		/// these objects still have to be saved, in the order of their ids
+		std::vector<ObjectRef*> pendingObjects;
 
-		std::ostream *stream;
-		std::map <void*,std::vector<ObjectRef*> > ptrToId;
-		std::list <ObjectRef> objects;
-		std::vector <ObjectRef*> pendingObjects; // these objects still have to be saved
-
-		// Serialize all class names
-		void WriteObjectInfo ();
 		// Helper for instance/ptr saving
-		void WriteObjectRef (void *inst, creg::Class *cls, bool embedded);
-
-		ObjectRef* FindObjectRef(void *inst, creg::Class *objClass, bool isEmbedded);
+		ObjectRef* FindObjectRef(void* inst, creg::Class* objClass, bool isEmbedded);
+		ObjectRef* AddObjectRef(void* inst, creg::Class* objClass, bool isEmbedded);
 
-		void SerializeObject (Class *c, void *ptr, ObjectRef *objr);
+		void SerializeObject(Class* c, void* ptr);
+		void WriteVarSizeUInt(unsigned int val);
 
 	public:
-		COutputStreamSerializer ();
+		COutputStreamSerializer();
 
 		/** Create a package of the given root object and all the objects that it references
-		 * @param s stream to serialize the data to
+		 * @param s stream to serialize the data to (as the package size, followed by the package)
 		 * @param rootObj the rootObj: the starting point for finding all the objects to save
 		 * @param cls the class of the root object
 		 * This method throws an std::runtime_error when something goes wrong
 		 */
-		void SavePackage (std::ostream *s, void *rootObj, creg::Class *cls);
+		void SavePackage(std::ostream* s, void* rootObj, creg::Class* cls);
+		/**
+		 * Appends a package to buf; its size is the growth of buf->GetSize().
+		 * If buf has a consumer, the object data reaches it while the
+		 * objects are still being serialized.
+		 */
+		void SavePackage(CChunkedBuffer* buf, void* rootObj, creg::Class* cls);
 
 		/** @see ISerializer::IsWriting */
-		bool IsWriting ();
+		bool IsWriting();
 
 		/** @see ISerializer::SerializeObjectPtr */
-		void SerializeObjectPtr (void **ptr, creg::Class *cls);
-		
+		void SerializeObjectPtr(void** ptr, creg::Class* cls);
+
 		/** @see ISerializer::SerializeObjectInstance */
-		void SerializeObjectInstance (void *inst, creg::Class *cls);
+		void SerializeObjectInstance(void* inst, creg::Class* cls);
 
 		/** @see ISerializer::Serialize */
-		void Serialize (void *data, int byteSize);
+		void Serialize(void* data, int byteSize);
 
 		/** @see ISerializer::SerializeInt */
-		void SerializeInt (void *data, int byteSize);
+		void SerializeInt(void* data, int byteSize);
 
 		/** Empty function, only applies to loading */
-		void AddPostLoadCallback (void (*cb)(void *d), void *d) {}
+		void AddPostLoadCallback(void (*cb)(void* d), void* d) {}
 	};
 
 	/** Input stream serializer
@@ -126,59 +121,78 @@ namespace creg {
 	class CInputStreamSerializer : public ISerializer
 	{
 	protected:
-		std::istream* stream;
-		std::vector <creg::Class *> classRefs;
+		/// the package is read in place, sequentially
+		const boost::uint8_t* readPos;
+		const boost::uint8_t* readEnd;
+
+		std::vector<creg::Class*> classRefs;
 
 		struct UnfixedPtr {
-			void **ptrAddr;
+			void** ptrAddr;
 			int objID;
 		};
-		std::vector <UnfixedPtr> unfixedPointers; // pointers to embedded objects that haven't been filled yet, because they are not yet loaded
+		std::vector<UnfixedPtr> unfixedPointers; // pointers to embedded objects that haven't been filled yet, because they are not yet loaded
 
 		struct StoredObject
 		{
-			void *obj;
+			void* obj;
 			int classRef;
 			bool isEmbedded;
 		};
-		std::vector <StoredObject> objects;
+		std::vector<StoredObject> objects;
 
 		struct PostLoadCallback
 		{
-			void (*cb)(void *d);
-			void *userdata;
+			void (*cb)(void* d);
+			void* userdata;
 		};
-		std::vector <PostLoadCallback> callbacks;
+		std::vector<PostLoadCallback> callbacks;
+
+		void SerializeObject(Class* c, void* ptr);
+
+		void Read(void* data, size_t size) {
+			if (size > size_t(readEnd - readPos))
+				throw std::runtime_error("Unexpected end of object package");
+
+			memcpy(data, readPos, size);
+			readPos += size;
+		}
+		unsigned int ReadVarSizeUInt();
 
-		void SerializeObject (Class *c, void *ptr);
 	public:
-		CInputStreamSerializer ();
-		~CInputStreamSerializer ();
+		CInputStreamSerializer();
+		~CInputStreamSerializer();
 
 		/** @see ISerializer::IsWriting */
-		bool IsWriting ();
+		bool IsWriting();
 
 		/** @see ISerializer::SerializeObjectPtr */
-		void SerializeObjectPtr (void **ptr, creg::Class *cls);
-		
+		void SerializeObjectPtr(void** ptr, creg::Class* cls);
+
 		/** @see ISerializer::SerializeObjectInstance */
-		void SerializeObjectInstance (void *inst, creg::Class *cls);
+		void SerializeObjectInstance(void* inst, creg::Class* cls);
 
 		/** @see ISerializer::Serialize */
-		void Serialize (void *data, int byteSize);
+		void Serialize(void* data, int byteSize);
 
 		/** @see ISerializer::SerializeInt */
-		void SerializeInt (void *data, int byteSize);
+		void SerializeInt(void* data, int byteSize);
 
 		/** @see ISerializer::AddPostLoadCallback */
-		void AddPostLoadCallback (void (*cb)(void *userdata), void *userdata);
+		void AddPostLoadCallback(void (*cb)(void* userdata), void* userdata);
 
-		/** Load a package that is saved by CInputStreamSerializer
+		/** Load a package that is saved by COutputStreamSerializer
 		 * @param s the input stream to read from
 		 * @param root the root object address will be assigned to this
 		 * @param rootCls the root object class will be assigned to this
 		 * This method throws an std::runtime_error when something goes wrong */
-		void LoadPackage (std::istream *s, void *&root, creg::Class *&rootCls);
+		void LoadPackage(std::istream* s, void*& root, creg::Class*& rootCls);
+		/**
+		 * Load a package from memory (e.g. a memory-mapped file) in a single
+		 * pass over its data, without copying it.
+		 * @param size the exact size of the package
+		 */
+		void LoadPackage(const boost::uint8_t* data, size_t size, void*& root, creg::Class*& rootCls);
 	};
 
 };
@@ -1599,3 +1599,20 @@ extern int ZEXPORT unzSetOffset (file, pos)
     s->current_file_ok = (err == UNZ_OK);
     return err;
 }
+
+/* Backported from minizip 1.1 (unzGetCurrentFileZStreamPos64) */
+extern uLong ZEXPORT unzGetCurrentFileZStreamPos (file)
+    unzFile file;
+{
+    unz_s* s;
+    file_in_zip_read_info_s* pfile_in_zip_read_info;
+
+    if (file==NULL)
+        return 0;
+    s=(unz_s*)file;
+    pfile_in_zip_read_info=s->pfile_in_zip_read;
+    if (pfile_in_zip_read_info==NULL)
+        return 0;
+    return pfile_in_zip_read_info->pos_in_zipfile +
+           pfile_in_zip_read_info->byte_before_the_zipfile;
+}
@@ -345,6 +345,10 @@ extern uLong ZEXPORT unzGetOffset (unzFile file);
 /* Set the current file offset */
 extern int ZEXPORT unzSetOffset (unzFile file, uLong pos);
 
+/* Get the offset of the (compressed) data of the currently opened file,
+   relative to the start of the zipfile; 0 if no file is opened */
+extern uLong ZEXPORT unzGetCurrentFileZStreamPos (unzFile file);
+
 
 
 #ifdef __cplusplus
@@ -0,0 +1,140 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Map/SMF/SMFTileCache.h"
+#include "Map/SMF/SMFFormat.h"
+
+#include <cstring>
+#include <vector>
+#include <boost/thread/thread.hpp>
+
+#define BOOST_TEST_MODULE SMFTileCache
+#include <boost/test/unit_test.hpp>
+
+static const int numSquaresX = 3;
+static const int numSquaresY = 2;
+static const int tileMapSizeX = numSquaresX * CSMFTileCache::SQUARE_TILES;
+static const int tileMapSizeY = numSquaresY * CSMFTileCache::SQUARE_TILES;
+static const int numTiles = 100;
+
+
+/// every byte of a tile holds its index (mod 256)
+class TestTileSource: public CSMFTileCache::ITileSource {
+public:
+	TestTileSource(): tiles(numTiles * SMALL_TILE_SIZE) {
+		for (int i = 0; i < numTiles; ++i) {
+			memset(&tiles[i * SMALL_TILE_SIZE], i, SMALL_TILE_SIZE);
+		}
+	}
+
+	const char* GetTile(int tileIdx) {
+		return &tiles[tileIdx * SMALL_TILE_SIZE];
+	}
+
+	std::vector<char> tiles;
+};
+
+static std::vector<int> CreateTileMap()
+{
+	std::vector<int> tileMap(tileMapSizeX * tileMapSizeY);
+
+	for (size_t i = 0; i < tileMap.size(); ++i) {
+		tileMap[i] = (i * 7) % numTiles;
+	}
+
+	return tileMap;
+}
+
+/// index of the tile at the first DXT1 block of tile (tx, ty) in an extracted square
+static int TileAt(const std::vector<char>& square, int mipLevel, int tx, int ty)
+{
+	const int numBlocks = 8 >> mipLevel;
+	const int doff = (tx * numBlocks) + (ty * numBlocks * numBlocks) * CSMFTileCache::SQUARE_TILES;
+
+	return (unsigned char) square[doff * 8];
+}
+
+static std::vector<char> SquareBuffer(int mipLevel)
+{
+	const int size = (CSMFTileCache::SQUARE_TILES * 32) >> mipLevel;
+	return std::vector<char>((size * size) / 2);
+}
+
+
+BOOST_AUTO_TEST_CASE(LowResAlwaysAvailable)
+{
+	TestTileSource source;
+	const std::vector<int> tileMap = CreateTileMap();
+	CSMFTileCache cache(&source, tileMap, numSquaresX, numSquaresY, 0, false);
+
+	std::vector<char> square = SquareBuffer(CSMFTileCache::LOW_RES_LEVEL);
+
+	BOOST_CHECK(cache.ExtractSquare(2, 1, CSMFTileCache::LOW_RES_LEVEL, &square[0]));
+	BOOST_CHECK_EQUAL(TileAt(square, CSMFTileCache::LOW_RES_LEVEL, 5, 3), tileMap[(32 + 3) * tileMapSizeX + 64 + 5]);
+
+	// nothing high-res is resident without a request
+	square = SquareBuffer(0);
+	BOOST_CHECK(!cache.ExtractSquare(2, 1, 0, &square[0]));
+	BOOST_CHECK_EQUAL(cache.GetStats().numResident, 0u);
+}
+
+
+BOOST_AUTO_TEST_CASE(ResidencyIsBounded)
+{
+	TestTileSource source;
+	const std::vector<int> tileMap = CreateTileMap();
+	CSMFTileCache cache(&source, tileMap, numSquaresX, numSquaresY, 2 * CSMFTileCache::SQUARE_BYTES, false);
+
+	std::vector<char> square = SquareBuffer(1);
+
+	BOOST_CHECK(cache.Request(0, 0));
+	BOOST_CHECK(cache.ExtractSquare(0, 0, 1, &square[0]));
+	BOOST_CHECK_EQUAL(TileAt(square, 1, 31, 31), tileMap[31 * tileMapSizeX + 31]);
+
+	BOOST_CHECK(cache.Request(1, 0));
+	BOOST_CHECK(cache.Request(0, 0)); // most recently used again
+	BOOST_CHECK(cache.Request(2, 0));
+	cache.Update();
+
+	const CSMFTileCache::Stats& stats = cache.GetStats();
+	BOOST_CHECK_EQUAL(stats.numResident, 2u);
+	BOOST_CHECK(stats.residentBytes <= stats.maxResidentBytes);
+	BOOST_CHECK_EQUAL(stats.numEvictions, 1u);
+	BOOST_CHECK_EQUAL(stats.numMisses, 3u);
+
+	// (1, 0) was the least recently used one
+	square = SquareBuffer(0);
+	BOOST_CHECK(cache.ExtractSquare(0, 0, 0, &square[0]));
+	BOOST_CHECK(cache.ExtractSquare(2, 0, 0, &square[0]));
+	BOOST_CHECK(!cache.ExtractSquare(1, 0, 0, &square[0]));
+}
+
+
+BOOST_AUTO_TEST_CASE(AsyncLoading)
+{
+	TestTileSource source;
+	const std::vector<int> tileMap = CreateTileMap();
+	CSMFTileCache cache(&source, tileMap, numSquaresX, numSquaresY, 4 * CSMFTileCache::SQUARE_BYTES, true);
+
+	std::vector<char> square = SquareBuffer(2);
+
+	BOOST_CHECK(!cache.Request(1, 1));
+	BOOST_CHECK(!cache.Request(1, 1)); // already queued
+
+	for (int n = 0; n < 1000 && !cache.Request(1, 1); ++n) {
+		boost::this_thread::sleep(boost::posix_time::milliseconds(5));
+		cache.Update();
+	}
+
+	BOOST_CHECK(cache.ExtractSquare(1, 1, 2, &square[0]));
+	BOOST_CHECK_EQUAL(TileAt(square, 2, 0, 0), tileMap[32 * tileMapSizeX + 32]);
+
+	const CSMFTileCache::Stats& stats = cache.GetStats();
+	BOOST_CHECK_EQUAL(stats.numMisses, 1u);
+	BOOST_CHECK_EQUAL(stats.numLoads, 1u);
+	BOOST_CHECK(stats.maxMissLatency <= stats.totalMissLatency);
+
+	// loading on the calling thread
+	square = SquareBuffer(0);
+	cache.RequestNow(0, 1);
+	BOOST_CHECK(cache.ExtractSquare(0, 1, 0, &square[0]));
+}
@@ -0,0 +1,296 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Map/Ground.h"
+#include "Sim/Misc/GlobalSynced.h"
+#include "Sim/Misc/GroundBlockingObjectMap.h"
+#include "Sim/Misc/QuadField.h"
+#include "Sim/MoveTypes/GroundMoveType.h"
+#include "Sim/MoveTypes/MoveInfo.h"
+#include "Sim/MoveTypes/MoveMath/MoveMath.h"
+#include "Sim/Path/IPathManager.h"
+#include "Sim/Projectiles/Projectile.h"
+#include "Sim/Units/Unit.h"
+#include "Sim/Units/UnitDef.h"
+#include "Sim/Units/CommandAI/CommandAI.h"
+#include "System/ThreadPool.h"
+#include "System/myMath.h"
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#define BOOST_TEST_MODULE ParallelMovement
+#include <boost/test/unit_test.hpp>
+
+/*
+ * Two dense armies of CGroundMoveType units march through each other on
+ * the flat, open map of NullSim.cpp, updated as in CUnitHandler::Update:
+ * AMoveType::PrepareUpdates, then the Update of every move type in turn.
+ */
+
+static const int armyRows = 40;
+static const int armyCols = 50; // units per army = rows * cols
+static const int numFrames = 150;
+
+static const float unitSpacing = 20.0f;
+static const float unitSpeed = 2.0f;
+
+
+/// paths lead straight to the goal
+class CStraightPathManager : public IPathManager
+{
+public:
+	unsigned int RequestPath(const MoveData*, const float3&, const float3& goalPos, float, CSolidObject*, bool) {
+		goals[++lastPathId] = goalPos;
+		return lastPathId;
+	}
+	void DeletePath(unsigned int pathId) { goals.erase(pathId); }
+
+	float3 NextWaypoint(unsigned int pathId, float3 callerPos, float, int, int, bool) const {
+		std::map<unsigned int, float3>::const_iterator it = goals.find(pathId);
+
+		if (it == goals.end())
+			return float3(-1.0f, -1.0f, -1.0f);
+
+		float3 dir = (it->second - callerPos);
+		dir.y = 0.0f;
+
+		if (dir.Length() <= (SQUARE_SIZE * 8))
+			return it->second;
+
+		return (callerPos + dir.Normalize() * (SQUARE_SIZE * 8));
+	}
+
+	CStraightPathManager(): lastPathId(0) {}
+
+private:
+	std::map<unsigned int, float3> goals;
+	unsigned int lastPathId;
+};
+
+class CFlatMoveMath : public CMoveMath
+{
+protected:
+	float SpeedMod(const MoveData&, float, float) const { return 1.0f; }
+	float SpeedMod(const MoveData&, float, float, float) const { return 1.0f; }
+
+public:
+	float yLevel(int, int) const { return 0.0f; }
+};
+
+CR_BIND_INTERFACE(CMoveMath);
+float CMoveMath::yLevel(const float3&) const { return 0.0f; }
+
+// only referenced by the creg metadata of the move types
+creg::ClassBinder CProjectile::binder("CProjectile", creg::CF_Abstract, NULL, NULL, sizeof(CProjectile), NULL, NULL);
+
+
+struct World {
+	World() {
+		gs = new CGlobalSynced();
+		ground = new CGround();
+		qf = new CQuadField();
+		groundBlockingObjectMap = new CGroundBlockingObjectMap(gs->mapSquares);
+		pathManager = new CStraightPathManager();
+
+		float3::maxxpos = gs->mapx * SQUARE_SIZE - 1;
+		float3::maxzpos = gs->mapy * SQUARE_SIZE - 1;
+
+		moveData = new MoveData(NULL);
+		moveData->xsize = 2;
+		moveData->zsize = 2;
+		moveData->moveMath = new CFlatMoveMath();
+
+		unitDef = new UnitDef();
+		unitDef->movedata = moveData;
+		unitDef->xsize = moveData->xsize;
+		unitDef->zsize = moveData->zsize;
+		unitDef->rSpeed = 0.0f;
+		unitDef->canfly = false;
+		unitDef->pushResistant = false;
+		unitDef->turnInPlace = true;
+		unitDef->turnInPlaceSpeedLimit = 0.0f;
+		unitDef->slideTolerance = 0.0f;
+		unitDef->waterline = 0.0f;
+
+		for (int side = 0; side < 2; ++side) {
+			for (int r = 0; r < armyRows; ++r) {
+				for (int c = 0; c < armyCols; ++c) {
+					const float x = 1024.0f + c * unitSpacing + r * 0.37f;
+					const float z = ((side == 0)? 1000.0f: 2000.0f) + r * unitSpacing;
+
+					AddUnit(float3(x, 0.0f, z), float3(x, 0.0f, (side == 0)? (z + 2000.0f): (z - 1800.0f)));
+				}
+			}
+		}
+	}
+
+	~World() {
+		for (std::list<CUnit*>::iterator it = units.begin(); it != units.end(); ++it) {
+			CUnit* unit = *it;
+
+			qf->RemoveUnit(unit);
+			unit->UnBlock();
+
+			delete unit->moveType;
+			delete unit->commandAI;
+			delete unit;
+		}
+
+		delete unitDef;
+		delete moveData->moveMath;
+		delete moveData;
+
+		delete pathManager; pathManager = NULL;
+		delete groundBlockingObjectMap; groundBlockingObjectMap = NULL;
+		delete qf; qf = NULL;
+		delete ground; ground = NULL;
+		delete gs; gs = NULL;
+	}
+
+	void AddUnit(const float3& pos, const float3& goal) {
+		CUnit* unit = new CUnit();
+
+		unit->id = units.size();
+		unit->unitDef = unitDef;
+		unit->mobility = new MoveData(moveData);
+		unit->team = 0;
+		unit->allyteam = 0;
+		unit->mass = 100.0f;
+		unit->xsize = moveData->xsize;
+		unit->zsize = moveData->zsize;
+		unit->radius = 8.0f;
+		unit->height = 16.0f;
+		unit->blocking = true;
+		unit->maxSpeed = unitSpeed;
+		unit->pos = pos;
+		unit->heading = GetHeadingFromVector(0.0f, goal.z - pos.z);
+		unit->SetDirectionFromHeading();
+
+		// no BuggerOff (it would need a CGameHelper)
+		unit->commandAI = new CCommandAI();
+		unit->commandAI->unimportantMove = true;
+
+		CGroundMoveType* moveType = new CGroundMoveType(unit);
+		moveType->maxSpeed = unitSpeed;
+		moveType->accRate = 0.1f;
+		moveType->decRate = 0.1f;
+		moveType->turnRate = 500.0f;
+		unit->moveType = moveType;
+
+		// StartMoving without the unit script calls
+		moveType->goalPos = goal;
+		moveType->goalRadius = 16.0f;
+		moveType->requestedSpeed = unitSpeed;
+		moveType->progressState = AMoveType::Active;
+		moveType->pathId = pathManager->RequestPath(moveData, pos, goal, moveType->goalRadius, unit);
+		moveType->waypoint = pos;
+		moveType->nextWaypoint = pathManager->NextWaypoint(moveType->pathId, pos);
+
+		qf->MovedUnit(unit);
+		unit->Block();
+
+		units.push_back(unit);
+	}
+
+	void Update(bool prepare, int numThreads) {
+		gs->frameNum += 1;
+
+		if (prepare) {
+			const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+			AMoveType::PrepareUpdates(units, numThreads);
+
+			prepareTime += (boost::posix_time::microsec_clock::universal_time() - start);
+		}
+
+		for (std::list<CUnit*>::iterator it = units.begin(); it != units.end(); ++it) {
+			(*it)->moveType->Update();
+		}
+
+		if ((gs->frameNum % UNIT_SLOWUPDATE_RATE) == 0) {
+			// as AMoveType::SlowUpdate does
+			for (std::list<CUnit*>::iterator it = units.begin(); it != units.end(); ++it) {
+				qf->MovedUnit(*it);
+			}
+		}
+	}
+
+	std::vector<float> GetState() const {
+		std::vector<float> state;
+
+		for (std::list<CUnit*>::const_iterator it = units.begin(); it != units.end(); ++it) {
+			state.push_back((*it)->pos.x);
+			state.push_back((*it)->pos.z);
+			state.push_back((*it)->heading);
+		}
+
+		return state;
+	}
+
+	std::list<CUnit*> units;
+	boost::posix_time::time_duration prepareTime;
+
+	MoveData* moveData;
+	UnitDef* unitDef;
+};
+
+
+static double Seconds(const boost::posix_time::ptime& start)
+{
+	return (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() * 1e-6;
+}
+
+/// runs all frames, returns the positions and headings at the end
+static std::vector<float> Run(bool prepare, int numThreads, double* seconds, double* prepareSeconds = NULL)
+{
+	World world;
+
+	const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+	for (int f = 0; f < numFrames; ++f)
+		world.Update(prepare, numThreads);
+
+	*seconds = Seconds(start);
+
+	if (prepareSeconds != NULL)
+		*prepareSeconds = world.prepareTime.total_microseconds() * 1e-6;
+
+	return world.GetState();
+}
+
+BOOST_AUTO_TEST_CASE(DenseArmyBenchmark)
+{
+	CMyMath::Init();
+	CGroundMoveType::CreateLineTable();
+
+	double serialTime = 0.0;
+	const std::vector<float> serialState = Run(false, 1, &serialTime);
+
+	BOOST_TEST_MESSAGE((armyRows * armyCols * 2) << " units, " << numFrames << " frames: "
+		<< serialTime << "s not prepared");
+
+	// on one thread PrepareUpdates leaves everything to Update
+	double oneThreadTime = 0.0;
+	double oneThreadPrepareTime = 0.0;
+	const std::vector<float> oneThreadState = Run(true, 1, &oneThreadTime, &oneThreadPrepareTime);
+
+	BOOST_TEST_MESSAGE("  prepared on 1 thread: " << oneThreadTime << "s ("
+		<< oneThreadPrepareTime << "s of it in PrepareUpdates)");
+	BOOST_CHECK(oneThreadState == serialState);
+
+	// the results must not depend on whether or on how many threads they were prepared
+	for (int numThreads = 2; numThreads <= std::max(4, ThreadPool::GetNumThreads()); numThreads *= 2) {
+		double time = 0.0;
+		double prepareTime = 0.0;
+		const std::vector<float> state = Run(true, numThreads, &time, &prepareTime);
+
+		BOOST_TEST_MESSAGE("  prepared on " << numThreads << " threads: " << time << "s ("
+			<< prepareTime << "s of it in PrepareUpdates)");
+		BOOST_CHECK(state == serialState);
+	}
+
+	CGroundMoveType::DeleteLineTable();
+}
@@ -0,0 +1,270 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+/*
+ * The parts of the sim around the units, reduced to what headless tests of
+ * the real move types and projectile collisions need: a flat, open map
+ * without water, one ally team and units without scripts, weapons, models
+ * or orders.
+ */
+
+#include "ExternalAI/EngineOutHandler.h"
+#include "Game/GameHelper.h"
+#include "Game/GlobalUnsynced.h"
+#include "Lua/LuaMaterial.h"
+#include "Map/Ground.h"
+#include "Map/MapInfo.h"
+#include "Rendering/Icon.h"
+#include "Sim/Features/Feature.h"
+#include "Sim/Misc/AirBaseHandler.h"
+#include "Sim/Misc/DamageArray.h"
+#include "Sim/Misc/GlobalSynced.h"
+#include "Sim/Misc/GroundBlockingObjectMap.h"
+#include "Sim/Misc/LosHandler.h"
+#include "Sim/Misc/RadarHandler.h"
+#include "Sim/Misc/TeamHandler.h"
+#include "Sim/MoveTypes/MoveInfo.h"
+#include "Sim/MoveTypes/MoveMath/MoveMath.h"
+#include "Sim/Path/IPathManager.h"
+#include "Sim/Units/Unit.h"
+#include "Sim/Units/UnitDef.h"
+#include "Sim/Units/CommandAI/CommandAI.h"
+#include "System/EventHandler.h"
+#include "System/myMath.h"
+
+#include <cstddef>
+
+class CCamera;
+class ConfigHandler;
+
+CCamera* camera = NULL;
+ConfigHandler* configHandler = NULL;
+CGlobalSynced* gs = NULL;
+CGlobalUnsynced* gu = NULL;
+CTeamHandler* teamHandler = NULL;
+CGround* ground = NULL;
+CGameHelper* helper = NULL;
+CLosHandler* loshandler = NULL;
+CRadarHandler* radarhandler = NULL;
+const CMapInfo* mapInfo = NULL;
+IPathManager* pathManager = NULL;
+CEventHandler eventHandler;
+
+
+CR_BIND(CGlobalSynced, );
+CR_BIND(CTeamHandler, );
+CR_BIND_INTERFACE(MoveData);
+CR_BIND_DERIVED_INTERFACE(CUnit, CSolidObject);
+CR_BIND_DERIVED(CCommandAI, CObject, );
+CR_BIND(CCommandQueue, );
+
+// only referenced by the creg metadata of the move types
+creg::ClassBinder CFeature::binder("CFeature", creg::CF_Abstract, NULL, NULL, sizeof(CFeature), NULL, NULL);
+creg::ClassBinder CAirBaseHandler::LandingPad::binder("LandingPad", creg::CF_Abstract, NULL, NULL, sizeof(CAirBaseHandler::LandingPad), NULL, NULL);
+
+
+CGlobalSynced::CGlobalSynced()
+{
+	mapx  = 512;
+	mapy  = 512;
+	mapxm1 = mapx - 1;
+	mapym1 = mapy - 1;
+	mapxp1 = mapx + 1;
+	mapyp1 = mapy + 1;
+	mapSquares = mapx * mapy;
+	hmapx = mapx>>1;
+	hmapy = mapy>>1;
+	pwr2mapx = mapx;
+	pwr2mapy = mapy;
+	randSeed = 18655;
+	initRandSeed = randSeed;
+	frameNum = 0;
+	tempNum = 2;
+
+	teamHandler = new CTeamHandler();
+}
+
+CGlobalSynced::~CGlobalSynced()
+{
+	delete teamHandler;
+	teamHandler = NULL;
+}
+
+float CGlobalSynced::randFloat()
+{
+	randSeed = (randSeed * 214013L + 2531011L);
+	return float((randSeed >> 16) & RANDINT_MAX) / RANDINT_MAX;
+}
+
+CPlayer* CGlobalUnsynced::GetMyPlayer() { return NULL; }
+
+
+CTeamHandler::CTeamHandler():
+	gaiaTeamID(-1),
+	gaiaAllyTeamID(-1)
+{
+	allyTeams.resize(1);
+	allyTeams[0].allies.resize(1, true);
+}
+
+CTeamHandler::~CTeamHandler() {}
+
+
+CEventHandler::CEventHandler() {}
+CEventHandler::~CEventHandler() {}
+
+CEngineOutHandler* CEngineOutHandler::GetInstance() { return NULL; }
+void CEngineOutHandler::UnitMoveFailed(const CUnit& unit) {}
+
+void CGameHelper::BuggerOff(float3 pos, float radius, bool spherical, bool forced, int teamId, CUnit* exclude) {}
+void CLosHandler::MoveUnit(CUnit* unit, bool redoCurrent) {}
+void CRadarHandler::MoveUnit(CUnit* unit) {}
+
+
+CGround::~CGround() {}
+
+float CGround::GetApproximateHeight(float x, float y, bool synced) const { return 0.0f; }
+float CGround::GetHeightAboveWater(float x, float y, bool synced) const { return 0.0f; }
+float CGround::GetHeightReal(float x, float y, bool synced) const { return 0.0f; }
+float CGround::GetSlope(float x, float y, bool synced) const { return 0.0f; }
+const float3& CGround::GetNormal(float x, float y, bool synced) const { return UpVector; }
+
+
+bool CMoveMath::CrushResistant(const MoveData& moveData, const CSolidObject* object)
+{
+	// there are no features on the map
+	return object->blocking;
+}
+
+bool CMoveMath::IsNonBlocking(const MoveData& moveData, const CSolidObject* obstacle, const CSolidObject* unit)
+{
+	// everything is on the same (flat, dry) ground
+	return !obstacle->blocking;
+}
+
+float CMoveMath::GetPosSpeedMod(const MoveData& moveData, int xSquare, int zSquare) const { return 1.0f; }
+float CMoveMath::GetPosSpeedMod(const MoveData& moveData, int xSquare, int zSquare, const float3& moveDir) const { return 1.0f; }
+int CMoveMath::IsBlocked(const MoveData& moveData, const float3& pos) const { return 0; }
+int CMoveMath::IsBlocked(const MoveData& moveData, int xSquare, int zSquare) const { return 0; }
+
+
+DamageArray::DamageArray(float damage) {}
+void CFeature::DoDamage(const DamageArray& damages, const float3& impulse) {}
+
+
+UnitDef::UnitDef() {}
+UnitDef::~UnitDef() {}
+
+icon::CIcon::CIcon() : data(NULL) {}
+icon::CIcon::~CIcon() {}
+
+LuaMatRef::~LuaMatRef() {}
+
+
+CUnit::CUnit() : CSolidObject(),
+	unitDef(NULL),
+	unitDefID(-1),
+	frontdir(0.0f, 0.0f, 1.0f),
+	rightdir(-1.0f, 0.0f, 0.0f),
+	updir(0.0f, 1.0f, 0.0f),
+	upright(true),
+	beingBuilt(false),
+	stunned(false),
+	falling(false),
+	inWater(false),
+	usingScriptMoveType(false),
+	transporter(NULL),
+	moveType(NULL),
+	commandAI(NULL),
+	script(NULL),
+	fpsControlPlayer(NULL)
+{
+}
+
+CUnit::~CUnit() {}
+
+void CUnit::PreInit(const UnitDef* def, int team, int facing, const float3& position, bool build) {}
+void CUnit::PostInit(const CUnit* builder) {}
+void CUnit::SlowUpdate() {}
+void CUnit::SlowUpdateWeapons() {}
+void CUnit::Update() {}
+void CUnit::DoDamage(const DamageArray& damages, CUnit* attacker, const float3& impulse, int weaponId) {}
+void CUnit::DoWaterDamage() {}
+void CUnit::Kill(const float3& impulse) {}
+void CUnit::AddImpulse(const float3&) {}
+void CUnit::FinishedBuilding() {}
+void CUnit::DeleteDeathDependence(CObject* o, DependenceType dep) {}
+bool CUnit::ChangeTeam(int team, ChangeType type) { return false; }
+void CUnit::StopAttackingAllyTeam(int ally) {}
+void CUnit::KillUnit(bool SelfDestruct, bool reclaimed, CUnit* attacker, bool showDeathSequence) {}
+void CUnit::LoadSave(CLoadSaveInterface* file, bool loading) {}
+void CUnit::IncomingMissile(CMissileProjectile* missile) {}
+bool CUnit::AddBuildPower(float amount, CUnit* builder) { return false; }
+void CUnit::DependentDied(CObject* o) {}
+
+CMatrix44f CUnit::GetTransformMatrix(const bool synced, const bool error) const
+{
+	// there is no drawn (or error) position
+	return CMatrix44f(pos, -rightdir, updir, frontdir);
+}
+
+void CUnit::SetDirectionFromHeading()
+{
+	// UpdateDirVectors on flat ground
+	updir    = UpVector;
+	frontdir = GetVectorFromHeading(heading);
+	rightdir = (frontdir.cross(updir)).Normalize();
+	frontdir = updir.cross(rightdir);
+
+	UpdateMidPos();
+}
+
+void CUnit::UpdateMidPos()
+{
+	midPos = pos +
+		(frontdir * relMidPos.z) +
+		(updir    * relMidPos.y) +
+		(rightdir * relMidPos.x);
+}
+
+void CUnit::MoveMidPos(const float3& deltaPos) {
+	midPos += deltaPos;
+	pos = midPos -
+		(frontdir * relMidPos.z) -
+		(updir    * relMidPos.y) -
+		(rightdir * relMidPos.x);
+}
+
+
+CCommandAI::CCommandAI():
+	stockpileWeapon(0),
+	lastUserCommand(-1000),
+	selfDCountdown(0),
+	lastFinishCommand(0),
+	owner(NULL),
+	orderTarget(0),
+	targetDied(false),
+	inCommand(false),
+	selected(false),
+	repeatOrders(false),
+	lastSelectedCommandPage(0),
+	unimportantMove(false),
+	targetLostTimer(0)
+{}
+
+CCommandAI::~CCommandAI() {}
+
+int CCommandAI::GetDefaultCmd(const CUnit* pointed, const CFeature* feature) { return 0; }
+void CCommandAI::SlowUpdate() {}
+void CCommandAI::GiveCommandReal(const Command& c, bool fromSynced) {}
+std::vector<CommandDescription>& CCommandAI::GetPossibleCommands() { return possibleCommands; }
+void CCommandAI::FinishCommand() {}
+void CCommandAI::WeaponFired(CWeapon* weapon) {}
+void CCommandAI::BuggerOff(const float3& pos, float radius) {}
+void CCommandAI::LoadSave(CLoadSaveInterface* file, bool loading) {}
+bool CCommandAI::WillCancelQueued(const Command& c) { return false; }
+bool CCommandAI::HasMoreMoveCommands() { return false; }
+void CCommandAI::StopAttackingAllyTeam(int ally) {}
+void CCommandAI::ExecuteAttack(Command& c) {}
+void CCommandAI::ExecuteStop(Command& c) {}
+bool CCommandAI::AllowedCommand(const Command& c, bool fromSynced) { return false; }
+void CCommandAI::DependentDied(CObject* o) {}
@@ -0,0 +1,256 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Sim/Path/Default/PathFlowField.h"
+#include "Sim/Path/Default/PathConstants.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#define BOOST_TEST_MODULE PathFlowField
+#include <boost/test/unit_test.hpp>
+
+/*
+ * Compares the two ways CPathManager can serve a group of units ordered to
+ * the same goal: one search per unit over the estimator blocks (modelling
+ * CPathEstimator::GetPath), or one shared CPathFlowField that every unit
+ * follows from its own block.
+ */
+
+static const int numBlocksX = 128;
+static const int numBlocksZ = 128;
+static const int numBlocks = numBlocksX * numBlocksZ;
+
+// block offsets of the PATHDIR_* directions
+static const int dirX[8] = {1,  1,  0, -1, -1, -1,  0,  1};
+static const int dirZ[8] = {0,  1,  1,  1,  0, -1, -1, -1};
+
+/// a hilly map with a few impassable ridges, edge costs as the estimator vertices
+static void MakeEdgeCosts(std::vector<float>* edgeCosts)
+{
+	std::vector<float> blockCosts(numBlocks);
+	std::vector<bool> blocked(numBlocks, false);
+
+	for (int z = 0; z < numBlocksZ; ++z) {
+		for (int x = 0; x < numBlocksX; ++x) {
+			blockCosts[z * numBlocksX + x] = 8.0f + 6.0f * std::fabs(std::sin(x * 0.13f) * std::cos(z * 0.07f));
+
+			// walls with gaps
+			blocked[z * numBlocksX + x] =
+				((x % 32) == 16 && (z % 40) > 4) ||
+				((z % 48) == 24 && (x % 36) > 6);
+		}
+	}
+
+	edgeCosts->assign(numBlocks * 8, PATHCOST_INFINITY);
+
+	for (int z = 0; z < numBlocksZ; ++z) {
+		for (int x = 0; x < numBlocksX; ++x) {
+			for (int dir = 0; dir < 8; ++dir) {
+				const int nx = x + dirX[dir];
+				const int nz = z + dirZ[dir];
+
+				if (nx < 0 || nz < 0 || nx >= numBlocksX || nz >= numBlocksZ)
+					continue;
+				if (blocked[z * numBlocksX + x] || blocked[nz * numBlocksX + nx])
+					continue;
+
+				const float len = ((dir & 1) != 0)? 1.42f: 1.0f;
+				const float cost = 0.5f * (blockCosts[z * numBlocksX + x] + blockCosts[nz * numBlocksX + nx]) * len;
+
+				(*edgeCosts)[(z * numBlocksX + x) * 8 + dir] = cost;
+			}
+		}
+	}
+}
+
+
+/// A* over the blocks with a reusable state buffer, as the estimator does it
+class BlockSearch {
+public:
+	BlockSearch(): gCosts(numBlocks, PATHCOST_INFINITY), closed(numBlocks, false) {}
+
+	float FindPath(const std::vector<float>& edgeCosts, int startBlock, int goalBlock) {
+		for (size_t n = 0; n < dirtyBlocks.size(); ++n) {
+			gCosts[dirtyBlocks[n]] = PATHCOST_INFINITY;
+			closed[dirtyBlocks[n]] = false;
+		}
+		dirtyBlocks.clear();
+
+		typedef std::pair<float, int> Node;
+		std::priority_queue<Node, std::vector<Node>, std::greater<Node> > openBlocks;
+
+		gCosts[startBlock] = 0.0f;
+		dirtyBlocks.push_back(startBlock);
+		openBlocks.push(Node(Heuristic(startBlock, goalBlock), startBlock));
+
+		while (!openBlocks.empty()) {
+			const int block = openBlocks.top().second;
+			openBlocks.pop();
+
+			if (block == goalBlock)
+				return gCosts[block];
+			if (closed[block])
+				continue;
+
+			closed[block] = true;
+
+			const int bx = block % numBlocksX;
+			const int bz = block / numBlocksX;
+
+			for (int dir = 0; dir < 8; ++dir) {
+				const int nx = bx + dirX[dir];
+				const int nz = bz + dirZ[dir];
+
+				if (nx < 0 || nz < 0 || nx >= numBlocksX || nz >= numBlocksZ)
+					continue;
+
+				const int next = nz * numBlocksX + nx;
+				const float gCost = gCosts[block] + edgeCosts[block * 8 + dir];
+
+				if (gCost >= gCosts[next])
+					continue;
+
+				gCosts[next] = gCost;
+				dirtyBlocks.push_back(next);
+				openBlocks.push(Node(gCost + Heuristic(next, goalBlock), next));
+			}
+		}
+
+		return PATHCOST_INFINITY;
+	}
+
+private:
+	static float Heuristic(int block, int goalBlock) {
+		const float dx = float(std::abs(block % numBlocksX - goalBlock % numBlocksX));
+		const float dz = float(std::abs(block / numBlocksX - goalBlock / numBlocksX));
+
+		// the cheapest block costs 8 per step
+		return 8.0f * (std::max(dx, dz) + 0.42f * std::min(dx, dz));
+	}
+
+	std::vector<float> gCosts;
+	std::vector<bool> closed;
+	std::vector<int> dirtyBlocks;
+};
+
+
+static std::vector<int> MakeGroup(const std::vector<float>& edgeCosts, int numUnits)
+{
+	// spread over the other half of the map, on passable blocks
+	std::vector<int> startBlocks;
+	unsigned int seed = 12345;
+
+	while (int(startBlocks.size()) < numUnits) {
+		seed = seed * 1103515245 + 12345;
+		const int x = (seed >> 8) % (numBlocksX / 2);
+		seed = seed * 1103515245 + 12345;
+		const int z = (seed >> 8) % numBlocksZ;
+		const int block = z * numBlocksX + x;
+
+		bool passable = false;
+		for (int dir = 0; dir < 8; ++dir)
+			passable |= (edgeCosts[block * 8 + dir] < PATHCOST_INFINITY);
+
+		if (passable)
+			startBlocks.push_back(block);
+	}
+
+	return startBlocks;
+}
+
+static double Seconds(const boost::posix_time::ptime& start)
+{
+	return (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() * 1e-6;
+}
+
+static const int goalBlock = 100 * numBlocksX + 120;
+
+
+BOOST_AUTO_TEST_CASE(FlowFieldMatchesSearch)
+{
+	std::vector<float> edgeCosts;
+	MakeEdgeCosts(&edgeCosts);
+
+	CPathFlowField flowField(0, goalBlock, numBlocksX, numBlocksZ);
+	BOOST_CHECK(flowField.IsObsolete());
+	flowField.Calculate(edgeCosts);
+	BOOST_CHECK(!flowField.IsObsolete());
+
+	BlockSearch search;
+	const std::vector<int> startBlocks = MakeGroup(edgeCosts, 64);
+
+	for (size_t n = 0; n < startBlocks.size(); ++n) {
+		const float searchCost = search.FindPath(edgeCosts, startBlocks[n], goalBlock);
+		const float fieldCost = flowField.GetCost(startBlocks[n]);
+
+		BOOST_CHECK_EQUAL((searchCost < PATHCOST_INFINITY), (fieldCost < PATHCOST_INFINITY));
+
+		if (searchCost >= PATHCOST_INFINITY)
+			continue;
+
+		BOOST_CHECK_CLOSE(searchCost, fieldCost, 0.01f);
+
+		// following the field leads to the goal over passable edges, at the cost it claims
+		float walkedCost = 0.0f;
+		int block = startBlocks[n];
+		int steps = 0;
+
+		while (block != goalBlock && steps++ < numBlocks) {
+			const int next = flowField.GetNextBlock(block);
+			BOOST_REQUIRE(next >= 0);
+
+			const int dx = next % numBlocksX - block % numBlocksX;
+			const int dz = next / numBlocksX - block / numBlocksX;
+			int dir = 0;
+			while (dirX[dir] != dx || dirZ[dir] != dz) { ++dir; }
+
+			walkedCost += edgeCosts[block * 8 + dir];
+			block = next;
+		}
+
+		BOOST_CHECK_EQUAL(block, goalBlock);
+		BOOST_CHECK_CLOSE(walkedCost, fieldCost, 0.01f);
+	}
+
+	BOOST_CHECK_EQUAL(flowField.GetNextBlock(goalBlock), -1);
+}
+
+BOOST_AUTO_TEST_CASE(GroupBenchmark)
+{
+	std::vector<float> edgeCosts;
+	MakeEdgeCosts(&edgeCosts);
+
+	for (int numUnits = 8; numUnits <= 512; numUnits *= 4) {
+		const std::vector<int> startBlocks = MakeGroup(edgeCosts, numUnits);
+
+		BlockSearch search;
+		float searchCosts = 0.0f;
+
+		boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+		for (size_t n = 0; n < startBlocks.size(); ++n)
+			searchCosts += search.FindPath(edgeCosts, startBlocks[n], goalBlock);
+		const double searchTime = Seconds(start);
+
+		CPathFlowField flowField(0, goalBlock, numBlocksX, numBlocksZ);
+		float fieldCosts = 0.0f;
+
+		start = boost::posix_time::microsec_clock::universal_time();
+		flowField.Calculate(edgeCosts);
+		for (size_t n = 0; n < startBlocks.size(); ++n) {
+			fieldCosts += flowField.GetCost(startBlocks[n]);
+
+			// what a path reads per refill
+			for (int block = startBlocks[n], k = 0; k < 12 && block >= 0; ++k)
+				block = flowField.GetNextBlock(block);
+		}
+		const double fieldTime = Seconds(start);
+
+		BOOST_CHECK_CLOSE(searchCosts, fieldCosts, 0.01f);
+		BOOST_TEST_MESSAGE(numUnits << " units: " << searchTime << "s searching per unit, " << fieldTime << "s with a shared flow field");
+	}
+}
@@ -0,0 +1,429 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Game/Game.h"
+#include "Game/LoadScreen.h"
+#include "Lua/LuaParser.h"
+#include "Map/Ground.h"
+#include "Map/MapDataCache.h"
+#include "Map/MapInfo.h"
+#include "Map/MetalMap.h"
+#include "Map/ReadMap.h"
+#include "Sim/Features/Feature.h"
+#include "Sim/Misc/GlobalSynced.h"
+#include "Sim/MoveTypes/MoveInfo.h"
+#include "Sim/MoveTypes/MoveMath/MoveMath.h"
+#include "System/EventHandler.h"
+#include "System/TimeProfiler.h"
+#include "System/Config/ConfigVariable.h"
+#include "System/FileSystem/ArchiveScanner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#define BOOST_TEST_MODULE SpeedModGrid
+#include <boost/test/unit_test.hpp>
+
+/*
+ * The speed-modifier grids of the real CMoveInfo on a hilly map with water,
+ * kept up to date by CMoveInfo::TerrainChange after the real
+ * CReadMap::UpdateHeightMapSynced (as CBasicMapDamage::RecalcDirtyAreas does),
+ * have to match grids built from scratch. A* searches over the squares (as
+ * in CPathFinder, which looks each modifier up twice) report their nodes per
+ * second with modifiers computed on the fly by CMoveMath::CalcPosSpeedMod
+ * (as before the grids) and looked up by CMoveMath::GetPosSpeedMod.
+ */
+
+static const int mapSize = 512; // in heightmap squares
+
+
+// the parts of the map code not under test
+class CGameSetup;
+class CGlobalUnsynced;
+class CLosHandler;
+class CMapDamage;
+class CUnitHandler;
+class IPathManager;
+class ConfigHandler;
+
+CGlobalSynced* gs = NULL;
+CGlobalUnsynced* gu = NULL;
+const CMapInfo* mapInfo = NULL;
+CGame* game = NULL;
+CGround* ground = NULL;
+CUnitHandler* uh = NULL;
+IPathManager* pathManager = NULL;
+CLosHandler* loshandler = NULL;
+CMapDamage* mapDamage = NULL;
+CArchiveScanner* archiveScanner = NULL;
+const CGameSetup* gameSetup = NULL;
+ConfigHandler* configHandler = NULL;
+CLoadScreen* CLoadScreen::singleton = NULL;
+CEventHandler eventHandler;
+
+CR_BIND(CGlobalSynced, );
+
+CGlobalSynced::CGlobalSynced() {}
+CGlobalSynced::~CGlobalSynced() {}
+
+CEventHandler::CEventHandler() {}
+CEventHandler::~CEventHandler() {}
+
+// there are no features on the map
+creg::ClassBinder CFeature::binder("CFeature", creg::CF_Abstract, NULL, NULL, sizeof(CFeature), NULL, NULL);
+creg::Class* CFeature::GetClass() { return binder.class_; }
+CFeature::~CFeature() {}
+bool CFeature::AddBuildPower(float amount, CUnit* builder) { return false; }
+void CFeature::Kill(const float3& impulse) {}
+bool CFeature::Update() { return false; }
+void CFeature::DependentDied(CObject* o) {}
+
+float CGround::GetHeightAboveWater(float x, float y, bool synced) const { return 0.0f; }
+float CGround::GetHeightReal(float x, float y, bool synced) const { return 0.0f; }
+
+// only used by CReadMap::Initialize, which the test map does not call
+CMapDataCache::CMapDataCache(unsigned int mapArchiveChecksum, unsigned int heightMapChecksum, int mapx, int mapy, bool enabled):
+	heightMapChecksum(heightMapChecksum), mapx(mapx), mapy(mapy), enabled(false), dirty(false) {}
+CMapDataCache::~CMapDataCache() {}
+const boost::uint8_t* CMapDataCache::GetSection(const std::string& name, size_t* size) const { return NULL; }
+void CMapDataCache::AddSection(const std::string& name, const void* data, size_t size) {}
+unsigned int CArchiveScanner::GetSingleArchiveChecksum(const std::string& name) const { return 0; }
+void CLoadScreen::SetLoadMessage(const std::string& text, bool replace_lastline) {}
+void ConfigVariable::AddMetaData(const ConfigVariableMetaData* data) {}
+
+BasicTimer::BasicTimer(const char* const myname): name(myname), starttime(0) {}
+ScopedTimer::~ScopedTimer() {}
+ScopedOnceTimer::~ScopedOnceTimer() {}
+
+
+/// the MoveDefs table, one move def of each family
+static const char* moveDefNames[] = {"tank3", "kbot2", "hover3", "boat4"};
+static const int numMoveDefs = sizeof(moveDefNames) / sizeof(moveDefNames[0]);
+
+LuaTable::LuaTable(LuaParser* parser): isValid(true), parser(parser), L(NULL), refnum(0) {}
+LuaTable::LuaTable(const LuaTable& tbl): path(tbl.path), isValid(tbl.isValid), parser(tbl.parser), L(NULL), refnum(0) {}
+LuaTable::~LuaTable() {}
+LuaTable LuaParser::GetRoot() { return LuaTable(this); }
+
+LuaTable LuaTable::SubTable(const std::string& key) const { return *this; }
+LuaTable LuaTable::SubTable(int key) const {
+	LuaTable subTable(*this);
+	subTable.path = ((key <= numMoveDefs)? moveDefNames[key - 1]: "");
+	subTable.parser = ((key <= numMoveDefs)? parser: NULL);
+	return subTable;
+}
+
+std::string LuaTable::GetString(const std::string& key, const std::string& def) const { return ((key == "name")? path: def); }
+int LuaTable::GetInt(const std::string& key, int def) const { return def; }
+bool LuaTable::GetBool(const std::string& key, bool def) const { return def; }
+float LuaTable::GetFloat(const std::string& key, float def) const {
+	if (key == "maxWaterDepth") return 25.0f;
+	if (key == "maxSlope") return 30.0f;
+	return def;
+}
+
+
+class CTestReadMap : public CReadMap
+{
+public:
+	CTestReadMap() {
+		width = mapSize;
+		height = mapSize;
+
+		// CReadMap::Initialize without the loading screen and map-data cache
+		gs->mapx = width;
+		gs->mapxm1 = width - 1;
+		gs->mapxp1 = width + 1;
+		gs->mapy = height;
+		gs->mapym1 = height - 1;
+		gs->mapyp1 = height + 1;
+		gs->mapSquares = gs->mapx * gs->mapy;
+		gs->hmapx = gs->mapx >> 1;
+		gs->hmapy = gs->mapy >> 1;
+
+		cornerHeightMap.resize(gs->mapxp1 * gs->mapyp1);
+		originalHeightMap.resize(gs->mapxp1 * gs->mapyp1);
+		faceNormalsSynced.resize(gs->mapx * gs->mapy * 2);
+		centerNormalsSynced.resize(gs->mapx * gs->mapy);
+		centerHeightMap.resize(gs->mapx * gs->mapy);
+
+		mipCenterHeightMaps.resize(numHeightMipMaps - 1);
+		mipPointerHeightMaps.resize(numHeightMipMaps, NULL);
+		mipPointerHeightMaps[0] = &centerHeightMap[0];
+
+		for (int i = 1; i < numHeightMipMaps; i++) {
+			mipCenterHeightMaps[i - 1].resize((gs->mapx >> i) * (gs->mapy >> i));
+			mipPointerHeightMaps[i] = &mipCenterHeightMaps[i - 1][0];
+		}
+
+		slopeMap.resize(gs->hmapx * gs->hmapy);
+		typeMap.resize(gs->hmapx * gs->hmapy);
+
+		// hills and valleys below the water line
+		for (int z = 0; z <= gs->mapy; ++z) {
+			for (int x = 0; x <= gs->mapx; ++x) {
+				cornerHeightMap[z * gs->mapxp1 + x] = 60.0f * std::sin(x * 0.031f) * std::cos(z * 0.023f) + 25.0f * std::sin((x + z) * 0.11f);
+			}
+		}
+		for (int z = 0; z < gs->hmapy; ++z) {
+			for (int x = 0; x < gs->hmapx; ++x) {
+				typeMap[z * gs->hmapx + x] = ((x / 37) + (z / 53)) % 4;
+			}
+		}
+
+		UpdateHeightMapSynced(0, 0, gs->mapx, gs->mapy);
+	}
+
+	float* GetHeightMap() { return &cornerHeightMap[0]; }
+
+	const float* GetCornerHeightMapSynced() const { return &cornerHeightMap[0]; }
+	const float* GetCornerHeightMapUnsynced() const { return &cornerHeightMap[0]; }
+
+	void UpdateHeightMapUnsynced(const HeightMapUpdate&) {}
+	void NewGroundDrawer() {}
+	unsigned int GetShadingTexture() const { return 0; }
+	void DrawMinimap() const {}
+	int GetNumFeatures() { return 0; }
+	int GetNumFeatureTypes() { return 0; }
+	void GetFeatureInfo(MapFeatureInfo* f) {}
+	const char* GetFeatureTypeName(int typeID) { return ""; }
+	unsigned char* GetInfoMap(const std::string& name, MapBitmapInfo* bm) { return NULL; }
+	void FreeInfoMap(const std::string& name, unsigned char* data) {}
+	void GridVisibility(CCamera* cam, int quadSize, float maxdist, IQuadDrawer* cb, int extraSize) {}
+
+private:
+	std::vector<float> cornerHeightMap;
+};
+
+
+struct World {
+	World() {
+		gs = new CGlobalSynced();
+		readmap = new CTestReadMap();
+
+		// only the terrain types are read
+		CMapInfo* terrainInfo = static_cast<CMapInfo*>(::operator new(sizeof(CMapInfo)));
+
+		for (int n = 0; n < CMapInfo::NUM_TERRAIN_TYPES; ++n) {
+			CMapInfo::TerrainType& tt = terrainInfo->terrainTypes[n];
+
+			tt.hardness = 1.0f;
+			tt.tankSpeed = 1.0f - (n % 4) * 0.2f;
+			tt.kbotSpeed = 1.0f - (n % 3) * 0.2f;
+			tt.hoverSpeed = 1.0f;
+			tt.shipSpeed = 1.0f;
+		}
+
+		mapInfo = terrainInfo;
+
+		// only the move defs are read
+		game = static_cast<CGame*>(::operator new(sizeof(CGame)));
+		game->defsParser = static_cast<LuaParser*>(::operator new(sizeof(LuaParser)));
+
+		moveinfo = new CMoveInfo();
+	}
+
+	~World() {
+		delete moveinfo; moveinfo = NULL;
+
+		::operator delete(game->defsParser);
+		::operator delete(game); game = NULL;
+		::operator delete(const_cast<CMapInfo*>(mapInfo)); mapInfo = NULL;
+
+		delete readmap; readmap = NULL;
+		delete gs; gs = NULL;
+	}
+
+	CTestReadMap* GetReadMap() { return static_cast<CTestReadMap*>(readmap); }
+
+	/// the grids of all MoveData classes
+	std::vector<float> GetGrids() const {
+		std::vector<float> grids;
+
+		for (size_t n = 0; n < moveinfo->moveData.size(); ++n) {
+			const float* grid = moveinfo->GetSpeedModGrid(n);
+			grids.insert(grids.end(), grid, grid + gs->hmapx * gs->hmapy);
+		}
+
+		return grids;
+	}
+
+	/// raises or lowers the corners in [x1, x2] x [z1, z2] as CBasicMapDamage::Explosion does
+	void Deform(int x1, int z1, int x2, int z2, float dif) {
+		for (int z = z1; z <= z2; ++z) {
+			for (int x = x1; x <= x2; ++x) {
+				GetReadMap()->GetHeightMap()[z * gs->mapxp1 + x] += dif;
+			}
+		}
+
+		// CBasicMapDamage::RecalcArea and RecalcDirtyAreas
+		readmap->UpdateHeightMapSynced(x1, z1, x2 + 1, z2 + 1);
+		moveinfo->TerrainChange(x1, z1, x2, z2);
+	}
+
+	/// LuaSyncedCtrl::SetMapSquareTerrainType
+	void SetTerrainType(int hx, int hz, unsigned char type) {
+		readmap->GetTypeMapSynced()[(hz >> 1) * gs->hmapx + (hx >> 1)] = type;
+		moveinfo->TerrainChange(hx, hz,  hx + 1, hz + 1);
+	}
+};
+
+
+BOOST_AUTO_TEST_CASE(IncrementalUpdate)
+{
+	World world;
+
+	BOOST_CHECK_EQUAL(moveinfo->moveData.size(), numMoveDefs);
+
+	unsigned int seed = 1234;
+
+	// craters of all sizes, at odd and even squares and along the map edges
+	for (int n = 0; n < 200; ++n) {
+		seed = seed * 1103515245 + 12345; const int x1 = (seed >> 8) % gs->mapx;
+		seed = seed * 1103515245 + 12345; const int z1 = (seed >> 8) % gs->mapy;
+		seed = seed * 1103515245 + 12345; const int size = (seed >> 8) % 12;
+		seed = seed * 1103515245 + 12345; const float dif = ((seed >> 8) % 80) - 40.0f;
+
+		world.Deform(x1, z1, std::min(gs->mapx, x1 + size), std::min(gs->mapy, z1 + size), dif);
+	}
+
+	world.Deform(0, 0, 3, 3, -30.0f);
+	world.Deform(gs->mapx - 1, gs->mapy - 1, gs->mapx, gs->mapy, 30.0f);
+	world.Deform(gs->mapx, 100, gs->mapx, 100, 50.0f);
+
+	for (int n = 0; n < 50; ++n) {
+		seed = seed * 1103515245 + 12345; const int hx = (seed >> 8) % gs->mapx;
+		seed = seed * 1103515245 + 12345; const int hz = (seed >> 8) % gs->mapy;
+
+		world.SetTerrainType(hx, hz, n % 4);
+	}
+
+	const std::vector<float> updated = world.GetGrids();
+
+	readmap->UpdateHeightMapSynced(0, 0, gs->mapx, gs->mapy);
+	moveinfo->TerrainChange(0, 0, gs->mapxm1, gs->mapym1);
+
+	const std::vector<float> rebuilt = world.GetGrids();
+
+	BOOST_CHECK(updated == rebuilt);
+}
+
+
+/// source of the speed modifiers
+struct OnTheFly {
+	const MoveData* md;
+	float operator() (int x, int z) const { return md->moveMath->CalcPosSpeedMod(*md, x, z); }
+};
+struct Cached {
+	const MoveData* md;
+	float operator() (int x, int z) const { return md->moveMath->GetPosSpeedMod(*md, x, z); }
+};
+
+struct Node {
+	float fCost;
+	int square;
+	bool operator < (const Node& n) const { return (fCost > n.fCost); }
+};
+
+/// A* over the squares as in CPathFinder, which looks each modifier up twice (IsBlocked and TestSquare)
+template<typename SpeedMods>
+static float FindPath(const SpeedMods& speedMods, int sx, int sz, int gx, int gz, unsigned int* testedNodes)
+{
+	static const int dx[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+	static const int dz[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+	static const float moveCost[8] = {1.0f, 1.0f, 1.0f, 1.0f, 1.42f, 1.42f, 1.42f, 1.42f};
+
+	std::vector<float> gCosts(mapSize * mapSize, 1e30f);
+	std::vector<bool> closed(mapSize * mapSize, false);
+	std::priority_queue<Node> open;
+
+	const Node start = {0.0f, sx + sz * mapSize};
+	gCosts[start.square] = 0.0f;
+	open.push(start);
+
+	while (!open.empty()) {
+		const Node n = open.top(); open.pop();
+
+		if (closed[n.square])
+			continue;
+		if (n.square == gx + gz * mapSize)
+			return gCosts[n.square];
+
+		closed[n.square] = true;
+
+		const int x = n.square % mapSize;
+		const int z = n.square / mapSize;
+
+		for (int d = 0; d < 8; ++d) {
+			const int nx = x + dx[d];
+			const int nz = z + dz[d];
+
+			(*testedNodes)++;
+
+			// "IsBlocked"
+			if (speedMods(nx, nz) == 0.0f)
+				continue;
+			if (closed[nx + nz * mapSize])
+				continue;
+
+			const float gCost = gCosts[n.square] + moveCost[d] / speedMods(nx, nz);
+
+			if (gCost >= gCosts[nx + nz * mapSize])
+				continue;
+
+			const float hx = float(std::abs(gx - nx));
+			const float hz = float(std::abs(gz - nz));
+			const Node next = {gCost + std::max(hx, hz) + 0.42f * std::min(hx, hz), nx + nz * mapSize};
+
+			gCosts[next.square] = gCost;
+			open.push(next);
+		}
+	}
+
+	return -1.0f;
+}
+
+static double Seconds(const boost::posix_time::ptime& start)
+{
+	return (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() * 1e-6;
+}
+
+static const int numSearches = 12;
+static const int searches[numSearches][4] = {
+	{ 20,  20, 490, 470}, {490,  20,  20, 480}, {256,  10, 256, 500}, { 10, 256, 500, 256},
+	{100, 100, 400, 400}, {400, 100, 100, 400}, { 50, 300, 450, 120}, {300,  50, 120, 450},
+	{ 30,  30, 200, 220}, {480, 480, 260, 250}, {150, 450, 350,  60}, {460, 200,  40, 330},
+};
+
+
+BOOST_AUTO_TEST_CASE(PathFinderThroughput)
+{
+	World world;
+
+	// the tank, its paths are blocked by steep slopes and deep water
+	const OnTheFly onTheFly = {moveinfo->moveData[0]};
+	const Cached cached = {moveinfo->moveData[0]};
+
+	std::vector<float> costsOnTheFly, costsCached;
+	unsigned int nodesOnTheFly = 0, nodesCached = 0;
+
+	boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+	for (int n = 0; n < numSearches; ++n)
+		costsOnTheFly.push_back(FindPath(onTheFly, searches[n][0], searches[n][1], searches[n][2], searches[n][3], &nodesOnTheFly));
+	const double timeOnTheFly = Seconds(start);
+
+	start = boost::posix_time::microsec_clock::universal_time();
+	for (int n = 0; n < numSearches; ++n)
+		costsCached.push_back(FindPath(cached, searches[n][0], searches[n][1], searches[n][2], searches[n][3], &nodesCached));
+	const double timeCached = Seconds(start);
+
+	BOOST_CHECK(costsOnTheFly == costsCached);
+	BOOST_CHECK_EQUAL(nodesOnTheFly, nodesCached);
+
+	BOOST_TEST_MESSAGE(numSearches << " searches, " << nodesCached << " nodes tested");
+	BOOST_TEST_MESSAGE("  on the fly: " << timeOnTheFly << "s (" << (nodesOnTheFly / timeOnTheFly) << " nodes/s)");
+	BOOST_TEST_MESSAGE("  cached:     " << timeCached << "s (" << (nodesCached / timeCached) << " nodes/s)");
+}
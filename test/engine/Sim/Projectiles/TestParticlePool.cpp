@@ -0,0 +1,267 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Map/Ground.h"
+#include "Rendering/GlobalRendering.h"
+#include "Rendering/GroundFlash.h"
+#include "Rendering/ProjectileDrawer.h"
+#include "Rendering/GL/myGL.h"
+#include "Rendering/GL/VertexArray.h"
+#include "Rendering/Textures/TextureAtlas.h"
+#include "Sim/Misc/GlobalSynced.h"
+#include "Sim/Misc/QuadField.h"
+#include "Sim/Projectiles/ExplosionGenerator.h"
+#include "Sim/Projectiles/ParticlePool.h"
+#include "Sim/Projectiles/ProjectileHandler.h"
+#include "Sim/Projectiles/Unsynced/DirtProjectile.h"
+#include "Sim/Projectiles/Unsynced/FlyingPiece.h"
+#include "Sim/Projectiles/Unsynced/HeatCloudProjectile.h"
+#include "Sim/Units/UnitHandler.h"
+#include "System/EventBatchHandler.h"
+#include "System/EventHandler.h"
+#include "System/TimeProfiler.h"
+#include "System/myMath.h"
+#include "System/Config/ConfigHandler.h"
+
+#include <algorithm>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#define BOOST_TEST_MODULE ParticlePool
+#include <boost/test/unit_test.hpp>
+
+/*
+ * An artillery barrage of real CDirtProjectile and CHeatCloudProjectile
+ * particles on the flat map of NullSim.cpp, updated by the real
+ * CProjectileHandler: once allocated on the heap (so they are kept in
+ * unsyncedProjectiles, as all particles were before the pools) and once
+ * allocated from their CParticlePool.
+ */
+
+static const int numFrames = 300;
+static const int shellsPerFrame = 40;
+static const int particlesPerShell = 12; // of each type
+
+
+// the parts of the projectile code not under test
+CUnitHandler* uh = NULL;
+CGlobalRendering* globalRendering = NULL;
+CProjectileDrawer* projectileDrawer = NULL;
+
+CR_BIND(CUnitHandler, );
+CR_BIND(AtlasedTexture, );
+CR_BIND_DERIVED_INTERFACE(CExpGenSpawnable, CWorldObject);
+CR_REG_METADATA(CExpGenSpawnable, );
+creg::ClassBinder CGroundFlash::binder("CGroundFlash", creg::CF_Abstract, NULL, NULL, sizeof(CGroundFlash), NULL, NULL);
+
+CUnitHandler::CUnitHandler(): maxUnitRadius(0.0f), morphUnitToFeature(true), maxUnits(1) {}
+CUnitHandler::~CUnitHandler() {}
+
+CExpGenSpawnable::CExpGenSpawnable(): CWorldObject() {}
+CExpGenSpawnable::CExpGenSpawnable(const float3& pos): CWorldObject(pos) {}
+
+void CEventHandler::UpdateProjectiles() {}
+void CEventHandler::DeleteSyncedProjectiles() {}
+
+EventBatchHandler* EventBatchHandler::GetInstance() { return NULL; }
+void EventBatchHandler::ProjectileCreatedDestroyedEvent::Add(const CProjectile*) {}
+void EventBatchHandler::ProjectileCreatedDestroyedEvent::Remove(const CProjectile*) {}
+void EventBatchHandler::UnsyncedProjectileCreatedDestroyedEvent::Add(const CProjectile*) {}
+void EventBatchHandler::UnsyncedProjectileCreatedDestroyedEvent::Remove(const CProjectile*) {}
+
+void FlyingPiece::Init(int _team, const float3& _pos, const float3& _speed) {}
+FlyingPiece::~FlyingPiece() {}
+
+BasicTimer::BasicTimer(const char* const myname): name(myname), starttime(0) {}
+ScopedTimer::~ScopedTimer() {}
+
+// nothing is drawn
+CVertexArray* GetVertexArray() { return NULL; }
+void CVertexArray::Initialize() {}
+void CVertexArray::DrawArrayTC(const int drawType, unsigned int stride) {}
+void CVertexArray::EnlargeDrawArray() {}
+
+
+/// every config value is 0
+class CNullConfigHandler : public ConfigHandler
+{
+public:
+	void SetString(const std::string&, const std::string&, bool) {}
+	std::string GetString(const std::string&) const { return "0"; }
+	bool IsSet(const std::string&) const { return false; }
+	void Delete(const std::string&) {}
+	std::string GetConfigFile() const { return ""; }
+	const std::map<std::string, std::string> GetData() const { return std::map<std::string, std::string>(); }
+	void Update() {}
+
+protected:
+	void AddObserver(ConfigNotifyCallback) {}
+};
+
+
+struct World {
+	World() {
+		gs = new CGlobalSynced();
+		ground = new CGround();
+		qf = new CQuadField();
+		configHandler = new CNullConfigHandler();
+		uh = new CUnitHandler();
+		ph = new CProjectileHandler();
+
+		float3::maxxpos = gs->mapx * SQUARE_SIZE - 1;
+		float3::maxzpos = gs->mapy * SQUARE_SIZE - 1;
+
+		// the particles only take their texture pointers from it
+		projectileDrawer = static_cast<CProjectileDrawer*>(::operator new(sizeof(CProjectileDrawer)));
+		projectileDrawer->randdotstex = NULL;
+		projectileDrawer->heatcloudtex = NULL;
+	}
+
+	~World() {
+		delete ph; // deletes the particles
+
+		::operator delete(projectileDrawer); projectileDrawer = NULL;
+		delete uh; uh = NULL;
+		delete configHandler; configHandler = NULL;
+		delete qf; qf = NULL;
+		delete ground; ground = NULL;
+		delete gs; gs = NULL;
+	}
+};
+
+
+/// memory for a particle on the heap instead of in its pool
+template<typename T> static void* HeapAlloc() { return ::operator new(sizeof(T)); }
+
+/// the live particles, wherever they are kept
+static std::vector<CProjectile*> GetParticles()
+{
+	std::vector<CProjectile*> particles(ph->unsyncedProjectiles.begin(), ph->unsyncedProjectiles.end());
+	CParticlePools::GetInstance().GetParticles(&particles);
+	return particles;
+}
+
+/// sum over the state of all particles, the same for both storages
+static double StateSum()
+{
+	const std::vector<CProjectile*> particles = GetParticles();
+	std::vector<float> states;
+
+	for (size_t n = 0; n < particles.size(); ++n) {
+		states.push_back(particles[n]->pos.x + particles[n]->pos.y * 3.0f + particles[n]->pos.z * 7.0f);
+	}
+
+	// in the same order for both
+	std::sort(states.begin(), states.end());
+
+	double sum = 0.0;
+
+	for (size_t n = 0; n < states.size(); ++n) {
+		sum += states[n];
+	}
+
+	return sum;
+}
+
+/// runs the barrage, @return the state sum after each frame
+static std::vector<double> Barrage(bool pooled, double* seconds)
+{
+	World world;
+	std::vector<double> sums;
+	boost::posix_time::time_duration time;
+
+	unsigned int seed = 1234;
+
+	for (int f = 0; f < numFrames; ++f) {
+		const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+		for (int s = 0; s < shellsPerFrame; ++s) {
+			seed = seed * 1103515245 + 12345; const float x = 100.0f + ((seed >> 8) % 3800);
+			seed = seed * 1103515245 + 12345; const float z = 100.0f + ((seed >> 8) % 3800);
+
+			const float3 impactPos(x, 0.0f, z);
+
+			// as CStdExplosionGenerator does
+			for (int n = 0; n < particlesPerShell; ++n) {
+				seed = seed * 1103515245 + 12345; const float a = ((seed >> 8) % 6283) * 0.001f;
+				seed = seed * 1103515245 + 12345; const float v = 1.0f + ((seed >> 8) % 100) * 0.04f;
+
+				const float3 speed(math::cos(a) * v, v * 1.5f, math::sin(a) * v);
+				const float3 color(0.15f, 0.1f, 0.05f);
+
+				if (pooled) {
+					new CDirtProjectile(impactPos, speed, 70.0f + n, 5.0f, 0.1f, 0.99f, NULL, color);
+					new CHeatCloudProjectile(impactPos, speed * 0.2f, 8.0f + n, 12.0f, NULL);
+				} else {
+					new (HeapAlloc<CDirtProjectile>()) CDirtProjectile(impactPos, speed, 70.0f + n, 5.0f, 0.1f, 0.99f, NULL, color);
+					new (HeapAlloc<CHeatCloudProjectile>()) CHeatCloudProjectile(impactPos, speed * 0.2f, 8.0f + n, 12.0f, NULL);
+				}
+			}
+		}
+
+		ph->Update();
+
+		time += (boost::posix_time::microsec_clock::universal_time() - start);
+
+		sums.push_back(StateSum());
+	}
+
+	*seconds = time.total_microseconds() * 1e-6;
+
+	return sums;
+}
+
+
+BOOST_AUTO_TEST_CASE(AllocFree)
+{
+	World world;
+
+	CProjectile* a = new CDirtProjectile(ZeroVector, UpVector, 10.0f, 1.0f, 0.0f, 1.0f, NULL, ZeroVector);
+	CProjectile* b = new CDirtProjectile(ZeroVector, UpVector, 10.0f, 1.0f, 0.0f, 1.0f, NULL, ZeroVector);
+	CProjectile* c = new (HeapAlloc<CDirtProjectile>()) CDirtProjectile(ZeroVector, UpVector, 10.0f, 1.0f, 0.0f, 1.0f, NULL, ZeroVector);
+
+#if PARTICLE_POOLS_ENABLED
+	BOOST_CHECK(CParticlePools::GetInstance().FindPool(a) == &CDirtProjectile::particlePool);
+	BOOST_CHECK(CParticlePools::GetInstance().FindPool(b) == &CDirtProjectile::particlePool);
+	BOOST_CHECK_EQUAL(CParticlePools::GetInstance().GetNumParticles(), 2);
+#endif
+	BOOST_CHECK(CParticlePools::GetInstance().FindPool(c) == NULL);
+
+	// the particles CProjectileHandler::Serialize saves
+	BOOST_CHECK_EQUAL(GetParticles().size(), 3);
+
+	// the next update deletes the flagged particles
+	a->deleteMe = true;
+	b->deleteMe = true;
+	c->deleteMe = true;
+	ph->Update();
+
+	BOOST_CHECK(GetParticles().empty());
+	BOOST_CHECK_EQUAL(CParticlePools::GetInstance().GetNumParticles(), 0);
+
+#if PARTICLE_POOLS_ENABLED
+	// freed slots get reused
+	CProjectile* d = new CDirtProjectile(ZeroVector, UpVector, 10.0f, 1.0f, 0.0f, 1.0f, NULL, ZeroVector);
+	BOOST_CHECK(d == a || d == b);
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(ArtilleryBarrageBenchmark)
+{
+	CMyMath::Init();
+
+	double heapTime = 0.0;
+	double pooledTime = 0.0;
+
+	const std::vector<double> heapSums = Barrage(false, &heapTime);
+	const std::vector<double> pooledSums = Barrage(true, &pooledTime);
+
+	BOOST_TEST_MESSAGE(numFrames << " frames of " << (shellsPerFrame * particlesPerShell * 2) << " new particles each: "
+		<< heapTime << "s on the heap, " << pooledTime << "s in pools");
+
+	// the same particles in the same states
+	BOOST_CHECK(heapSums == pooledSums);
+	BOOST_CHECK_EQUAL(CParticlePools::GetInstance().GetNumParticles(), 0);
+}
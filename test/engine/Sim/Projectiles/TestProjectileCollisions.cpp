@@ -0,0 +1,287 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Map/Ground.h"
+#include "Rendering/GroundFlash.h"
+#include "Rendering/GL/myGL.h"
+#include "Rendering/GL/VertexArray.h"
+#include "Sim/Misc/CollisionHandler.h"
+#include "Sim/Misc/CollisionVolume.h"
+#include "Sim/Misc/GlobalSynced.h"
+#include "Sim/Misc/GroundBlockingObjectMap.h"
+#include "Sim/Misc/QuadField.h"
+#include "Sim/Projectiles/ExplosionGenerator.h"
+#include "Sim/Projectiles/Projectile.h"
+#include "Sim/Projectiles/ProjectileHandler.h"
+#include "Sim/Projectiles/Unsynced/FlyingPiece.h"
+#include "Sim/Units/Unit.h"
+#include "Sim/Units/UnitDef.h"
+#include "Sim/Units/UnitHandler.h"
+#include "System/EventBatchHandler.h"
+#include "System/EventHandler.h"
+#include "System/TimeProfiler.h"
+#include "System/myMath.h"
+#include "System/Config/ConfigHandler.h"
+
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#define BOOST_TEST_MODULE ProjectileCollisions
+#include <boost/test/unit_test.hpp>
+
+/*
+ * A volley of synced projectiles flies through a field of units on the flat
+ * map of NullSim.cpp; CProjectileHandler checks their collisions each frame,
+ * once with the serial loop over the container (as before the parallel
+ * collision phase) and once with CheckUnitFeatureCollisions(container).
+ */
+
+static const int unitRows = 60;
+static const int unitCols = 60;
+static const int numProjectiles = 20000;
+static const int numFrames = 10;
+
+static const float unitSpacing = 48.0f;
+static const float unitRadius = 8.0f;
+static const float projectileSpeed = 8.0f;
+
+
+// the parts of the projectile code not under test
+CUnitHandler* uh = NULL;
+
+CR_BIND(CUnitHandler, );
+CR_BIND_DERIVED_INTERFACE(CExpGenSpawnable, CWorldObject);
+CR_REG_METADATA(CExpGenSpawnable, );
+creg::ClassBinder CGroundFlash::binder("CGroundFlash", creg::CF_Abstract, NULL, NULL, sizeof(CGroundFlash), NULL, NULL);
+
+// the units are not registered, so the projectiles have no owner
+CUnitHandler::CUnitHandler(): maxUnitRadius(0.0f), morphUnitToFeature(true), maxUnits(unitRows * unitCols) {
+	units.AddSlots(maxUnits);
+}
+CUnitHandler::~CUnitHandler() {}
+
+CExpGenSpawnable::CExpGenSpawnable(): CWorldObject() {}
+CExpGenSpawnable::CExpGenSpawnable(const float3& pos): CWorldObject(pos) {}
+
+void CEventHandler::UpdateProjectiles() {}
+void CEventHandler::DeleteSyncedProjectiles() {}
+
+EventBatchHandler* EventBatchHandler::GetInstance() { return NULL; }
+void EventBatchHandler::ProjectileCreatedDestroyedEvent::Add(const CProjectile*) {}
+void EventBatchHandler::ProjectileCreatedDestroyedEvent::Remove(const CProjectile*) {}
+void EventBatchHandler::UnsyncedProjectileCreatedDestroyedEvent::Add(const CProjectile*) {}
+void EventBatchHandler::UnsyncedProjectileCreatedDestroyedEvent::Remove(const CProjectile*) {}
+
+void FlyingPiece::Init(int _team, const float3& _pos, const float3& _speed) {}
+FlyingPiece::~FlyingPiece() {}
+
+BasicTimer::BasicTimer(const char* const myname): name(myname), starttime(0) {}
+ScopedTimer::~ScopedTimer() {}
+
+CVertexArray* GetVertexArray() { return NULL; }
+void CVertexArray::Initialize() {}
+void CVertexArray::DrawArrayTC(const int drawType, unsigned int stride) {}
+
+
+/// every config value is 0
+class CNullConfigHandler : public ConfigHandler
+{
+public:
+	void SetString(const std::string&, const std::string&, bool) {}
+	std::string GetString(const std::string&) const { return "0"; }
+	bool IsSet(const std::string&) const { return false; }
+	void Delete(const std::string&) {}
+	std::string GetConfigFile() const { return ""; }
+	const std::map<std::string, std::string> GetData() const { return std::map<std::string, std::string>(); }
+	void Update() {}
+
+protected:
+	void AddObserver(ConfigNotifyCallback) {}
+};
+
+
+/// (projectile, unit) in the order the collisions were applied
+typedef std::vector< std::pair<int, int> > HitList;
+
+class CTestProjectile : public CProjectile
+{
+public:
+	CTestProjectile(const float3& pos, const float3& speed, int index, HitList* hits):
+		CProjectile(pos, speed, NULL, true, true, false),
+		index(index),
+		hits(hits)
+	{}
+
+	void Collision(CUnit* unit) {
+		hits->push_back(std::make_pair(index, unit->id));
+
+		if ((hits->size() % 64) == 0) {
+			// moved by the hit (or by Lua in UnitDamaged), which makes
+			// the parallel phase check the following ones serially
+			unit->pos.x += 4.0f;
+			unit->UpdateMidPos();
+			qf->MovedUnit(unit);
+		}
+
+		CProjectile::Collision(unit);
+	}
+
+private:
+	int index;
+	HitList* hits;
+};
+
+
+struct World {
+	World() {
+		gs = new CGlobalSynced();
+		ground = new CGround();
+		qf = new CQuadField();
+		groundBlockingObjectMap = new CGroundBlockingObjectMap(gs->mapSquares);
+		configHandler = new CNullConfigHandler();
+		uh = new CUnitHandler();
+		ph = new CProjectileHandler();
+
+		float3::maxxpos = gs->mapx * SQUARE_SIZE - 1;
+		float3::maxzpos = gs->mapy * SQUARE_SIZE - 1;
+
+		unitDef = new UnitDef();
+		unitDef->usePieceCollisionVolumes = false;
+
+		for (int r = 0; r < unitRows; ++r) {
+			for (int c = 0; c < unitCols; ++c) {
+				AddUnit(float3(400.0f + c * unitSpacing, 0.0f, 400.0f + r * unitSpacing));
+			}
+		}
+
+		unsigned int seed = 1234;
+
+		for (int i = 0; i < numProjectiles; ++i) {
+			seed = seed * 1103515245 + 12345; const float x = 300.0f + ((seed >> 8) % 3000);
+			seed = seed * 1103515245 + 12345; const float z = 300.0f + ((seed >> 8) % 3000);
+			seed = seed * 1103515245 + 12345; const float a = ((seed >> 8) % 6283) * 0.001f;
+
+			const float3 speed(math::cos(a) * projectileSpeed, 0.0f, math::sin(a) * projectileSpeed);
+
+			ph->syncedProjectiles.push(new CTestProjectile(float3(x, 4.0f, z), speed, i, &hits));
+		}
+	}
+
+	~World() {
+		delete ph; // deletes the projectiles
+
+		for (std::list<CUnit*>::iterator it = units.begin(); it != units.end(); ++it) {
+			qf->RemoveUnit(*it);
+			delete *it;
+		}
+
+		delete unitDef;
+
+		delete uh; uh = NULL;
+		delete configHandler; configHandler = NULL;
+		delete groundBlockingObjectMap; groundBlockingObjectMap = NULL;
+		delete qf; qf = NULL;
+		delete ground; ground = NULL;
+		delete gs; gs = NULL;
+	}
+
+	void AddUnit(const float3& pos) {
+		const CollisionVolume defaultVolume;
+
+		CUnit* unit = new CUnit();
+
+		unit->id = units.size();
+		unit->unitDef = unitDef;
+		unit->team = 0;
+		unit->allyteam = 0;
+		unit->radius = unitRadius;
+		unit->height = unitRadius * 2.0f;
+		unit->blocking = true;
+		unit->pos = pos;
+		unit->SetDirectionFromHeading();
+		// as CUnit::PostInit does for units without explicit volumes
+		unit->collisionVolume = new CollisionVolume(&defaultVolume, unitRadius);
+
+		qf->MovedUnit(unit);
+		units.push_back(unit);
+	}
+
+	void CheckCollisions(bool parallel) {
+		ProjectileContainer& pc = ph->syncedProjectiles;
+
+		if (parallel) {
+			ph->CheckUnitFeatureCollisions(pc);
+			return;
+		}
+
+		for (ProjectileContainer::iterator pci = pc.begin(); pci != pc.end(); ++pci) {
+			CProjectile* p = *pci;
+
+			if (p->checkCol && !p->deleteMe) {
+				ph->CheckUnitFeatureCollisions(p);
+			}
+		}
+	}
+
+	void MoveProjectiles() {
+		ProjectileContainer& pc = ph->syncedProjectiles;
+
+		for (ProjectileContainer::iterator pci = pc.begin(); pci != pc.end(); ++pci) {
+			if (!(*pci)->deleteMe) {
+				(*pci)->Update();
+			}
+		}
+	}
+
+	std::list<CUnit*> units;
+	HitList hits;
+
+	UnitDef* unitDef;
+};
+
+
+/// runs all frames, returns the hits in the order they were applied
+static HitList Run(bool parallel, double* seconds)
+{
+	World world;
+	boost::posix_time::time_duration time;
+
+	for (int f = 0; f < numFrames; ++f) {
+		gs->frameNum += 1;
+
+		const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+		world.CheckCollisions(parallel);
+
+		time += (boost::posix_time::microsec_clock::universal_time() - start);
+
+		world.MoveProjectiles();
+	}
+
+	*seconds = time.total_microseconds() * 1e-6;
+
+	return world.hits;
+}
+
+BOOST_AUTO_TEST_CASE(ProjectileVolleyBenchmark)
+{
+	CMyMath::Init();
+
+	double serialTime = 0.0;
+	double parallelTime = 0.0;
+
+	const HitList serialHits = Run(false, &serialTime);
+	const HitList parallelHits = Run(true, &parallelTime);
+
+	BOOST_TEST_MESSAGE(numProjectiles << " projectiles, " << (unitRows * unitCols) << " units, "
+		<< numFrames << " frames, " << serialHits.size() << " hits: "
+		<< serialTime << "s serial, "
+		<< parallelTime << "s in the compute and apply phases");
+
+	// the same collisions, applied in the same order
+	BOOST_CHECK(!serialHits.empty());
+	BOOST_CHECK(parallelHits == serialHits);
+}
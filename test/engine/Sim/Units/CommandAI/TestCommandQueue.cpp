@@ -0,0 +1,134 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Sim/Units/CommandAI/CommandQueue.h"
+
+#include <ctime>
+#include <deque>
+#include <vector>
+
+#define BOOST_TEST_MODULE CommandQueue
+#include <boost/test/unit_test.hpp>
+
+static const int numUnits = 500;
+static const int numOrders = 50;
+static const int numRounds = 20;
+
+
+/// how a command looked before its parameters were stored inline
+struct HeapCommand {
+	HeapCommand(int id): id(id), options(0), tag(0), timeOut(0) {}
+
+	int id;
+	unsigned char options;
+	std::vector<float> params;
+	unsigned int tag;
+	int timeOut;
+};
+
+static double GetSeconds(clock_t start)
+{
+	return double(clock() - start) / CLOCKS_PER_SEC;
+}
+
+template<typename CommandType>
+static CommandType CreateOrder(int i)
+{
+	// mostly map positions, sometimes areas
+	CommandType c(CMD_MOVE);
+	c.options = SHIFT_KEY;
+	c.params.push_back(i * 8.0f);
+	c.params.push_back(100.0f);
+	c.params.push_back(i * 16.0f);
+
+	if ((i % 4) == 0)
+		c.params.push_back(250.0f);
+
+	return c;
+}
+
+/**
+ * Issues numOrders shift-queued orders to a selection of numUnits units
+ * (every unit gets its own copy), then lets every unit work through its
+ * queue; like CSelectedUnits::GiveCommand and CCommandAI::SlowUpdate do.
+ */
+template<typename CommandType, typename QueueType>
+static double IssueAndDispatch(float* checksum)
+{
+	std::vector<QueueType> queues(numUnits);
+
+	const clock_t start = clock();
+
+	for (int r = 0; r < numRounds; ++r) {
+		for (int o = 0; o < numOrders; ++o) {
+			const CommandType c = CreateOrder<CommandType>(o);
+
+			for (int u = 0; u < numUnits; ++u) {
+				queues[u].push_back(c);
+				queues[u].back().tag = o;
+			}
+		}
+
+		for (int u = 0; u < numUnits; ++u) {
+			while (!queues[u].empty()) {
+				*checksum += queues[u].front().params[0];
+				queues[u].pop_front();
+			}
+		}
+	}
+
+	return GetSeconds(start);
+}
+
+
+BOOST_AUTO_TEST_CASE(InlineParams)
+{
+	Command c(CMD_MOVE);
+
+	for (int i = 0; i < int(CommandParams::INLINE_PARAMS); ++i) {
+		c.params.push_back(i);
+	}
+
+	Command copy = c;
+	BOOST_CHECK(copy.params == c.params);
+	BOOST_CHECK(copy.params.begin() != c.params.begin());
+	BOOST_CHECK_EQUAL(copy.params.size(), CommandParams::INLINE_PARAMS);
+
+	// spills over to the heap
+	for (int i = CommandParams::INLINE_PARAMS; i < 100; ++i) {
+		c.params.push_back(i);
+	}
+	BOOST_CHECK_EQUAL(c.params.size(), 100U);
+
+	copy = c;
+	for (int i = 0; i < 100; ++i) {
+		BOOST_CHECK_EQUAL(copy.params[i], float(i));
+	}
+
+	copy.params.erase(copy.params.begin() + 1, copy.params.end() - 1);
+	copy.params.insert(copy.params.begin() + 1, 42.0f);
+	BOOST_CHECK_EQUAL(copy.params.size(), 3U);
+	BOOST_CHECK_EQUAL(copy.params[0], 0.0f);
+	BOOST_CHECK_EQUAL(copy.params[1], 42.0f);
+	BOOST_CHECK_EQUAL(copy.params[2], 99.0f);
+
+	// out of range reads are not fatal
+	BOOST_CHECK_EQUAL(copy.params[3], 0.0f);
+
+	copy.params.clear();
+	BOOST_CHECK(copy.params.empty());
+}
+
+BOOST_AUTO_TEST_CASE(IssueAndDispatchThroughput)
+{
+	float heapChecksum = 0.0f;
+	float inlineChecksum = 0.0f;
+
+	const double heapTime = IssueAndDispatch< HeapCommand, std::deque<HeapCommand> >(&heapChecksum);
+	const double inlineTime = IssueAndDispatch< Command, CCommandQueue::basis >(&inlineChecksum);
+
+	BOOST_CHECK_EQUAL(heapChecksum, inlineChecksum);
+
+	BOOST_TEST_MESSAGE(numRounds << "x " << numOrders << " orders to " << numUnits << " units:"
+			<< " heap params " << heapTime << "s,"
+			<< " inline params and pooled queues " << inlineTime << "s");
+}
@@ -0,0 +1,198 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Sim/Units/CommandAI/TargetReservations.h"
+
+#include <ctime>
+#include <set>
+#include <vector>
+
+#define BOOST_TEST_MODULE TargetReservations
+#include <boost/test/unit_test.hpp>
+
+static const int numBuilders = 200;
+static const int fieldSize = 60; // wrecks per row/column
+static const int numWrecks = fieldSize * fieldSize;
+
+
+BOOST_AUTO_TEST_CASE(AddRemove)
+{
+	CTargetReservations res;
+
+	BOOST_CHECK(res.GetWorkers(5) == NULL);
+
+	res.Add(1, 5);
+	res.Add(2, 5);
+	res.Add(3, 7);
+	BOOST_REQUIRE(res.GetWorkers(5) != NULL);
+	BOOST_CHECK_EQUAL(res.GetWorkers(5)->size(), 2);
+	BOOST_CHECK_EQUAL(res.GetNumWorkers(), 3);
+
+	// moves the worker over
+	res.Add(2, 7);
+	BOOST_CHECK_EQUAL(res.GetWorkers(5)->size(), 1);
+	BOOST_CHECK_EQUAL(res.GetWorkers(7)->size(), 2);
+	BOOST_CHECK_EQUAL(res.GetNumWorkers(), 3);
+
+	res.Remove(1);
+	res.Remove(1);
+	BOOST_CHECK(res.GetWorkers(5) == NULL);
+
+	res.Clear();
+	BOOST_CHECK(res.GetWorkers(7) == NULL);
+	BOOST_CHECK_EQUAL(res.GetNumWorkers(), 0);
+}
+
+
+/// workers with their current target (-1 if none) and ally team
+class CTestWorkers : public CTargetReservations::IWorkerState
+{
+public:
+	CTestWorkers(int numWorkers): targets(numWorkers, -1), allyTeams(numWorkers, 0), allyTeam(0) {}
+
+	int GetTarget(int workerID) const { return targets[workerID]; }
+	bool Counts(int workerID) const { return (allyTeams[workerID] == allyTeam); }
+
+	std::vector<int> targets;
+	std::vector<int> allyTeams;
+	int allyTeam;
+};
+
+BOOST_AUTO_TEST_CASE(IsReserved)
+{
+	CTargetReservations res;
+	CTestWorkers workers(4);
+
+	workers.targets[0] = 5; res.Add(0, 5);
+	workers.targets[1] = 5; res.Add(1, 5);
+	workers.targets[2] = 7; res.Add(2, 7);
+	workers.allyTeams[2] = 1;
+
+	BOOST_CHECK(res.IsReserved(5, workers));
+	BOOST_CHECK(!res.IsReserved(6, workers));
+
+	// reserved, but not by an ally
+	BOOST_CHECK(!res.IsReserved(7, workers));
+	BOOST_CHECK_EQUAL(res.GetNumWorkers(), 3);
+
+	// finished, and switched to another target before its next update
+	workers.targets[0] = -1;
+	workers.targets[1] = 9;
+	BOOST_CHECK(!res.IsReserved(5, workers));
+	BOOST_CHECK(res.GetWorkers(5) == NULL);
+	BOOST_CHECK_EQUAL(res.GetNumWorkers(), 2);
+	BOOST_CHECK(res.IsReserved(9, workers));
+}
+
+
+/**
+ * The old way (as in CBuilderCAI before the index): every builder that
+ * reclaims anything is in one set, checking a target means looking at the
+ * current target of all of them.
+ */
+struct LinearReservations {
+	void Add(int builder, int target) { builders.insert(builder); }
+
+	bool IsReserved(int target, const CTestWorkers& workers) {
+		bool retval = false;
+		std::vector<int> rm;
+
+		for (std::set<int>::const_iterator it = builders.begin(); it != builders.end(); ++it) {
+			if (workers.GetTarget(*it) < 0) {
+				rm.push_back(*it);
+				continue;
+			}
+			if (workers.GetTarget(*it) == target && workers.Counts(*it)) {
+				retval = true;
+				break;
+			}
+		}
+		for (std::vector<int>::const_iterator it = rm.begin(); it != rm.end(); ++it)
+			builders.erase(*it);
+		return retval;
+	}
+
+	std::set<int> builders;
+};
+
+/**
+ * 200 builders area-reclaim a field of wrecks, the way CBuilderCAI does:
+ * a builder without target looks at all wrecks in the area (nearest first),
+ * skips those reserved by another one and takes the first free one.
+ * Every wreck takes a few frames to reclaim; a builder that finishes one
+ * is not removed, its stale reservation is dropped by the next check.
+ * @return the order in which the wrecks were reclaimed
+ */
+template<typename Reservations>
+static std::vector<int> ReclaimField(double* seconds)
+{
+	Reservations res;
+	CTestWorkers builders(numBuilders);
+	std::vector<bool> reclaimed(numWrecks, false);
+	std::vector<int> progress(numBuilders, 0);
+	std::vector<int> order;
+
+	// builders stand along one side of the field, so they all see the same wrecks first
+	std::vector< std::vector<int> > wrecksByDist(numBuilders);
+	for (int b = 0; b < numBuilders; ++b) {
+		const int bx = (b * fieldSize) / numBuilders;
+
+		for (int row = 0; row < fieldSize; ++row) {
+			for (int d = 0; d < fieldSize; ++d) {
+				const int x = bx + (((d & 1) == 0)? (d / 2): -(d / 2 + 1));
+				if (x >= 0 && x < fieldSize)
+					wrecksByDist[b].push_back(row * fieldSize + x);
+			}
+		}
+	}
+
+	const clock_t start = clock();
+
+	while (int(order.size()) < numWrecks) {
+		for (int b = 0; b < numBuilders; ++b) {
+			int& target = builders.targets[b];
+
+			if (target >= 0) {
+				if (++progress[b] < 5)
+					continue;
+
+				// FinishCommand
+				reclaimed[target] = true;
+				order.push_back(target);
+				target = -1;
+			}
+
+			const std::vector<int>& candidates = wrecksByDist[b];
+
+			for (size_t c = 0; c < candidates.size(); ++c) {
+				const int w = candidates[c];
+
+				if (reclaimed[w] || res.IsReserved(w, builders))
+					continue;
+
+				// ExecuteReclaim
+				target = w;
+				res.Add(b, w);
+				progress[b] = 0;
+				break;
+			}
+		}
+	}
+
+	*seconds = double(clock() - start) / CLOCKS_PER_SEC;
+	return order;
+}
+
+BOOST_AUTO_TEST_CASE(AreaReclaimBenchmark)
+{
+	double linearTime = 0.0;
+	double indexedTime = 0.0;
+
+	const std::vector<int> linearOrder = ReclaimField<LinearReservations>(&linearTime);
+	const std::vector<int> indexedOrder = ReclaimField<CTargetReservations>(&indexedTime);
+
+	BOOST_TEST_MESSAGE(numBuilders << " builders reclaiming " << numWrecks << " wrecks: "
+		<< linearTime << "s scanning all reclaimers, " << indexedTime << "s with the reservation index");
+
+	// same decisions
+	BOOST_CHECK(linearOrder == indexedOrder);
+}
@@ -0,0 +1,332 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Rendering/Models/3DModel.h"
+#include "Sim/Units/Scripts/UnitScript.h"
+#include "Sim/Units/Scripts/UnitScriptEngine.h"
+#include "System/TimeProfiler.h"
+#include "System/myMath.h"
+
+#include <cstring>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#define BOOST_TEST_MODULE UnitScriptEngine
+#include <boost/test/unit_test.hpp>
+
+/*
+ * A large army idles with its animations running: every unit spins a radar
+ * dish, turns a turret and moves a barrel, as COB and Lua scripts do through
+ * CUnitScript::Spin/Turn/Move. GUnitScriptEngine.Tick advances them all and
+ * is compared with the bare arithmetic of the same animations over
+ * contiguous arrays, as an SoA or SIMD layout would run it.
+ */
+
+static const int numUnits = 5000;
+static const int numFrames = 300;
+static const int deltaTime = 1000 / 30; // as in CGame::SimFrame
+
+
+// the parts of CUnitScript not under test
+CUnitScript::CUnitScript(CUnit* unit, const std::vector<LocalModelPiece*>& pieces)
+	: unit(unit)
+	, yardOpen(false)
+	, busy(false)
+	, hasSetSFXOccupy(false)
+	, hasRockUnit(false)
+	, hasStartBuilding(false)
+	, pieces(pieces)
+{
+	memset(unitVars, 0, sizeof(unitVars));
+}
+
+CUnitScript::~CUnitScript()
+{
+	while (!animIndices.empty()) {
+		GUnitScriptEngine.RemoveAnim(animIndices.back());
+	}
+}
+
+void CUnitScript::UnblockAll(const AnimInfo& anim)
+{
+	std::vector<IAnimListener*>::const_iterator li;
+
+	for (li = anim.listeners.begin(); li != anim.listeners.end(); ++li) {
+		(*li)->AnimFinished(anim.type, anim.piece, anim.axis);
+	}
+}
+
+// pieces are positioned by the animations only
+LocalModelPiece::LocalModelPiece(const S3DModelPiece* piece)
+	: pos(ZeroVector)
+	, rot(ZeroVector)
+	, colvol(NULL)
+	, numUpdatesSynced(1)
+	, lastMatrixUpdate(0)
+	, visible(true)
+	, identity(true)
+	, original(piece)
+	, parent(NULL)
+	, dispListID(0)
+{}
+LocalModelPiece::~LocalModelPiece() {}
+
+BasicTimer::BasicTimer(const char* const myname): name(myname), starttime(0) {}
+ScopedTimer::~ScopedTimer() {}
+
+
+/// counts the finished animations, as a waiting CCobThread would be woken
+struct CAnimCounter : public CUnitScript::IAnimListener
+{
+	CAnimCounter(): numFinished(0) {}
+	void AnimFinished(CUnitScript::AnimType type, int piece, int axis) { ++numFinished; }
+
+	int numFinished;
+};
+
+/// a script without callins
+class CTestUnitScript : public CUnitScript
+{
+public:
+	CTestUnitScript(): CUnitScript(NULL, piecePtrs) {
+		// allocated one by one, as LocalModel does
+		for (int n = 0; n < 3; ++n) {
+			piecePtrs.push_back(new LocalModelPiece(NULL));
+		}
+	}
+	~CTestUnitScript() {
+		for (size_t n = 0; n < piecePtrs.size(); ++n) {
+			delete piecePtrs[n];
+		}
+	}
+
+	void Animate(AnimType type, int piece, int axis, float speed, float dest, float accel, IAnimListener* listener) {
+		const int animIndex = GUnitScriptEngine.AddAnim(this, type, piece, axis);
+
+		AnimInfo& ai = GUnitScriptEngine.GetAnim(animIndex);
+		ai.speed = speed;
+		ai.dest = dest;
+		ai.accel = accel;
+
+		if (listener != NULL) {
+			ai.listeners.push_back(listener);
+		}
+	}
+
+	void RawCall(int functionId) {}
+	void Create() {}
+	void Killed() {}
+	void WindChanged(float heading, float speed) {}
+	void ExtractionRateChanged(float speed) {}
+	void RockUnit(const float3& rockDir) {}
+	void HitByWeapon(const float3& hitDir, int weaponDefId, float& inout_damage) {}
+	void SetSFXOccupy(int curTerrainType) {}
+	void QueryLandingPads(std::vector<int>& out_pieces) {}
+	void BeginTransport(const CUnit* unit) {}
+	int  QueryTransport(const CUnit* unit) { return -1; }
+	void TransportPickup(const CUnit* unit) {}
+	void TransportDrop(const CUnit* unit, const float3& pos) {}
+	void StartBuilding(float heading, float pitch) {}
+	int  QueryNanoPiece() { return -1; }
+	int  QueryBuildInfo() { return -1; }
+
+	void Destroy() {}
+	void StartMoving() {}
+	void StopMoving() {}
+	void StartUnload() {}
+	void EndTransport() {}
+	void StartBuilding() {}
+	void StopBuilding() {}
+	void Falling() {}
+	void Landed() {}
+	void Activate() {}
+	void Deactivate() {}
+	void MoveRate(int curRate) {}
+	void FireWeapon(int weaponNum) {}
+	void EndBurst(int weaponNum) {}
+
+	int   QueryWeapon(int weaponNum) { return -1; }
+	void  AimWeapon(int weaponNum, float heading, float pitch) {}
+	void  AimShieldWeapon(CPlasmaRepulser* weapon) {}
+	int   AimFromWeapon(int weaponNum) { return -1; }
+	void  Shot(int weaponNum) {}
+	bool  BlockShot(int weaponNum, const CUnit* targetUnit, bool userTarget) { return false; }
+	float TargetWeight(int weaponNum, const CUnit* targetUnit) { return 1.0f; }
+
+protected:
+	void ShowScriptError(const std::string& msg) {}
+
+private:
+	std::vector<LocalModelPiece*> piecePtrs;
+};
+
+
+/// the animation values of a single unit
+static void GetParams(int u, float* spinSpeed, float* turnDest, float* moveDest)
+{
+	*spinSpeed = 1.0f + (u % 7) * 0.25f;
+	*turnDest = -PI + (u % 13) * 0.45f;
+	*moveDest = 2.0f + (u % 11) * 0.5f;
+}
+
+struct Army {
+	Army() {
+		for (int u = 0; u < numUnits; ++u) {
+			float spinSpeed, turnDest, moveDest;
+			GetParams(u, &spinSpeed, &turnDest, &moveDest);
+
+			CTestUnitScript* script = new CTestUnitScript();
+			script->Animate(CUnitScript::ASpin, 0, 1, 0.0f, spinSpeed, 0.05f, NULL);
+			script->Animate(CUnitScript::ATurn, 1, 1, 0.5f, turnDest, 0.0f, &counter);
+			script->Animate(CUnitScript::AMove, 2, 2, 1.0f, moveDest, 0.0f, &counter);
+			scripts.push_back(script);
+		}
+	}
+	~Army() {
+		for (size_t n = 0; n < scripts.size(); ++n) {
+			delete scripts[n];
+		}
+	}
+
+	std::vector<CTestUnitScript*> scripts;
+	CAnimCounter counter;
+};
+
+
+/// the same animations as Army, advanced without the table and the pieces
+struct AnimArrays {
+	AnimArrays() {
+		for (int u = 0; u < numUnits; ++u) {
+			float spinSpeed, turnDest, moveDest;
+			GetParams(u, &spinSpeed, &turnDest, &moveDest);
+
+			spinCur.push_back(0.0f); spinDest.push_back(spinSpeed); spinSpeed_.push_back(0.0f);
+			turnCur.push_back(0.0f); turnDest_.push_back(turnDest); turnDone.push_back(0);
+			moveCur.push_back(0.0f); moveDest_.push_back(moveDest); moveDone.push_back(0);
+		}
+	}
+
+	void Tick(int deltaTime) {
+		const int tickRate = (1000 / deltaTime);
+
+		for (int u = 0; u < numUnits; ++u) {
+			CUnitScriptEngine::DoSpin(spinCur[u], spinDest[u], spinSpeed_[u], 0.05f, tickRate);
+		}
+		for (int u = 0; u < numUnits; ++u) {
+			if (!turnDone[u]) {
+				turnDone[u] = CUnitScriptEngine::TurnToward(turnCur[u], turnDest_[u], 0.5f / tickRate);
+			}
+		}
+		for (int u = 0; u < numUnits; ++u) {
+			if (!moveDone[u]) {
+				moveDone[u] = CUnitScriptEngine::MoveToward(moveCur[u], moveDest_[u], 1.0f / tickRate);
+			}
+		}
+	}
+
+	/// hands the values to the pieces, which the rest of the engine reads
+	void Scatter(const std::vector<CTestUnitScript*>& scripts) const {
+		for (int u = 0; u < numUnits; ++u) {
+			const std::vector<LocalModelPiece*>& pieces = scripts[u]->pieces;
+
+			float3 spinRot = pieces[0]->GetRotation(); spinRot.y = spinCur[u]; pieces[0]->SetRotation(spinRot);
+			float3 turnRot = pieces[1]->GetRotation(); turnRot.y = turnCur[u]; pieces[1]->SetRotation(turnRot);
+			float3 movePos = pieces[2]->GetPosition(); movePos.z = moveCur[u]; pieces[2]->SetPosition(movePos);
+		}
+	}
+
+	std::vector<float> spinCur, spinDest, spinSpeed_;
+	std::vector<float> turnCur, turnDest_;
+	std::vector<float> moveCur, moveDest_;
+	std::vector<char> turnDone, moveDone;
+};
+
+
+static double Seconds(const boost::posix_time::ptime& start)
+{
+	return (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() * 1e-6;
+}
+
+
+BOOST_AUTO_TEST_CASE(AnimationsFinish)
+{
+	Army army;
+
+	BOOST_CHECK_EQUAL(GUnitScriptEngine.GetNumAnims(), numUnits * 3);
+
+	for (int f = 0; f < numFrames; ++f) {
+		GUnitScriptEngine.Tick(deltaTime);
+	}
+
+	// every turn and move is done and was notified once, the spins go on
+	BOOST_CHECK_EQUAL(army.counter.numFinished, numUnits * 2);
+	BOOST_CHECK_EQUAL(GUnitScriptEngine.GetNumAnims(), numUnits);
+
+	for (int u = 0; u < numUnits; ++u) {
+		float spinSpeed, turnDest, moveDest;
+		GetParams(u, &spinSpeed, &turnDest, &moveDest);
+
+		const CTestUnitScript* script = army.scripts[u];
+
+		BOOST_CHECK_EQUAL(script->pieces[1]->GetRotation().y, turnDest);
+		BOOST_CHECK_EQUAL(script->pieces[2]->GetPosition().z, moveDest);
+		BOOST_CHECK(script->HaveAnimations());
+	}
+}
+
+BOOST_AUTO_TEST_CASE(IdleArmyBenchmark)
+{
+	double tickTime = 0.0;
+	double arraysTime = 0.0;
+	double scatterTime = 0.0;
+
+	Army army;
+	AnimArrays arrays;
+	AnimArrays scatteredArrays;
+
+	{
+		const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+		for (int f = 0; f < numFrames; ++f) {
+			GUnitScriptEngine.Tick(deltaTime);
+		}
+
+		tickTime = Seconds(start);
+	}
+	{
+		const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+		for (int f = 0; f < numFrames; ++f) {
+			arrays.Tick(deltaTime);
+		}
+
+		arraysTime = Seconds(start);
+	}
+
+	BOOST_TEST_MESSAGE(numUnits << " units, " << (numUnits * 3) << " animations, " << numFrames << " frames: "
+		<< tickTime << "s in UnitScriptEngine::Tick, "
+		<< arraysTime << "s for the arithmetic alone");
+
+	// the same steps, in the same order
+	for (int u = 0; u < numUnits; ++u) {
+		const CTestUnitScript* script = army.scripts[u];
+
+		BOOST_CHECK_EQUAL(script->pieces[0]->GetRotation().y, arrays.spinCur[u]);
+		BOOST_CHECK_EQUAL(script->pieces[1]->GetRotation().y, arrays.turnCur[u]);
+		BOOST_CHECK_EQUAL(script->pieces[2]->GetPosition().z, arrays.moveCur[u]);
+	}
+
+	// what a SIMD pass over such arrays would cost at least, since the
+	// values are read from the pieces everywhere else
+	{
+		const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+		for (int f = 0; f < numFrames; ++f) {
+			scatteredArrays.Tick(deltaTime);
+			scatteredArrays.Scatter(army.scripts);
+		}
+
+		scatterTime = Seconds(start);
+	}
+
+	BOOST_TEST_MESSAGE("  " << scatterTime << "s for the arithmetic plus storing the results in the pieces");
+}
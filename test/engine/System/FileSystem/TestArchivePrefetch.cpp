@@ -0,0 +1,270 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/FileSystem/ArchiveFileCache.h"
+#include "System/FileSystem/ArchiveLoader.h"
+#include "System/FileSystem/ArchiveScanner.h"
+#include "System/FileSystem/DataDirsAccess.h"
+#include "System/FileSystem/FileSystem.h"
+#include "System/FileSystem/PoolArchive.h"
+#include "System/FileSystem/VFSHandler.h"
+#include "System/ThreadPool.h"
+#include "System/Util.h"
+#include "System/Config/ConfigHandler.h"
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#define BOOST_TEST_MODULE ArchivePrefetch
+#include <boost/test/unit_test.hpp>
+
+/*
+ * A game in a rapid pool, loaded through the VFS as CGame::LoadDefs reads
+ * it: every file below the def, script and model dirs, once file by file
+ * (ArchivePrefetch=0) and once after CVFSHandler::PrefetchDirs.
+ */
+
+struct ContentDir {
+	const char* name;
+	int numFiles;
+	int minSize;
+	int maxSize;
+};
+
+// roughly the contents of a large game
+static const ContentDir contentDirs[] = {
+	{"gamedata/",    40,  2000,  30000},
+	{"units/",      500,  4000,  20000},
+	{"weapons/",    150,  2000,  12000},
+	{"features/",   150,  1000,   6000},
+	{"scripts/",    500,  2000,  16000},
+	{"objects3d/",  400, 20000, 120000},
+};
+static const int numContentDirs = sizeof(contentDirs) / sizeof(contentDirs[0]);
+
+static std::string dataDir;
+
+
+/// the archive cache budget and the number of threads to prefetch with
+class CTestConfigHandler : public ConfigHandler
+{
+public:
+	void SetString(const std::string& key, const std::string& value, bool) { values[key] = value; }
+	std::string GetString(const std::string& key) const {
+		const std::map<std::string, std::string>::const_iterator it = values.find(key);
+		return (it != values.end())? it->second: "0";
+	}
+	bool IsSet(const std::string& key) const { return (values.find(key) != values.end()); }
+	void Delete(const std::string& key) { values.erase(key); }
+	std::string GetConfigFile() const { return ""; }
+	const std::map<std::string, std::string> GetData() const { return values; }
+	void Update() {}
+
+protected:
+	void AddObserver(ConfigNotifyCallback) {}
+
+private:
+	std::map<std::string, std::string> values;
+};
+
+
+// the parts of the file system not under test: pool files are looked up
+// in the test data-dir, and every archive is a pool archive
+ConfigHandler* configHandler = NULL;
+
+DataDirsAccess dataDirsAccess;
+std::string DataDirsAccess::LocateFile(std::string file, int flags) const { return dataDir + file; }
+
+CArchiveScanner* archiveScanner = NULL;
+std::vector<std::string> CArchiveScanner::GetArchives(const std::string& root, int depth) const { return std::vector<std::string>(1, root); }
+
+CArchiveLoader::CArchiveLoader() {}
+CArchiveLoader::~CArchiveLoader() {}
+CArchiveLoader& CArchiveLoader::GetInstance() { static CArchiveLoader instance; return instance; }
+IArchive* CArchiveLoader::OpenArchive(const std::string& fileName, const std::string& type) const { return new CPoolArchive(fileName); }
+
+
+static void AppendInt32(std::vector<unsigned char>& buf, unsigned int i)
+{
+	buf.push_back((i >> 24) & 0xff);
+	buf.push_back((i >> 16) & 0xff);
+	buf.push_back((i >>  8) & 0xff);
+	buf.push_back((i >>  0) & 0xff);
+}
+
+static void WriteGzFile(const std::string& path, const std::vector<unsigned char>& data)
+{
+	gzFile out = gzopen(path.c_str(), "wb");
+	BOOST_REQUIRE(out != NULL);
+	BOOST_REQUIRE(data.empty() || gzwrite(out, &data[0], data.size()) == int(data.size()));
+	gzclose(out);
+}
+
+/// writes a pool with an .sdp index in the temporary data-dir
+struct TestPool {
+	TestPool(): numBytes(0) {
+		char* tmpDir = tmpnam(NULL);
+		BOOST_REQUIRE(tmpDir != NULL);
+
+		dataDir = std::string(tmpDir) + "/";
+		BOOST_REQUIRE(FileSystem::CreateDirectory(dataDir + "packages"));
+
+		std::vector<unsigned char> index;
+		unsigned int seed = 1234;
+
+		for (int d = 0; d < numContentDirs; ++d) {
+			const ContentDir& cd = contentDirs[d];
+
+			for (int n = 0; n < cd.numFiles; ++n) {
+				char name[64];
+				sprintf(name, "%sfile%04d.dat", cd.name, n);
+
+				// text-like, so it compresses about as well as real content
+				seed = seed * 1103515245 + 12345;
+				const int size = cd.minSize + ((seed >> 8) % (cd.maxSize - cd.minSize));
+				std::vector<unsigned char> data(size);
+
+				for (int i = 0; i < size; ++i) {
+					seed = seed * 1103515245 + 12345;
+					data[i] = "\tabcdefghij klmnop = {}\n0123"[(seed >> 16) % 28];
+				}
+
+				unsigned char md5[16];
+				for (int i = 0; i < 16; ++i) {
+					seed = seed * 1103515245 + 12345;
+					md5[i] = (seed >> 16) & 0xff;
+				}
+
+				char hex[33];
+				for (int i = 0; i < 16; ++i) {
+					sprintf(&hex[i * 2], "%02x", md5[i]);
+				}
+
+				const std::string poolDir = dataDir + "pool/" + std::string(hex, 2);
+				const std::string poolFile = poolDir + "/" + std::string(hex + 2, 30) + ".gz";
+
+				if (poolDirs.insert(poolDir).second) {
+					BOOST_REQUIRE(FileSystem::CreateDirectory(poolDir));
+				}
+				WriteGzFile(poolFile, data);
+				poolFiles.push_back(poolFile);
+
+				index.push_back(strlen(name));
+				index.insert(index.end(), name, name + strlen(name));
+				index.insert(index.end(), md5, md5 + 16);
+				AppendInt32(index, crc32(0, &data[0], size));
+				AppendInt32(index, size);
+
+				names.push_back(name);
+				crcs.push_back(crc32(0, &data[0], size));
+				numBytes += size;
+			}
+		}
+
+		sdpPath = dataDir + "packages/test.sdp";
+		WriteGzFile(sdpPath, index);
+	}
+
+	~TestPool() {
+		FileSystem::DeleteFile(sdpPath);
+
+		for (size_t n = 0; n < poolFiles.size(); ++n) {
+			FileSystem::DeleteFile(poolFiles[n]);
+		}
+		for (std::set<std::string>::const_iterator it = poolDirs.begin(); it != poolDirs.end(); ++it) {
+			FileSystem::DeleteFile(*it);
+		}
+
+		FileSystem::DeleteFile(dataDir + "pool");
+		FileSystem::DeleteFile(dataDir + "packages");
+		FileSystem::DeleteFile(dataDir);
+	}
+
+	std::string sdpPath;
+	std::vector<std::string> poolFiles;
+	std::set<std::string> poolDirs;
+
+	std::vector<std::string> names;
+	std::vector<unsigned int> crcs;
+	size_t numBytes;
+};
+
+
+/// loads all files of the pool, @return their CRCs
+static std::vector<unsigned int> Load(const TestPool& pool, bool prefetch, double* seconds)
+{
+	vfsHandler = new CVFSHandler();
+	vfsHandler->AddArchive(pool.sdpPath, false);
+
+	std::vector<unsigned int> crcs;
+	std::vector<boost::uint8_t> buffer;
+
+	const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+	if (prefetch) {
+		std::vector<std::string> dirs;
+		for (int d = 0; d < numContentDirs; ++d) {
+			dirs.push_back(contentDirs[d].name);
+		}
+
+		vfsHandler->PrefetchDirs(dirs);
+	}
+
+	for (size_t n = 0; n < pool.names.size(); ++n) {
+		if (vfsHandler->LoadFile(pool.names[n], buffer)) {
+			crcs.push_back(crc32(0, buffer.empty()? NULL: &buffer[0], buffer.size()));
+		} else {
+			crcs.push_back(0);
+		}
+	}
+
+	*seconds = (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() * 1e-6;
+
+	// drops the archive and its cached files
+	delete vfsHandler;
+	vfsHandler = NULL;
+
+	return crcs;
+}
+
+BOOST_AUTO_TEST_CASE(PoolLoadBenchmark)
+{
+	configHandler = new CTestConfigHandler();
+	configHandler->SetString("ArchiveCacheSize", "256");
+
+	const TestPool pool;
+
+	BOOST_REQUIRE(archiveFileCache.IsEnabled());
+	BOOST_REQUIRE(pool.numBytes < (archiveFileCache.GetStats().maxBytes / 2));
+
+	// the OS caches the pool files after the first pass, so the
+	// timed passes only differ in how the files are decompressed
+	double warmupTime = 0.0;
+	Load(pool, false, &warmupTime);
+
+	double serialTime = 0.0;
+	const std::vector<unsigned int> serialCrcs = Load(pool, false, &serialTime);
+
+	BOOST_TEST_MESSAGE(pool.names.size() << " files (" << (pool.numBytes / 1024) << " KB) in a pool archive: "
+		<< serialTime << "s with ArchivePrefetch=0 "
+		<< "(" << warmupTime << "s for the first pass)");
+	BOOST_CHECK(serialCrcs == pool.crcs);
+
+	for (int numThreads = 1; numThreads <= 8; numThreads *= 2) {
+		configHandler->SetString("HardwareThreadCount", IntToString(numThreads));
+
+		double prefetchTime = 0.0;
+		const std::vector<unsigned int> prefetchCrcs = Load(pool, true, &prefetchTime);
+
+		BOOST_TEST_MESSAGE("  " << prefetchTime << "s with prefetching on " << numThreads << " threads");
+		BOOST_CHECK(prefetchCrcs == pool.crcs);
+	}
+
+	delete configHandler;
+	configHandler = NULL;
+}
@@ -0,0 +1,206 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/AICommandBatch.h"
+#include "System/BaseNetProtocol.h"
+#include "System/Net/RawPacket.h"
+#include "System/Net/UnpackPacket.h"
+
+#include <cstring>
+#include <vector>
+
+#define BOOST_TEST_MODULE AICommandBatch
+#include <boost/test/unit_test.hpp>
+
+static const int numUnits = 200;
+
+/// size of a NETMSG_AICOMMAND, as sent for every unit without batching
+static unsigned int GetAICommandSize(unsigned int numParams)
+{
+	return (11 + numParams * sizeof(float));
+}
+
+struct Order {
+	short unitID;
+	int cmdID;
+	unsigned char options;
+	std::vector<float> params;
+};
+
+/**
+ * Batches the orders like CNetProtocol does, decodes the messages again and
+ * checks that every unit gets exactly its order.
+ * @return total bytes sent
+ */
+static unsigned int SendOrders(const std::vector<Order>& orders, unsigned int* numPackets)
+{
+	CAICommandBatch batch;
+	std::vector< boost::shared_ptr<const netcode::RawPacket> > packets;
+
+	for (size_t i = 0; i < orders.size(); ++i) {
+		const Order& o = orders[i];
+
+		if (batch.Add(0, o.unitID, o.cmdID, o.options, &o.params[0], o.params.size()))
+			continue;
+
+		packets.push_back(batch.Pack());
+		batch.Clear();
+		BOOST_REQUIRE(batch.Add(0, o.unitID, o.cmdID, o.options, &o.params[0], o.params.size()));
+	}
+	if (!batch.Empty())
+		packets.push_back(batch.Pack());
+
+	unsigned int numBytes = 0;
+	size_t orderNum = 0;
+
+	for (size_t p = 0; p < packets.size(); ++p) {
+		BOOST_REQUIRE(packets[p]->length <= CAICommandBatch::MAX_PACKET_SIZE);
+		BOOST_REQUIRE_EQUAL(packets[p]->data[0], NETMSG_AICOMMANDS_BATCH);
+
+		CAICommandBatch received;
+		received.Unpack(packets[p]);
+
+		// CNetProtocol sends single orders as NETMSG_AICOMMAND
+		if (received.GetNumUnits() == 1) {
+			numBytes += GetAICommandSize(received.GetNumParams());
+		} else {
+			numBytes += packets[p]->length;
+		}
+
+		for (size_t u = 0; u < received.GetNumUnits(); ++u, ++orderNum) {
+			BOOST_REQUIRE(orderNum < orders.size());
+			const Order& o = orders[orderNum];
+
+			float params[CAICommandBatch::MAX_PARAMS];
+			received.GetUnitParams(u, params);
+
+			BOOST_REQUIRE_EQUAL(received.GetUnitID(u), o.unitID);
+			BOOST_REQUIRE_EQUAL(received.GetCommandID(), o.cmdID);
+			BOOST_REQUIRE_EQUAL(received.GetOptions(), o.options);
+			BOOST_REQUIRE_EQUAL(received.GetNumParams(), o.params.size());
+			BOOST_REQUIRE(std::memcmp(params, &o.params[0], o.params.size() * sizeof(float)) == 0);
+		}
+	}
+
+	BOOST_REQUIRE_EQUAL(orderNum, orders.size());
+
+	*numPackets = packets.size();
+	return numBytes;
+}
+
+static void CheckBandwidth(const char* name, const std::vector<Order>& orders, unsigned int maxBatchedBytes)
+{
+	unsigned int unbatchedBytes = 0;
+	unsigned int numPackets = 0;
+
+	for (size_t i = 0; i < orders.size(); ++i) {
+		unbatchedBytes += GetAICommandSize(orders[i].params.size());
+	}
+
+	const unsigned int batchedBytes = SendOrders(orders, &numPackets);
+
+	BOOST_TEST_MESSAGE(name << ": " << orders.size() << " orders, "
+		<< unbatchedBytes << " bytes in " << orders.size() << " messages before, "
+		<< batchedBytes << " bytes in " << numPackets << " messages batched");
+	BOOST_CHECK(batchedBytes <= maxBatchedBytes);
+}
+
+static Order MakeOrder(short unitID, int cmdID, float x, float y, float z)
+{
+	Order o;
+	o.unitID = unitID;
+	o.cmdID = cmdID;
+	o.options = 0;
+	o.params.push_back(x);
+	o.params.push_back(y);
+	o.params.push_back(z);
+	return o;
+}
+
+
+BOOST_AUTO_TEST_CASE(SameOrder)
+{
+	// e.g. every unit of a group attacks the same target
+	std::vector<Order> orders;
+
+	for (int i = 0; i < numUnits; ++i) {
+		orders.push_back(MakeOrder(i * 3, 20, 1234.5f, 56.25f, 789.125f));
+	}
+
+	CheckBandwidth("same order", orders, 13 + 3 * 4 + numUnits * 2);
+}
+
+BOOST_AUTO_TEST_CASE(GridPositions)
+{
+	// e.g. build orders or moves to the centers of map squares
+	std::vector<Order> orders;
+
+	for (int i = 0; i < numUnits; ++i) {
+		orders.push_back(MakeOrder(i, -15, 2048.0f + (i % 20) * 48.0f, 100.0f + (i % 7) * 0.5f, 1024.0f + (i / 20) * 48.0f));
+	}
+
+	CheckBandwidth("grid positions", orders, 13 + 3 * 4 + numUnits * 8);
+}
+
+BOOST_AUTO_TEST_CASE(ArbitraryPositions)
+{
+	// positions that are not on the delta grid still arrive unchanged
+	std::vector<Order> orders;
+
+	for (int i = 0; i < numUnits; ++i) {
+		orders.push_back(MakeOrder(i, 10, 1000.0f + i * 1.3f, 50.0f, 2000.0f - i * 0.7f));
+	}
+
+	CheckBandwidth("arbitrary positions", orders, numUnits * GetAICommandSize(3));
+}
+
+BOOST_AUTO_TEST_CASE(MixedOrders)
+{
+	// the order of the commands has to be kept
+	std::vector<Order> orders;
+
+	for (int i = 0; i < numUnits; ++i) {
+		orders.push_back(MakeOrder(i, 10, 512.0f + i, 0.0f, 512.0f));
+		orders.push_back(MakeOrder(i, (i % 3 == 0)? 20: 10, 512.0f + i, 0.0f, 4096.0f * 20));
+
+		Order stop;
+		stop.unitID = i;
+		stop.cmdID = 0;
+		stop.options = (i % 2) * 32;
+		stop.params.resize(1, 0.0f);
+		orders.push_back(stop);
+	}
+
+	unsigned int numPackets = 0;
+	SendOrders(orders, &numPackets);
+}
+
+BOOST_AUTO_TEST_CASE(PacketSizeLimit)
+{
+	std::vector<Order> orders;
+
+	for (int i = 0; i < 5000; ++i) {
+		orders.push_back(MakeOrder(i, 10, 64.0f + (i % 64) * 8.0f, 0.0f, 64.0f));
+	}
+
+	CheckBandwidth("many units", orders, (5000 / 1000 + 1) * CAICommandBatch::MAX_PACKET_SIZE);
+}
+
+BOOST_AUTO_TEST_CASE(InvalidPackets)
+{
+	CAICommandBatch batch;
+	const float params[3] = {8.0f, 0.0f, 8.0f};
+	BOOST_REQUIRE(batch.Add(1, 5, 10, 0, params, 3));
+	BOOST_REQUIRE(batch.Add(1, 6, 10, 0, params, 3));
+
+	boost::shared_ptr<const netcode::RawPacket> packet = batch.Pack();
+
+	// cut off the last unit
+	netcode::RawPacket* truncated = new netcode::RawPacket(packet->data, packet->length - 2);
+	CAICommandBatch received;
+	BOOST_CHECK_THROW(received.Unpack(boost::shared_ptr<const netcode::RawPacket>(truncated)), netcode::UnpackPacketException);
+
+	// claim more units than there are
+	netcode::RawPacket* wrongCount = new netcode::RawPacket(packet->data, packet->length);
+	wrongCount->data[wrongCount->length - 2 * 2 - 2] = 3;
+	BOOST_CHECK_THROW(received.Unpack(boost::shared_ptr<const netcode::RawPacket>(wrongCount)), netcode::UnpackPacketException);
+}
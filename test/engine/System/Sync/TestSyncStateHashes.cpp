@@ -0,0 +1,84 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/Sync/SyncStateHashes.h"
+
+#define BOOST_TEST_MODULE SyncStateHashes
+#include <boost/test/unit_test.hpp>
+
+typedef CSyncStateHashes::Hashes Hashes;
+
+static Hashes MakeHashes(boost::uint32_t base)
+{
+	Hashes hashes(CSyncStateHashes::NUM_SUBSYSTEMS);
+
+	for (int s = 0; s < CSyncStateHashes::NUM_SUBSYSTEMS; ++s) {
+		hashes[s] = base + s;
+	}
+	return hashes;
+}
+
+
+BOOST_AUTO_TEST_CASE(InSync)
+{
+	std::map<int, Hashes> playerHashes;
+	playerHashes[0] = MakeHashes(100);
+	playerHashes[1] = MakeHashes(100);
+	playerHashes[4] = MakeHashes(100);
+
+	const std::vector< std::vector<int> > desyncs = CSyncStateHashes::FindDesyncs(playerHashes, -1);
+
+	BOOST_REQUIRE_EQUAL(desyncs.size(), size_t(CSyncStateHashes::NUM_SUBSYSTEMS));
+	for (int s = 0; s < CSyncStateHashes::NUM_SUBSYSTEMS; ++s) {
+		BOOST_CHECK(desyncs[s].empty());
+	}
+}
+
+BOOST_AUTO_TEST_CASE(Democracy)
+{
+	// player 2 desynced in the features only
+	std::map<int, Hashes> playerHashes;
+	playerHashes[0] = MakeHashes(100);
+	playerHashes[1] = MakeHashes(100);
+	playerHashes[2] = MakeHashes(100);
+	playerHashes[2][CSyncStateHashes::SUBSYS_FEATURES] = 7;
+
+	const std::vector< std::vector<int> > desyncs = CSyncStateHashes::FindDesyncs(playerHashes, -1);
+
+	for (int s = 0; s < CSyncStateHashes::NUM_SUBSYSTEMS; ++s) {
+		if (s == CSyncStateHashes::SUBSYS_FEATURES) {
+			BOOST_REQUIRE_EQUAL(desyncs[s].size(), 1);
+			BOOST_CHECK_EQUAL(desyncs[s][0], 2);
+		} else {
+			BOOST_CHECK(desyncs[s].empty());
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(Dictatorship)
+{
+	// the reference player is right, even if outnumbered
+	std::map<int, Hashes> playerHashes;
+	playerHashes[0] = MakeHashes(100);
+	playerHashes[1] = MakeHashes(100);
+	playerHashes[3] = MakeHashes(100);
+	playerHashes[3][CSyncStateHashes::SUBSYS_HEIGHTMAP] = 5;
+
+	const std::vector< std::vector<int> > desyncs = CSyncStateHashes::FindDesyncs(playerHashes, 3);
+
+	BOOST_REQUIRE_EQUAL(desyncs[CSyncStateHashes::SUBSYS_HEIGHTMAP].size(), 2);
+	BOOST_CHECK_EQUAL(desyncs[CSyncStateHashes::SUBSYS_HEIGHTMAP][0], 0);
+	BOOST_CHECK_EQUAL(desyncs[CSyncStateHashes::SUBSYS_HEIGHTMAP][1], 1);
+	BOOST_CHECK(desyncs[CSyncStateHashes::SUBSYS_UNITS].empty());
+
+	// a reference player that sent nothing falls back to the majority
+	const std::vector< std::vector<int> > majority = CSyncStateHashes::FindDesyncs(playerHashes, 2);
+
+	BOOST_REQUIRE_EQUAL(majority[CSyncStateHashes::SUBSYS_HEIGHTMAP].size(), 1);
+	BOOST_CHECK_EQUAL(majority[CSyncStateHashes::SUBSYS_HEIGHTMAP][0], 3);
+}
+
+BOOST_AUTO_TEST_CASE(SubsystemNames)
+{
+	BOOST_CHECK_EQUAL(std::string(CSyncStateHashes::GetSubsystemName(CSyncStateHashes::SUBSYS_UNITS)), "units");
+	BOOST_CHECK_EQUAL(std::string(CSyncStateHashes::GetSubsystemName(CSyncStateHashes::NUM_SUBSYSTEMS)), "unknown");
+}
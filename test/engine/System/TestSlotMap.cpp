@@ -0,0 +1,173 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#define NOT_USING_CREG
+#include "System/SlotMap.h"
+
+#include <ctime>
+#include <list>
+#include <map>
+#include <vector>
+
+#define BOOST_TEST_MODULE SlotMap
+#include <boost/test/unit_test.hpp>
+
+static const int numPreloadedIDs = 16384;
+static const int numFrames = 3000;
+static const int shotsPerFrame = 200;
+static const int shotLifeTime = 45; // frames
+
+
+BOOST_AUTO_TEST_CASE(InsertErase)
+{
+	CSlotMap<int> map;
+
+	BOOST_CHECK_EQUAL(map.Insert(1), -1);
+	BOOST_CHECK(!map.IsUsed(-1));
+	BOOST_CHECK(!map.IsUsed(0));
+
+	map.AddSlots(3);
+	BOOST_CHECK_EQUAL(map.GetSize(), 3);
+	BOOST_CHECK_EQUAL(map.Insert(10), 0);
+	BOOST_CHECK_EQUAL(map.Insert(11), 1);
+	BOOST_CHECK_EQUAL(map[1], 11);
+	BOOST_CHECK(map.IsUsed(1));
+	BOOST_CHECK_EQUAL(map.GetNumUsed(), 2);
+
+	// released ids are reused last, in release order
+	map.Erase(0);
+	BOOST_CHECK(!map.IsUsed(0));
+	BOOST_CHECK_EQUAL(map[0], 0);
+	BOOST_CHECK_EQUAL(map.Insert(12), 2);
+	BOOST_CHECK_EQUAL(map.Insert(13), 0);
+	BOOST_CHECK_EQUAL(map.Insert(14), -1);
+	BOOST_CHECK_EQUAL(map.GetNumFree(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Generations)
+{
+	CSlotMap<int> map;
+	map.AddSlots(1);
+
+	const int id = map.Insert(1);
+	const unsigned int gen = map.GetGeneration(id);
+	BOOST_CHECK(map.IsCurrent(id, gen));
+
+	map.Erase(id);
+	BOOST_CHECK(!map.IsCurrent(id, gen));
+
+	// same id, but not the same object anymore
+	BOOST_CHECK_EQUAL(map.Insert(2), id);
+	BOOST_CHECK(!map.IsCurrent(id, gen));
+	BOOST_CHECK(map.IsCurrent(id, map.GetGeneration(id)));
+}
+
+BOOST_AUTO_TEST_CASE(ShuffledIDs)
+{
+	CSlotMap<int> map;
+	std::vector<int> order;
+	order.push_back(2);
+	order.push_back(0);
+	order.push_back(1);
+
+	map.AddSlots(order);
+	BOOST_CHECK_EQUAL(map.Insert(1), 2);
+	BOOST_CHECK_EQUAL(map.Insert(1), 0);
+	BOOST_CHECK_EQUAL(map.Insert(1), 1);
+}
+
+
+/// the old way: std::map of living objects plus std::list of free ids
+struct MapAndListIDs {
+	MapAndListIDs(): maxUsedID(numPreloadedIDs) {
+		for (int i = 0; i < numPreloadedIDs; i++)
+			freeIDs.push_back(i);
+	}
+
+	int Add(int value) {
+		int id = 0;
+		if (!freeIDs.empty()) {
+			id = freeIDs.front();
+			freeIDs.pop_front();
+		} else {
+			id = ++maxUsedID;
+		}
+		objects[id] = value;
+		return id;
+	}
+	int Remove(int id) {
+		std::map<int, int>::iterator it = objects.find(id);
+		const int value = it->second;
+		objects.erase(it);
+		freeIDs.push_back(id);
+		return value;
+	}
+
+	std::map<int, int> objects;
+	std::list<int> freeIDs;
+	int maxUsedID;
+};
+
+struct SlotMapIDs {
+	SlotMapIDs() { objects.AddSlots(numPreloadedIDs); }
+
+	int Add(int value) {
+		if (objects.GetNumFree() == 0)
+			objects.AddSlots(1);
+		return objects.Insert(value);
+	}
+	int Remove(int id) {
+		const int value = objects[id];
+		objects.Erase(id);
+		return value;
+	}
+
+	CSlotMap<int> objects;
+};
+
+/**
+ * A long battle: every frame some hundred shots are fired, each one is
+ * looked up a few times while flying and removed when it hits.
+ * @return the ids in the order they were handed out
+ */
+template<typename IDs>
+static std::vector<int> FireShots(double* seconds)
+{
+	IDs ids;
+	std::vector< std::vector<int> > hitFrames(numFrames + shotLifeTime);
+	std::vector<int> order;
+	int sum = 0;
+
+	order.reserve(numFrames * shotsPerFrame);
+
+	const clock_t start = clock();
+
+	for (int f = 0; f < numFrames; ++f) {
+		for (int s = 0; s < shotsPerFrame; ++s) {
+			const int id = ids.Add(f + s);
+			order.push_back(id);
+			hitFrames[f + 1 + (f * 7 + s * 13) % shotLifeTime].push_back(id);
+		}
+		for (size_t n = 0; n < hitFrames[f].size(); ++n) {
+			sum += ids.Remove(hitFrames[f][n]);
+		}
+	}
+
+	*seconds = double(clock() - start) / CLOCKS_PER_SEC;
+	order.push_back(sum);
+	return order;
+}
+
+BOOST_AUTO_TEST_CASE(ProjectileIDBenchmark)
+{
+	double mapTime = 0.0;
+	double slotMapTime = 0.0;
+
+	const std::vector<int> mapOrder = FireShots<MapAndListIDs>(&mapTime);
+	const std::vector<int> slotMapOrder = FireShots<SlotMapIDs>(&slotMapTime);
+
+	BOOST_TEST_MESSAGE((numFrames * shotsPerFrame) << " projectile ids: "
+		<< mapTime << "s with map and free list, " << slotMapTime << "s with the slot map");
+
+	// same ids in the same order (never more than numPreloadedIDs are alive)
+	BOOST_CHECK(mapOrder == slotMapOrder);
+}
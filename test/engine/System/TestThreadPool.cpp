@@ -0,0 +1,119 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/ThreadPool.h"
+#include "System/Config/ConfigHandler.h"
+
+#include <algorithm>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#define BOOST_TEST_MODULE ThreadPool
+#include <boost/test/unit_test.hpp>
+
+static const int maxThreads = 16;
+
+
+// the config is not loaded, as in unitsync and the server
+ConfigHandler* configHandler = NULL;
+
+
+/// counts how often each item was run and by how many threads
+struct RunCounter {
+	RunCounter(int numItems): runs(numItems, 0) {}
+
+	void Run(int idx) {
+		boost::mutex::scoped_lock lock(mutex);
+		runs[idx]++;
+		threads.push_back(boost::this_thread::get_id());
+	}
+
+	int NumThreads() const {
+		std::vector<boost::thread::id> ids(threads);
+		std::sort(ids.begin(), ids.end());
+		return std::unique(ids.begin(), ids.end()) - ids.begin();
+	}
+
+	boost::mutex mutex;
+	std::vector<int> runs;
+	std::vector<boost::thread::id> threads;
+};
+
+/// stands in for a model: the work per item differs a lot, so items finish
+/// out of order, and some fail, as C3DModelLoader::PreloadModel expects
+static void ParseItem(const std::vector<int>* items, std::vector<int*>* results, int idx)
+{
+	const int item = (*items)[idx];
+
+	if ((item % 7) == 0) {
+		(*results)[idx] = NULL;
+		return;
+	}
+
+	volatile int sum = 0;
+	for (int i = 0; i < ((item * 7919) % 20000); i++) {
+		sum += i;
+	}
+
+	(*results)[idx] = new int(item * 2);
+}
+
+
+BOOST_AUTO_TEST_CASE(NumThreads)
+{
+	BOOST_CHECK(ThreadPool::GetNumThreads() >= 1);
+}
+
+BOOST_AUTO_TEST_CASE(AllItemsRun)
+{
+	for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+		for (int numItems = 0; numItems <= 100; numItems += 33) {
+			// a range not starting at 0, with fewer items than threads for small counts
+			const int start = 5;
+
+			RunCounter counter(start + numItems);
+			ThreadPool::for_mt(start, start + numItems, boost::bind(&RunCounter::Run, &counter, _1), numThreads);
+
+			for (int i = 0; i < start; i++) {
+				BOOST_CHECK_EQUAL(counter.runs[i], 0);
+			}
+			for (int i = start; i < start + numItems; i++) {
+				BOOST_CHECK_EQUAL(counter.runs[i], 1);
+			}
+
+			BOOST_CHECK(counter.NumThreads() <= std::max(1, std::min(numThreads, numItems)));
+		}
+	}
+
+	// an empty or inverted range does nothing
+	RunCounter counter(10);
+	ThreadPool::for_mt(5, 5, boost::bind(&RunCounter::Run, &counter, _1), 4);
+	ThreadPool::for_mt(8, 2, boost::bind(&RunCounter::Run, &counter, _1), 4);
+	BOOST_CHECK(counter.threads.empty());
+}
+
+BOOST_AUTO_TEST_CASE(ResultsInSubmissionOrder)
+{
+	std::vector<int> items;
+	for (int n = 0; n < 500; n++) {
+		items.push_back((n * 37) % 501);
+	}
+
+	for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+		// every item has its own result slot, as in C3DModelLoader::PreloadModels
+		std::vector<int*> results(items.size(), NULL);
+
+		ThreadPool::for_mt(0, items.size(), boost::bind(&ParseItem, &items, &results, _1), numThreads);
+
+		for (size_t n = 0; n < items.size(); n++) {
+			if ((items[n] % 7) == 0) {
+				BOOST_CHECK(results[n] == NULL);
+				continue;
+			}
+
+			BOOST_REQUIRE(results[n] != NULL);
+			BOOST_CHECK_EQUAL(*results[n], items[n] * 2);
+			delete results[n];
+		}
+	}
+}
@@ -0,0 +1,266 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/creg/creg_cond.h"
+#include "System/creg/ChunkedBuffer.h"
+#include "System/creg/Serializer.h"
+#include "System/LoadSave/SaveFileWriter.h"
+
+#include <cstring>
+#include <ctime>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#define BOOST_TEST_MODULE CregSerializer
+#include <boost/test/unit_test.hpp>
+
+static const int numObjects = 200000;
+
+
+struct TestEmbedded {
+	CR_DECLARE_STRUCT(TestEmbedded);
+
+	TestEmbedded(): value(0), weight(0.0f) {}
+
+	int value;
+	float weight;
+};
+
+CR_BIND(TestEmbedded, );
+CR_REG_METADATA(TestEmbedded, (
+	CR_MEMBER(value),
+	CR_MEMBER(weight)
+));
+
+
+class TestObject {
+	CR_DECLARE(TestObject);
+
+public:
+	TestObject(): id(0), next(NULL), other(NULL), embeddedPtr(NULL) {}
+	virtual ~TestObject() {}
+
+	int id;
+	std::string name;
+	std::vector<int> values;
+	TestObject* next;
+	TestObject* other;
+	TestEmbedded embedded;
+	/// points into the embedded member of another object
+	TestEmbedded* embeddedPtr;
+};
+
+CR_BIND(TestObject, );
+CR_REG_METADATA(TestObject, (
+	CR_MEMBER(id),
+	CR_MEMBER(name),
+	CR_MEMBER(values),
+	CR_MEMBER(next),
+	CR_MEMBER(other),
+	CR_MEMBER(embedded),
+	CR_MEMBER(embeddedPtr)
+));
+
+
+struct TestState {
+	CR_DECLARE_STRUCT(TestState);
+
+	~TestState() {
+		for (size_t i = 0; i < objects.size(); ++i) {
+			delete objects[i];
+		}
+	}
+
+	std::vector<TestObject*> objects;
+};
+
+CR_BIND(TestState, );
+CR_REG_METADATA(TestState, (
+	CR_MEMBER(objects)
+));
+
+
+struct InitCreg {
+	InitCreg() { creg::System::InitializeClasses(); }
+	~InitCreg() { creg::System::FreeClasses(); }
+};
+
+BOOST_GLOBAL_FIXTURE(InitCreg);
+
+
+/// a large state with references between objects in every direction
+static TestState* CreateState()
+{
+	TestState* state = new TestState();
+	state->objects.resize(numObjects);
+
+	for (int i = 0; i < numObjects; ++i) {
+		TestObject* obj = new TestObject();
+		std::ostringstream name;
+		name << "object" << i;
+
+		obj->id = i;
+		obj->name = name.str();
+		obj->values.resize(i % 17, i);
+		obj->embedded.value = i * 3;
+		obj->embedded.weight = i * 0.5f;
+		state->objects[i] = obj;
+	}
+
+	for (int i = 0; i < numObjects; ++i) {
+		TestObject* obj = state->objects[i];
+
+		obj->next = state->objects[(i + 1) % numObjects];
+		obj->other = ((i % 5) == 0)? NULL: state->objects[(i * 7919) % numObjects];
+		obj->embeddedPtr = &state->objects[(i * 3571) % numObjects]->embedded;
+	}
+
+	return state;
+}
+
+static void CheckState(const TestState* state)
+{
+	BOOST_REQUIRE_EQUAL(state->objects.size(), size_t(numObjects));
+
+	for (int i = 0; i < numObjects; ++i) {
+		const TestObject* obj = state->objects[i];
+
+		BOOST_REQUIRE_EQUAL(obj->id, i);
+		BOOST_REQUIRE_EQUAL(obj->values.size(), size_t(i % 17));
+		BOOST_REQUIRE_EQUAL(obj->embedded.value, i * 3);
+		BOOST_REQUIRE_EQUAL(obj->embedded.weight, i * 0.5f);
+		BOOST_REQUIRE(obj->next == state->objects[(i + 1) % numObjects]);
+		BOOST_REQUIRE(obj->other == (((i % 5) == 0)? NULL: state->objects[(i * 7919) % numObjects]));
+		BOOST_REQUIRE(obj->embeddedPtr == &state->objects[(i * 3571) % numObjects]->embedded);
+
+		std::ostringstream name;
+		name << "object" << i;
+		BOOST_REQUIRE_EQUAL(obj->name, name.str());
+	}
+}
+
+static double GetSeconds(clock_t start)
+{
+	return double(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static std::vector<boost::uint8_t> SavePackage(TestState* state, creg::CChunkedBuffer* buffer = NULL)
+{
+	creg::CChunkedBuffer localBuffer;
+	creg::COutputStreamSerializer os;
+
+	os.SavePackage((buffer != NULL)? buffer: &localBuffer, state, state->GetClass());
+
+	std::vector<boost::uint8_t> data;
+
+	if (buffer == NULL)
+		localBuffer.Release(data);
+
+	return data;
+}
+
+static TestState* LoadPackage(const std::vector<boost::uint8_t>& data)
+{
+	creg::CInputStreamSerializer is;
+	void* root = NULL;
+	creg::Class* rootCls = NULL;
+
+	is.LoadPackage(&data[0], data.size(), root, rootCls);
+	BOOST_REQUIRE(rootCls == TestState::StaticClass());
+
+	return (TestState*) root;
+}
+
+
+BOOST_AUTO_TEST_CASE(SaveAndLoad)
+{
+	TestState* state = CreateState();
+
+	clock_t start = clock();
+	const std::vector<boost::uint8_t> data = SavePackage(state);
+	BOOST_TEST_MESSAGE("saved " << numObjects << " objects (" << data.size() << " bytes) in " << GetSeconds(start) << "s");
+
+	start = clock();
+	TestState* loaded = LoadPackage(data);
+	BOOST_TEST_MESSAGE("loaded them in " << GetSeconds(start) << "s");
+
+	CheckState(loaded);
+
+	// the package only depends on the state
+	BOOST_CHECK(SavePackage(loaded) == data);
+
+	delete loaded;
+	delete state;
+}
+
+BOOST_AUTO_TEST_CASE(StreamedCompression)
+{
+	TestState* state = CreateState();
+	const std::vector<boost::uint8_t> data = SavePackage(state);
+
+	for (int compress = 0; compress < 2; ++compress) {
+		std::ostringstream stream;
+		CSaveFileWriter writer(&stream, compress != 0);
+		creg::CChunkedBuffer buffer(64 * 1024, &writer);
+
+		const clock_t start = clock();
+		SavePackage(state, &buffer);
+		buffer.Flush();
+		BOOST_REQUIRE(writer.Finish());
+		BOOST_TEST_MESSAGE("saved with" << (compress? "": "out") << " compression (" << stream.str().size() << " bytes) in " << GetSeconds(start) << "s");
+
+		BOOST_REQUIRE_EQUAL(buffer.GetSize(), data.size());
+
+		const std::string& written = stream.str();
+		std::vector<boost::uint8_t> package(data.size());
+
+		if (compress) {
+			uLongf size = package.size();
+			BOOST_REQUIRE_EQUAL(uncompress(&package[0], &size, (const Bytef*) written.data(), written.size()), Z_OK);
+			BOOST_REQUIRE_EQUAL(size, package.size());
+		} else {
+			BOOST_REQUIRE_EQUAL(written.size(), package.size());
+			memcpy(&package[0], written.data(), written.size());
+		}
+
+		BOOST_CHECK(package == data);
+	}
+
+	delete state;
+}
+
+BOOST_AUTO_TEST_CASE(ChunkBoundaries)
+{
+	const boost::uint8_t bytes[] = {1, 2, 3, 4, 5, 6, 7};
+
+	creg::CChunkedBuffer buffer(4);
+
+	// empty writes with an empty, a full and a partially filled chunk
+	buffer.Write(bytes, 0);
+	buffer.Write(bytes, 4);
+	buffer.Write(bytes, 0);
+	buffer.Write(NULL, 0);
+	buffer.Write(bytes + 4, 3);
+	buffer.Write(bytes, 0);
+
+	BOOST_CHECK_EQUAL(buffer.GetSize(), sizeof(bytes));
+
+	std::vector<boost::uint8_t> data;
+	buffer.Release(data);
+
+	BOOST_CHECK(data == std::vector<boost::uint8_t>(bytes, bytes + sizeof(bytes)));
+}
+
+BOOST_AUTO_TEST_CASE(TruncatedPackage)
+{
+	TestState* state = CreateState();
+	std::vector<boost::uint8_t> data = SavePackage(state);
+	delete state;
+
+	creg::CInputStreamSerializer is;
+	void* root = NULL;
+	creg::Class* rootCls = NULL;
+
+	BOOST_CHECK_THROW(is.LoadPackage(&data[0], data.size() / 2, root, rootCls), std::runtime_error);
+}
@@ -228,6 +228,17 @@ void TrafficDump(CDemoReader& reader, bool trafficStats)
 				}
 				std::cout << std::endl;
 				break;
+			case NETMSG_AICOMMANDS_BATCH:
+				std::cout << "AICOMMANDS_BATCH: Playernum: " << (unsigned)buffer[3];
+				std::cout << " Length: " << (unsigned)packet->length;
+				cmdId = *((int*)(buffer + 4));
+				std::cout << " CommandId: " << GetCommandName(cmdId) << "(" << cmdId << ")";
+				std::cout << " Options: " << (unsigned)buffer[8];
+				std::cout << " Parameters: " << (unsigned)buffer[9];
+				std::cout << " Deltas: " << (unsigned)buffer[10 + buffer[9] * 4];
+				std::cout << " Units: " << *((unsigned short*)(buffer + 11 + buffer[9] * 4));
+				std::cout << std::endl;
+				break;
 			case NETMSG_PLAYERNAME:
 				std::cout << "PLAYERNAME: Playernum: " << (unsigned)buffer[2] << " Name: " << buffer+3 << std::endl;
 				break;